@@ -0,0 +1,367 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// gapir-bench replays an exported replay archive (see gapit export_replay)
+// against null renderers whose functions only pop their arguments, and
+// reports the execution speed of the replay VM. It needs no GPU and no GAPIS.
+
+#include "gapir/cc/archive_replay_service.h"
+#include "gapir/cc/cached_resource_loader.h"
+#include "gapir/cc/function_table.h"
+#include "gapir/cc/gles_gfx_api.h"
+#include "gapir/cc/interpreter.h"
+#include "gapir/cc/memory_manager.h"
+#include "gapir/cc/on_disk_resource_cache.h"
+#include "gapir/cc/replay_request.h"
+#include "gapir/cc/stack.h"
+#include "gapir/cc/vulkan_gfx_api.h"
+
+#include "core/cc/crash_handler.h"
+#include "core/cc/log.h"
+#include "core/cc/target.h"
+#include "core/cc/timer.h"
+
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if TARGET_OS == GAPID_OS_LINUX || TARGET_OS == GAPID_OS_OSX
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <vector>
+
+using namespace core;
+using namespace gapir;
+
+namespace {
+
+std::vector<uint32_t> memorySizes{
+    2 * 1024 * 1024 * 1024U,  // 2GB
+    1 * 1024 * 1024 * 1024U,  // 1GB
+    512 * 1024 * 1024U,       // 512MB
+    256 * 1024 * 1024U,       // 256MB
+};
+
+struct Options {
+  const char* replayArchive = nullptr;
+  int iterations = 10;
+  bool verify = true;
+  int logLevel = LOG_LEVEL_ERROR;
+  const char* logPath = "logs/gapir-bench.log";
+
+  static void PrintHelp() {
+    printf("gapir-bench: measures the replay VM speed on an exported replay\n");
+    printf("Usage: gapir-bench [args]\n");
+    printf("Args:\n");
+    printf("  --replay-archive string\n");
+    printf("    Path to an archive directory to replay\n");
+    printf("  --iterations int\n");
+    printf("    Number of times the replay is run (default 10)\n");
+    printf("  --no-verify\n");
+    printf("    Runs every instruction with the stack checks\n");
+    printf("  --log-level <F|E|W|I|D|V>\n");
+    printf("    Sets the log level for gapir-bench (default E)\n");
+    printf("  --log string\n");
+    printf("    Sets the path for the log file\n");
+  }
+
+  static Options Parse(int argc, const char* argv[]) {
+    Options opts;
+    for (int i = 1; i < argc; i++) {
+      if (strcmp(argv[i], "--replay-archive") == 0) {
+        if (i + 1 >= argc) {
+          GAPID_FATAL("Usage: --replay-archive <archive-directory>");
+        }
+        opts.replayArchive = argv[++i];
+      } else if (strcmp(argv[i], "--iterations") == 0) {
+        if (i + 1 >= argc || atoi(argv[i + 1]) <= 0) {
+          GAPID_FATAL("Usage: --iterations <count>");
+        }
+        opts.iterations = atoi(argv[++i]);
+      } else if (strcmp(argv[i], "--no-verify") == 0) {
+        opts.verify = false;
+      } else if (strcmp(argv[i], "--log-level") == 0) {
+        if (i + 1 >= argc) {
+          GAPID_FATAL("Usage: --log-level <F|E|W|I|D|V>");
+        }
+        switch (argv[++i][0]) {
+          case 'F':
+            opts.logLevel = LOG_LEVEL_FATAL;
+            break;
+          case 'E':
+            opts.logLevel = LOG_LEVEL_ERROR;
+            break;
+          case 'W':
+            opts.logLevel = LOG_LEVEL_WARNING;
+            break;
+          case 'I':
+            opts.logLevel = LOG_LEVEL_INFO;
+            break;
+          case 'D':
+            opts.logLevel = LOG_LEVEL_DEBUG;
+            break;
+          case 'V':
+            opts.logLevel = LOG_LEVEL_VERBOSE;
+            break;
+          default:
+            GAPID_FATAL("Usage: --log-level <F|E|W|I|D|V>");
+        }
+      } else if (strcmp(argv[i], "--log") == 0) {
+        if (i + 1 >= argc) {
+          GAPID_FATAL("Usage: --log <log-file-path>");
+        }
+        opts.logPath = argv[++i];
+      } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "-help") == 0 ||
+                 strcmp(argv[i], "--help") == 0) {
+        PrintHelp();
+        exit(EXIT_SUCCESS);
+      } else {
+        GAPID_FATAL("Unknown argument: %s", argv[i]);
+      }
+    }
+    return opts;
+  }
+};
+
+// Stats accumulates the measurements of all the benchmark iterations.
+struct Stats {
+  // Called before every function call made by the interpreter. The time
+  // between the first calls of two consecutive labels is recorded as a
+  // latency sample of the first label.
+  void onCall(uint32_t label) {
+    calls++;
+    if (label != currentLabel) {
+      uint64_t now = GetNanoseconds();
+      if (labelStart != 0) {
+        labelLatencies[currentLabel].push_back(now - labelStart);
+      }
+      currentLabel = label;
+      labelStart = now;
+    }
+  }
+
+  // Closes the latency measurement of the last label of an iteration.
+  void endIteration() {
+    if (labelStart != 0) {
+      labelLatencies[currentLabel].push_back(GetNanoseconds() - labelStart);
+    }
+    currentLabel = 0;
+    labelStart = 0;
+  }
+
+  // Returns the p-th (0..1) percentile of the latency samples.
+  static uint64_t percentile(std::vector<uint64_t>* samples, double p) {
+    if (samples->empty()) {
+      return 0;
+    }
+    std::sort(samples->begin(), samples->end());
+    return (*samples)[static_cast<size_t>(p * (samples->size() - 1))];
+  }
+
+  uint64_t calls = 0;
+  uint64_t resourceBytes = 0;
+  uint64_t postBytes = 0;
+  uint64_t runNanoseconds = 0;
+  // The latency samples of each label, one per iteration that reached it.
+  std::map<uint32_t, std::vector<uint64_t>> labelLatencies;
+
+ private:
+  uint32_t currentLabel = 0;
+  uint64_t labelStart = 0;
+};
+
+// Returns the peak resident set size of the process in bytes, or 0 if it is
+// not available on this platform.
+uint64_t peakMemory() {
+#if TARGET_OS == GAPID_OS_LINUX
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024;  // Reported in KB.
+#elif TARGET_OS == GAPID_OS_OSX
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<uint64_t>(usage.ru_maxrss);  // Reported in bytes.
+#else
+  return 0;
+#endif
+}
+
+// Measured is the context of a function wrapped by measured().
+struct Measured {
+  Stats* stats;
+  FunctionTable::Function func;
+
+  static bool call(void* context, uint32_t label, Stack* stack,
+                   bool pushReturn) {
+    auto measured = static_cast<Measured*>(context);
+    measured->stats->onCall(label);
+    return measured->func(nullptr, label, stack, pushReturn);
+  }
+};
+
+// Wraps func so that every call is accounted in stats. The returned closure
+// is used for the builtins that carry state.
+FunctionTable::Closure measured(Stats* stats, FunctionTable::Closure func) {
+  return [stats, func](uint32_t label, Stack* stack, bool pushReturn) {
+    stats->onCall(label);
+    return func(label, stack, pushReturn);
+  };
+}
+
+// Registers the null renderer functions of the API A on the interpreter. The
+// wrapper contexts are appended to contexts, which must outlive the
+// interpreter.
+template <typename A>
+void registerNullApi(Interpreter* interpreter, FunctionTable* functions,
+                     std::vector<std::unique_ptr<Measured>>* contexts,
+                     Stats* stats) {
+  A::forEachNullFunction([&](FunctionTable::Id id, bool builtin,
+                             FunctionTable::Function func) {
+    contexts->emplace_back(new Measured{stats, func});
+    void* context = contexts->back().get();
+    if (builtin) {
+      interpreter->registerBuiltin(A::INDEX, id, &Measured::call, context);
+    } else {
+      functions->insert(id, &Measured::call, context);
+    }
+  });
+  interpreter->setRendererFunctions(A::INDEX, functions);
+}
+
+// Runs the replay once. Returns false if the interpreter stopped with an
+// error.
+bool runOnce(CrashHandler& crashHandler, MemoryManager* memoryManager,
+             ReplayRequest* request, ResourceLoader* resourceLoader,
+             bool verify, Stats* stats) {
+  Interpreter interpreter(crashHandler, memoryManager,
+                          request->getStackSize());
+
+  interpreter.registerBuiltin(
+      Interpreter::GLOBAL_INDEX, Interpreter::POST_FUNCTION_ID,
+      measured(stats, [stats](uint32_t, Stack* stack, bool) {
+        const uint32_t count = stack->pop<uint32_t>();
+        stack->pop<const void*>();
+        stats->postBytes += count;
+        return stack->isValid();
+      }));
+  interpreter.registerBuiltin(
+      Interpreter::GLOBAL_INDEX, Interpreter::RESOURCE_FUNCTION_ID,
+      measured(stats, [stats, request, resourceLoader](uint32_t, Stack* stack,
+                                                       bool) {
+        uint32_t resourceId = stack->pop<uint32_t>();
+        void* address = stack->pop<void*>();
+        if (!stack->isValid()) {
+          return false;
+        }
+        const auto& resource = request->getResources()[resourceId];
+        if (!resourceLoader->load(&resource, 1, address, resource.size)) {
+          GAPID_WARNING("Can't load resource: %s", resource.id.c_str());
+          return false;
+        }
+        stats->resourceBytes += resource.size;
+        return true;
+      }));
+
+  std::vector<std::unique_ptr<Measured>> contexts;
+  FunctionTable gles;
+  FunctionTable vulkan;
+  registerNullApi<Gles>(&interpreter, &gles, &contexts, stats);
+  registerNullApi<Vulkan>(&interpreter, &vulkan, &contexts, stats);
+
+  auto instructions = request->getInstructionList();
+  uint64_t start = GetNanoseconds();
+  bool ok = interpreter.run(instructions.first, instructions.second,
+                            verify ? &request->getVerifiedBlocks() : nullptr);
+  stats->runNanoseconds += GetNanoseconds() - start;
+  stats->endIteration();
+  if (!ok) {
+    GAPID_ERROR("Replay stopped with an error at label %u",
+                interpreter.getLabel());
+  }
+  return ok;
+}
+
+}  // anonymous namespace
+
+int main(int argc, const char* argv[]) {
+  Options opts = Options::Parse(argc, argv);
+  if (opts.replayArchive == nullptr) {
+    Options::PrintHelp();
+    return EXIT_FAILURE;
+  }
+
+  CrashHandler crashHandler;
+  GAPID_LOGGER_INIT(opts.logLevel, "gapir-bench", opts.logPath);
+
+  MemoryManager memoryManager(memorySizes);
+  ArchiveReplayService replayArchive(opts.replayArchive, "");
+  auto onDiskCache = OnDiskResourceCache::create(opts.replayArchive, false);
+  std::unique_ptr<ResourceLoader> resLoader =
+      CachedResourceLoader::create(onDiskCache.get(), nullptr);
+
+  uint64_t loadStart = GetNanoseconds();
+  auto request = ReplayRequest::create(&replayArchive, "payload",
+                                       &memoryManager);
+  if (request == nullptr) {
+    GAPID_ERROR("Loading the replay archive failed");
+    return EXIT_FAILURE;
+  }
+  if (!memoryManager.setVolatileMemory(request->getVolatileMemorySize())) {
+    GAPID_ERROR("Setting the volatile memory size failed (size: %u)",
+                request->getVolatileMemorySize());
+    return EXIT_FAILURE;
+  }
+  uint64_t loadNanoseconds = GetNanoseconds() - loadStart;
+
+  Stats stats;
+  int failures = 0;
+  for (int i = 0; i < opts.iterations; i++) {
+    if (!runOnce(crashHandler, &memoryManager, request.get(),
+                 resLoader.get(), opts.verify, &stats)) {
+      failures++;
+    }
+  }
+
+  const double seconds = stats.runNanoseconds / 1e9;
+  const uint64_t opcodes =
+      static_cast<uint64_t>(request->getInstructionList().second) *
+      opts.iterations;
+  printf("iterations:          %d (%d failed)\n", opts.iterations, failures);
+  printf("load time:           %.3f ms\n", loadNanoseconds / 1e6);
+  printf("run time:            %.3f ms\n", stats.runNanoseconds / 1e6);
+  printf("opcodes/sec:         %.0f\n", opcodes / seconds);
+  printf("calls/sec:           %.0f\n", stats.calls / seconds);
+  printf("resource bytes/sec:  %.0f\n", stats.resourceBytes / seconds);
+  printf("post bytes/sec:      %.0f\n", stats.postBytes / seconds);
+  printf("peak memory:         %" PRIu64 " bytes\n", peakMemory());
+  printf("label latencies:\n");
+  printf("  %10s %10s %12s %12s\n", "label", "samples", "p50 (us)",
+         "p99 (us)");
+  for (auto& it : stats.labelLatencies) {
+    printf("  %10u %10zu %12.3f %12.3f\n", it.first, it.second.size(),
+           Stats::percentile(&it.second, 0.5) / 1e3,
+           Stats::percentile(&it.second, 0.99) / 1e3);
+  }
+
+  return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
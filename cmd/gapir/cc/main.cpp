@@ -670,12 +670,12 @@ std::unique_ptr<ResourceCache> createCache(
 }  // namespace
 
 static int replayArchive(Options opts) {
-  // The directory consists an archive(resources.{index,data}) and payload.bin.
+  // The directory consists an archive(resources.{index,data}) and
+  // payload.map or payload.bin.
   core::CrashHandler crashHandler;
   GAPID_LOGGER_INIT(opts.logLevel, "gapir", opts.logPath);
   MemoryManager memoryManager(memorySizes);
-  std::string payloadPath = std::string(opts.replayArchive) + "/payload.bin";
-  gapir::ArchiveReplayService replayArchive(payloadPath,
+  gapir::ArchiveReplayService replayArchive(opts.replayArchive,
                                             opts.postbackDirectory);
   // All the resource data must be in the archive file, no fallback resource
   // loader to fetch uncached resources data.
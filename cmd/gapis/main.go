@@ -42,6 +42,7 @@ import (
 	"github.com/google/gapid/gapis/server"
 	"github.com/google/gapid/gapis/service"
 	"github.com/google/gapid/gapis/service/path"
+	"github.com/google/gapid/gapis/shadertools"
 	"github.com/google/gapid/gapis/stringtable"
 	"github.com/google/gapid/gapis/trace"
 
@@ -62,6 +63,7 @@ var (
 	adbPath          = flag.String("adb", "", "Path to the adb executable; leave empty to search the environment")
 	enableLocalFiles = flag.Bool("enable-local-files", false, "Allow clients to access local .gfxtrace files by path")
 	remoteSSHConfig  = flag.String("ssh-config", "", "_Path to an ssh config file for remote devices")
+	shaderCacheDir   = flag.String("shader-cache", "", "_Directory in which to cache translated shaders across runs")
 )
 
 func main() {
@@ -97,6 +99,12 @@ func run(ctx context.Context) error {
 		adb.ADB = file.Abs(*adbPath)
 	}
 
+	if *shaderCacheDir != "" {
+		if err := shadertools.SetCacheDir(*shaderCacheDir); err != nil {
+			log.W(ctx, "Couldn't use the shader cache directory %v: %v", *shaderCacheDir, err)
+		}
+	}
+
 	r := bind.NewRegistry()
 	ctx = bind.PutRegistry(ctx, r)
 	m := replay.New(ctx)
@@ -896,6 +896,7 @@ func (verb *benchmarkVerb) doTrace(ctx context.Context, client client.Client, tr
 		RecordTraceTimes:          true,
 		ClearCache:                false,
 		ServerLocalSavePath:       out,
+		InternStrings:             verb.InternStrings,
 	}
 	options.App = &service.TraceOptions_Uri{
 		uri,
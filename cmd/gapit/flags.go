@@ -124,6 +124,7 @@ type (
 		OriginalDevice bool   `help:"export replay for the original device"`
 		Out            string `help:"output directory for commands and assets"`
 		OutputFrames   bool   `help:"generate trace that output frames(disable diagnostics)"`
+		MappedPayload  bool   `help:"write the payload in the format that gapir maps into memory"`
 		CommandFilterFlags
 		CaptureFileFlags
 	}
@@ -249,6 +250,9 @@ type (
 		No struct {
 			Buffer bool `help:"Do not buffer the output, this helps if the application crashes"`
 		}
+		Intern struct {
+			Strings bool `help:"share the memory of observed strings with the same contents"`
+		}
 		API   string `help:"only capture the given API valid options are gles and vulkan"`
 		Local struct {
 			Port int `help:"connect to an application already running on the server using this port"`
@@ -268,6 +272,7 @@ type (
 		StartFrame     int    `help:"perform a MEC trace starting at this frame"`
 		NoOpt          bool   `help:"disables optimization of the replay stream"`
 		OutputCSV      bool   `help:"outputs data in CSV-friendly format"`
+		InternStrings  bool   `help:"share the memory of observed strings with the same contents"`
 	}
 
 	StatusFlags struct {
@@ -205,6 +205,7 @@ func (verb *traceVerb) Run(ctx context.Context, flags flag.FlagSet) error {
 		ClearCache:                verb.Clear.Cache,
 		ServerLocalSavePath:       out,
 		PipeName:                  verb.PipeName,
+		InternStrings:             verb.Intern.Strings,
 	}
 	target(options)
 
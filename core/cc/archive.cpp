@@ -240,6 +240,11 @@ bool Archive::contains(const std::string& id) const {
   return mRecords.find(id) != mRecords.end();
 }
 
+uint32_t Archive::size(const std::string& id) const {
+  const auto r = mRecords.find(id);
+  return r != mRecords.end() ? r->second.size : 0;
+}
+
 bool Archive::read(const std::string& id, void* buffer, uint32_t size) {
   const auto r = mRecords.find(id);
   if (r == mRecords.end() || r->second.size != size) return false;
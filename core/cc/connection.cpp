@@ -21,6 +21,30 @@
 
 namespace core {
 
+size_t Connection::sendv(const ConstBuffer* buffers, size_t count) {
+  size_t total = 0;
+  for (size_t i = 0; i < count; i++) {
+    size_t sent = this->send(buffers[i].data, buffers[i].size);
+    total += sent;
+    if (sent != buffers[i].size) {
+      break;
+    }
+  }
+  return total;
+}
+
+size_t Connection::recvv(const Buffer* buffers, size_t count) {
+  size_t total = 0;
+  for (size_t i = 0; i < count; i++) {
+    size_t received = this->recv(buffers[i].data, buffers[i].size);
+    total += received;
+    if (received != buffers[i].size) {
+      break;
+    }
+  }
+  return total;
+}
+
 bool Connection::sendString(const std::string& s) {
   const uint32_t length = static_cast<uint32_t>(s.size()) + 1;
   return this->send(s.c_str(), length) == length;
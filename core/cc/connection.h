@@ -31,6 +31,18 @@ class Connection {
   // block with no timeouts until a connection is made, or the socket closes.
   static const int NO_TIMEOUT = -1;
 
+  // ConstBuffer is one of the buffers sent by sendv.
+  struct ConstBuffer {
+    const void* data;
+    size_t size;
+  };
+
+  // Buffer is one of the buffers filled by recvv.
+  struct Buffer {
+    void* data;
+    size_t size;
+  };
+
   virtual ~Connection() {}
 
   // Try to send size bytes of data from the specified buffer using the
@@ -45,6 +57,17 @@ class Connection {
   // occurred).
   virtual size_t recv(void* data, size_t size) = 0;
 
+  // Sends the count buffers one after the other, as a single send of their
+  // concatenation would. Returns the total number of bytes successfully sent.
+  // The default implementation calls send for each buffer.
+  virtual size_t sendv(const ConstBuffer* buffers, size_t count);
+
+  // Fills the count buffers one after the other with the next bytes received,
+  // blocking until all of them are full. Returns the total number of bytes
+  // successfully retrieved. The default implementation calls recv for each
+  // buffer.
+  virtual size_t recvv(const Buffer* buffers, size_t count);
+
   // Returns the last error message raised by the connection.
   virtual const char* error() = 0;
 
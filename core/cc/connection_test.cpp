@@ -97,5 +97,36 @@ TEST_F(ConnectionTest, ReadStringError) {
   EXPECT_FALSE(mConnection->readString(&s));
 }
 
+TEST_F(ConnectionTest, Sendv) {
+  const Connection::ConstBuffer buffers[] = {{"AB", 2}, {"", 0}, {"CDE", 3}};
+  EXPECT_EQ(5u, mConnection->sendv(buffers, 3));
+  EXPECT_THAT(mConnection->out, ElementsAre('A', 'B', 'C', 'D', 'E'));
+}
+
+TEST_F(ConnectionTest, SendvError) {
+  mConnection->out_limit = 3;
+  const Connection::ConstBuffer buffers[] = {{"AB", 2}, {"CD", 2}, {"E", 1}};
+  EXPECT_EQ(3u, mConnection->sendv(buffers, 3));
+  EXPECT_THAT(mConnection->out, ElementsAre('A', 'B', 'C'));
+}
+
+TEST_F(ConnectionTest, Recvv) {
+  pushBytes(&mConnection->in, {'A', 'B', 'C', 'D', 'E'});
+  char first[2];
+  char second[3];
+  const Connection::Buffer buffers[] = {{first, 2}, {second, 3}};
+  EXPECT_EQ(5u, mConnection->recvv(buffers, 2));
+  EXPECT_EQ("AB", std::string(first, 2));
+  EXPECT_EQ("CDE", std::string(second, 3));
+}
+
+TEST_F(ConnectionTest, RecvvError) {
+  pushBytes(&mConnection->in, {'A', 'B', 'C'});
+  char first[2];
+  char second[3];
+  const Connection::Buffer buffers[] = {{first, 2}, {second, 3}};
+  EXPECT_EQ(3u, mConnection->recvv(buffers, 2));
+}
+
 }  // namespace test
 }  // namespace core
@@ -38,6 +38,9 @@ bool CrashHandler::handleMinidump(const std::string& minidumpPath,
   for (const auto& it : mHandlers) {
     it.second(minidumpPath, succeeded);
   }
+  // Write out the messages that were logged before the crash, as the process
+  // will not live long enough for the logger to write them out.
+  GAPID_LOGGER_FLUSH();
   return succeeded;
 }
 
@@ -0,0 +1,362 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hasher.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#if defined(__x86_64__) && !defined(_MSC_VER)
+#define HASHER_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__)
+#define HASHER_NEON 1
+#include <arm_neon.h>
+#endif
+
+// The stripe accumulation and scrambling follow XXH3, with its primes but
+// with a key of our own.
+
+namespace {
+
+const uint32_t kPrime32_1 = 0x9E3779B1U;
+const uint32_t kPrime32_2 = 0x85EBCA77U;
+const uint32_t kPrime32_3 = 0xC2B2AE3DU;
+const uint64_t kPrime64_1 = 0x9E3779B185EBCA87ULL;
+const uint64_t kPrime64_2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t kPrime64_3 = 0x165667B19E3779F9ULL;
+const uint64_t kPrime64_4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t kPrime64_5 = 0x27D4EB2F165667C5ULL;
+
+const size_t kKeySize = 192;
+// The offset of the key used to scramble the accumulators.
+const size_t kScrambleKey = kKeySize - 64;
+
+inline uint64_t read64(const uint8_t* p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+// key returns the kKeySize bytes of key, generated with SplitMix64.
+const uint8_t* key() {
+  struct Key {
+    Key() {
+      uint64_t state = kPrime64_1;
+      for (size_t i = 0; i < kKeySize; i += 8) {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        z ^= z >> 31;
+        memcpy(&data[i], &z, sizeof(z));
+      }
+    }
+    uint8_t data[kKeySize];
+  };
+  static const Key k;
+  return k.data;
+}
+
+// fold returns the xor of the low and high 64 bits of the product of a and b.
+inline uint64_t fold(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+  auto p = static_cast<unsigned __int128>(a) * b;
+  return static_cast<uint64_t>(p) ^ static_cast<uint64_t>(p >> 64);
+#else
+  uint64_t aLo = a & 0xffffffff, aHi = a >> 32;
+  uint64_t bLo = b & 0xffffffff, bHi = b >> 32;
+  uint64_t lolo = aLo * bLo;
+  uint64_t hilo = aHi * bLo;
+  uint64_t lohi = aLo * bHi;
+  uint64_t hihi = aHi * bHi;
+  uint64_t cross = (lolo >> 32) + (hilo & 0xffffffff) + lohi;
+  uint64_t hi = (hilo >> 32) + (cross >> 32) + hihi;
+  uint64_t lo = (cross << 32) | (lolo & 0xffffffff);
+  return lo ^ hi;
+#endif
+}
+
+inline uint64_t avalanche(uint64_t h) {
+  h ^= h >> 37;
+  h *= kPrime64_3;
+  h ^= h >> 32;
+  return h;
+}
+
+core::Id makeId(uint64_t lo, uint64_t hi, uint64_t size) {
+  core::Id id;
+  memcpy(&id.data[0], &lo, 8);
+  memcpy(&id.data[8], &hi, 8);
+  auto len = static_cast<uint32_t>(size);
+  memcpy(&id.data[16], &len, 4);
+  return id;
+}
+
+// readPartial returns the n bytes at p, 0 < n <= 8, packed into 64 bits. For
+// a given n, the result covers all of the bytes.
+inline uint64_t readPartial(const uint8_t* p, uint64_t n) {
+  if (n >= 4) {
+    uint32_t a, b;
+    memcpy(&a, p, 4);
+    memcpy(&b, p + n - 4, 4);
+    return a | static_cast<uint64_t>(b) << 32;
+  }
+  return p[0] | static_cast<uint64_t>(p[n >> 1]) << 8 |
+         static_cast<uint64_t>(p[n - 1]) << 16;
+}
+
+// mixShort mixes the 16 bytes a and b into lo and hi, using the 32 bytes of
+// key.
+inline void mixShort(uint64_t a, uint64_t b, const uint8_t* k, uint64_t* lo,
+                     uint64_t* hi) {
+  *lo += fold(a ^ read64(k), b ^ read64(k + 8));
+  *hi += fold(b ^ read64(k + 16), a ^ read64(k + 24));
+}
+
+// hashShort returns the Id of size bytes of data, less than a stripe.
+core::Id hashShort(const uint8_t* data, uint64_t size) {
+  auto k = key();
+  uint64_t lo = size * kPrime64_1;
+  uint64_t hi = ~(size * kPrime64_2);
+  uint64_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    mixShort(read64(data + i), read64(data + i + 8), k + 2 * i, &lo, &hi);
+  }
+  auto left = size - i;
+  if (left > 8) {
+    mixShort(read64(data + i), readPartial(data + i + 8, left - 8), k + 2 * i,
+             &lo, &hi);
+  } else if (left > 0) {
+    mixShort(readPartial(data + i, left), 0, k + 2 * i, &lo, &hi);
+  }
+  lo = avalanche(lo);
+  return makeId(lo, avalanche(hi + lo), size);
+}
+
+void accumulateScalar(uint64_t* acc, const uint8_t* data, size_t count,
+                      const uint8_t* key) {
+  for (size_t s = 0; s < count; s++, data += 64, key += 8) {
+    for (int i = 0; i < 8; i++) {
+      auto d = read64(data + 8 * i);
+      auto k = d ^ read64(key + 8 * i);
+      acc[i ^ 1] += d;
+      acc[i] += (k & 0xffffffff) * (k >> 32);
+    }
+  }
+}
+
+void scrambleScalar(uint64_t* acc, const uint8_t* key) {
+  for (int i = 0; i < 8; i++) {
+    auto a = acc[i];
+    a ^= a >> 47;
+    a ^= read64(key + 8 * i);
+    acc[i] = a * kPrime32_1;
+  }
+}
+
+const core::Hasher::Backend kScalar = {"scalar", accumulateScalar,
+                                       scrambleScalar};
+
+#if HASHER_AVX2
+
+__attribute__((target("avx2"))) void accumulateAVX2(uint64_t* acc,
+                                                    const uint8_t* data,
+                                                    size_t count,
+                                                    const uint8_t* key) {
+  auto acc0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc));
+  auto acc1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + 4));
+  for (size_t s = 0; s < count; s++, data += 64, key += 8) {
+    auto d0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    auto d1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 32));
+    auto k0 = _mm256_xor_si256(
+        d0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(key)));
+    auto k1 = _mm256_xor_si256(
+        d1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(key + 32)));
+    // Multiply the low and high 32 bits of each 64-bit lane.
+    auto p0 = _mm256_mul_epu32(k0, _mm256_shuffle_epi32(k0, 0x31));
+    auto p1 = _mm256_mul_epu32(k1, _mm256_shuffle_epi32(k1, 0x31));
+    // Swap the 64-bit lanes of each pair.
+    acc0 = _mm256_add_epi64(acc0, _mm256_shuffle_epi32(d0, 0x4e));
+    acc1 = _mm256_add_epi64(acc1, _mm256_shuffle_epi32(d1, 0x4e));
+    acc0 = _mm256_add_epi64(acc0, p0);
+    acc1 = _mm256_add_epi64(acc1, p1);
+  }
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc), acc0);
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + 4), acc1);
+}
+
+__attribute__((target("avx2"))) void scrambleAVX2(uint64_t* acc,
+                                                  const uint8_t* key) {
+  auto prime = _mm256_set1_epi32(kPrime32_1);
+  for (int i = 0; i < 8; i += 4) {
+    auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + i));
+    auto k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(key + 8 * i));
+    a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+    a = _mm256_xor_si256(a, k);
+    auto lo = _mm256_mul_epu32(a, prime);
+    auto hi = _mm256_mul_epu32(_mm256_shuffle_epi32(a, 0x31), prime);
+    a = _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + i), a);
+  }
+}
+
+const core::Hasher::Backend kAVX2 = {"avx2", accumulateAVX2, scrambleAVX2};
+
+#endif  // HASHER_AVX2
+
+#if HASHER_NEON
+
+void accumulateNEON(uint64_t* acc, const uint8_t* data, size_t count,
+                    const uint8_t* key) {
+  uint64x2_t a[4];
+  for (int i = 0; i < 4; i++) {
+    a[i] = vld1q_u64(acc + 2 * i);
+  }
+  for (size_t s = 0; s < count; s++, data += 64, key += 8) {
+    for (int i = 0; i < 4; i++) {
+      auto d = vreinterpretq_u64_u8(vld1q_u8(data + 16 * i));
+      auto k = veorq_u64(d, vreinterpretq_u64_u8(vld1q_u8(key + 16 * i)));
+      auto p = vmull_u32(vmovn_u64(k), vshrn_n_u64(k, 32));
+      a[i] = vaddq_u64(a[i], vextq_u64(d, d, 1));
+      a[i] = vaddq_u64(a[i], p);
+    }
+  }
+  for (int i = 0; i < 4; i++) {
+    vst1q_u64(acc + 2 * i, a[i]);
+  }
+}
+
+void scrambleNEON(uint64_t* acc, const uint8_t* key) {
+  auto prime = vdup_n_u32(kPrime32_1);
+  for (int i = 0; i < 4; i++) {
+    auto a = vld1q_u64(acc + 2 * i);
+    auto k = vreinterpretq_u64_u8(vld1q_u8(key + 16 * i));
+    a = veorq_u64(a, vshrq_n_u64(a, 47));
+    a = veorq_u64(a, k);
+    auto lo = vmull_u32(vmovn_u64(a), prime);
+    auto hi = vmull_u32(vshrn_n_u64(a, 32), prime);
+    vst1q_u64(acc + 2 * i, vaddq_u64(lo, vshlq_n_u64(hi, 32)));
+  }
+}
+
+const core::Hasher::Backend kNEON = {"neon", accumulateNEON, scrambleNEON};
+
+#endif  // HASHER_NEON
+
+}  // anonymous namespace
+
+namespace core {
+
+const std::vector<const Hasher::Backend*>& Hasher::backends() {
+  static const std::vector<const Backend*> list = [] {
+    std::vector<const Backend*> out{&kScalar};
+#if HASHER_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+      out.push_back(&kAVX2);
+    }
+#endif
+#if HASHER_NEON
+    out.push_back(&kNEON);
+#endif
+    return out;
+  }();
+  return list;
+}
+
+Id Hasher::Hash(const void* ptr, uint64_t size) {
+  if (size < kStripeSize) {
+    return hashShort(static_cast<const uint8_t*>(ptr), size);
+  }
+  Hasher hasher;
+  hasher.update(ptr, size);
+  return hasher.id();
+}
+
+Hasher::Hasher(const Backend* backend)
+    : mBackend(backend != nullptr ? backend : backends().back()),
+      mAcc{kPrime32_3, kPrime64_1, kPrime64_2, kPrime64_3,
+           kPrime64_4, kPrime32_2, kPrime64_5, kPrime32_1},
+      mSize(0),
+      mStripe(0),
+      mBuffered(0) {
+  memset(mBuffer, 0, sizeof(mBuffer));
+}
+
+void Hasher::update(const void* ptr, uint64_t size) {
+  auto data = static_cast<const uint8_t*>(ptr);
+  mSize += size;
+  if (mBuffered > 0) {
+    auto n = static_cast<uint32_t>(
+        std::min<uint64_t>(size, kStripeSize - mBuffered));
+    memcpy(mBuffer + mBuffered, data, n);
+    mBuffered += n;
+    data += n;
+    size -= n;
+    if (mBuffered < kStripeSize) {
+      return;
+    }
+    consume(mBuffer, 1);
+    mBuffered = 0;
+  }
+  auto stripes = size / kStripeSize;
+  consume(data, stripes);
+  data += stripes * kStripeSize;
+  size -= stripes * kStripeSize;
+  memcpy(mBuffer, data, size);
+  mBuffered = static_cast<uint32_t>(size);
+}
+
+void Hasher::consume(const uint8_t* data, size_t count) {
+  while (count > 0) {
+    auto n = std::min<size_t>(count, kStripesPerBlock - mStripe);
+    mBackend->accumulate(mAcc, data, n, key() + 8 * mStripe);
+    data += n * kStripeSize;
+    count -= n;
+    mStripe += n;
+    if (mStripe == kStripesPerBlock) {
+      mBackend->scramble(mAcc, key() + kScrambleKey);
+      mStripe = 0;
+    }
+  }
+}
+
+Id Hasher::id() const {
+  if (mSize < kStripeSize) {
+    return hashShort(mBuffer, mSize);
+  }
+  auto k = key();
+  uint64_t lo = mSize * kPrime64_1;
+  uint64_t hi = ~(mSize * kPrime64_2);
+  uint64_t acc[8];
+  memcpy(acc, mAcc, sizeof(acc));
+  if (mBuffered > 0) {
+    uint8_t last[kStripeSize] = {};
+    memcpy(last, mBuffer, mBuffered);
+    mBackend->accumulate(acc, last, 1, k + 8 * mStripe);
+  }
+  for (int i = 0; i < 4; i++) {
+    lo += fold(acc[2 * i] ^ read64(k + 11 + 16 * i),
+               acc[2 * i + 1] ^ read64(k + 19 + 16 * i));
+    hi += fold(acc[2 * i] ^ read64(k + 117 + 16 * i),
+               acc[2 * i + 1] ^ read64(k + 125 + 16 * i));
+  }
+  return makeId(avalanche(lo), avalanche(hi), mSize);
+}
+
+}  // namespace core
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CORE_HASHER_H
+#define CORE_HASHER_H
+
+#include "id.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace core {
+
+// Hasher computes the Id of data that may be given in several chunks, so that
+// large observations can be hashed without first copying them into a single
+// buffer. The Id holds a 128-bit hash followed by the low 32 bits of the data
+// size, like Id::Hash, and does not depend on how the data is split into
+// chunks.
+//
+// The hash is not the CityHash128 of Id::Hash: it accumulates the data in
+// 64-byte stripes that are hashed with SIMD instructions where the CPU supports
+// them. The Ids are only meant to be compared with other Ids computed by a
+// Hasher in the same process. Use Id::Hash for Ids that are stored or compared
+// with known values.
+class Hasher {
+ public:
+  // Backend is an implementation of the stripe hashing. All the backends
+  // compute the same hashes.
+  struct Backend {
+    // The name of the backend, as reported by the benchmarks.
+    const char* name;
+
+    // accumulate mixes count 64-byte stripes of data into the 8 accumulators.
+    // Each stripe is mixed with a key 8 bytes further along key than the key of
+    // the previous stripe.
+    void (*accumulate)(uint64_t* acc, const uint8_t* data, size_t count,
+                       const uint8_t* key);
+
+    // scramble mixes the 8 accumulators with the 64-byte key.
+    void (*scramble)(uint64_t* acc, const uint8_t* key);
+  };
+
+  // backends returns the backends supported by this CPU, from the slowest to
+  // the fastest.
+  static const std::vector<const Backend*>& backends();
+
+  // Hash returns the Id of the size bytes at ptr.
+  static Id Hash(const void* ptr, uint64_t size);
+
+  // Constructs a Hasher using backend, or the fastest backend if nullptr.
+  Hasher(const Backend* backend = nullptr);
+
+  // update hashes the next size bytes at ptr.
+  void update(const void* ptr, uint64_t size);
+
+  // id returns the Id of all the data given to update().
+  Id id() const;
+
+ private:
+  // The number of stripes accumulated between scrambles.
+  static const uint32_t kStripesPerBlock = 16;
+  static const uint32_t kStripeSize = 64;
+
+  // consume accumulates count stripes of data.
+  void consume(const uint8_t* data, size_t count);
+
+  const Backend* mBackend;
+  uint64_t mAcc[8];
+  uint64_t mSize;
+  uint32_t mStripe;  // The index of the next stripe in its block.
+  uint32_t mBuffered;
+  uint8_t mBuffer[kStripeSize];
+};
+
+}  // namespace core
+
+#endif  // CORE_HASHER_H
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// hash-bench reports the throughput of Id::Hash, Hasher::Hash and of each
+// Hasher backend for a range of input sizes.
+
+#include "hasher.h"
+#include "id.h"
+#include "timer.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+// The number of bytes hashed for each measurement.
+const uint64_t kBytesPerRun = 256 << 20;
+
+const uint64_t kSizes[] = {4,    16,    64,      256,     1024,
+                           4096, 65536, 1 << 20, 16 << 20};
+
+template <typename F>
+double measure(uint64_t size, F&& hash) {
+  auto runs = std::max<uint64_t>(kBytesPerRun / size, 1);
+  uint8_t sink = 0;
+  auto start = core::GetNanoseconds();
+  for (uint64_t i = 0; i < runs; i++) {
+    sink ^= hash().data[0];
+  }
+  auto elapsed = core::GetNanoseconds() - start;
+  // Keep the hashes from being optimized away.
+  if (sink == 0x100) {
+    printf("\n");
+  }
+  return static_cast<double>(runs * size) / elapsed;  // bytes/ns == GB/s
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  std::vector<uint8_t> data(kSizes[sizeof(kSizes) / sizeof(kSizes[0]) - 1]);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = static_cast<uint8_t>(i * 0x9E3779B1U >> 24);
+  }
+
+  const auto& backends = core::Hasher::backends();
+  printf("%10s %12s %12s", "size", "Id::Hash", "Hasher::Hash");
+  for (auto backend : backends) {
+    printf(" %12s", backend->name);
+  }
+  printf("  (GB/s)\n");
+
+  for (auto size : kSizes) {
+    printf("%10llu", static_cast<unsigned long long>(size));
+    printf(" %12.2f",
+           measure(size, [&] { return core::Id::Hash(data.data(), size); }));
+    printf(" %12.2f", measure(size, [&] {
+             return core::Hasher::Hash(data.data(), size);
+           }));
+    for (auto backend : backends) {
+      printf(" %12.2f", measure(size, [&] {
+               core::Hasher hasher(backend);
+               hasher.update(data.data(), size);
+               return hasher.id();
+             }));
+    }
+    printf("\n");
+  }
+  return 0;
+}
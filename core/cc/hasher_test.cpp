@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hasher.h"
+
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <algorithm>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+namespace core {
+namespace test {
+
+std::vector<uint8_t> randomData(size_t size, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::vector<uint8_t> data(size);
+  for (auto& b : data) {
+    b = static_cast<uint8_t>(rng());
+  }
+  return data;
+}
+
+// Sizes around the stripe and block boundaries.
+const size_t kSizes[] = {0,   1,   15,   16,   17,   63,   64,   65,  127,
+                         128, 200, 1023, 1024, 1025, 1087, 4096, 5000};
+
+TEST(HasherTest, ChunksMatchOneShot) {
+  std::mt19937 rng(1);
+  for (auto size : kSizes) {
+    auto data = randomData(size, size);
+    auto expected = Hasher::Hash(data.data(), data.size());
+    for (int i = 0; i < 10; i++) {
+      Hasher hasher;
+      size_t offset = 0;
+      while (offset < size) {
+        size_t n = std::min<size_t>(size - offset, rng() % 130);
+        hasher.update(data.data() + offset, n);
+        offset += n;
+      }
+      EXPECT_TRUE(hasher.id() == expected) << "size: " << size;
+    }
+  }
+}
+
+TEST(HasherTest, BackendsMatch) {
+  for (auto size : kSizes) {
+    auto data = randomData(size, size);
+    auto expected = Hasher::Hash(data.data(), data.size());
+    for (auto backend : Hasher::backends()) {
+      Hasher hasher(backend);
+      hasher.update(data.data(), data.size());
+      EXPECT_TRUE(hasher.id() == expected)
+          << backend->name << ", size: " << size;
+    }
+  }
+}
+
+TEST(HasherTest, Size) {
+  uint8_t data[100] = {};
+  auto id = Hasher::Hash(data, sizeof(data));
+  uint32_t size;
+  memcpy(&size, &id.data[16], sizeof(size));
+  EXPECT_EQ(100u, size);
+  // Zeros of different sizes have different hashes.
+  EXPECT_FALSE(Hasher::Hash(data, 99) == id);
+  EXPECT_FALSE(Hasher::Hash(data, 0) == Hasher::Hash(data, 1));
+}
+
+TEST(HasherTest, Distinct) {
+  // Ids of data that differs by a single bit, or by the order of its
+  // stripes, are all distinct.
+  auto data = randomData(2048, 2);
+  std::unordered_set<Id> ids;
+  ids.insert(Hasher::Hash(data.data(), data.size()));
+  for (size_t bit = 0; bit < data.size() * 8; bit += 7) {
+    data[bit / 8] ^= 1 << (bit % 8);
+    ids.insert(Hasher::Hash(data.data(), data.size()));
+    data[bit / 8] ^= 1 << (bit % 8);
+  }
+  std::swap_ranges(data.begin(), data.begin() + 64, data.begin() + 64);
+  ids.insert(Hasher::Hash(data.data(), data.size()));
+  EXPECT_EQ(2 + (data.size() * 8 + 6) / 7, ids.size());
+}
+
+}  // namespace test
+}  // namespace core
@@ -26,6 +26,8 @@ namespace core {
 // Id is a 20-byte unique identifier.
 struct Id {
   // Construct an Id with the hash of the given memory address.
+  // The hash is the CityHash128 of the data, and is stable across processes.
+  // See core::Hasher for a faster hash of data only compared in-process.
   static Id Hash(const void* ptr, uint64_t size);
 
   bool operator==(const Id& rhs) const;
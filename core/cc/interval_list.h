@@ -21,6 +21,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <utility>
 #include <vector>
 
 #include "core/cc/target.h"
@@ -83,6 +84,17 @@ class CustomIntervalList {
   // merge adds the interval i to this list, merging any overlapping intervals.
   inline void merge(const T& i);
 
+  // mergeAll adds all the intervals to this list, merging any overlapping
+  // intervals as merge() would. Unlike calling merge() for each interval,
+  // which moves the intervals following the merged one each time, the
+  // intervals are sorted and swept together with the list once, in
+  // O((n + m) log(n + m)) for m intervals added to n intervals.
+  // combine(T& merged, const T& other) is called for each interval merged
+  // into another, so that custom interval types can combine their fields.
+  template <typename F>
+  inline void mergeAll(std::vector<T> intervals, F&& combine);
+  inline void mergeAll(std::vector<T> intervals);
+
   // setMergeThreshold sets the edge-distance threshold for merging intervals
   // when calling merge(). Intervals will merge if: edge-distance < threshold.
   // Examples:
@@ -215,6 +227,44 @@ inline void CustomIntervalList<T>::merge(const T& i) {
   }
 }
 
+template <typename T>
+template <typename F>
+inline void CustomIntervalList<T>::mergeAll(std::vector<T> intervals,
+                                            F&& combine) {
+  // Added intervals with the same start are kept in the order they were
+  // given, and follow the intervals of the list with the same start.
+  std::stable_sort(intervals.begin(), intervals.end(),
+                   [](const T& a, const T& b) { return a.start() < b.start(); });
+  std::vector<T> merged;
+  merged.reserve(mIntervals.size() + intervals.size());
+  // Intervals of the list are only merged together by an added interval.
+  bool lastHoldsAdded = false;
+  auto listIt = mIntervals.begin();
+  auto addedIt = intervals.begin();
+  while (listIt != mIntervals.end() || addedIt != intervals.end()) {
+    bool added = listIt == mIntervals.end() ||
+                 (addedIt != intervals.end() &&
+                  addedIt->start() < listIt->start());
+    const T& i = added ? *addedIt++ : *listIt++;
+    if (!merged.empty() && (added || lastHoldsAdded) &&
+        merged.back().end() + mMergeBias >= i.start()) {
+      T& last = merged.back();
+      combine(last, i);
+      last.adjust(last.start(), std::max(last.end(), i.end()));
+      lastHoldsAdded = true;
+    } else {
+      merged.push_back(i);
+      lastHoldsAdded = added;
+    }
+  }
+  mIntervals.swap(merged);
+}
+
+template <typename T>
+inline void CustomIntervalList<T>::mergeAll(std::vector<T> intervals) {
+  mergeAll(std::move(intervals), [](T&, const T&) {});
+}
+
 template <typename T>
 inline void CustomIntervalList<T>::setMergeThreshold(
     interval_unit_type threshold) {
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// interval-list-bench reports the time taken to merge random ranges into an
+// IntervalList one at a time with merge(), and all at once with mergeAll().
+
+#include "interval_list.h"
+#include "timer.h"
+
+#include <stdio.h>
+
+#include <random>
+#include <vector>
+
+namespace {
+
+const int kRanges = 1000000;
+
+// Merging ranges one at a time moves the ranges following each merged one, so
+// only the first kOnlineRanges are merged with merge().
+const int kOnlineRanges = 50000;
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  std::mt19937 rng(1);
+  std::vector<core::Interval<uint64_t>> intervals;
+  intervals.reserve(kRanges);
+  for (int i = 0; i < kRanges; i++) {
+    uint64_t start = (uint64_t(rng()) << 8) + (rng() % 256);
+    intervals.push_back(
+        core::Interval<uint64_t>{start, start + 1 + rng() % 256});
+  }
+
+  auto start = core::GetNanoseconds();
+  core::IntervalList<uint64_t> online;
+  for (int i = 0; i < kOnlineRanges; i++) {
+    online.merge(intervals[i]);
+  }
+  auto mergeTime = core::GetNanoseconds() - start;
+
+  start = core::GetNanoseconds();
+  core::IntervalList<uint64_t> batched;
+  batched.mergeAll({intervals.begin(), intervals.begin() + kOnlineRanges});
+  auto mergeAllTime = core::GetNanoseconds() - start;
+
+  start = core::GetNanoseconds();
+  core::IntervalList<uint64_t> all;
+  all.mergeAll(intervals);
+  auto mergeAllRangesTime = core::GetNanoseconds() - start;
+
+  printf("%d ranges: merge %.1f ms, mergeAll %.1f ms (%u intervals)\n",
+         kOnlineRanges, mergeTime / 1e6, mergeAllTime / 1e6,
+         static_cast<unsigned>(batched.count()));
+  printf("%d ranges: mergeAll %.1f ms (%u intervals)\n", kRanges,
+         mergeAllRangesTime / 1e6, static_cast<unsigned>(all.count()));
+  return 0;
+}
@@ -19,6 +19,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <random>
+
 using ::testing::ElementsAre;
 using ::testing::ElementsAreArray;
 using ::testing::Eq;
@@ -362,6 +364,73 @@ TEST_F(IntervalListTest, MergeThreshold4) {
   }
 }
 
+TEST_F(IntervalListTest, MergeAll) {
+  struct test {
+    const char* name;
+    std::vector<Interval<int>> intervals;
+    std::vector<Interval<int>> expected;
+  };
+  for (auto t : {
+           test{"none", {}, {I(0x2, 0x4), I(0x8, 0x9), I(0xb, 0xc)}},
+           test{"a", {a}, {I(0x0, 0x0), I(0x2, 0x4), I(0x8, 0x9), I(0xb, 0xc)}},
+           test{"b", {b}, {I(0x1, 0x4), I(0x8, 0x9), I(0xb, 0xc)}},
+           test{"f", {f}, {I(0x2, 0x4), I(0x8, 0xc)}},
+           test{"h", {h}, {I(0x2, 0x4), I(0x8, 0x9), I(0xb, 0xc), I(0xe, 0xe)}},
+           test{"k", {k}, {I(0x0, 0xe)}},
+           test{"h,a,d", {h, a, d}, {I(0x0, 0x0), I(0x2, 0x5), I(0x8, 0x9),
+                                     I(0xb, 0xc), I(0xe, 0xe)}},
+           test{"e,c,g", {e, c, g}, {I(0x2, 0x4), I(0x7, 0x9), I(0xb, 0xd)}},
+           test{"a,b,c,d,e", {a, b, c, d, e}, {I(0x0, 0x5), I(0x7, 0x9),
+                                               I(0xb, 0xc)}},
+           test{"j,i", {j, i}, {I(0x1, 0x5), I(0x8, 0xc)}},
+           test{"h,g,f", {h, g, f}, {I(0x2, 0x4), I(0x8, 0xe)}},
+       }) {
+    clear();
+    merge(I(0x2, 0x4));  // 0
+    merge(I(0x8, 0x9));  // 1
+    merge(I(0xb, 0xc));  // 2
+
+    mergeAll(t.intervals);
+
+    EXPECT_THAT(L(), ElementsAreArray(t.expected)) << t.name;
+  }
+}
+
+TEST_F(IntervalListTest, MergeAllMatchesMerge) {
+  std::mt19937 rng(1);
+  std::vector<Interval<int>> intervals;
+  IntervalList<int> expected;
+  for (int i = 0; i < 1000; i++) {
+    int start = rng() % 10000;
+    auto interval = I(start, start + rng() % 16);
+    intervals.push_back(interval);
+    expected.merge(interval);
+  }
+  merge(I(0x10, 0x20));
+  merge(I(0x100, 0x200));
+  expected.merge(I(0x10, 0x20));
+  expected.merge(I(0x100, 0x200));
+
+  mergeAll(intervals);
+
+  EXPECT_THAT(L(), ElementsAreArray(expected.begin(), expected.end()));
+}
+
+TEST_F(IntervalListTest, MergeAllCombine) {
+  merge(I(0x2, 0x4));
+  merge(I(0x8, 0x9));
+
+  int combined = 0;
+  mergeAll({I(0x3, 0x3), I(0x5, 0x7), I(0xb, 0xc)},
+           [&](Interval<int>& merged, const Interval<int>& other) {
+             EXPECT_LE(merged.start(), other.start());
+             combined++;
+           });
+
+  EXPECT_THAT(L(), ElementsAre(I(0x2, 0x9), I(0xb, 0xc)));
+  EXPECT_EQ(3, combined);
+}
+
 TEST_F(IntervalListTest, rangeFirstLast) {
   merge(I(0x2, 0x4));  // 0
   merge(I(0x8, 0x9));  // 1
@@ -21,20 +21,980 @@
 #if TARGET_OS != GAPID_OS_ANDROID
 
 #include <errno.h>
+#include <inttypes.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <ctime>  // Required for MSVC.
+#include <mutex>
+#include <string>
+#include <thread>
 
 #if TARGET_OS == GAPID_OS_WINDOWS
 #include "Windows.h"
 #endif  // GAPID_OS_WINDOWS
 
+namespace {
+
+// The size in bytes of the log buffer of each thread.
+const size_t kBufferSize = 64 << 10;
+
+// The largest record that is added to a log buffer. Longer messages are
+// written out on the logging thread.
+const size_t kMaxRecordSize = kBufferSize / 4;
+
+// The largest size of the packed arguments of a message. Messages with larger
+// arguments are formatted on the logging thread.
+const size_t kMaxArgsSize = 2048;
+
+// The longest flags, width and precision of a conversion in a format string.
+const size_t kMaxSpecLength = 32;
+
+// How often the writer thread writes out the logged messages.
+const std::chrono::milliseconds kWritePeriod(10);
+
+// How long flush waits for the writer thread to finish writing out messages.
+// This stops a crash in the writer thread from hanging the crash handler.
+const std::chrono::seconds kFlushTimeout(1);
+
+// The level of the records that pad a log buffer up to its end.
+const uint32_t kPadding = ~0u;
+
+// RecordHeader is the start of each record in a log buffer. It is followed by
+// copies of the system, the file and, unless the message is already
+// formatted, the format string, each terminated by a zero. The strings are
+// copied as they may not outlive the record, such as the strings of JIT
+// compiled code. The packed arguments of the message follow the strings, or
+// the formatted message if formatted is set.
+struct RecordHeader {
+  uint32_t size;   // The size of the record, including this header.
+  uint32_t level;  // The log level, or kPadding.
+  uint32_t line;
+  uint32_t formatted;
+  int64_t time;  // Microseconds since the epoch of the system clock.
+  uint32_t stringsSize;  // The size of the strings, padded to 8 bytes.
+  uint32_t unused;
+};
+
+inline size_t align8(size_t size) { return (size + 7) & ~size_t(7); }
+
+// LogBuffer is a ring of the records logged by a single thread. The thread
+// adds records without taking any locks, and the writer thread removes them.
+struct LogBuffer {
+  // The number of bytes ever added. Only modified by the logging thread.
+  std::atomic<uint64_t> head;
+  // Keeps head and tail on separate cache lines.
+  uint8_t padding[64 - sizeof(std::atomic<uint64_t>)];
+  // The number of bytes ever removed. Only modified by the writer.
+  std::atomic<uint64_t> tail;
+  // The number of records dropped since the writer last reported them.
+  std::atomic<uint64_t> dropped;
+  // Set when the logging thread exits.
+  std::atomic<bool> closed;
+  alignas(8) uint8_t data[kBufferSize];
+
+  LogBuffer() : head(0), tail(0), dropped(0), closed(false) {}
+
+  // Returns where to write a record of size bytes, which must be a multiple
+  // of 8, and the head to commit it with. Returns nullptr if the buffer does
+  // not have the space.
+  uint8_t* reserve(size_t size, uint64_t* next) {
+    uint64_t h = head.load(std::memory_order_relaxed);
+    uint64_t t = tail.load(std::memory_order_acquire);
+    size_t offset = h % kBufferSize;
+    size_t contiguous = kBufferSize - offset;
+    // Records do not wrap around the end of the buffer.
+    size_t needed = size <= contiguous ? size : contiguous + size;
+    if (needed > kBufferSize - (h - t)) {
+      return nullptr;
+    }
+    if (size > contiguous) {
+      RecordHeader* padding = reinterpret_cast<RecordHeader*>(data + offset);
+      padding->size = contiguous;
+      padding->level = kPadding;
+      offset = 0;
+    }
+    *next = h + needed;
+    return data + offset;
+  }
+
+  // Makes the records reserved up to next visible to the writer.
+  void commit(uint64_t next) { head.store(next, std::memory_order_release); }
+};
+
+// ThreadBuffer holds the log buffer of a thread, and hands it over to the
+// writer when the thread exits.
+struct ThreadBuffer {
+  LogBuffer* buffer = nullptr;
+
+  ~ThreadBuffer() {
+    if (buffer != nullptr) {
+      buffer->closed.store(true, std::memory_order_release);
+      buffer = nullptr;
+    }
+  }
+};
+
+thread_local ThreadBuffer tThreadBuffer;
+
+// Conversion is a single printf conversion specification.
+struct Conversion {
+  enum Kind {
+    kPercent,  // %%
+    kSigned,
+    kUnsigned,
+    kChar,
+    kPointer,
+    kDouble,
+    kLongDouble,
+    kString,
+  };
+  enum Length {
+    kNone,
+    kHH,
+    kH,
+    kL,
+    kLL,
+    kJ,
+    kZ,
+    kT,
+    kI,
+    kI32,
+    kI64,
+    kBigL,
+  };
+
+  Kind kind;
+  Length length;
+  char conversion;
+  // The length of the '%', flags, width and precision.
+  size_t specLength;
+  // The number of '*' widths and precisions.
+  int stars;
+  // Whether the precision is a '*'.
+  bool starPrecision;
+  // The precision, or -1 if there is none or it is a '*'.
+  int precision;
+  // One past the conversion character.
+  const char* end;
+};
+
+// Parses the conversion specification that starts at the '%' at p. Returns
+// false if the conversion is not one that can be packed.
+bool parse(const char* p, Conversion* c) {
+  const char* start = p++;
+  c->stars = 0;
+  c->starPrecision = false;
+  c->precision = -1;
+  while (*p != '\0' && strchr("-+ #0'", *p) != nullptr) {
+    p++;
+  }
+  if (*p == '*') {
+    c->stars++;
+    p++;
+  } else {
+    while (*p >= '0' && *p <= '9') {
+      p++;
+    }
+  }
+  if (*p == '.') {
+    p++;
+    if (*p == '*') {
+      c->stars++;
+      c->starPrecision = true;
+      p++;
+    } else {
+      c->precision = 0;
+      while (*p >= '0' && *p <= '9') {
+        c->precision = c->precision * 10 + (*p++ - '0');
+      }
+    }
+  }
+  c->specLength = p - start;
+  if (c->specLength > kMaxSpecLength) {
+    return false;
+  }
+
+  c->length = Conversion::kNone;
+  switch (*p) {
+    case 'h':
+      p++;
+      c->length = Conversion::kH;
+      if (*p == 'h') {
+        p++;
+        c->length = Conversion::kHH;
+      }
+      break;
+    case 'l':
+      p++;
+      c->length = Conversion::kL;
+      if (*p == 'l') {
+        p++;
+        c->length = Conversion::kLL;
+      }
+      break;
+    case 'j':
+      p++;
+      c->length = Conversion::kJ;
+      break;
+    case 'z':
+      p++;
+      c->length = Conversion::kZ;
+      break;
+    case 't':
+      p++;
+      c->length = Conversion::kT;
+      break;
+    case 'L':
+      p++;
+      c->length = Conversion::kBigL;
+      break;
+    case 'I':
+      p++;
+      c->length = Conversion::kI;
+      if (p[0] == '3' && p[1] == '2') {
+        p += 2;
+        c->length = Conversion::kI32;
+      } else if (p[0] == '6' && p[1] == '4') {
+        p += 2;
+        c->length = Conversion::kI64;
+      }
+      break;
+  }
+
+  c->conversion = *p;
+  c->end = p + 1;
+  bool integer = c->length != Conversion::kBigL;
+  switch (c->conversion) {
+    case '%':
+      c->kind = Conversion::kPercent;
+      return c->specLength == 1 && c->length == Conversion::kNone;
+    case 'd':
+    case 'i':
+      c->kind = Conversion::kSigned;
+      return integer;
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+      c->kind = Conversion::kUnsigned;
+      return integer;
+    case 'c':
+      c->kind = Conversion::kChar;
+      return c->length == Conversion::kNone;
+    case 'p':
+      c->kind = Conversion::kPointer;
+      return c->length == Conversion::kNone;
+    case 'e':
+    case 'E':
+    case 'f':
+    case 'F':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      if (c->length == Conversion::kBigL) {
+        c->kind = Conversion::kLongDouble;
+        return true;
+      }
+      c->kind = Conversion::kDouble;
+      return c->length == Conversion::kNone || c->length == Conversion::kL;
+    case 's':
+      c->kind = Conversion::kString;
+      return c->length == Conversion::kNone;
+    default:
+      // %n, wide characters and platform extensions such as %m.
+      return false;
+  }
+}
+
+int64_t readSigned(Conversion::Length length, va_list* args) {
+  switch (length) {
+    case Conversion::kHH:
+      return static_cast<signed char>(va_arg(*args, int));
+    case Conversion::kH:
+      return static_cast<short>(va_arg(*args, int));
+    case Conversion::kL:
+      return va_arg(*args, long);
+    case Conversion::kLL:
+      return va_arg(*args, long long);
+    case Conversion::kJ:
+      return va_arg(*args, intmax_t);
+    case Conversion::kZ:
+    case Conversion::kT:
+    case Conversion::kI:
+      return va_arg(*args, ptrdiff_t);
+    case Conversion::kI32:
+      return va_arg(*args, int32_t);
+    case Conversion::kI64:
+      return va_arg(*args, int64_t);
+    default:
+      return va_arg(*args, int);
+  }
+}
+
+uint64_t readUnsigned(Conversion::Length length, va_list* args) {
+  switch (length) {
+    case Conversion::kHH:
+      return static_cast<unsigned char>(va_arg(*args, unsigned));
+    case Conversion::kH:
+      return static_cast<unsigned short>(va_arg(*args, unsigned));
+    case Conversion::kL:
+      return va_arg(*args, unsigned long);
+    case Conversion::kLL:
+      return va_arg(*args, unsigned long long);
+    case Conversion::kJ:
+      return va_arg(*args, uintmax_t);
+    case Conversion::kZ:
+    case Conversion::kT:
+    case Conversion::kI:
+      return va_arg(*args, size_t);
+    case Conversion::kI32:
+      return va_arg(*args, uint32_t);
+    case Conversion::kI64:
+      return va_arg(*args, uint64_t);
+    default:
+      return va_arg(*args, unsigned);
+  }
+}
+
+// Packer writes the arguments of a message into a fixed size buffer, with
+// each argument aligned to 8 bytes.
+class Packer {
+ public:
+  Packer(uint8_t* data, size_t size) : mData(data), mSize(size), mUsed(0) {}
+
+  template <typename T>
+  bool put(const T& value) {
+    if (mUsed + align8(sizeof(value)) > mSize) {
+      return false;
+    }
+    memcpy(mData + mUsed, &value, sizeof(value));
+    mUsed += align8(sizeof(value));
+    return true;
+  }
+
+  // Puts the string str, truncated to precision characters if precision is
+  // not negative.
+  bool putString(const char* str, int precision) {
+    if (str == nullptr) {
+      str = "(null)";
+    }
+    uint32_t length = 0;
+    while ((precision < 0 || length < uint32_t(precision)) &&
+           str[length] != '\0') {
+      length++;
+    }
+    if (!put(length)) {
+      return false;
+    }
+    if (mUsed + length + 1 > mSize) {
+      return false;
+    }
+    memcpy(mData + mUsed, str, length);
+    mData[mUsed + length] = '\0';
+    mUsed = align8(mUsed + length + 1);
+    return true;
+  }
+
+  size_t used() const { return mUsed; }
+
+ private:
+  uint8_t* mData;
+  size_t mSize;
+  size_t mUsed;
+};
+
+// Packs the arguments of format into packer. Returns false if format has a
+// conversion that cannot be packed, or the arguments do not fit.
+bool pack(const char* format, va_list* args, Packer* packer) {
+  for (const char* p = strchr(format, '%'); p != nullptr;
+       p = strchr(p, '%')) {
+    Conversion c;
+    if (!parse(p, &c)) {
+      return false;
+    }
+    p = c.end;
+    int precision = c.precision;
+    for (int i = 0; i < c.stars; i++) {
+      int star = va_arg(*args, int);
+      if (c.starPrecision && i == c.stars - 1) {
+        precision = star;
+      }
+      if (!packer->put(int64_t(star))) {
+        return false;
+      }
+    }
+    bool ok = true;
+    switch (c.kind) {
+      case Conversion::kPercent:
+        break;
+      case Conversion::kSigned:
+        ok = packer->put(readSigned(c.length, args));
+        break;
+      case Conversion::kUnsigned:
+        ok = packer->put(readUnsigned(c.length, args));
+        break;
+      case Conversion::kChar:
+        ok = packer->put(int64_t(va_arg(*args, int)));
+        break;
+      case Conversion::kPointer:
+        ok = packer->put(va_arg(*args, void*));
+        break;
+      case Conversion::kDouble:
+        ok = packer->put(va_arg(*args, double));
+        break;
+      case Conversion::kLongDouble:
+        ok = packer->put(va_arg(*args, long double));
+        break;
+      case Conversion::kString:
+        ok = packer->putString(va_arg(*args, const char*), precision);
+        break;
+    }
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Appends the result of formatting args with format to out.
+void appendv(std::string* out, const char* format, va_list args) {
+  char buf[256];
+  va_list args_copy;
+  va_copy(args_copy, args);
+  int n = vsnprintf(buf, sizeof(buf), format, args_copy);
+  va_end(args_copy);
+  if (n < 0) {
+    return;
+  }
+  if (size_t(n) < sizeof(buf)) {
+    out->append(buf, n);
+    return;
+  }
+  size_t start = out->size();
+  out->resize(start + n + 1);
+  va_copy(args_copy, args);
+  vsnprintf(&(*out)[start], n + 1, format, args_copy);
+  va_end(args_copy);
+  out->resize(start + n);
+}
+
+// Appends the result of formatting the arguments with format to out.
+void appendf(std::string* out, const char* format, ...) {
+  va_list args;
+  va_start(args, format);
+  appendv(out, format, args);
+  va_end(args);
+}
+
+// Appends value formatted with the conversion spec to out, passing the star
+// widths and precisions before it.
+template <typename T>
+void appendConversion(std::string* out, const char* spec, int stars,
+                      const int* star, T value) {
+  switch (stars) {
+    case 0:
+      appendf(out, spec, value);
+      break;
+    case 1:
+      appendf(out, spec, star[0], value);
+      break;
+    default:
+      appendf(out, spec, star[0], star[1], value);
+      break;
+  }
+}
+
+// Unpacker reads the arguments written by a Packer.
+class Unpacker {
+ public:
+  Unpacker(const uint8_t* data) : mData(data) {}
+
+  template <typename T>
+  T get() {
+    T value;
+    memcpy(&value, mData, sizeof(value));
+    mData += align8(sizeof(value));
+    return value;
+  }
+
+  const char* getString() {
+    uint32_t length = get<uint32_t>();
+    const char* str = reinterpret_cast<const char*>(mData);
+    mData += align8(length + 1);
+    return str;
+  }
+
+ private:
+  const uint8_t* mData;
+};
+
+// Appends the message formatted from format and the packed arguments args
+// to out.
+void formatMessage(std::string* out, const char* format, const uint8_t* args) {
+  // The length modifiers of the 64-bit integers that the integer arguments
+  // are packed as. For example "ll" or "I64".
+  static const std::string kSigned(PRId64, sizeof(PRId64) - 2);
+  static const std::string kUnsigned(PRIu64, sizeof(PRIu64) - 2);
+
+  Unpacker unpacker(args);
+  const char* p = format;
+  while (*p != '\0') {
+    const char* percent = strchr(p, '%');
+    if (percent == nullptr) {
+      out->append(p);
+      break;
+    }
+    out->append(p, percent - p);
+    Conversion c;
+    parse(percent, &c);
+    p = c.end;
+    if (c.kind == Conversion::kPercent) {
+      out->push_back('%');
+      continue;
+    }
+
+    int star[2];
+    for (int i = 0; i < c.stars; i++) {
+      star[i] = static_cast<int>(unpacker.get<int64_t>());
+    }
+    // The spec is the flags, width and precision of the original conversion,
+    // followed by the length modifier of the packed argument.
+    std::string spec(percent, c.specLength);
+    switch (c.kind) {
+      case Conversion::kSigned:
+        spec += kSigned + c.conversion;
+        appendConversion(out, spec.c_str(), c.stars, star,
+                         unpacker.get<int64_t>());
+        break;
+      case Conversion::kUnsigned:
+        spec += kUnsigned + c.conversion;
+        appendConversion(out, spec.c_str(), c.stars, star,
+                         unpacker.get<uint64_t>());
+        break;
+      case Conversion::kChar:
+        spec += c.conversion;
+        appendConversion(out, spec.c_str(), c.stars, star,
+                         static_cast<int>(unpacker.get<int64_t>()));
+        break;
+      case Conversion::kPointer:
+        spec += c.conversion;
+        appendConversion(out, spec.c_str(), c.stars, star,
+                         unpacker.get<void*>());
+        break;
+      case Conversion::kDouble:
+        spec += c.conversion;
+        appendConversion(out, spec.c_str(), c.stars, star,
+                         unpacker.get<double>());
+        break;
+      case Conversion::kLongDouble:
+        spec += 'L';
+        spec += c.conversion;
+        appendConversion(out, spec.c_str(), c.stars, star,
+                         unpacker.get<long double>());
+        break;
+      case Conversion::kString:
+        spec += c.conversion;
+        appendConversion(out, spec.c_str(), c.stars, star,
+                         unpacker.getString());
+        break;
+      case Conversion::kPercent:
+        break;
+    }
+  }
+}
+
+int64_t now() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // anonymous namespace
+
 namespace core {
 
+// Writer owns the log buffers of all of the threads, and writes out the
+// messages in them on a background thread.
+class Logger::Writer {
+ public:
+  Writer() : mStarted(false), mStopped(false), mDropped(0) {}
+
+  // Adds the message to the log buffer of the calling thread.
+  void log(unsigned level, const char* system, const char* file,
+           unsigned line, const char* format, va_list args);
+
+  // Writes out all of the messages in the log buffers, if the writer can get
+  // hold of them within kFlushTimeout.
+  void flush();
+
+  // Writes out the remaining messages, stops writing out messages and waits
+  // for the writer thread to exit.
+  void stop();
+
+  uint64_t dropped() const { return mDropped.load(std::memory_order_relaxed); }
+
+  // Adds file to the files that the messages are written to.
+  void addFile(FILE* file);
+
+ private:
+  // The read position of the writer in a log buffer.
+  struct Cursor {
+    LogBuffer* buffer;
+    uint64_t tail;
+    uint64_t head;
+    bool closed;
+  };
+
+  // Returns the log buffer of the calling thread, creating it if needed.
+  LogBuffer* buffer();
+
+  // Starts the writer thread, if it has not been started yet.
+  void start();
+
+  // The entry point of the writer thread.
+  void run();
+
+  // Writes out all of the messages in the log buffers. mWriteMutex must be
+  // held.
+  void drain();
+
+  // Writes out the message on the calling thread, after the messages already
+  // in the log buffers.
+  void writeNow(unsigned level, const char* system, const char* file,
+                unsigned line, int64_t time, const char* message);
+
+  // Skips the padding at the tail of the cursor. Returns the next record, or
+  // nullptr if there is none.
+  const RecordHeader* next(Cursor* cursor);
+
+  // Writes out the message of the record.
+  void write(const RecordHeader* record);
+
+  // Writes out the line with the given header. mWriteMutex must be held.
+  void writeLine(unsigned level, const char* system, const char* file,
+                 unsigned line, int64_t time, const char* message);
+
+  std::atomic<bool> mStarted;
+  std::mutex mStartMutex;
+  std::thread mThread;
+
+  // The lock for writing out messages, mStopped and the logger's files.
+  std::timed_mutex mWriteMutex;
+  bool mStopped;
+
+  // The lock for modifying mBuffers.
+  std::mutex mBuffersMutex;
+  std::vector<LogBuffer*> mBuffers;
+
+  // The writer thread waits on mWake between writes.
+  std::mutex mWakeMutex;
+  std::condition_variable mWake;
+
+  std::atomic<uint64_t> mDropped;
+
+  // Scratch space reused for each message.
+  std::vector<Cursor> mCursors;
+  std::string mLine;
+};
+
+LogBuffer* Logger::Writer::buffer() {
+  LogBuffer* buffer = tThreadBuffer.buffer;
+  if (buffer == nullptr) {
+    buffer = new LogBuffer();
+    {
+      std::lock_guard<std::mutex> lock(mBuffersMutex);
+      mBuffers.push_back(buffer);
+    }
+    tThreadBuffer.buffer = buffer;
+  }
+  return buffer;
+}
+
+void Logger::Writer::start() {
+  std::lock_guard<std::mutex> lock(mStartMutex);
+  if (!mStarted.load(std::memory_order_relaxed)) {
+    mThread = std::thread([this] { run(); });
+    mStarted.store(true, std::memory_order_release);
+  }
+}
+
+void Logger::Writer::run() {
+  std::unique_lock<std::mutex> lock(mWakeMutex);
+  while (true) {
+    mWake.wait_for(lock, kWritePeriod);
+    std::unique_lock<std::timed_mutex> write(mWriteMutex);
+    if (mStopped) {
+      return;
+    }
+    drain();
+  }
+}
+
+void Logger::Writer::log(unsigned level, const char* system, const char* file,
+                         unsigned line, const char* format, va_list args) {
+  if (!mStarted.load(std::memory_order_acquire)) {
+    start();
+  }
+
+  int64_t time = now();
+  if (level <= LOG_LEVEL_ERROR) {
+    // Errors are never dropped, and must be out before a fatal error
+    // terminates the program.
+    std::string message;
+    appendv(&message, format, args);
+    writeNow(level, system, file, line, time, message.c_str());
+    return;
+  }
+
+  RecordHeader header;
+  header.level = level;
+  header.line = line;
+  header.formatted = 0;
+  header.time = time;
+  header.unused = 0;
+
+  alignas(8) uint8_t packed[kMaxArgsSize];
+  Packer packer(packed, sizeof(packed));
+  va_list args_copy;
+  va_copy(args_copy, args);
+  bool ok = pack(format, &args_copy, &packer);
+  va_end(args_copy);
+
+  const void* payload = packed;
+  size_t payloadSize = packer.used();
+  std::string message;
+  if (!ok) {
+    // Format the message here, as the writer can not format it from packed
+    // arguments.
+    appendv(&message, format, args);
+    header.formatted = 1;
+    payload = message.c_str();
+    payloadSize = message.size() + 1;
+  }
+
+  if (system == nullptr) {
+    system = "";
+  }
+  size_t systemSize = strlen(system) + 1;
+  size_t fileSize = strlen(file) + 1;
+  size_t formatSize = header.formatted ? 0 : strlen(format) + 1;
+  size_t stringsSize = align8(systemSize + fileSize + formatSize);
+  size_t size = sizeof(header) + stringsSize + align8(payloadSize);
+  if (size > kMaxRecordSize) {
+    // Too large for the log buffer, write it out in order with the messages
+    // logged before it.
+    if (!header.formatted) {
+      appendv(&message, format, args);
+    }
+    writeNow(level, system, file, line, time, message.c_str());
+    return;
+  }
+
+  LogBuffer* buf = buffer();
+  uint64_t next;
+  uint8_t* data = buf->reserve(size, &next);
+  if (data == nullptr) {
+    mDropped.fetch_add(1, std::memory_order_relaxed);
+    if (buf->dropped.fetch_add(1, std::memory_order_relaxed) == 0) {
+      mWake.notify_one();
+    }
+    return;
+  }
+  header.size = size;
+  header.stringsSize = stringsSize;
+  uint8_t* out = data;
+  memcpy(out, &header, sizeof(header));
+  out += sizeof(header);
+  memcpy(out, system, systemSize);
+  out += systemSize;
+  memcpy(out, file, fileSize);
+  out += fileSize;
+  memcpy(out, format, formatSize);
+  memcpy(data + sizeof(header) + stringsSize, payload, payloadSize);
+  uint64_t last = buf->head.load(std::memory_order_relaxed);
+  buf->commit(next);
+
+  // Wake the writer up early when the buffer fills past half way.
+  uint64_t tail = buf->tail.load(std::memory_order_relaxed);
+  if (next - tail > kBufferSize / 2 && last - tail <= kBufferSize / 2) {
+    mWake.notify_one();
+  }
+}
+
+void Logger::Writer::writeNow(unsigned level, const char* system,
+                              const char* file, unsigned line, int64_t time,
+                              const char* message) {
+  std::unique_lock<std::timed_mutex> lock(mWriteMutex);
+  if (mStopped) {
+    return;
+  }
+  drain();
+  writeLine(level, system, file, line, time, message);
+  for (FILE* f : mInstance.mFiles) {
+    fflush(f);
+  }
+}
+
+void Logger::Writer::flush() {
+  std::unique_lock<std::timed_mutex> lock(mWriteMutex, kFlushTimeout);
+  if (lock.owns_lock() && !mStopped) {
+    drain();
+  }
+}
+
+void Logger::Writer::stop() {
+  {
+    std::unique_lock<std::timed_mutex> lock(mWriteMutex, kFlushTimeout);
+    if (!lock.owns_lock() || mStopped) {
+      // The writer thread is stuck, or already stopped.
+      return;
+    }
+    drain();
+    mStopped = true;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mWakeMutex);
+    mWake.notify_one();
+  }
+  // Join the thread, so that it is not left running code that is unloaded
+  // with the shared library holding the logger. mStarted is set so that
+  // logging no longer starts a new thread.
+  std::lock_guard<std::mutex> lock(mStartMutex);
+  mStarted.store(true, std::memory_order_release);
+  if (mThread.joinable()) {
+    mThread.join();
+  }
+}
+
+void Logger::Writer::addFile(FILE* file) {
+  std::unique_lock<std::timed_mutex> lock(mWriteMutex);
+  mInstance.mFiles.push_back(file);
+}
+
+const RecordHeader* Logger::Writer::next(Cursor* cursor) {
+  while (cursor->tail < cursor->head) {
+    const RecordHeader* record = reinterpret_cast<const RecordHeader*>(
+        cursor->buffer->data + cursor->tail % kBufferSize);
+    if (record->level != kPadding) {
+      return record;
+    }
+    cursor->tail += record->size;
+  }
+  return nullptr;
+}
+
+void Logger::Writer::drain() {
+  mCursors.clear();
+  {
+    std::lock_guard<std::mutex> lock(mBuffersMutex);
+    for (LogBuffer* buffer : mBuffers) {
+      Cursor cursor;
+      cursor.buffer = buffer;
+      // Read closed before head, so that a closed buffer is only deleted
+      // once all of its records have been written out.
+      cursor.closed = buffer->closed.load(std::memory_order_acquire);
+      cursor.head = buffer->head.load(std::memory_order_acquire);
+      cursor.tail = buffer->tail.load(std::memory_order_relaxed);
+      mCursors.push_back(cursor);
+    }
+  }
+
+  for (Cursor& cursor : mCursors) {
+    if (uint64_t dropped = cursor.buffer->dropped.exchange(0)) {
+      std::string message;
+      appendf(&message, "%" PRIu64 " log messages dropped", dropped);
+      writeLine(LOG_LEVEL_WARNING, mInstance.mSystem, __FILE__, __LINE__,
+                now(), message.c_str());
+    }
+  }
+
+  // Write out the records of all of the threads in the order they were
+  // logged.
+  while (true) {
+    Cursor* first = nullptr;
+    const RecordHeader* record = nullptr;
+    for (Cursor& cursor : mCursors) {
+      const RecordHeader* r = next(&cursor);
+      if (r != nullptr && (record == nullptr || r->time < record->time)) {
+        first = &cursor;
+        record = r;
+      }
+    }
+    if (record == nullptr) {
+      break;
+    }
+    write(record);
+    first->tail += record->size;
+    first->buffer->tail.store(first->tail, std::memory_order_release);
+  }
+
+  for (FILE* file : mInstance.mFiles) {
+    fflush(file);
+  }
+
+  // Delete the buffers of the threads that have exited.
+  std::lock_guard<std::mutex> lock(mBuffersMutex);
+  for (const Cursor& cursor : mCursors) {
+    if (cursor.closed) {
+      // Flush any padding after the last record too.
+      cursor.buffer->tail.store(cursor.head, std::memory_order_relaxed);
+      mBuffers.erase(
+          std::find(mBuffers.begin(), mBuffers.end(), cursor.buffer));
+      delete cursor.buffer;
+    }
+  }
+}
+
+void Logger::Writer::write(const RecordHeader* record) {
+  const char* system = reinterpret_cast<const char*>(record + 1);
+  const char* file = system + strlen(system) + 1;
+  const uint8_t* payload =
+      reinterpret_cast<const uint8_t*>(system) + record->stringsSize;
+  const char* message;
+  std::string formatted;
+  if (record->formatted) {
+    message = reinterpret_cast<const char*>(payload);
+  } else {
+    const char* format = file + strlen(file) + 1;
+    formatMessage(&formatted, format, payload);
+    message = formatted.c_str();
+  }
+  writeLine(record->level, system, file, record->line, record->time, message);
+}
+
+void Logger::Writer::writeLine(unsigned level, const char* system,
+                               const char* file, unsigned line, int64_t time,
+                               const char* message) {
+  std::time_t seconds = static_cast<std::time_t>(time / 1000000);
+  std::tm* loc = std::localtime(&seconds);
+  mLine.clear();
+  appendf(&mLine, "%02d:%02d:%02d.%03d %c %s: [%s:%u] ", loc->tm_hour,
+          loc->tm_min, loc->tm_sec, static_cast<int>(time / 1000 % 1000),
+          "FEWIDV"[level], system, file, line);
+
+#if TARGET_OS == GAPID_OS_WINDOWS
+  OutputDebugStringA(mLine.c_str());
+  OutputDebugStringA(message);
+  OutputDebugStringA("\r\n");
+#endif  // GAPID_OS_WINDOWS
+
+  mLine.append(message);
+  // Always finish with a newline
+  mLine.push_back('\n');
+  for (FILE* file : mInstance.mFiles) {
+    fwrite(mLine.data(), 1, mLine.size(), file);
+  }
+}
+
 Logger Logger::mInstance = Logger();
 
 void Logger::init(unsigned level, const char* system, const char* path) {
@@ -43,7 +1003,7 @@ void Logger::init(unsigned level, const char* system, const char* path) {
   if (path != nullptr) {
     if (FILE* f = fopen(path, "w")) {
       GAPID_INFO("Logging to %s", path);
-      mInstance.mFiles.push_back(f);
+      mInstance.mWriter->addFile(f);
     } else {
       GAPID_WARNING("Can't open file for logging (%s): %s", path,
                     strerror(errno));
@@ -51,11 +1011,13 @@ void Logger::init(unsigned level, const char* system, const char* path) {
   }
 }
 
-Logger::Logger() : mLevel(LOG_LEVEL_INFO), mSystem("") {
+Logger::Logger()
+    : mLevel(LOG_LEVEL_INFO), mSystem(""), mWriter(new Writer()) {
   mFiles.push_back(stdout);
 }
 
 Logger::~Logger() {
+  mWriter->stop();
   for (FILE* file : mFiles) {
     fclose(file);
   }
@@ -71,54 +1033,27 @@ void Logger::logf(unsigned level, const char* file, unsigned line,
 
 void Logger::vlogf(unsigned level, const char* src_file, unsigned src_line,
                    const char* format, va_list args) const {
-  // Get the current time with milliseconds precision
-  auto t = std::chrono::system_clock::now();
-  std::time_t now = std::chrono::system_clock::to_time_t(t);
-  std::tm* loc = std::localtime(&now);
-  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-      t.time_since_epoch());
-
-#define LOG_COMMON                                                       \
-  "%02d:%02d:%02d.%03d %c %s: [%s:%u] ", loc->tm_hour, loc->tm_min,      \
-      loc->tm_sec, static_cast<int>(ms.count() % 1000), "FEWIDV"[level], \
-      mSystem, src_file, src_line
-
-#if TARGET_OS == GAPID_OS_WINDOWS
-  {
-    va_list args_copy;
-    va_copy(args_copy, args);
-    char buf[2048];
-    snprintf(buf, sizeof(buf), LOG_COMMON);
-    OutputDebugStringA(buf);
-    vsnprintf(buf, sizeof(buf), format, args_copy);
-    OutputDebugStringA(buf);
-    OutputDebugStringA("\r\n");
-  }
-#endif  // GAPID_OS_WINDOWS
-
-  for (FILE* file : mFiles) {
-    va_list args_copy;
-    va_copy(args_copy, args);
-
-    // Print out the common part of the log messages
-    fprintf(file, LOG_COMMON);
-
-    // Print out the actual log message
-    vfprintf(file, format, args_copy);
-
-    // Always finish with a newline
-    fprintf(file, "\n");
-
-    // Flush the log to ensure that every message is written out even if the
-    // application crashes
-    fflush(file);
+  // mWriter is null if this is called before the logger is constructed.
+  if (mWriter != nullptr) {
+    mWriter->log(level, mSystem, src_file, src_line, format, args);
   }
 
   if (level == LOG_LEVEL_FATAL) {
+    flush();
     exit(EXIT_FAILURE);
   }
 }
 
+void Logger::flush() {
+  if (mInstance.mWriter != nullptr) {
+    mInstance.mWriter->flush();
+  }
+}
+
+uint64_t Logger::dropped() {
+  return mInstance.mWriter != nullptr ? mInstance.mWriter->dropped() : 0;
+}
+
 }  // namespace core
 
 #endif  // TARGET_OS != GAPID_OS_ANDROID
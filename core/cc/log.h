@@ -66,6 +66,7 @@
 #include <android/log.h>
 
 #define GAPID_LOGGER_INIT(...)
+#define GAPID_LOGGER_FLUSH()
 #define GAPID_SHOULD_LOG(LEVEL) (LOG_LEVEL >= LEVEL)
 #define GAPID_LOG(LEVEL, ANDROID_LOG_LEVEL, FORMAT, ...)                    \
   if                                                                        \
@@ -93,11 +94,21 @@
 
 #else  // TARGET_OS == GAPID_OS_ANDROID
 
+#include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 
 namespace core {
 
 // Singleton logger implementation for PCs to write formatted log messages.
+//
+// Logging a message does not format it or write it out on the calling thread.
+// Instead, the format string and the arguments are packed into a log buffer
+// owned by the calling thread, and a background writer thread formats and
+// writes out the messages of all of the threads. If a thread logs faster than
+// the writer can keep up with, the messages that do not fit in its buffer are
+// dropped and counted. Errors are written out on the calling thread, and are
+// never dropped.
 class Logger {
  public:
   // Initializes the logger to write to the log file at path.
@@ -108,17 +119,29 @@ class Logger {
   // format is a standard C format string If a message is logged with level
   // LOG_LEVEL_FATAL, the program will terminate after the message is printed.
   // Log messages take the form: <time> <level> <system> <file:line> : <message>
+  // The format string, file, system and string arguments are copied, so they
+  // only need to live for the duration of the call.
   void logf(unsigned level, const char* file, unsigned line, const char* format,
             ...) const;
 
   void vlogf(unsigned level, const char* file, unsigned line,
              const char* format, va_list args) const;
 
+  // Writes out all of the messages logged so far, on the calling thread.
+  // This is called on crashes and before fatal errors terminate the program.
+  static void flush();
+
+  // Returns the number of messages dropped because the log buffer of the
+  // thread that logged them was full.
+  static uint64_t dropped();
+
   static const Logger& instance() { return mInstance; }
 
   static unsigned level() { return mInstance.mLevel; }
 
  private:
+  class Writer;
+
   // mInstance is the single logger instance.
   static Logger mInstance;
 
@@ -128,11 +151,15 @@ class Logger {
   unsigned mLevel;
   const char* mSystem;
   std::vector<FILE*> mFiles;
+  // mWriter is never deleted, so that threads still logging while the
+  // program exits do not use it after it is freed.
+  Writer* mWriter;
 };
 
 }  // namespace core
 
 #define GAPID_LOGGER_INIT(...) ::core::Logger::init(__VA_ARGS__)
+#define GAPID_LOGGER_FLUSH() ::core::Logger::flush()
 #define GAPID_SHOULD_LOG(LEVEL) (::core::Logger::level() >= LEVEL)
 #define GAPID_LOG(LEVEL, FORMAT, ...)                                    \
   if                                                                     \
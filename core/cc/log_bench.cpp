@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// log-bench reports the time a thread spends in each call to GAPID_INFO,
+// for a thread that logs in short bursts and for threads that log as fast as
+// they can.
+
+#include "log.h"
+#include "target.h"
+#include "timer.h"
+
+#include <stdio.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+#if TARGET_OS == GAPID_OS_WINDOWS
+const char* kNullPath = "NUL";
+#else
+const char* kNullPath = "/dev/null";
+#endif
+
+// The number of messages logged by each thread for each measurement.
+const int kMessages = 200000;
+
+// Logs kMessages messages, in bursts of burst messages with a pause after
+// each, and returns the nanoseconds spent logging.
+uint64_t logMessages(int burst) {
+  const char* name = "frame";
+  uint64_t elapsed = 0;
+  for (int i = 0; i < kMessages; i += burst) {
+    auto start = core::GetNanoseconds();
+    for (int j = i; j < i + burst; j++) {
+      GAPID_INFO("%s %d took %.3f ms", name, j, j * 0.001);
+    }
+    elapsed += core::GetNanoseconds() - start;
+    if (burst < kMessages) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+  }
+  return elapsed;
+}
+
+void measure(const char* name, int threads, int burst) {
+  uint64_t dropped = core::Logger::dropped();
+  std::vector<uint64_t> elapsed(threads);
+  std::vector<std::thread> running;
+  for (int t = 0; t < threads; t++) {
+    running.emplace_back(
+        [&elapsed, t, burst] { elapsed[t] = logMessages(burst); });
+  }
+  uint64_t total = 0;
+  for (int t = 0; t < threads; t++) {
+    running[t].join();
+    total += elapsed[t];
+  }
+  core::Logger::flush();
+  fprintf(stderr, "%-24s %8.1f ns/call  %8.2f%% dropped\n", name,
+          double(total) / (threads * kMessages),
+          100.0 * (core::Logger::dropped() - dropped) / (threads * kMessages));
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  // The logger always writes to stdout, so throw stdout away and report on
+  // stderr.
+  if (freopen(kNullPath, "w", stdout) == nullptr) {
+    fprintf(stderr, "Failed to redirect stdout\n");
+    return 1;
+  }
+  GAPID_LOGGER_INIT(LOG_LEVEL_INFO, "log-bench", kNullPath);
+
+  measure("1 thread, bursts of 500", 1, 500);
+  measure("1 thread", 1, kMessages);
+  measure("4 threads", 4, kMessages);
+  return 0;
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "log.h"
+
+#include "core/cc/target.h"
+
+#if TARGET_OS != GAPID_OS_ANDROID
+
+#include <gtest/gtest.h>
+
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace core {
+namespace test {
+namespace {
+
+// The log file written by all of the tests.
+const std::string& logPath() {
+  static const std::string path = ::testing::TempDir() + "log_test.log";
+  return path;
+}
+
+class LoggerTest : public ::testing::Test {
+ protected:
+  // The logger is not restored afterwards, so these tests run in their own
+  // binary (see BUILD.bazel).
+  static void SetUpTestCase() {
+    Logger::init(LOG_LEVEL_VERBOSE, "log_test", logPath().c_str());
+  }
+
+  // Records the message that vsnprintf formats from format, with tag in front
+  // of it.
+  void expect(const char* tag, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(nullptr, 0, format, args);
+    va_end(args);
+    std::string message(n + 1, '\0');
+    va_start(args, format);
+    vsnprintf(&message[0], message.size(), format, args);
+    va_end(args);
+    message.resize(n);
+    mExpected.push_back(tag + message);
+  }
+
+  // Returns the messages of the lines in the log file that start with tag.
+  static std::vector<std::string> messages(const std::string& tag) {
+    Logger::flush();
+    return written(tag);
+  }
+
+  // Returns the messages starting with tag that have been written out to the
+  // log file, without flushing the logger.
+  static std::vector<std::string> written(const std::string& tag) {
+    std::ifstream file(logPath());
+    std::vector<std::string> out;
+    std::string line;
+    while (std::getline(file, line)) {
+      size_t start = line.find("] ");
+      if (start != std::string::npos &&
+          line.compare(start + 2, tag.size(), tag) == 0) {
+        out.push_back(line.substr(start + 2));
+      }
+    }
+    return out;
+  }
+
+  std::vector<std::string> mExpected;
+};
+
+// Logs the message and records what it is expected to be. TAG must be a
+// string literal.
+#define EXPECT_LOGGED(TAG, FORMAT, ...) \
+  expect(TAG, FORMAT, ##__VA_ARGS__);   \
+  GAPID_INFO(TAG FORMAT, ##__VA_ARGS__)
+
+TEST_F(LoggerTest, FormatsLikePrintf) {
+  int i = -42;
+  unsigned u = 0xdeadbeef;
+  const char* str = "a string";
+  char buf[] = "a buffer that is freed";
+  EXPECT_LOGGED("format: ", "no arguments");
+  EXPECT_LOGGED("format: ", "100%% %d %i %5d|%-5d|%05d", i, i, i, i, i);
+  EXPECT_LOGGED("format: ", "%u %x %X %#o %hhu %hd", u, u, u, u, u, u);
+  EXPECT_LOGGED("format: ", "%ld %lu %lld %llu", -1L, 2UL, -3LL, 4ULL);
+  EXPECT_LOGGED("format: ", "%zu %zd %td %jd", sizeof(u), ptrdiff_t(-5),
+                ptrdiff_t(6), intmax_t(-7));
+  EXPECT_LOGGED("format: ", "%" PRIu64 " %" PRId64 " %" PRIx64,
+                uint64_t(1) << 63, int64_t(-1), uint64_t(0xabcdef));
+  EXPECT_LOGGED("format: ", "%c%c %p", 'o', 'k', &u);
+  EXPECT_LOGGED("format: ", "%f %.2f %e %g %10.3G %a", 1.5, 3.14159, 1e-20,
+                0.1, 12345.678, 2.0);
+  EXPECT_LOGGED("format: ", "%Lf", 1.25L);
+  EXPECT_LOGGED("format: ", "[%s] [%10s] [%-10s] [%.3s]", str, "b", "c",
+                "truncated");
+  EXPECT_LOGGED("format: ", "[%*d] [%-*d] [%.*f] [%*.*s]", 6, 1, 6, 2, 3,
+                1.0, 8, 2, str);
+  EXPECT_LOGGED("format: ", "%s", buf);
+  // Wide strings are formatted on the logging thread.
+  EXPECT_LOGGED("format: ", "%ls %d", L"wide", 8);
+  // Overwriting the buffer does not change the logged message.
+  buf[0] = 'A';
+  EXPECT_EQ(mExpected, messages("format: "));
+}
+
+TEST_F(LoggerTest, CopiesStrings) {
+  // The format and file may be freed once the call returns, as the strings
+  // of JIT compiled code are.
+  std::string format = "transient: %s %d";
+  std::string file = "transient.cpp";
+  Logger::instance().logf(LOG_LEVEL_INFO, file.c_str(), 12, format.c_str(),
+                          "copied", 34);
+  format.assign(format.size(), 'x');
+  file.assign(file.size(), 'x');
+  EXPECT_EQ(std::vector<std::string>{"transient: copied 34"},
+            messages("transient: "));
+}
+
+TEST_F(LoggerTest, ErrorsWrittenOutImmediately) {
+  for (int i = 0; i < 100000; i++) {
+    GAPID_VERBOSE("filler: %d", i);
+  }
+  GAPID_ERROR("error: %d", 1);
+  EXPECT_EQ(std::vector<std::string>{"error: 1"}, written("error: "));
+}
+
+TEST_F(LoggerTest, LongMessages) {
+  std::string medium(5000, 'm');
+  std::string large(100000, 'l');
+  EXPECT_LOGGED("long: ", "%s", medium.c_str());
+  EXPECT_LOGGED("long: ", "%s", large.c_str());
+  EXPECT_LOGGED("long: ", "%d", 1);
+  EXPECT_EQ(mExpected, messages("long: "));
+}
+
+TEST_F(LoggerTest, Threads) {
+  const int kThreads = 4;
+  const int kMessages = 10000;
+  uint64_t dropped = Logger::dropped();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([t] {
+      for (int i = 0; i < kMessages; i++) {
+        GAPID_DEBUG("thread %d: message %d", t, i);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  dropped = Logger::dropped() - dropped;
+
+  // Every message is either written out, in order, or counted as dropped.
+  size_t written = 0;
+  for (int t = 0; t < kThreads; t++) {
+    char tag[32];
+    snprintf(tag, sizeof(tag), "thread %d: ", t);
+    int last = -1;
+    for (const std::string& message : messages(tag)) {
+      int i = atoi(message.c_str() + strlen(tag) + strlen("message "));
+      EXPECT_GT(i, last);
+      last = i;
+      written++;
+    }
+  }
+  EXPECT_EQ(uint64_t(kThreads * kMessages), written + dropped);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace core
+
+#endif  // TARGET_OS != GAPID_OS_ANDROID
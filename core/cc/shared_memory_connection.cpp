@@ -0,0 +1,423 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "shared_memory_connection.h"
+
+#include "core/cc/log.h"
+#include "core/cc/target.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+#if TARGET_OS == GAPID_OS_LINUX
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+namespace {
+
+// 'g', 's', 'h', 'm' in little-endian.
+const uint32_t kMagic = 0x6d687367;
+const uint32_t kVersion = 1;
+
+// The size of the page at the start of the shared memory that holds the
+// header and the control blocks of the rings. The ring data follows it.
+const size_t kControlSize = 4096;
+
+// How long a blocked end sleeps before checking that the other process is
+// still running.
+const long kWaitTimeoutNs = 100 * 1000 * 1000;
+
+// Returns size rounded up to a power of two, and to at least a page.
+size_t ringSize(size_t size) {
+  size_t rounded = kControlSize;
+  while (rounded < size) {
+    rounded <<= 1;
+  }
+  return rounded;
+}
+
+int futexWait(std::atomic<uint32_t>* word, uint32_t value,
+              const timespec* timeout) {
+  return syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT,
+                 value, timeout, nullptr, 0);
+}
+
+void futexWake(std::atomic<uint32_t>* word) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX,
+          nullptr, nullptr, 0);
+}
+
+// Wakes up the waiters on seq if the waiting flag is set. The caller must
+// have published the change that they are waiting for first.
+void wake(std::atomic<uint32_t>* seq, std::atomic<uint32_t>* waiting) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiting->load(std::memory_order_relaxed) != 0) {
+    seq->fetch_add(1, std::memory_order_seq_cst);
+    futexWake(seq);
+  }
+}
+
+}  // anonymous namespace
+
+namespace core {
+
+// Header is at the start of the shared memory. Ring 0 carries the data sent
+// by the creator, and ring 1 the data sent by the end that opened it.
+struct SharedMemoryConnection::Header {
+  std::atomic<uint32_t> magic;
+  uint32_t version;
+  std::atomic<uint32_t> pids[2];
+  uint64_t ringSizes[2];
+  uint64_t ringOffsets[2];
+};
+
+// Ring is the control block of a ring buffer. head and tail count the bytes
+// written and read since the connection was created, and the fields written
+// by each end are on different cache lines.
+struct SharedMemoryConnection::Ring {
+  // Written by the producer.
+  alignas(64) std::atomic<uint64_t> head;
+  // Written by the consumer.
+  alignas(64) std::atomic<uint64_t> tail;
+  // Futex that the consumer waits on for data, and whether it is waiting.
+  alignas(64) std::atomic<uint32_t> dataSeq;
+  std::atomic<uint32_t> consumerWaiting;
+  // Set by either end when it closes the connection.
+  std::atomic<uint32_t> closed;
+  // Futex that the producer waits on for space, and whether it is waiting.
+  alignas(64) std::atomic<uint32_t> spaceSeq;
+  std::atomic<uint32_t> producerWaiting;
+};
+
+namespace {
+
+// The offsets of the control blocks of the two rings.
+const size_t kRingOffsets[2] = {256, 512};
+
+}  // anonymous namespace
+
+std::unique_ptr<SharedMemoryConnection> SharedMemoryConnection::create(
+    size_t sendSize, size_t recvSize) {
+  sendSize = ringSize(sendSize);
+  recvSize = ringSize(recvSize);
+  const size_t size = kControlSize + sendSize + recvSize;
+
+  int fd = syscall(SYS_memfd_create, "gapid-connection", MFD_CLOEXEC);
+  if (fd < 0) {
+    GAPID_WARNING("memfd_create failed: %s", strerror(errno));
+    return nullptr;
+  }
+  if (ftruncate(fd, size) != 0) {
+    GAPID_WARNING("Failed to resize shared memory to %zu bytes: %s", size,
+                  strerror(errno));
+    ::close(fd);
+    return nullptr;
+  }
+  void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (memory == MAP_FAILED) {
+    GAPID_WARNING("Failed to map shared memory: %s", strerror(errno));
+    ::close(fd);
+    return nullptr;
+  }
+
+  // The file starts out zeroed, which is the initial state of the rings.
+  Header* header = reinterpret_cast<Header*>(memory);
+  header->version = kVersion;
+  header->pids[0].store(getpid(), std::memory_order_relaxed);
+  header->ringSizes[0] = sendSize;
+  header->ringSizes[1] = recvSize;
+  header->ringOffsets[0] = kControlSize;
+  header->ringOffsets[1] = kControlSize + sendSize;
+  header->magic.store(kMagic, std::memory_order_release);
+
+  return std::unique_ptr<SharedMemoryConnection>(new SharedMemoryConnection(
+      fd, reinterpret_cast<uint8_t*>(memory), size, true));
+}
+
+std::unique_ptr<SharedMemoryConnection> SharedMemoryConnection::open(
+    const char* path) {
+  int fd = ::open(path, O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    GAPID_WARNING("Failed to open shared memory %s: %s", path,
+                  strerror(errno));
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || size_t(st.st_size) < kControlSize) {
+    GAPID_WARNING("Shared memory %s is too small", path);
+    ::close(fd);
+    return nullptr;
+  }
+  const size_t size = st.st_size;
+  void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (memory == MAP_FAILED) {
+    GAPID_WARNING("Failed to map shared memory %s: %s", path, strerror(errno));
+    ::close(fd);
+    return nullptr;
+  }
+
+  Header* header = reinterpret_cast<Header*>(memory);
+  bool valid = header->magic.load(std::memory_order_acquire) == kMagic &&
+               header->version == kVersion;
+  for (int i = 0; valid && i < 2; i++) {
+    const uint64_t ringSize = header->ringSizes[i];
+    valid = ringSize != 0 && (ringSize & (ringSize - 1)) == 0 &&
+            header->ringOffsets[i] >= kControlSize &&
+            header->ringOffsets[i] <= size &&
+            ringSize <= size - header->ringOffsets[i];
+  }
+  if (!valid) {
+    GAPID_WARNING("Shared memory %s is not a connection", path);
+    munmap(memory, size);
+    ::close(fd);
+    return nullptr;
+  }
+  header->pids[1].store(getpid(), std::memory_order_release);
+
+  return std::unique_ptr<SharedMemoryConnection>(new SharedMemoryConnection(
+      fd, reinterpret_cast<uint8_t*>(memory), size, false));
+}
+
+SharedMemoryConnection::SharedMemoryConnection(int fd, uint8_t* memory,
+                                               size_t size, bool creator)
+    : mFd(fd),
+      mMemory(memory),
+      mSize(size),
+      mHeader(reinterpret_cast<Header*>(memory)),
+      mEnd(creator ? 0 : 1),
+      mPeerExited(false) {
+  static_assert(sizeof(Header) <= 256, "header overlaps the first ring");
+  static_assert(sizeof(Ring) == 256, "ring layout differs from gapii/client");
+  const int send = mEnd;
+  const int recv = 1 - mEnd;
+  mSend = reinterpret_cast<Ring*>(memory + kRingOffsets[send]);
+  mRecv = reinterpret_cast<Ring*>(memory + kRingOffsets[recv]);
+  mSendData = memory + mHeader->ringOffsets[send];
+  mRecvData = memory + mHeader->ringOffsets[recv];
+  mSendSize = mHeader->ringSizes[send];
+  mRecvSize = mHeader->ringSizes[recv];
+}
+
+SharedMemoryConnection::~SharedMemoryConnection() {
+  close();
+  munmap(mMemory, mSize);
+  ::close(mFd);
+}
+
+std::string SharedMemoryConnection::path() const {
+  return "/proc/" + std::to_string(getpid()) + "/fd/" + std::to_string(mFd);
+}
+
+size_t SharedMemoryConnection::write(const void* data, size_t size) {
+  const uint8_t* in = reinterpret_cast<const uint8_t*>(data);
+  size_t done = 0;
+  while (done < size && !closed(mSend)) {
+    const uint64_t head = mSend->head.load(std::memory_order_relaxed);
+    const uint64_t tail = mSend->tail.load(std::memory_order_acquire);
+    const size_t space = mSendSize - size_t(head - tail);
+    if (space == 0) {
+      // Let the consumer drain what has been written so far, then sleep
+      // until it has made some space.
+      flush();
+      const uint32_t seq = mSend->spaceSeq.load(std::memory_order_seq_cst);
+      mSend->producerWaiting.store(1, std::memory_order_seq_cst);
+      if (mSend->tail.load(std::memory_order_seq_cst) == tail) {
+        wait(&mSend->spaceSeq, seq);
+      }
+      mSend->producerWaiting.store(0, std::memory_order_relaxed);
+      continue;
+    }
+    const size_t n = std::min(space, size - done);
+    const size_t offset = size_t(head) & (mSendSize - 1);
+    const size_t first = std::min(n, mSendSize - offset);
+    memcpy(mSendData + offset, in + done, first);
+    memcpy(mSendData, in + done + first, n - first);
+    mSend->head.store(head + n, std::memory_order_release);
+    done += n;
+  }
+  return done;
+}
+
+void SharedMemoryConnection::flush() {
+  wake(&mSend->dataSeq, &mSend->consumerWaiting);
+}
+
+size_t SharedMemoryConnection::send(const void* data, size_t size) {
+  size_t sent = write(data, size);
+  flush();
+  return sent;
+}
+
+size_t SharedMemoryConnection::sendv(const ConstBuffer* buffers,
+                                     size_t count) {
+  size_t total = 0;
+  for (size_t i = 0; i < count; i++) {
+    const size_t sent = write(buffers[i].data, buffers[i].size);
+    total += sent;
+    if (sent != buffers[i].size) {
+      break;
+    }
+  }
+  flush();
+  return total;
+}
+
+size_t SharedMemoryConnection::recv(void* data, size_t size) {
+  uint8_t* out = reinterpret_cast<uint8_t*>(data);
+  size_t done = 0;
+  while (done < size) {
+    const uint64_t tail = mRecv->tail.load(std::memory_order_relaxed);
+    const uint64_t head = mRecv->head.load(std::memory_order_acquire);
+    if (head == tail) {
+      if (closed(mRecv)) {
+        // Data written before the close is still received.
+        if (mRecv->head.load(std::memory_order_acquire) == tail) {
+          break;
+        }
+        continue;
+      }
+      const uint32_t seq = mRecv->dataSeq.load(std::memory_order_seq_cst);
+      mRecv->consumerWaiting.store(1, std::memory_order_seq_cst);
+      if (mRecv->head.load(std::memory_order_seq_cst) == tail) {
+        wait(&mRecv->dataSeq, seq);
+      }
+      mRecv->consumerWaiting.store(0, std::memory_order_relaxed);
+      continue;
+    }
+    const size_t n = std::min(size_t(head - tail), size - done);
+    const size_t offset = size_t(tail) & (mRecvSize - 1);
+    const size_t first = std::min(n, mRecvSize - offset);
+    memcpy(out + done, mRecvData + offset, first);
+    memcpy(out + done + first, mRecvData, n - first);
+    mRecv->tail.store(tail + n, std::memory_order_release);
+    wake(&mRecv->spaceSeq, &mRecv->producerWaiting);
+    done += n;
+  }
+  return done;
+}
+
+void SharedMemoryConnection::wait(std::atomic<uint32_t>* seq, uint32_t value) {
+  timespec timeout = {0, kWaitTimeoutNs};
+  if (futexWait(seq, value, &timeout) != 0 && errno == ETIMEDOUT &&
+      peerExited()) {
+    mPeerExited.store(true, std::memory_order_release);
+  }
+}
+
+bool SharedMemoryConnection::closed(const Ring* ring) const {
+  return ring->closed.load(std::memory_order_acquire) != 0 ||
+         mPeerExited.load(std::memory_order_acquire);
+}
+
+bool SharedMemoryConnection::peerExited() const {
+  const pid_t pid = mHeader->pids[1 - mEnd].load(std::memory_order_acquire);
+  // The other end has not opened the connection yet.
+  if (pid == 0) {
+    return false;
+  }
+  // A process that has exited stays a zombie until its parent waits for it,
+  // and kill still succeeds for it, so check its state instead.
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+  FILE* file = fopen(path, "r");
+  if (file == nullptr) {
+    return errno == ENOENT;
+  }
+  char stat[512];
+  size_t size = fread(stat, 1, sizeof(stat) - 1, file);
+  fclose(file);
+  stat[size] = '\0';
+  // The state follows the command name, which is in parentheses.
+  const char* end = strrchr(stat, ')');
+  return end != nullptr && end[1] == ' ' && end[2] == 'Z';
+}
+
+const char* SharedMemoryConnection::error() {
+  if (mPeerExited.load(std::memory_order_acquire)) {
+    return "the process at the other end of the connection exited";
+  }
+  if (closed(mSend) || closed(mRecv)) {
+    return "connection closed";
+  }
+  return "";
+}
+
+std::unique_ptr<Connection> SharedMemoryConnection::accept(int) {
+  return nullptr;
+}
+
+void SharedMemoryConnection::close() {
+  for (Ring* ring : {mSend, mRecv}) {
+    if (ring->closed.exchange(1, std::memory_order_seq_cst) == 0) {
+      ring->dataSeq.fetch_add(1, std::memory_order_seq_cst);
+      ring->spaceSeq.fetch_add(1, std::memory_order_seq_cst);
+      futexWake(&ring->dataSeq);
+      futexWake(&ring->spaceSeq);
+    }
+  }
+}
+
+}  // namespace core
+
+#else  // TARGET_OS == GAPID_OS_LINUX
+
+namespace core {
+
+struct SharedMemoryConnection::Header {};
+struct SharedMemoryConnection::Ring {};
+
+std::unique_ptr<SharedMemoryConnection> SharedMemoryConnection::create(
+    size_t, size_t) {
+  return nullptr;
+}
+
+std::unique_ptr<SharedMemoryConnection> SharedMemoryConnection::open(
+    const char*) {
+  return nullptr;
+}
+
+SharedMemoryConnection::~SharedMemoryConnection() {}
+
+std::string SharedMemoryConnection::path() const { return ""; }
+
+size_t SharedMemoryConnection::send(const void*, size_t) { return 0; }
+size_t SharedMemoryConnection::recv(void*, size_t) { return 0; }
+size_t SharedMemoryConnection::sendv(const ConstBuffer*, size_t) { return 0; }
+const char* SharedMemoryConnection::error() {
+  return "shared memory connections are not supported";
+}
+std::unique_ptr<Connection> SharedMemoryConnection::accept(int) {
+  return nullptr;
+}
+void SharedMemoryConnection::close() {}
+
+}  // namespace core
+
+#endif  // TARGET_OS == GAPID_OS_LINUX
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CORE_SHARED_MEMORY_CONNECTION_H
+#define CORE_SHARED_MEMORY_CONNECTION_H
+
+#include "connection.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <string>
+
+namespace core {
+
+// SharedMemoryConnection is a connection between two processes on the same
+// Linux machine through a shared memory file. Each direction is a ring
+// buffer with a single producer and a single consumer, so data is copied
+// once on each side instead of going through the kernel. A blocked end
+// sleeps on a futex in the shared memory and is only woken by the other end
+// when it is waiting.
+//
+// One process creates the shared memory and sends its path to the other,
+// which opens it through /proc/<pid>/fd/<fd>. An end that is blocked treats
+// the connection as closed when the other process exits.
+//
+// The layout of the shared memory is read by gapii/client in Go, so it must
+// be kept in sync with shared_memory_linux.go.
+//
+// Shared memory connections are only supported on Linux. Elsewhere create
+// and open return nullptr.
+class SharedMemoryConnection : public Connection {
+ public:
+  ~SharedMemoryConnection();
+
+  // Creates the shared memory of a new connection, with a ring of sendSize
+  // bytes for the data sent by the returned end and one of recvSize bytes for
+  // the data that it receives. Sizes are rounded up to a power of two pages.
+  // Returns nullptr on error.
+  static std::unique_ptr<SharedMemoryConnection> create(size_t sendSize,
+                                                        size_t recvSize);
+
+  // Opens the other end of a connection from the path of its shared memory
+  // file. Returns nullptr on error.
+  static std::unique_ptr<SharedMemoryConnection> open(const char* path);
+
+  // Returns the file descriptor of the shared memory file.
+  inline int fd() const { return mFd; }
+
+  // Returns the path that other processes open the connection with.
+  std::string path() const;
+
+  // Implementation of the Connection interface
+  size_t send(const void* data, size_t size) override;
+  size_t recv(void* data, size_t size) override;
+  size_t sendv(const ConstBuffer* buffers, size_t count) override;
+  const char* error() override;
+  // Shared memory connections do not accept connections, this always returns
+  // nullptr.
+  std::unique_ptr<Connection> accept(int timeoutMs = NO_TIMEOUT) override;
+
+  // Marks both directions as closed and wakes up the other end.
+  void close() override;
+
+ private:
+  struct Header;
+  struct Ring;
+
+  SharedMemoryConnection(int fd, uint8_t* memory, size_t size, bool creator);
+
+  // Copies size bytes from data into the ring, blocking while it is full.
+  // Returns the number of bytes copied, which is less than size if the
+  // connection closed.
+  size_t write(const void* data, size_t size);
+
+  // Wakes up the consumer of the send ring if it is waiting for data.
+  void flush();
+
+  // Blocks until the futex word seq no longer holds value, the other end
+  // wakes this one up, or a short timeout expires, after which it checks
+  // whether the other process is still running.
+  void wait(std::atomic<uint32_t>* seq, uint32_t value);
+
+  // Returns true if ring is closed or the other end has gone away.
+  bool closed(const Ring* ring) const;
+
+  // Returns true if the process at the other end has exited.
+  bool peerExited() const;
+
+  int mFd;
+  uint8_t* mMemory;
+  size_t mSize;
+  Header* mHeader;
+
+  // The rings that this end produces and consumes.
+  Ring* mSend;
+  Ring* mRecv;
+  uint8_t* mSendData;
+  uint8_t* mRecvData;
+  size_t mSendSize;
+  size_t mRecvSize;
+
+  // The index of this end's process id in the header.
+  int mEnd;
+
+  // Set once the process at the other end has been found to have exited.
+  std::atomic<bool> mPeerExited;
+};
+
+}  // namespace core
+
+#endif  // CORE_SHARED_MEMORY_CONNECTION_H
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "shared_memory_connection.h"
+
+#include "core/cc/target.h"
+
+#if TARGET_OS == GAPID_OS_LINUX
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace core {
+namespace test {
+namespace {
+
+class SharedMemoryConnectionTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // Small rings, so that the data wraps around and both ends block.
+    mCreator = SharedMemoryConnection::create(4096, 4096);
+    ASSERT_NE(nullptr, mCreator);
+    // Opening the file through /proc maps it a second time, as the other
+    // process would.
+    mOpener = SharedMemoryConnection::open(mCreator->path().c_str());
+    ASSERT_NE(nullptr, mOpener);
+  }
+
+  // Returns random data made up of count chunks of random sizes, some of
+  // them empty and some larger than the rings, and sets chunks to the sizes.
+  static std::string makeData(size_t count, std::vector<size_t>* chunks) {
+    std::mt19937 rng(1);
+    std::string data;
+    for (size_t i = 0; i < count; i++) {
+      size_t size = rng() % 8 == 0 ? 0 : rng() % 3000;
+      if (i % 100 == 0) {
+        size = 100000;
+      }
+      chunks->push_back(size);
+      for (size_t j = 0; j < size; j++) {
+        data.push_back(static_cast<char>(rng()));
+      }
+    }
+    return data;
+  }
+
+  std::unique_ptr<SharedMemoryConnection> mCreator;
+  std::unique_ptr<SharedMemoryConnection> mOpener;
+};
+
+TEST_F(SharedMemoryConnectionTest, Stream) {
+  std::vector<size_t> chunks;
+  const std::string data = makeData(5000, &chunks);
+
+  std::thread writer([&] {
+    // Send some runs of chunks with send and others with sendv.
+    std::vector<Connection::ConstBuffer> buffers;
+    auto flush = [&] {
+      size_t size = 0;
+      for (const auto& buffer : buffers) {
+        size += buffer.size;
+      }
+      EXPECT_EQ(size, mCreator->sendv(buffers.data(), buffers.size()));
+      buffers.clear();
+    };
+    size_t offset = 0;
+    for (size_t i = 0; i < chunks.size(); i++) {
+      if ((i / 16) % 2 == 0) {
+        EXPECT_EQ(chunks[i], mCreator->send(data.data() + offset, chunks[i]));
+      } else {
+        buffers.push_back({data.data() + offset, chunks[i]});
+        if (buffers.size() == 16) {
+          flush();
+        }
+      }
+      offset += chunks[i];
+    }
+    flush();
+    mCreator->close();
+  });
+
+  std::mt19937 rng(2);
+  std::string received;
+  std::vector<char> buffer(20000);
+  while (true) {
+    size_t size = rng() % buffer.size() + 1;
+    size_t n = mOpener->recv(buffer.data(), size);
+    received.append(buffer.data(), n);
+    if (n != size) {
+      break;
+    }
+  }
+  writer.join();
+  EXPECT_EQ(data.size(), received.size());
+  EXPECT_TRUE(data == received);
+}
+
+TEST_F(SharedMemoryConnectionTest, BothDirections) {
+  const int kMessages = 10000;
+  std::thread echo([&] {
+    uint32_t value;
+    while (mOpener->recv(&value, sizeof(value)) == sizeof(value)) {
+      value++;
+      ASSERT_EQ(sizeof(value), mOpener->send(&value, sizeof(value)));
+    }
+  });
+  for (uint32_t i = 0; i < kMessages; i++) {
+    uint32_t value = i;
+    ASSERT_EQ(sizeof(value), mCreator->send(&value, sizeof(value)));
+    ASSERT_EQ(sizeof(value), mCreator->recv(&value, sizeof(value)));
+    EXPECT_EQ(i + 1, value);
+  }
+  mCreator->close();
+  echo.join();
+}
+
+TEST_F(SharedMemoryConnectionTest, RecvAfterClose) {
+  char buffer[16];
+  ASSERT_EQ(10u, mCreator->send("0123456789", 10));
+  mCreator->close();
+  EXPECT_EQ(10u, mOpener->recv(buffer, sizeof(buffer)));
+  EXPECT_EQ("0123456789", std::string(buffer, 10));
+  EXPECT_EQ(0u, mOpener->recv(buffer, sizeof(buffer)));
+  EXPECT_EQ(0u, mOpener->send(buffer, sizeof(buffer)));
+}
+
+TEST_F(SharedMemoryConnectionTest, SendBlocksUntilClose) {
+  std::thread closer([&] {
+    // The data does not fit in the ring, so the sender is left blocked
+    // until the close.
+    char byte;
+    ASSERT_EQ(1u, mOpener->recv(&byte, 1));
+    mOpener->close();
+  });
+  std::string data(100000, 'x');
+  size_t sent = mCreator->send(data.data(), data.size());
+  closer.join();
+  EXPECT_LT(sent, data.size());
+}
+
+TEST(SharedMemoryConnectionOpenTest, NotAConnection) {
+  EXPECT_EQ(nullptr, SharedMemoryConnection::open("/proc/self/stat"));
+  EXPECT_EQ(nullptr, SharedMemoryConnection::open("/does/not/exist"));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace core
+
+#endif  // TARGET_OS == GAPID_OS_LINUX
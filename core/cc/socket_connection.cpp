@@ -23,6 +23,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <algorithm>
+
 #if TARGET_OS == GAPID_OS_WINDOWS
 
 #define _WSPIAPI_EMIT_LEGACY
@@ -32,13 +34,23 @@
 #else  // TARGET_OS == GAPID_OS_WINDOWS
 
 #include <errno.h>
+#include <limits.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
 
+#if TARGET_OS == GAPID_OS_LINUX && defined(SO_ZEROCOPY) && \
+    defined(MSG_ZEROCOPY)
+#include <linux/errqueue.h>
+#define GAPID_SOCKET_ZERO_COPY
+#endif
+
 #endif  // TARGET_OS == GAPID_OS_WINDOWS
 
 namespace core {
@@ -99,6 +111,93 @@ size_t send(int sockfd, const void* buf, size_t len, int flags) {
 #endif  // TARGET_OS == GAPID_OS_WINDOWS
 }
 
+#if TARGET_OS != GAPID_OS_WINDOWS
+
+// The most buffers passed to a single sendmsg or recvmsg.
+#ifdef IOV_MAX
+const size_t kMaxIovecs = IOV_MAX < 1024 ? IOV_MAX : 1024;
+#else
+const size_t kMaxIovecs = 16;
+#endif
+
+// Moves the start of the message on by n bytes, dropping the buffers that
+// have been used up and any empty ones after them.
+void advance(msghdr* msg, size_t n) {
+  while (msg->msg_iovlen > 0 && n >= msg->msg_iov->iov_len) {
+    n -= msg->msg_iov->iov_len;
+    msg->msg_iov++;
+    msg->msg_iovlen--;
+  }
+  if (msg->msg_iovlen > 0) {
+    msg->msg_iov->iov_base = static_cast<char*>(msg->msg_iov->iov_base) + n;
+    msg->msg_iov->iov_len -= n;
+  }
+}
+
+// Sends all of the count buffers in iov, which it modifies. Returns the
+// number of bytes sent, and adds the number of successful sendmsg calls made
+// with MSG_ZEROCOPY to calls.
+size_t sendv(int sockfd, iovec* iov, size_t count, int flags,
+             uint32_t* calls) {
+  msghdr msg{};
+  msg.msg_iov = iov;
+  msg.msg_iovlen = count;
+  advance(&msg, 0);
+  size_t result = 0;
+  while (msg.msg_iovlen > 0) {
+    const ssize_t n = ::sendmsg(sockfd, &msg, flags);
+    if (n == -1) {
+      if (errno == EINTR) {
+        // A signal occurred before any data was transmitted - retry.
+        continue;
+      }
+#ifdef GAPID_SOCKET_ZERO_COPY
+      if (errno == ENOBUFS && (flags & MSG_ZEROCOPY) != 0) {
+        // Out of memory for pinning pages, copy instead.
+        flags &= ~MSG_ZEROCOPY;
+        continue;
+      }
+#endif  // GAPID_SOCKET_ZERO_COPY
+      return result;
+    }
+    // A signal after some data was transmitted can result in partial send.
+    if (flags != 0) {
+      (*calls)++;
+    }
+    result += n;
+    advance(&msg, n);
+  }
+  return result;
+}
+
+// Fills all of the count buffers in iov, which it modifies. Returns the
+// number of bytes received.
+size_t recvv(int sockfd, iovec* iov, size_t count) {
+  msghdr msg{};
+  msg.msg_iov = iov;
+  msg.msg_iovlen = count;
+  advance(&msg, 0);
+  size_t result = 0;
+  while (msg.msg_iovlen > 0) {
+    const ssize_t n = ::recvmsg(sockfd, &msg, MSG_WAITALL);
+    if (n == 0) {
+      // The connection was closed.
+      return result;
+    }
+    if (n == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return result;
+    }
+    result += n;
+    advance(&msg, n);
+  }
+  return result;
+}
+
+#endif  // TARGET_OS != GAPID_OS_WINDOWS
+
 int accept(int sockfd, int timeoutMs) {
   if (timeoutMs != Connection::NO_TIMEOUT) {
     fd_set set;
@@ -164,7 +263,43 @@ int getsockname(int sockfd, struct sockaddr* addr, socklen_t* addrlen) {
 
 }  // anonymous namespace
 
-SocketConnection::SocketConnection(int socket) : mSocket(socket) {}
+SocketConnection::SocketConnection(int socket, bool tcp,
+                                   const Options& options)
+    : mSocket(socket),
+      mTcp(tcp),
+      mOptions(options),
+      mZeroCopySends(0),
+      mZeroCopyDone(0) {}
+
+void SocketConnection::configure() {
+  if (mTcp && mOptions.noDelay) {
+    const int one = 1;
+    if (-1 == core::setsockopt(mSocket, IPPROTO_TCP, TCP_NODELAY, &one,
+                               sizeof(one))) {
+      GAPID_WARNING("setsockopt(TCP_NODELAY) failed: %s",
+                    strerror(core::error()));
+    }
+  }
+  if (mOptions.sendBufferSize > 0) {
+    if (-1 == core::setsockopt(mSocket, SOL_SOCKET, SO_SNDBUF,
+                               &mOptions.sendBufferSize,
+                               sizeof(mOptions.sendBufferSize))) {
+      GAPID_WARNING("setsockopt(SO_SNDBUF) failed: %s",
+                    strerror(core::error()));
+    }
+  }
+  if (mOptions.zeroCopyThreshold > 0) {
+#ifdef GAPID_SOCKET_ZERO_COPY
+    const int one = 1;
+    if (!mTcp || -1 == core::setsockopt(mSocket, SOL_SOCKET, SO_ZEROCOPY,
+                                        &one, sizeof(one))) {
+      mOptions.zeroCopyThreshold = 0;
+    }
+#else   // GAPID_SOCKET_ZERO_COPY
+    mOptions.zeroCopyThreshold = 0;
+#endif  // GAPID_SOCKET_ZERO_COPY
+  }
+}
 
 SocketConnection::~SocketConnection() { core::close(mSocket); }
 
@@ -176,6 +311,114 @@ size_t SocketConnection::recv(void* data, size_t size) {
   return core::recv(mSocket, data, size, MSG_WAITALL);
 }
 
+size_t SocketConnection::sendv(const ConstBuffer* buffers, size_t count) {
+#if TARGET_OS == GAPID_OS_WINDOWS
+  return Connection::sendv(buffers, count);
+#else   // TARGET_OS == GAPID_OS_WINDOWS
+  int flags = 0;
+#ifdef GAPID_SOCKET_ZERO_COPY
+  if (mOptions.zeroCopyThreshold > 0) {
+    size_t size = 0;
+    for (size_t i = 0; i < count; i++) {
+      size += buffers[i].size;
+    }
+    if (size >= mOptions.zeroCopyThreshold) {
+      flags = MSG_ZEROCOPY;
+    }
+  }
+#endif  // GAPID_SOCKET_ZERO_COPY
+
+  iovec iov[kMaxIovecs];
+  size_t total = 0;
+  for (size_t start = 0; start < count; start += kMaxIovecs) {
+    const size_t n = std::min(count - start, kMaxIovecs);
+    size_t size = 0;
+    for (size_t i = 0; i < n; i++) {
+      iov[i].iov_base = const_cast<void*>(buffers[start + i].data);
+      iov[i].iov_len = buffers[start + i].size;
+      size += iov[i].iov_len;
+    }
+    const size_t sent = core::sendv(mSocket, iov, n, flags, &mZeroCopySends);
+    total += sent;
+    if (sent != size) {
+      break;
+    }
+  }
+  if (flags != 0 && !waitForZeroCopy()) {
+    GAPID_WARNING("Failed waiting for zero-copy sends: %s",
+                  strerror(core::error()));
+  }
+  return total;
+#endif  // TARGET_OS == GAPID_OS_WINDOWS
+}
+
+size_t SocketConnection::recvv(const Buffer* buffers, size_t count) {
+#if TARGET_OS == GAPID_OS_WINDOWS
+  return Connection::recvv(buffers, count);
+#else   // TARGET_OS == GAPID_OS_WINDOWS
+  iovec iov[kMaxIovecs];
+  size_t total = 0;
+  for (size_t start = 0; start < count; start += kMaxIovecs) {
+    const size_t n = std::min(count - start, kMaxIovecs);
+    size_t size = 0;
+    for (size_t i = 0; i < n; i++) {
+      iov[i].iov_base = buffers[start + i].data;
+      iov[i].iov_len = buffers[start + i].size;
+      size += iov[i].iov_len;
+    }
+    const size_t received = core::recvv(mSocket, iov, n);
+    total += received;
+    if (received != size) {
+      break;
+    }
+  }
+  return total;
+#endif  // TARGET_OS == GAPID_OS_WINDOWS
+}
+
+bool SocketConnection::waitForZeroCopy() {
+#ifdef GAPID_SOCKET_ZERO_COPY
+  // The kernel reports the sends it is done with as ranges of their sequence
+  // numbers on the socket's error queue.
+  while (mZeroCopyDone != mZeroCopySends) {
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(sock_extended_err)) * 4];
+    msghdr msg{};
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (-1 == ::recvmsg(mSocket, &msg, MSG_ERRQUEUE)) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        pollfd fd{};
+        fd.fd = mSocket;
+        // The error queue signals POLLERR, which is always polled for.
+        if (-1 == ::poll(&fd, 1, -1) && errno != EINTR) {
+          return false;
+        }
+        continue;
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      const sock_extended_err* err =
+          reinterpret_cast<const sock_extended_err*>(CMSG_DATA(cmsg));
+      if (err->ee_errno != 0 || err->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+        continue;
+      }
+      mZeroCopyDone += err->ee_data - err->ee_info + 1;
+      if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+        // The data was copied anyway, so waiting for the kernel only adds
+        // to the cost of each send.
+        mOptions.zeroCopyThreshold = 0;
+      }
+    }
+  }
+#endif  // GAPID_SOCKET_ZERO_COPY
+  return true;
+}
+
 const char* SocketConnection::error() { return strerror(core::error()); }
 
 void SocketConnection::close() {
@@ -194,13 +437,16 @@ std::unique_ptr<Connection> SocketConnection::accept(
     case ACCEPT_TIMEOUT:
       GAPID_INFO("Timeout accepting incoming connection");
       return nullptr;
-    default:
-      return std::unique_ptr<Connection>(new SocketConnection(clientSocket));
+    default: {
+      auto connection = new SocketConnection(clientSocket, mTcp, mOptions);
+      connection->configure();
+      return std::unique_ptr<Connection>(connection);
+    }
   }
 }
 
-std::unique_ptr<Connection> SocketConnection::createSocket(const char* hostname,
-                                                           const char* port) {
+std::unique_ptr<Connection> SocketConnection::createSocket(
+    const char* hostname, const char* port, const Options& options) {
   // Network initializer to ensure that the network driver is initialized during
   // the lifetime of the create function. If the connection created successfully
   // then the new connection will hold a reference to a networkInitializer
@@ -272,7 +518,8 @@ std::unique_ptr<Connection> SocketConnection::createSocket(const char* hostname,
   }
 
   sockScopeGuard.release();
-  return std::unique_ptr<Connection>(new SocketConnection(sock));
+  return std::unique_ptr<Connection>(
+      new SocketConnection(sock, true, options));
 }
 
 uint32_t SocketConnection::getFreePort(const char* hostname) {
@@ -334,8 +581,8 @@ uint32_t SocketConnection::getFreePort(const char* hostname) {
   return ntohs(sin.sin_port);
 }
 
-std::unique_ptr<Connection> SocketConnection::createPipe(const char* pipename,
-                                                         bool abstract) {
+std::unique_ptr<Connection> SocketConnection::createPipe(
+    const char* pipename, bool abstract, const Options& options) {
 #if TARGET_OS == GAPID_OS_WINDOWS
   // AF_UNIX is not supported on Windows.
   return nullptr;
@@ -382,7 +629,8 @@ std::unique_ptr<Connection> SocketConnection::createPipe(const char* pipename,
   }
 
   sockScopeGuard.release();
-  return std::unique_ptr<Connection>(new SocketConnection(sock));
+  return std::unique_ptr<Connection>(
+      new SocketConnection(sock, false, options));
 #endif  // TARGET_OS == GAPID_OS_WINDOWS
 }
 
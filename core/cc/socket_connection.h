@@ -19,6 +19,7 @@
 
 #include "connection.h"
 
+#include <stddef.h>
 #include <stdint.h>
 #include <memory>
 
@@ -27,13 +28,35 @@ namespace core {
 // Connection object using a native socket
 class SocketConnection : public Connection {
  public:
+  // Options configures the connections returned by accept.
+  struct Options {
+    Options() : noDelay(true), sendBufferSize(0), zeroCopyThreshold(0) {}
+
+    // Turns off Nagle's algorithm on TCP connections, so that small sends go
+    // out without waiting for earlier ones to be acknowledged.
+    bool noDelay;
+
+    // The size of the kernel send buffer in bytes, or 0 to keep the system
+    // default. On Linux, setting it turns off the automatic sizing of TCP
+    // send buffers, and it is capped by net.core.wmem_max.
+    int sendBufferSize;
+
+    // sendv calls sending at least this many bytes use MSG_ZEROCOPY on Linux
+    // TCP connections, or 0 to always copy. The kernel then reads the
+    // buffers in place, and sendv waits until it is done with them. This is
+    // turned off for the connection if the kernel reports that it copied
+    // the data anyway, as it does over loopback.
+    size_t zeroCopyThreshold;
+  };
+
   ~SocketConnection();
 
   // Creates a new socket connection listening on the specified hostname and
   // port. Returns a connection object on successful open or a nullptr if
   // opening the connection is unsuccessful
-  static std::unique_ptr<Connection> createSocket(const char* hostname,
-                                                  const char* port);
+  static std::unique_ptr<Connection> createSocket(
+      const char* hostname, const char* port,
+      const Options& options = Options());
 
   // Returns a free port to use with the given hostname. In case of error,
   // returns 0
@@ -43,20 +66,30 @@ class SocketConnection : public Connection {
   // without pipe creation on the local file system if abstract is true. Returns
   // a connection object on successful open or a nullptr if opening the
   // connection is unsuccessful
-  static std::unique_ptr<Connection> createPipe(const char* pipename,
-                                                bool abstract);
+  static std::unique_ptr<Connection> createPipe(
+      const char* pipename, bool abstract, const Options& options = Options());
 
   // Implementation of the Connection interface
   size_t send(const void* data, size_t size) override;
   size_t recv(void* data, size_t size) override;
+  size_t sendv(const ConstBuffer* buffers, size_t count) override;
+  size_t recvv(const Buffer* buffers, size_t count) override;
   const char* error() override;
   std::unique_ptr<Connection> accept(int timeoutMs = NO_TIMEOUT) override;
 
   void close() override;
 
  private:
-  // Private constructor used only by the static create function
-  explicit SocketConnection(int socket);
+  // Private constructor used only by the static create function. tcp is true
+  // for TCP sockets, and options configure the sockets that are accepted.
+  SocketConnection(int socket, bool tcp, const Options& options);
+
+  // Applies the options to this connection's socket.
+  void configure();
+
+  // Waits until the kernel has finished with the buffers of the zero-copy
+  // sends so far. Returns false on error.
+  bool waitForZeroCopy();
 
   // Network initializer class to handle the initialization of the network
   // driver. A socket function can be called only if there is at least one
@@ -69,6 +102,14 @@ class SocketConnection : public Connection {
   // The underlying socket for the connection
   int mSocket;
 
+  bool mTcp;
+  Options mOptions;
+
+  // The number of sends made with MSG_ZEROCOPY, and the number that the
+  // kernel has reported as done.
+  uint32_t mZeroCopySends;
+  uint32_t mZeroCopyDone;
+
   // Network initializer instance lasts for the lifetime of the connection
   NetworkInitializer mNetworkInitializer;
 };
@@ -0,0 +1,310 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// socket-bench streams a synthetic capture over loopback TCP, a UNIX pipe
+// and, on Linux, a shared memory connection, and reports the throughput. The stream is a mix of small command chunks
+// and large memory observations, each with a short size header in front, as
+// the gapii chunk writer sends them. Each chunk is either copied into a
+// 32KiB buffer that is sent with send, or, if it is large, sent from where
+// it is with sendv.
+
+#include "shared_memory_connection.h"
+#include "socket_connection.h"
+#include "target.h"
+#include "timer.h"
+
+#if TARGET_OS == GAPID_OS_WINDOWS
+
+int main(int, char**) { return 0; }
+
+#else  // TARGET_OS == GAPID_OS_WINDOWS
+
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// The number of bytes streamed by each measurement.
+const size_t kStreamSize = size_t(512) << 20;
+
+// The size of the buffer that small chunks are copied into.
+const size_t kBufferSize = 32 << 10;
+
+// Chunks of at least this size are sent in place by sendv.
+const size_t kGatherSize = 4 << 10;
+
+// The most buffers sent by a single sendv.
+const size_t kMaxBuffers = 64;
+
+const char* kPipeName = "socket-bench";
+
+// The size of the ring that carries the stream over shared memory. Larger
+// rings are slower, as the data no longer stays in the cache between the
+// write and the read.
+const size_t kRingSize = 256 << 10;
+
+struct Chunk {
+  const char* data;
+  size_t size;
+};
+
+// Returns the chunks of the stream, which point into pool.
+std::vector<Chunk> makeChunks(const std::string& pool) {
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> percent(0, 99);
+  std::vector<Chunk> chunks;
+  size_t total = 0;
+  while (total < kStreamSize) {
+    size_t size;
+    int p = percent(rng);
+    if (p < 70) {
+      size = std::uniform_int_distribution<size_t>(40, 300)(rng);
+    } else if (p < 95) {
+      size = std::uniform_int_distribution<size_t>(300, 4000)(rng);
+    } else {
+      size = std::uniform_int_distribution<size_t>(16 << 10, 1 << 20)(rng);
+    }
+    size_t offset =
+        std::uniform_int_distribution<size_t>(0, pool.size() - size)(rng);
+    chunks.push_back(Chunk{pool.data() + offset, size});
+    total += size;
+  }
+  return chunks;
+}
+
+// Returns the varint size header of a chunk of size bytes.
+size_t header(size_t size, uint8_t* out) {
+  size_t n = 0;
+  uint64_t value = size << 1;
+  do {
+    out[n] = (value & 0x7f) | (value >= 0x80 ? 0x80 : 0);
+    value >>= 7;
+    n++;
+  } while (value != 0);
+  return n;
+}
+
+// Sends the chunks the way the chunk writer did before sendv: everything is
+// copied into a buffer that is sent when it fills up.
+size_t sendCopied(core::Connection* c, const std::vector<Chunk>& chunks) {
+  std::string buffer;
+  size_t sent = 0;
+  for (const Chunk& chunk : chunks) {
+    uint8_t head[16];
+    buffer.append(reinterpret_cast<char*>(head), header(chunk.size, head));
+    buffer.append(chunk.data, chunk.size);
+    if (buffer.size() >= kBufferSize) {
+      sent += c->send(buffer.data(), buffer.size());
+      buffer.clear();
+    }
+  }
+  sent += c->send(buffer.data(), buffer.size());
+  return sent;
+}
+
+// Sends the chunks with sendv, copying only the small ones.
+size_t sendGathered(core::Connection* c, const std::vector<Chunk>& chunks) {
+  std::vector<std::string> copies(kMaxBuffers);
+  std::vector<core::Connection::ConstBuffer> buffers;
+  size_t pending = 0;
+  size_t sent = 0;
+  std::string* copy = nullptr;
+  auto flush = [&] {
+    sent += c->sendv(buffers.data(), buffers.size());
+    buffers.clear();
+    copy = nullptr;
+    pending = 0;
+  };
+  auto add = [&](const char* data, size_t size) {
+    if (size >= kGatherSize) {
+      if (copy != nullptr) {
+        buffers.push_back({copy->data(), copy->size()});
+        copy = nullptr;
+      }
+      buffers.push_back({data, size});
+    } else {
+      if (copy == nullptr) {
+        copy = &copies[buffers.size()];
+        copy->clear();
+      }
+      copy->append(data, size);
+    }
+    pending += size;
+  };
+  for (const Chunk& chunk : chunks) {
+    uint8_t head[16];
+    add(reinterpret_cast<char*>(head), header(chunk.size, head));
+    add(chunk.data, chunk.size);
+    if (pending >= kBufferSize || buffers.size() >= kMaxBuffers - 2) {
+      if (copy != nullptr) {
+        buffers.push_back({copy->data(), copy->size()});
+      }
+      flush();
+    }
+  }
+  if (copy != nullptr) {
+    buffers.push_back({copy->data(), copy->size()});
+  }
+  flush();
+  return sent;
+}
+
+// Connects to the listening socket and reads until the connection closes.
+// Returns the number of bytes read.
+size_t readAll(int domain, uint32_t port) {
+  int fd = socket(domain, SOCK_STREAM, 0);
+  if (domain == AF_INET) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    while (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))) {
+      std::this_thread::yield();
+    }
+  } else {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path + 1, kPipeName, sizeof(addr.sun_path) - 2);
+    socklen_t len = sizeof(addr.sun_family) + strlen(kPipeName) + 1;
+    while (connect(fd, reinterpret_cast<sockaddr*>(&addr), len)) {
+      std::this_thread::yield();
+    }
+  }
+  std::vector<char> buffer(1 << 20);
+  size_t total = 0;
+  while (true) {
+    ssize_t n = recv(fd, buffer.data(), buffer.size(), 0);
+    if (n <= 0) {
+      break;
+    }
+    total += n;
+  }
+  close(fd);
+  return total;
+}
+
+void measure(const char* name, bool tcp, bool gather,
+             const core::SocketConnection::Options& options,
+             const std::vector<Chunk>& chunks) {
+  std::unique_ptr<core::Connection> listener;
+  uint32_t port = 0;
+  if (tcp) {
+    port = core::SocketConnection::getFreePort("127.0.0.1");
+    listener = core::SocketConnection::createSocket(
+        "127.0.0.1", std::to_string(port).c_str(), options);
+  } else {
+    listener = core::SocketConnection::createPipe(kPipeName, true, options);
+  }
+  if (listener == nullptr) {
+    fprintf(stderr, "%-40s failed to listen\n", name);
+    return;
+  }
+  size_t received = 0;
+  std::thread reader(
+      [&] { received = readAll(tcp ? AF_INET : AF_UNIX, port); });
+  std::unique_ptr<core::Connection> c = listener->accept();
+
+  uint64_t start = core::GetNanoseconds();
+  size_t sent = gather ? sendGathered(c.get(), chunks)
+                       : sendCopied(c.get(), chunks);
+  c->close();
+  reader.join();
+  uint64_t elapsed = core::GetNanoseconds() - start;
+  fprintf(stderr, "%-40s %8.1f MB/s%s\n", name,
+          double(sent) * 1000.0 / double(elapsed),
+          sent == received ? "" : "  (short read)");
+}
+
+#if TARGET_OS == GAPID_OS_LINUX
+
+void measureSharedMemory(const char* name, bool gather,
+                         const std::vector<Chunk>& chunks) {
+  auto c = core::SharedMemoryConnection::create(kRingSize, 4 << 10);
+  if (c == nullptr) {
+    fprintf(stderr, "%-40s failed to create\n", name);
+    return;
+  }
+  auto other = core::SharedMemoryConnection::open(c->path().c_str());
+  size_t received = 0;
+  std::thread reader([&] {
+    std::vector<char> buffer(1 << 20);
+    while (true) {
+      size_t n = other->recv(buffer.data(), buffer.size());
+      received += n;
+      if (n != buffer.size()) {
+        break;
+      }
+    }
+  });
+
+  uint64_t start = core::GetNanoseconds();
+  size_t sent = gather ? sendGathered(c.get(), chunks)
+                       : sendCopied(c.get(), chunks);
+  c->close();
+  reader.join();
+  uint64_t elapsed = core::GetNanoseconds() - start;
+  fprintf(stderr, "%-40s %8.1f MB/s%s\n", name,
+          double(sent) * 1000.0 / double(elapsed),
+          sent == received ? "" : "  (short read)");
+}
+
+#endif  // TARGET_OS == GAPID_OS_LINUX
+
+}  // anonymous namespace
+
+int main(int, char**) {
+  // Throw away the port messages that createSocket prints.
+  if (freopen("/dev/null", "w", stdout) == nullptr) {
+    return 1;
+  }
+
+  std::string pool(4 << 20, '\0');
+  std::mt19937 rng(2);
+  for (char& c : pool) {
+    c = static_cast<char>(rng());
+  }
+  std::vector<Chunk> chunks = makeChunks(pool);
+
+  core::SocketConnection::Options defaults;
+  core::SocketConnection::Options largeBuffer;
+  largeBuffer.sendBufferSize = 4 << 20;
+  core::SocketConnection::Options zeroCopy;
+  zeroCopy.zeroCopyThreshold = 64 << 10;
+
+  measure("tcp, send", true, false, defaults, chunks);
+  measure("tcp, sendv", true, true, defaults, chunks);
+  measure("tcp, sendv, 4MiB send buffer", true, true, largeBuffer, chunks);
+  measure("tcp, sendv, zero-copy", true, true, zeroCopy, chunks);
+  measure("pipe, send", false, false, defaults, chunks);
+  measure("pipe, sendv", false, true, defaults, chunks);
+  measure("pipe, sendv, 4MiB send buffer", false, true, largeBuffer, chunks);
+#if TARGET_OS == GAPID_OS_LINUX
+  measureSharedMemory("shared memory, send", false, chunks);
+  measureSharedMemory("shared memory, sendv", true, chunks);
+#endif  // TARGET_OS == GAPID_OS_LINUX
+  return 0;
+}
+
+#endif  // TARGET_OS == GAPID_OS_WINDOWS
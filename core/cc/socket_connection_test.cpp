@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "socket_connection.h"
+
+#include "core/cc/target.h"
+
+#if TARGET_OS != GAPID_OS_WINDOWS
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace core {
+namespace test {
+namespace {
+
+class SocketConnectionTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    mPath = ::testing::TempDir() + "socket_connection_test";
+    unlink(mPath.c_str());
+    auto listener = SocketConnection::createPipe(mPath.c_str(), false);
+    ASSERT_NE(nullptr, listener);
+
+    mClient = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, mPath.c_str(), sizeof(addr.sun_path) - 1);
+    ASSERT_EQ(0, connect(mClient, reinterpret_cast<sockaddr*>(&addr),
+                         sizeof(addr)));
+    mConnection = listener->accept();
+    ASSERT_NE(nullptr, mConnection);
+  }
+
+  void TearDown() override {
+    close(mClient);
+    unlink(mPath.c_str());
+  }
+
+  // Returns random data made up of count pieces of random sizes, some of
+  // them empty, and sets pieces to the sizes.
+  static std::string makeData(size_t count, std::vector<size_t>* pieces) {
+    std::mt19937 rng(1);
+    std::string data;
+    for (size_t i = 0; i < count; i++) {
+      size_t size = rng() % 8 == 0 ? 0 : rng() % 3000;
+      if (i % 500 == 0) {
+        // Large enough to fill the socket buffer part way through.
+        size = 1 << 20;
+      }
+      pieces->push_back(size);
+      for (size_t j = 0; j < size; j++) {
+        data.push_back(static_cast<char>(rng()));
+      }
+    }
+    return data;
+  }
+
+  std::string mPath;
+  int mClient;
+  std::unique_ptr<Connection> mConnection;
+};
+
+TEST_F(SocketConnectionTest, Sendv) {
+  std::vector<size_t> pieces;
+  const std::string data = makeData(3000, &pieces);
+  std::vector<Connection::ConstBuffer> buffers;
+  size_t offset = 0;
+  for (size_t size : pieces) {
+    buffers.push_back({data.data() + offset, size});
+    offset += size;
+  }
+
+  std::string received;
+  std::thread reader([&] {
+    char buffer[4096];
+    while (received.size() < data.size()) {
+      ssize_t n = recv(mClient, buffer, sizeof(buffer), 0);
+      if (n <= 0) {
+        break;
+      }
+      received.append(buffer, n);
+    }
+  });
+  EXPECT_EQ(data.size(), mConnection->sendv(buffers.data(), buffers.size()));
+  reader.join();
+  EXPECT_TRUE(data == received);
+}
+
+TEST_F(SocketConnectionTest, Recvv) {
+  std::vector<size_t> pieces;
+  const std::string data = makeData(3000, &pieces);
+  std::string received(data.size(), '\0');
+  std::vector<Connection::Buffer> buffers;
+  size_t offset = 0;
+  for (size_t size : pieces) {
+    buffers.push_back({&received[offset], size});
+    offset += size;
+  }
+
+  std::thread writer([&] {
+    // Send in small pieces, so that the receives come back short.
+    for (size_t i = 0; i < data.size(); i += 1000) {
+      size_t size = std::min<size_t>(1000, data.size() - i);
+      ASSERT_EQ(ssize_t(size), send(mClient, data.data() + i, size, 0));
+    }
+  });
+  EXPECT_EQ(data.size(), mConnection->recvv(buffers.data(), buffers.size()));
+  writer.join();
+  EXPECT_TRUE(data == received);
+}
+
+TEST_F(SocketConnectionTest, RecvvClosed) {
+  char buffer[16];
+  const Connection::Buffer buffers[] = {{buffer, 8}, {buffer + 8, 8}};
+  ASSERT_EQ(10, send(mClient, "0123456789", 10, 0));
+  close(mClient);
+  mClient = -1;
+  EXPECT_EQ(10u, mConnection->recvv(buffers, 2));
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace core
+
+#endif  // TARGET_OS != GAPID_OS_WINDOWS
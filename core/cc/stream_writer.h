@@ -17,6 +17,7 @@
 #ifndef CORE_STREAM_WRITER_H
 #define CORE_STREAM_WRITER_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 namespace core {
@@ -24,12 +25,24 @@ namespace core {
 // StreamWriter is a pure-virtual interface used to write data streams.
 class StreamWriter {
  public:
+  // Buffer is one of the buffers written by writev.
+  struct Buffer {
+    const void* data;
+    uint64_t size;
+  };
+
   // write attempts to write size bytes from data to the stream, blocking
   // until all data is written. Returns the number of bytes successfully
   // written, which may be less than size if the stream was closed or there
   // was an error.
   virtual uint64_t write(const void* data, uint64_t size) = 0;
 
+  // writev writes the count buffers one after the other, as a single write
+  // of their concatenation would. Returns the total number of bytes
+  // successfully written. The default implementation calls write for each
+  // buffer.
+  virtual uint64_t writev(const Buffer* buffers, size_t count);
+
   // write attempts to write the bytes of s to the stream, returning true on
   // success or false if the write was partial or a complete failure.
   // Note: T must be a plain-old-data type.
@@ -40,6 +53,18 @@ class StreamWriter {
   virtual ~StreamWriter() {}
 };
 
+inline uint64_t StreamWriter::writev(const Buffer* buffers, size_t count) {
+  uint64_t total = 0;
+  for (size_t i = 0; i < count; i++) {
+    uint64_t written = write(buffers[i].data, buffers[i].size);
+    total += written;
+    if (written != buffers[i].size) {
+      break;
+    }
+  }
+  return total;
+}
+
 template <typename T>
 inline bool StreamWriter::write(const T& s) {
   return write(&s, sizeof(s)) == sizeof(s);
@@ -17,18 +17,34 @@
 #ifndef CORE_TRACE_H
 #define CORE_TRACE_H
 
-#ifdef GAPID_USE_TRACING
+#include "target.h"
+
 #if TARGET_OS == GAPID_OS_ANDROID
-#define GAPID_TRACE_MACROS_DEFINED
-#include "android/trace.h"
-#endif  // TARGET_OS == GAPID_OS_ANDROID
-#endif  // GAPID_USE_TRACING
 
-#ifndef GAPID_TRACE_MACROS_DEFINED
+#ifdef GAPID_USE_TRACING
+#include "android/trace.h"
+#define GAPID_TRACE_ENABLED() true
+#else  // GAPID_USE_TRACING
 #define GAPID_TRACE_CALL()
 #define GAPID_TRACE_NAME(name)
-#define GAPID_TRACE_INT(name)
+#define GAPID_TRACE_INT(name, value)
 #define GAPID_TRACE_ENABLED() false
-#endif  // GAPID_TRACE_MACROS_DEFINED
+#endif  // GAPID_USE_TRACING
+
+#else  // TARGET_OS == GAPID_OS_ANDROID
+
+// On desktop the trace points record into core::Tracer, which does nothing
+// unless tracing has been started. See tracer.h.
+#include "tracer.h"
+
+#define GAPID_TRACE_CALL() core::Tracer::Scope __gapidtrace(__FUNCTION__)
+
+#define GAPID_TRACE_NAME(name) core::Tracer::Scope __gapidtrace(name)
+
+#define GAPID_TRACE_INT(name, value) core::Tracer::counter(name, value)
+
+#define GAPID_TRACE_ENABLED() core::Tracer::enabled()
+
+#endif  // TARGET_OS == GAPID_OS_ANDROID
 
 #endif  // CORE_TRACE_H
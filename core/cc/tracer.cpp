@@ -0,0 +1,520 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tracer.h"
+
+#include "core/cc/target.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define GAPID_TRACER_USE_TSC
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define GAPID_TRACER_USE_TSC
+#endif
+
+#if TARGET_OS == GAPID_OS_WINDOWS
+#include "Windows.h"
+#elif TARGET_OS == GAPID_OS_LINUX || TARGET_OS == GAPID_OS_ANDROID
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// The number of events in the ring buffer of each thread.
+const size_t kRingSize = 16384;
+
+// How often the writer thread writes out the recorded events.
+const std::chrono::milliseconds kWritePeriod(10);
+
+// How long start measures the rate of the timestamp counter for.
+const std::chrono::milliseconds kCalibrationPeriod(10);
+
+enum EventType : uint32_t { kBegin, kEnd, kCounter };
+
+struct Event {
+  uint64_t ticks;
+  const char* name;
+  int64_t value;
+  EventType type;
+};
+
+// Returns the current timestamp, in ticks of the timestamp counter where
+// there is one, or nanoseconds of the steady clock otherwise.
+inline uint64_t ticks() {
+#ifdef GAPID_TRACER_USE_TSC
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+// Returns the nanoseconds of the steady clock. On Linux and Android this is
+// CLOCK_MONOTONIC, so the traces of several processes line up.
+inline uint64_t steadyNanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Returns the operating system's id of the calling thread, which matches the
+// ids shown by other tools.
+uint64_t osThreadId() {
+#if TARGET_OS == GAPID_OS_WINDOWS
+  return GetCurrentThreadId();
+#elif TARGET_OS == GAPID_OS_LINUX || TARGET_OS == GAPID_OS_ANDROID
+  return static_cast<uint64_t>(syscall(SYS_gettid));
+#else
+  uint64_t id = 0;
+  pthread_threadid_np(nullptr, &id);
+  return id;
+#endif
+}
+
+uint64_t processId() {
+#if TARGET_OS == GAPID_OS_WINDOWS
+  return GetCurrentProcessId();
+#else
+  return static_cast<uint64_t>(getpid());
+#endif
+}
+
+// EventRing is a ring of the events recorded by a single thread. The thread
+// adds events without taking any locks, and the writer thread removes them.
+struct EventRing {
+  // The number of events ever added. Only modified by the recording thread.
+  std::atomic<uint64_t> head;
+  // Keeps head and tail on separate cache lines.
+  uint8_t padding[64 - sizeof(std::atomic<uint64_t>)];
+  // The number of events ever removed. Only modified by the writer.
+  std::atomic<uint64_t> tail;
+  // Set when the recording thread exits.
+  std::atomic<bool> closed;
+  // The number of begin events without an end event. Only used by the
+  // recording thread.
+  uint64_t depth;
+  uint64_t tid;
+  Event events[kRingSize];
+
+  EventRing() : head(0), tail(0), closed(false), depth(0), tid(0) {}
+
+  // Adds the event if there are more than reserved free slots. Returns false
+  // if the ring is too full.
+  bool add(EventType type, const char* name, int64_t value, uint64_t reserved,
+           uint64_t time) {
+    uint64_t h = head.load(std::memory_order_relaxed);
+    uint64_t t = tail.load(std::memory_order_acquire);
+    if (kRingSize - (h - t) <= reserved) {
+      return false;
+    }
+    Event& event = events[h % kRingSize];
+    event.ticks = time;
+    event.name = name;
+    event.value = value;
+    event.type = type;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+};
+
+// ThreadRing holds the event ring of a thread, and hands it over to the
+// writer when the thread exits.
+struct ThreadRing {
+  EventRing* ring = nullptr;
+
+  ~ThreadRing() {
+    if (ring != nullptr) {
+      ring->closed.store(true, std::memory_order_release);
+      ring = nullptr;
+    }
+  }
+};
+
+thread_local ThreadRing tThreadRing;
+
+// Appends str to out as the contents of a JSON string.
+void appendEscaped(std::string* out, const char* str) {
+  for (; *str != 0; str++) {
+    char c = *str;
+    if (c == '"' || c == '\\') {
+      out->push_back('\\');
+      out->push_back(c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out->append(escaped);
+    } else {
+      out->push_back(c);
+    }
+  }
+}
+
+// Writer owns the trace file and the event rings, and writes the events out
+// on its own thread.
+class Writer {
+ public:
+  Writer()
+      : mFile(nullptr), mStopping(false), mDropped(0), mReported(0) {}
+
+  bool start(const char* path);
+  void stop();
+
+  // Returns the event ring of the calling thread, creating it if needed.
+  EventRing* ring();
+
+  // Called by a recording thread after adding an event to ring.
+  inline void added(EventRing* ring) {
+    // Wake the writer up early when the ring fills up to half way.
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_relaxed) == kRingSize / 2) {
+      mWake.notify_one();
+    }
+  }
+
+  // Called by a recording thread when an event is dropped.
+  inline void dropped() {
+    if (mDropped.fetch_add(1, std::memory_order_relaxed) == 0) {
+      mWake.notify_one();
+    }
+  }
+
+  uint64_t droppedTotal() const {
+    return mDropped.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // The read position of the writer in an event ring.
+  struct Cursor {
+    EventRing* ring;
+    uint64_t head;
+    bool closed;
+  };
+
+  // The entry point of the writer thread.
+  void run();
+
+  // Writes out all of the events in the rings. mWriteMutex must be held.
+  void drain();
+
+  // Appends the JSON object of the event to mLine.
+  void appendEvent(const Event& event, uint64_t tid);
+
+  // Returns the microseconds of the steady clock at the given ticks.
+  double microseconds(uint64_t time) const {
+    double elapsed = static_cast<double>(static_cast<int64_t>(time - mTicks0));
+    return (static_cast<double>(mNanoseconds0) + elapsed * mNanosPerTick) /
+           1000.0;
+  }
+
+  // The lock for the file, the thread and the clock calibration.
+  std::mutex mWriteMutex;
+  FILE* mFile;
+  std::thread mThread;
+  uint64_t mPid;
+  uint64_t mTicks0;
+  uint64_t mNanoseconds0;
+  double mNanosPerTick;
+
+  // The lock for modifying mRings.
+  std::mutex mRingsMutex;
+  std::vector<EventRing*> mRings;
+
+  // The writer thread waits on mWake between writes.
+  std::mutex mWakeMutex;
+  std::condition_variable mWake;
+  bool mStopping;
+
+  // The number of events dropped since tracing started, and the number of
+  // those that have been reported in the trace.
+  std::atomic<uint64_t> mDropped;
+  uint64_t mReported;
+
+  // Scratch space reused for each write.
+  std::vector<Cursor> mCursors;
+  std::string mLine;
+  // Written before each event, to separate it from the one before.
+  const char* mSeparator;
+};
+
+// The writer is never deleted, as threads may still be recording events
+// while the program exits.
+Writer* writer() {
+  static Writer* instance = new Writer();
+  return instance;
+}
+
+EventRing* Writer::ring() {
+  EventRing* ring = tThreadRing.ring;
+  if (ring == nullptr) {
+    ring = new EventRing();
+    ring->tid = osThreadId();
+    {
+      std::lock_guard<std::mutex> lock(mRingsMutex);
+      mRings.push_back(ring);
+    }
+    tThreadRing.ring = ring;
+  }
+  return ring;
+}
+
+bool Writer::start(const char* path) {
+  std::lock_guard<std::mutex> lock(mWriteMutex);
+  if (mFile != nullptr) {
+    return false;
+  }
+  mPid = processId();
+  std::string name;
+  for (const char* c = path; *c != 0; c++) {
+    if (c[0] == '%' && c[1] == 'p') {
+      name += std::to_string(mPid);
+      c++;
+    } else {
+      name.push_back(*c);
+    }
+  }
+  mFile = fopen(name.c_str(), "w");
+  if (mFile == nullptr) {
+    return false;
+  }
+  // The closing ] is optional, so a trace cut short by a crash still opens.
+  fputs("[", mFile);
+  mLine.clear();
+  mSeparator = "\n";
+
+  // Throw away the events left over from the last time tracing ran.
+  {
+    std::lock_guard<std::mutex> lock(mRingsMutex);
+    for (EventRing* ring : mRings) {
+      ring->tail.store(ring->head.load(std::memory_order_acquire),
+                       std::memory_order_release);
+    }
+  }
+  mReported = mDropped.load(std::memory_order_relaxed);
+
+  // Measure the rate of the timestamp counter against the steady clock,
+  // taking each clock reading between two readings of the counter.
+  uint64_t before = ticks();
+  mNanoseconds0 = steadyNanoseconds();
+  mTicks0 = before + (ticks() - before) / 2;
+  std::this_thread::sleep_for(kCalibrationPeriod);
+  before = ticks();
+  uint64_t nanoseconds = steadyNanoseconds();
+  uint64_t after = before + (ticks() - before) / 2;
+  mNanosPerTick = after > mTicks0 ? static_cast<double>(nanoseconds -
+                                                         mNanoseconds0) /
+                                        static_cast<double>(after - mTicks0)
+                                  : 1.0;
+
+  mStopping = false;
+  mThread = std::thread([this] { run(); });
+  return true;
+}
+
+void Writer::stop() {
+  std::unique_lock<std::mutex> lock(mWriteMutex);
+  if (mFile == nullptr || !mThread.joinable()) {
+    // Not started, or already being stopped by another thread.
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> wake(mWakeMutex);
+    mStopping = true;
+  }
+  mWake.notify_one();
+  std::thread thread = std::move(mThread);
+  lock.unlock();
+  thread.join();
+  lock.lock();
+  drain();
+  fputs("\n]\n", mFile);
+  fclose(mFile);
+  mFile = nullptr;
+}
+
+void Writer::run() {
+  std::unique_lock<std::mutex> wake(mWakeMutex);
+  while (!mStopping) {
+    mWake.wait_for(wake, kWritePeriod);
+    wake.unlock();
+    {
+      std::lock_guard<std::mutex> lock(mWriteMutex);
+      drain();
+    }
+    wake.lock();
+  }
+}
+
+void Writer::appendEvent(const Event& event, uint64_t tid) {
+  char buffer[128];
+  mLine += mSeparator;
+  mSeparator = ",\n";
+  switch (event.type) {
+    case kBegin:
+      mLine += "{\"ph\":\"B\",\"name\":\"";
+      appendEscaped(&mLine, event.name);
+      mLine += "\"";
+      break;
+    case kEnd:
+      mLine += "{\"ph\":\"E\"";
+      break;
+    case kCounter:
+      mLine += "{\"ph\":\"C\",\"name\":\"";
+      appendEscaped(&mLine, event.name);
+      snprintf(buffer, sizeof(buffer), "\",\"args\":{\"value\":%" PRId64 "}",
+               event.value);
+      mLine += buffer;
+      break;
+  }
+  snprintf(buffer, sizeof(buffer),
+           ",\"pid\":%" PRIu64 ",\"tid\":%" PRIu64 ",\"ts\":%.3f}", mPid, tid,
+           microseconds(event.ticks));
+  mLine += buffer;
+}
+
+void Writer::drain() {
+  if (mFile == nullptr) {
+    return;
+  }
+  mCursors.clear();
+  {
+    std::lock_guard<std::mutex> lock(mRingsMutex);
+    for (EventRing* ring : mRings) {
+      Cursor cursor;
+      cursor.ring = ring;
+      // Read closed before head, so that a closed ring is only deleted once
+      // all of its events have been written out.
+      cursor.closed = ring->closed.load(std::memory_order_acquire);
+      cursor.head = ring->head.load(std::memory_order_acquire);
+      mCursors.push_back(cursor);
+    }
+  }
+
+  for (const Cursor& cursor : mCursors) {
+    EventRing* ring = cursor.ring;
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    for (; tail < cursor.head; tail++) {
+      appendEvent(ring->events[tail % kRingSize], ring->tid);
+    }
+    ring->tail.store(tail, std::memory_order_release);
+    fputs(mLine.c_str(), mFile);
+    mLine.clear();
+  }
+
+  uint64_t dropped = mDropped.load(std::memory_order_relaxed);
+  if (dropped != mReported) {
+    Event event = {ticks(), "dropped trace events",
+                   static_cast<int64_t>(dropped - mReported), kCounter};
+    appendEvent(event, 0);
+    fputs(mLine.c_str(), mFile);
+    mLine.clear();
+    mReported = dropped;
+  }
+  fflush(mFile);
+
+  // Delete the rings of the threads that have exited.
+  std::lock_guard<std::mutex> lock(mRingsMutex);
+  for (const Cursor& cursor : mCursors) {
+    if (cursor.closed) {
+      mRings.erase(std::find(mRings.begin(), mRings.end(), cursor.ring));
+      delete cursor.ring;
+    }
+  }
+}
+
+// Starts tracing when GAPID_TRACE_FILE is set, and makes sure the trace is
+// written out when the program exits normally.
+struct StartFromEnvironment {
+  StartFromEnvironment() {
+    if (const char* path = getenv("GAPID_TRACE_FILE")) {
+      if (*path != 0 && core::Tracer::start(path)) {
+        atexit([] { core::Tracer::stop(); });
+      }
+    }
+  }
+} sStartFromEnvironment;
+
+}  // anonymous namespace
+
+namespace core {
+
+std::atomic<bool> Tracer::sEnabled(false);
+
+bool Tracer::start(const char* path) {
+  if (!writer()->start(path)) {
+    return false;
+  }
+  sEnabled.store(true, std::memory_order_release);
+  return true;
+}
+
+void Tracer::stop() {
+  sEnabled.store(false, std::memory_order_release);
+  writer()->stop();
+}
+
+uint64_t Tracer::dropped() { return writer()->droppedTotal(); }
+
+bool Tracer::begin(const char* name) {
+  Writer* w = writer();
+  EventRing* ring = w->ring();
+  // Keep a free slot for the end event of each open scope, so that begin and
+  // end events always pair up.
+  if (!ring->add(kBegin, name, 0, ring->depth + 1, ticks())) {
+    w->dropped();
+    return false;
+  }
+  ring->depth++;
+  w->added(ring);
+  return true;
+}
+
+void Tracer::end() {
+  Writer* w = writer();
+  EventRing* ring = w->ring();
+  ring->depth--;
+  ring->add(kEnd, nullptr, 0, 0, ticks());
+  w->added(ring);
+}
+
+void Tracer::record(const char* name, int64_t value) {
+  Writer* w = writer();
+  EventRing* ring = w->ring();
+  if (!ring->add(kCounter, name, value, ring->depth, ticks())) {
+    w->dropped();
+    return;
+  }
+  w->added(ring);
+}
+
+}  // namespace core
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CORE_TRACER_H
+#define CORE_TRACER_H
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace core {
+
+// Tracer records begin, end and counter events into a ring buffer per thread
+// and writes them out to a file in the Chrome trace event JSON format, which
+// both chrome://tracing and the Perfetto UI open.
+//
+// Tracing is off until start is called, or GAPID_TRACE_FILE is set in the
+// environment of the process. While tracing is off, each trace point costs a
+// single relaxed load.
+//
+// Event names are not copied, so they must be string literals.
+class Tracer {
+ public:
+  // Scope records a begin event when it is constructed and the matching end
+  // event when it is destroyed.
+  class Scope {
+   public:
+    inline explicit Scope(const char* name)
+        : mActive(enabled() && begin(name)) {}
+    inline ~Scope() {
+      if (mActive) {
+        end();
+      }
+    }
+
+   private:
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    bool mActive;
+  };
+
+  // Starts writing events to the file at path. Any %p in path is replaced
+  // with the process id, so that several processes can share the same path.
+  // Returns false if tracing has already started or the file can not be
+  // created.
+  static bool start(const char* path);
+
+  // Writes out the remaining events, closes the file and stops tracing.
+  static void stop();
+
+  // Returns true if events are being recorded.
+  static inline bool enabled() {
+    return sEnabled.load(std::memory_order_relaxed);
+  }
+
+  // Records a counter event with the given value.
+  static inline void counter(const char* name, int64_t value) {
+    if (enabled()) {
+      record(name, value);
+    }
+  }
+
+  // Returns the number of events that were dropped because the ring buffer
+  // of their thread was full.
+  static uint64_t dropped();
+
+ private:
+  // Records a begin event. Returns false if the event was dropped, in which
+  // case the end event must not be recorded.
+  static bool begin(const char* name);
+  static void end();
+  static void record(const char* name, int64_t value);
+
+  static std::atomic<bool> sEnabled;
+};
+
+}  // namespace core
+
+#endif  // CORE_TRACER_H
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tracer.h"
+
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace core {
+namespace test {
+namespace {
+
+// Event is the part of a Chrome trace event that the tests check.
+struct Event {
+  std::string ph;
+  std::string name;
+  std::string tid;
+  double ts;
+  std::string value;
+};
+
+// Returns the value of key in the JSON object line, which is written out
+// without any spaces. Escape sequences in strings are left as they are.
+std::string field(const std::string& line, const std::string& key) {
+  std::string prefix = "\"" + key + "\":";
+  size_t start = line.find(prefix);
+  if (start == std::string::npos) {
+    return "";
+  }
+  start += prefix.size();
+  if (line[start] == '"') {
+    size_t end = start + 1;
+    while (line[end] != '"') {
+      end += line[end] == '\\' ? 2 : 1;
+    }
+    return line.substr(start + 1, end - start - 1);
+  }
+  return line.substr(start, line.find_first_of(",}", start) - start);
+}
+
+// Reads the events of the trace file at path. Each event is on its own line.
+std::vector<Event> readTrace(const std::string& path) {
+  std::ifstream file(path);
+  std::string line;
+  std::getline(file, line);
+  EXPECT_EQ("[", line);
+  std::vector<Event> events;
+  while (std::getline(file, line) && line != "]") {
+    EXPECT_EQ('{', line.front());
+    Event event;
+    event.ph = field(line, "ph");
+    event.name = field(line, "name");
+    event.tid = field(line, "tid");
+    event.ts = atof(field(line, "ts").c_str());
+    event.value = field(line, "value");
+    events.push_back(event);
+  }
+  EXPECT_EQ("]", line);
+  return events;
+}
+
+TEST(TracerTest, WritesChromeTraceEvents) {
+  std::string path = ::testing::TempDir() + "tracer_test.json";
+  {
+    // Events are not recorded before tracing starts.
+    Tracer::Scope scope("before start");
+  }
+  ASSERT_TRUE(Tracer::start(path.c_str()));
+  EXPECT_TRUE(Tracer::enabled());
+  EXPECT_FALSE(Tracer::start(path.c_str()));
+  {
+    Tracer::Scope outer("outer \"quoted\"");
+    Tracer::counter("counter", -42);
+    { Tracer::Scope inner("inner"); }
+  }
+  Tracer::stop();
+  EXPECT_FALSE(Tracer::enabled());
+  { Tracer::Scope scope("after stop"); }
+
+  std::vector<Event> events = readTrace(path);
+  ASSERT_EQ(5u, events.size());
+  EXPECT_EQ("B", events[0].ph);
+  EXPECT_EQ("outer \\\"quoted\\\"", events[0].name);
+  EXPECT_EQ("C", events[1].ph);
+  EXPECT_EQ("counter", events[1].name);
+  EXPECT_EQ("-42", events[1].value);
+  EXPECT_EQ("B", events[2].ph);
+  EXPECT_EQ("inner", events[2].name);
+  EXPECT_EQ("E", events[3].ph);
+  EXPECT_EQ("E", events[4].ph);
+  for (size_t i = 1; i < events.size(); i++) {
+    EXPECT_EQ(events[0].tid, events[i].tid);
+    EXPECT_LE(events[i - 1].ts, events[i].ts);
+  }
+}
+
+TEST(TracerTest, Threads) {
+  const int kThreads = 4;
+  const int kScopes = 50000;
+  std::string path = ::testing::TempDir() + "tracer_test_threads.json";
+  uint64_t dropped = Tracer::dropped();
+  ASSERT_TRUE(Tracer::start(path.c_str()));
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([] {
+      for (int i = 0; i < kScopes; i++) {
+        Tracer::Scope outer("outer");
+        Tracer::Scope inner("inner");
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  Tracer::stop();
+  dropped = Tracer::dropped() - dropped;
+
+  // Every begin event is either written out with its end event, or dropped.
+  std::map<std::string, std::vector<std::string>> open;
+  uint64_t begins = 0;
+  uint64_t reported = 0;
+  for (const Event& event : readTrace(path)) {
+    if (event.ph == "C") {
+      EXPECT_EQ("dropped trace events", event.name);
+      reported += atoll(event.value.c_str());
+      continue;
+    }
+    std::vector<std::string>& stack = open[event.tid];
+    if (event.ph == "B") {
+      // The inner scope may be recorded when the outer one was dropped.
+      EXPECT_TRUE(stack.empty() || event.name == "inner");
+      stack.push_back(event.name);
+      begins++;
+    } else {
+      ASSERT_EQ("E", event.ph);
+      ASSERT_FALSE(stack.empty());
+      stack.pop_back();
+    }
+  }
+  EXPECT_EQ(size_t(kThreads), open.size());
+  for (const auto& it : open) {
+    EXPECT_TRUE(it.second.empty());
+  }
+  EXPECT_EQ(uint64_t(kThreads * kScopes * 2), begins + dropped);
+  EXPECT_EQ(dropped, reported);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace core
@@ -16,6 +16,14 @@
 
 #include "third_party/astc-encoder/Source/astc_codec_internals.h"
 
+#include <string.h>
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 // astc-encoder global variables... *sigh*
 int alpha_force_use_of_hdr = 0;
 int perform_srgb_transform = 0;
@@ -40,6 +48,41 @@ uint8_t float2byte(float f) {
     return (uint8_t)(f * 255.0f + 0.5f);
 }
 
+namespace {
+
+// The largest ASTC 2D block is 12x12 texels.
+const uint32_t kMaxBlockTexels = 12 * 12;
+
+// floats2bytes converts count floats to bytes the way float2byte does.
+void floats2bytes(const float* in, uint8_t* out, uint32_t count) {
+    uint32_t i = 0;
+#if defined(__SSE2__)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    auto convert = [&](const float* f) {
+        __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(f), zero), one);
+        return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half));
+    };
+    for (; i + 16 <= count; i += 16) {
+        __m128i lo = _mm_packs_epi32(convert(in + i), convert(in + i + 4));
+        __m128i hi = _mm_packs_epi32(convert(in + i + 8), convert(in + i + 12));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(lo, hi));
+    }
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_packs_epi32(convert(in + i), _mm_setzero_si128());
+        int32_t texel = _mm_cvtsi128_si32(_mm_packus_epi16(v, v));
+        memcpy(out + i, &texel, 4);
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = float2byte(in[i]);
+    }
+}
+
+}  // anonymous namespace
+
 extern "C" void init_astc() {
     build_quantization_mode_table();
 }
@@ -55,6 +98,41 @@ extern "C" void decompress_astc(
     uint32_t blocks_x = (width + block_width - 1) / block_width;
     uint32_t blocks_y = (height + block_height - 1) / block_height;
 
+    imageblock pb;
+    uint8_t texels[kMaxBlockTexels * 4];
+    for (uint32_t by = 0; by < blocks_y; by++) {
+        for (uint32_t bx = 0; bx < blocks_x; bx++) {
+            physical_compressed_block pcb = *(physical_compressed_block*) in;
+            symbolic_compressed_block scb;
+            physical_to_symbolic(block_width, block_height, 1, pcb, &scb);
+            decompress_symbolic_block(DECODE_LDR, block_width, block_height, 1, 0, 0, 0, &scb, &pb);
+            in += 16;
+
+            floats2bytes(pb.orig_data, texels, block_width * block_height * 4);
+
+            // Copy the texels of the block that are in the image.
+            uint32_t x = bx * block_width;
+            uint32_t y = by * block_height;
+            uint32_t w = std::min(block_width, width - x);
+            uint32_t h = std::min(block_height, height - y);
+            for (uint32_t dy = 0; dy < h; dy++) {
+                memcpy(&out[(width * (y + dy) + x) * 4], &texels[dy * block_width * 4], w * 4);
+            }
+        }
+    }
+}
+
+extern "C" void decompress_astc_reference(
+        uint8_t* in,
+        uint8_t* out,
+        uint32_t width,
+        uint32_t height,
+        uint32_t block_width,
+        uint32_t block_height) {
+
+    uint32_t blocks_x = (width + block_width - 1) / block_width;
+    uint32_t blocks_y = (height + block_height - 1) / block_height;
+
     imageblock pb;
     for (uint32_t by = 0; by < blocks_y; by++) {
         for (uint32_t bx = 0; bx < blocks_x; bx++) {
@@ -81,4 +159,4 @@ extern "C" void decompress_astc(
             }
         }
     }
-}
\ No newline at end of file
+}
@@ -125,23 +125,28 @@ func init() {
 	} {
 		f := f
 		image.RegisterConverter(f.src, f.dst, func(src []byte, w, h, d int) ([]byte, error) {
-			dst := make([]byte, w*h*d*4)
-			sliceSize := f.src.Size(w, h, 1)
-			for z := 0; z < d; z++ {
-				dst, src := dst[z*w*h*4:], src[z*sliceSize:]
-				in := (unsafe.Pointer)(&src[0])
-				out := (unsafe.Pointer)(&dst[0])
-				blockW := f.src.GetAstc().BlockWidth
-				blockH := f.src.GetAstc().BlockHeight
-				C.decompress_astc(
-					(*C.uint8_t)(in),
-					(*C.uint8_t)(out),
-					(C.uint32_t)(w),
-					(C.uint32_t)(h),
-					(C.uint32_t)(blockW),
-					(C.uint32_t)(blockH))
-			}
-			return dst, nil
+			return decompress(f.src, src, w, h, d, false), nil
 		})
 	}
 }
+
+// decompress decodes the d slices of w x h texels of format f in src, and
+// returns the RGBA8 texels. If reference is true, it uses the block at a time
+// decoder decompress_astc is checked against.
+func decompress(f *image.Format, src []byte, w, h, d int, reference bool) []byte {
+	dst := make([]byte, w*h*d*4)
+	sliceSize := f.Size(w, h, 1)
+	for z := 0; z < d; z++ {
+		dst, src := dst[z*w*h*4:], src[z*sliceSize:]
+		in := (*C.uint8_t)(unsafe.Pointer(&src[0]))
+		out := (*C.uint8_t)(unsafe.Pointer(&dst[0]))
+		blockW := (C.uint32_t)(f.GetAstc().BlockWidth)
+		blockH := (C.uint32_t)(f.GetAstc().BlockHeight)
+		if reference {
+			C.decompress_astc_reference(in, out, (C.uint32_t)(w), (C.uint32_t)(h), blockW, blockH)
+		} else {
+			C.decompress_astc(in, out, (C.uint32_t)(w), (C.uint32_t)(h), blockW, blockH)
+		}
+	}
+	return dst
+}
@@ -20,9 +20,17 @@ extern "C" {
 
 void init_astc();
 
+// decompress_astc decodes the width x height texels of the ASTC blocks in to
+// RGBA8 texels in out, converting the texels of each block at once.
 void decompress_astc(uint8_t* in, uint8_t* out, uint32_t width, uint32_t height,
                      uint32_t block_width, uint32_t block_height);
 
+// decompress_astc_reference is decompress_astc converting one texel at a
+// time, which decompress_astc is checked against.
+void decompress_astc_reference(uint8_t* in, uint8_t* out, uint32_t width,
+                               uint32_t height, uint32_t block_width,
+                               uint32_t block_height);
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
@@ -0,0 +1,92 @@
+// Copyright (C) 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package astc
+
+import (
+	"bytes"
+	"fmt"
+	"math/rand"
+	"testing"
+
+	"github.com/google/gapid/core/image"
+)
+
+var formats = []*image.Format{
+	RGBA_4x4, RGBA_5x4, RGBA_5x5, RGBA_6x5, RGBA_6x6, RGBA_8x5, RGBA_8x6,
+	RGBA_8x8, RGBA_10x5, RGBA_10x6, RGBA_10x8, RGBA_10x10, RGBA_12x10,
+	RGBA_12x12,
+}
+
+// blocks returns the blocks of a w x h image of format f, made of random
+// blocks, constant color blocks, other void-extent blocks and runs of repeated
+// blocks.
+func blocks(f *image.Format, w, h int, seed int64) []byte {
+	r := rand.New(rand.NewSource(seed))
+	data := make([]byte, f.Size(w, h, 1))
+	for i := 0; i < len(data); i += 16 {
+		block := data[i : i+16]
+		switch r.Intn(5) {
+		case 0:
+			if i > 0 {
+				copy(block, data[i-16:i])
+				continue
+			}
+			r.Read(block)
+		case 1:
+			// Constant color block: LDR void extent with no extent.
+			r.Read(block)
+			copy(block, []byte{0xfc, 0xfd, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff})
+		case 2:
+			// Void-extent block with random extents, HDR and reserved bits.
+			r.Read(block)
+			block[0], block[1] = 0xfc, block[1]|0x01
+		default:
+			r.Read(block)
+		}
+	}
+	return data
+}
+
+func TestDecompressMatchesReference(t *testing.T) {
+	for _, f := range formats {
+		for _, size := range []struct{ w, h int }{
+			{1, 1}, {13, 7}, {64, 64}, {333, 129}, {1024, 512},
+		} {
+			src := blocks(f, size.w, size.h, int64(size.w*size.h))
+			got := decompress(f, src, size.w, size.h, 1, false)
+			expected := decompress(f, src, size.w, size.h, 1, true)
+			if !bytes.Equal(got, expected) {
+				t.Errorf("%v %dx%d: decompress does not match the reference decoder",
+					f.Name, size.w, size.h)
+			}
+		}
+	}
+}
+
+func BenchmarkDecompress(b *testing.B) {
+	const w, h = 2048, 2048
+	for _, f := range formats {
+		src := blocks(f, w, h, 1)
+		for _, reference := range []bool{true, false} {
+			name := fmt.Sprintf("%v/reference=%v", f.Name, reference)
+			b.Run(name, func(b *testing.B) {
+				b.SetBytes(int64(w * h * 4))
+				for i := 0; i < b.N; i++ {
+					decompress(f, src, w, h, 1, reference)
+				}
+			})
+		}
+	}
+}
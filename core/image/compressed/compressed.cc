@@ -0,0 +1,708 @@
+// Copyright (C) 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "compressed.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// Images with fewer blocks than this per thread are not worth a thread.
+const uint32_t kMinBlocksPerThread = 4096;
+
+// The largest texel decoded is four bytes, RGBA8 or RG16.
+const uint32_t kMaxTexelSize = 4;
+
+// Row holds the four RGBA8 texels of a row of a block, one per 32 bit lane.
+#if defined(__SSE2__)
+typedef __m128i Row;
+
+inline Row broadcast(uint32_t v) { return _mm_set1_epi32(int32_t(v)); }
+
+inline Row lanes(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+    return _mm_setr_epi32(int32_t(a), int32_t(b), int32_t(c), int32_t(d));
+}
+
+inline Row load(const uint32_t* v) { return _mm_loadu_si128((const __m128i*)v); }
+
+inline void store(uint8_t* dst, Row r) { _mm_storeu_si128((__m128i*)dst, r); }
+
+inline Row merge(Row a, Row b) { return _mm_or_si128(a, b); }
+
+// choose returns the lanes of a where mask is set and those of b elsewhere.
+inline Row choose(Row mask, Row a, Row b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// test returns a mask of the lanes of bits that are set in v.
+inline Row test(uint32_t v, Row bits) {
+    return _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(int32_t(v)), bits), bits);
+}
+#elif defined(__ARM_NEON)
+typedef uint32x4_t Row;
+
+inline Row broadcast(uint32_t v) { return vdupq_n_u32(v); }
+
+inline Row lanes(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+    const uint32_t v[4] = {a, b, c, d};
+    return vld1q_u32(v);
+}
+
+inline Row load(const uint32_t* v) { return vld1q_u32(v); }
+
+inline void store(uint8_t* dst, Row r) { vst1q_u8(dst, vreinterpretq_u8_u32(r)); }
+
+inline Row merge(Row a, Row b) { return vorrq_u32(a, b); }
+
+inline Row choose(Row mask, Row a, Row b) { return vbslq_u32(mask, a, b); }
+
+inline Row test(uint32_t v, Row bits) { return vtstq_u32(vdupq_n_u32(v), bits); }
+#else
+struct Row {
+    uint32_t v[4];
+};
+
+inline Row broadcast(uint32_t v) { return Row{{v, v, v, v}}; }
+
+inline Row lanes(uint32_t a, uint32_t b, uint32_t c, uint32_t d) { return Row{{a, b, c, d}}; }
+
+inline Row load(const uint32_t* v) { return Row{{v[0], v[1], v[2], v[3]}}; }
+
+inline void store(uint8_t* dst, Row r) { memcpy(dst, r.v, 16); }
+
+inline Row merge(Row a, Row b) {
+    for (int i = 0; i < 4; i++) { a.v[i] |= b.v[i]; }
+    return a;
+}
+
+inline Row choose(Row mask, Row a, Row b) {
+    for (int i = 0; i < 4; i++) { a.v[i] = (mask.v[i] & a.v[i]) | (~mask.v[i] & b.v[i]); }
+    return a;
+}
+
+inline Row test(uint32_t v, Row bits) {
+    for (int i = 0; i < 4; i++) { bits.v[i] = (v & bits.v[i]) != 0 ? ~0u : 0; }
+    return bits;
+}
+#endif
+
+inline uint16_t load16(const uint8_t* p) { return uint16_t(p[0] | (p[1] << 8)); }
+
+inline uint32_t load32(const uint8_t* p) { return uint32_t(load16(p)) | (uint32_t(load16(p + 2)) << 16); }
+
+inline uint64_t load48(const uint8_t* p) { return uint64_t(load16(p)) | (uint64_t(load32(p + 2)) << 16); }
+
+inline uint64_t load64(const uint8_t* p) { return uint64_t(load32(p)) | (uint64_t(load32(p + 4)) << 32); }
+
+inline uint64_t load64BigEndian(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) { v = (v << 8) | p[i]; }
+    return v;
+}
+
+inline int clamp(int v, int lo, int hi) { return std::min(std::max(v, lo), hi); }
+
+inline uint8_t clampByte(int v) { return uint8_t(clamp(v, 0, 255)); }
+
+// rgba returns the RGBA8 texel as it is laid out in memory.
+inline uint32_t rgba(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    const uint8_t bytes[4] = {r, g, b, a};
+    uint32_t texel;
+    memcpy(&texel, bytes, 4);
+    return texel;
+}
+
+inline uint32_t alpha(uint8_t a) { return rgba(0, 0, 0, a); }
+
+// Layout gives, for each texel of a block in row-major order, the bit of a
+// 32 bit word holding the low and the high bit of its 2 bit color index.
+struct Layout {
+    uint32_t lo[16];
+    uint32_t hi[16];
+};
+
+// DXT color indices are two bits per texel, in row-major order.
+const Layout kDXTLayout = {
+    {1u << 0, 1u << 2, 1u << 4, 1u << 6, 1u << 8, 1u << 10, 1u << 12, 1u << 14,
+     1u << 16, 1u << 18, 1u << 20, 1u << 22, 1u << 24, 1u << 26, 1u << 28, 1u << 30},
+    {1u << 1, 1u << 3, 1u << 5, 1u << 7, 1u << 9, 1u << 11, 1u << 13, 1u << 15,
+     1u << 17, 1u << 19, 1u << 21, 1u << 23, 1u << 25, 1u << 27, 1u << 29, 1u << 31},
+};
+
+// ETC color indices are split in a half of low and a half of high bits, in
+// column-major order.
+const Layout kETCLayout = {
+    {1u << 0, 1u << 4, 1u << 8, 1u << 12, 1u << 1, 1u << 5, 1u << 9, 1u << 13,
+     1u << 2, 1u << 6, 1u << 10, 1u << 14, 1u << 3, 1u << 7, 1u << 11, 1u << 15},
+    {1u << 16, 1u << 20, 1u << 24, 1u << 28, 1u << 17, 1u << 21, 1u << 25, 1u << 29,
+     1u << 18, 1u << 22, 1u << 26, 1u << 30, 1u << 19, 1u << 23, 1u << 27, 1u << 31},
+};
+
+// select writes the RGBA8 texels of a block to the rows of dst. Each texel
+// takes the color of colors[row] picked by its index in indices. If alphas is
+// not null, the alpha of each row is merged from it.
+void select(uint32_t indices, const Layout& layout, const Row* const colors[4],
+            const Row* alphas, uint8_t* dst, size_t stride) {
+    for (int r = 0; r < 4; r++) {
+        Row lo = test(indices, load(&layout.lo[r * 4]));
+        Row hi = test(indices, load(&layout.hi[r * 4]));
+        const Row* c = colors[r];
+        Row texels = choose(hi, choose(lo, c[3], c[2]), choose(lo, c[1], c[0]));
+        if (alphas != nullptr) {
+            texels = merge(texels, alphas[r]);
+        }
+        store(dst + r * stride, texels);
+    }
+}
+
+// select writes the RGBA8 texels of a block, which all pick from the same
+// colors, to the rows of dst.
+void select(uint32_t indices, const Layout& layout, const uint32_t colors[4],
+            const Row* alphas, uint8_t* dst, size_t stride) {
+    const Row palette[4] = {
+        broadcast(colors[0]), broadcast(colors[1]), broadcast(colors[2]), broadcast(colors[3]),
+    };
+    const Row* const rows[4] = {palette, palette, palette, palette};
+    select(indices, layout, rows, alphas, dst, stride);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// S3TC / DXT
+////////////////////////////////////////////////////////////////////////////////
+
+void expand565(uint16_t c, int rgb[3]) {
+    rgb[0] = ((c >> 8) & 0xf8) | ((c >> 13) & 0x7);
+    rgb[1] = ((c >> 3) & 0xfc) | ((c >> 9) & 0x3);
+    rgb[2] = ((c << 3) & 0xf8) | ((c >> 2) & 0x7);
+}
+
+// decodeDXTColor decodes the color block of a DXT block. The colors have an
+// alpha of a, and the alphas of the texels are merged from alphas if it is not
+// null. If dxt1 is true, blocks with c0 <= c1 have three colors and black.
+void decodeDXTColor(const uint8_t* block, bool dxt1, uint32_t black, uint8_t a,
+                    const Row* alphas, uint8_t* dst, size_t stride) {
+    uint16_t c0 = load16(block);
+    uint16_t c1 = load16(block + 2);
+    int p0[3], p1[3];
+    expand565(c0, p0);
+    expand565(c1, p1);
+
+    uint32_t colors[4];
+    colors[0] = rgba(p0[0], p0[1], p0[2], a);
+    colors[1] = rgba(p1[0], p1[1], p1[2], a);
+    if (!dxt1 || c0 > c1) {
+        colors[2] = rgba((2 * p0[0] + p1[0]) / 3, (2 * p0[1] + p1[1]) / 3, (2 * p0[2] + p1[2]) / 3, a);
+        colors[3] = rgba((2 * p1[0] + p0[0]) / 3, (2 * p1[1] + p0[1]) / 3, (2 * p1[2] + p0[2]) / 3, a);
+    } else {
+        colors[2] = rgba((p0[0] + p1[0]) / 2, (p0[1] + p1[1]) / 2, (p0[2] + p1[2]) / 2, a);
+        colors[3] = black;
+    }
+    select(load32(block + 4), kDXTLayout, colors, alphas, dst, stride);
+}
+
+// bc4Values returns the eight values of the unsigned interpolated channel of
+// DXT5 alpha and RGTC blocks.
+void bc4Values(int v0, int v1, int values[8]) {
+    values[0] = v0;
+    values[1] = v1;
+    if (v0 > v1) {
+        for (int c = 2; c < 8; c++) {
+            values[c] = (v0 * (8 - c) + v1 * (c - 1)) / 7;
+        }
+    } else {
+        for (int c = 2; c < 6; c++) {
+            values[c] = (v0 * (6 - c) + v1 * (c - 1)) / 5;
+        }
+        values[6] = 0;
+        values[7] = 255;
+    }
+}
+
+// bc4SignedValues returns the eight values of the signed interpolated channel
+// of RGTC blocks, mapped to [0, 255].
+void bc4SignedValues(int8_t v0, int8_t v1, int values[8]) {
+    auto toFloat = [](int8_t i) { return i > -128 ? float(i) / 127.0f : -1.0f; };
+    float f0 = toFloat(v0);
+    float f1 = toFloat(v1);
+    float f[8];
+    f[0] = f0;
+    f[1] = f1;
+    if (f0 > f1) {
+        for (int c = 2; c < 8; c++) {
+            f[c] = (f0 * float(8 - c) + f1 * float(c - 1)) / 7.0f;
+        }
+    } else {
+        for (int c = 2; c < 6; c++) {
+            f[c] = (f0 * float(6 - c) + f1 * float(c - 1)) / 5.0f;
+        }
+        f[6] = -1.0f;
+        f[7] = 1.0f;
+    }
+    for (int c = 0; c < 8; c++) {
+        values[c] = clampByte(int((f[c] + 1.0f) * 255.0f / 2.0f));
+    }
+}
+
+// bc4Index returns the index of texel i, in row-major order, of the indices of
+// a DXT5 alpha or RGTC block.
+inline int bc4Index(uint64_t indices, int i) { return int(indices >> (i * 3)) & 7; }
+
+void decodeDXT1RGB(const uint8_t* block, uint8_t* dst, size_t stride) {
+    decodeDXTColor(block, true, rgba(0, 0, 0, 255), 255, nullptr, dst, stride);
+}
+
+void decodeDXT1RGBA(const uint8_t* block, uint8_t* dst, size_t stride) {
+    decodeDXTColor(block, true, rgba(0, 0, 0, 0), 255, nullptr, dst, stride);
+}
+
+void decodeDXT3(const uint8_t* block, uint8_t* dst, size_t stride) {
+    uint64_t a = load64(block);
+    Row alphas[4];
+    for (int r = 0; r < 4; r++, a >>= 16) {
+        alphas[r] = lanes(alpha((a & 0xf) * 0x11), alpha(((a >> 4) & 0xf) * 0x11),
+                          alpha(((a >> 8) & 0xf) * 0x11), alpha(((a >> 12) & 0xf) * 0x11));
+    }
+    decodeDXTColor(block + 8, false, 0, 0, alphas, dst, stride);
+}
+
+void decodeDXT5(const uint8_t* block, uint8_t* dst, size_t stride) {
+    int values[8];
+    bc4Values(block[0], block[1], values);
+    uint32_t a[8];
+    for (int c = 0; c < 8; c++) {
+        a[c] = alpha(values[c]);
+    }
+    uint64_t indices = load48(block + 2);
+    Row alphas[4];
+    for (int r = 0; r < 4; r++) {
+        alphas[r] = lanes(a[bc4Index(indices, r * 4)], a[bc4Index(indices, r * 4 + 1)],
+                          a[bc4Index(indices, r * 4 + 2)], a[bc4Index(indices, r * 4 + 3)]);
+    }
+    decodeDXTColor(block + 8, false, 0, 0, alphas, dst, stride);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// RGTC
+////////////////////////////////////////////////////////////////////////////////
+
+// decodeRGTC decodes the red block, and the green block that follows it if
+// green is true, into RGBA8 texels.
+template <bool sign, bool green>
+void decodeRGTC(const uint8_t* block, uint8_t* dst, size_t stride) {
+    int reds[8], greens[8] = {};
+    uint64_t redIndices = load48(block + 2), greenIndices = 0;
+    if (sign) {
+        bc4SignedValues(int8_t(block[0]), int8_t(block[1]), reds);
+    } else {
+        bc4Values(block[0], block[1], reds);
+    }
+    if (green) {
+        if (sign) {
+            bc4SignedValues(int8_t(block[8]), int8_t(block[9]), greens);
+        } else {
+            bc4Values(block[8], block[9], greens);
+        }
+        greenIndices = load48(block + 10);
+    }
+
+    uint32_t texels[4];
+    for (int r = 0; r < 4; r++) {
+        for (int x = 0; x < 4; x++) {
+            int i = r * 4 + x;
+            texels[x] = rgba(reds[bc4Index(redIndices, i)], greens[bc4Index(greenIndices, i)], 0, 255);
+        }
+        store(dst + r * stride, load(texels));
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// ETC2 / EAC
+////////////////////////////////////////////////////////////////////////////////
+
+const int kEACModifiers[16][8] = {
+    {-3, -6, -9, -15, 2, 5, 8, 14},
+    {-3, -7, -10, -13, 2, 6, 9, 12},
+    {-2, -5, -8, -13, 1, 4, 7, 12},
+    {-2, -4, -6, -13, 1, 3, 5, 12},
+    {-3, -6, -8, -12, 2, 5, 7, 11},
+    {-3, -7, -9, -11, 2, 6, 8, 10},
+    {-4, -7, -8, -11, 3, 6, 7, 10},
+    {-3, -5, -8, -11, 2, 4, 7, 10},
+    {-2, -6, -8, -10, 1, 5, 7, 9},
+    {-2, -5, -8, -10, 1, 4, 7, 9},
+    {-2, -4, -8, -10, 1, 3, 7, 9},
+    {-2, -5, -7, -10, 1, 4, 6, 9},
+    {-3, -4, -7, -10, 2, 3, 6, 9},
+    {-1, -2, -3, -10, 0, 1, 2, 9},
+    {-4, -6, -8, -9, 3, 5, 7, 8},
+    {-3, -5, -7, -9, 2, 4, 6, 8},
+};
+
+// The modifiers of the individual and differential modes, without and with
+// the punchthrough alpha opaque bit set.
+const int kETCModifiers[2][8][4] = {
+    {
+        {0, 8, 0, -8},
+        {0, 17, 0, -17},
+        {0, 29, 0, -29},
+        {0, 42, 0, -42},
+        {0, 60, 0, -60},
+        {0, 80, 0, -80},
+        {0, 106, 0, -106},
+        {0, 183, 0, -183},
+    },
+    {
+        {2, 8, -2, -8},
+        {5, 17, -5, -17},
+        {9, 29, -9, -29},
+        {13, 42, -13, -42},
+        {18, 60, -18, -60},
+        {24, 80, -24, -80},
+        {33, 106, -33, -106},
+        {47, 183, -47, -183},
+    },
+};
+
+// The distances of the T and H modes.
+const int kETCDistances[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+
+const int kETCDeltas[8] = {0, 1, 2, 3, -4, -3, -2, -1};
+
+inline int expand4to8(uint64_t v) { v &= 0xf; return int((v << 4) | v); }
+inline int expand6to8(uint64_t v) { v &= 0x3f; return int((v << 2) | (v >> 4)); }
+inline int expand7to8(uint64_t v) { v &= 0x7f; return int((v << 1) | (v >> 6)); }
+
+// eacIndex returns the index of the texel (x, y) of the indices of an EAC
+// block, whose texels are in column-major order from the high bits.
+inline int eacIndex(uint64_t v, int x, int y) { return int(v >> ((15 - (x * 4 + y)) * 3)) & 7; }
+
+// decodeEAC decodes an R11 EAC block into the 16 bit texels of dst, which are
+// size bytes apart.
+template <bool sign>
+void decodeEAC(const uint8_t* block, uint8_t* dst, size_t stride, size_t size) {
+    uint64_t v = load64BigEndian(block);
+    int base = int(v >> 56);
+    int mul = int(v >> 52) & 15;
+    const int* modifiers = kEACModifiers[(v >> 48) & 15];
+    if (sign) {
+        base = int8_t(base);
+    }
+    mul = mul != 0 ? mul * 8 : 1;
+
+    uint16_t values[8];
+    for (int c = 0; c < 8; c++) {
+        if (sign) {
+            int s11 = clamp(base * 8 + modifiers[c] * mul, -1023, 1023);
+            int s16 = s11 >= 0 ? (s11 << 5) | (s11 >> 5) : -((-s11 << 5) | (-s11 >> 5));
+            values[c] = uint16_t(s16);
+        } else {
+            int u11 = clamp(base * 8 + 4 + modifiers[c] * mul, 0, 2047);
+            values[c] = uint16_t((u11 << 5) | (u11 >> 5));
+        }
+    }
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            uint16_t value = values[eacIndex(v, x, y)];
+            uint8_t* texel = dst + y * stride + x * size;
+            texel[0] = uint8_t(value);
+            texel[1] = uint8_t(value >> 8);
+        }
+    }
+}
+
+template <bool sign>
+void decodeEACR(const uint8_t* block, uint8_t* dst, size_t stride) {
+    decodeEAC<sign>(block, dst, stride, 2);
+}
+
+template <bool sign>
+void decodeEACRG(const uint8_t* block, uint8_t* dst, size_t stride) {
+    decodeEAC<sign>(block, dst, stride, 4);
+    decodeEAC<sign>(block + 8, dst + 2, stride, 4);
+}
+
+enum ETCAlpha { kETCAlphaNone, kETCAlpha8Bit, kETCAlpha1Bit };
+
+// decodeETC2 decodes an ETC2 color block, and the EAC alpha block before it
+// for kETCAlpha8Bit, into RGBA8 texels.
+template <ETCAlpha mode>
+void decodeETC2(const uint8_t* block, uint8_t* dst, size_t stride) {
+    enum { R, G, B };
+
+    // The texel alphas come from the alpha block, or from the colors.
+    Row alphas[4];
+    uint8_t a = 255;
+    if (mode == kETCAlpha8Bit) {
+        uint64_t v = load64BigEndian(block);
+        int base = int(v >> 56);
+        int mul = int(v >> 52) & 15;
+        const int* modifiers = kEACModifiers[(v >> 48) & 15];
+        uint32_t values[8];
+        for (int c = 0; c < 8; c++) {
+            values[c] = alpha(clampByte(base + modifiers[c] * mul));
+        }
+        for (int y = 0; y < 4; y++) {
+            alphas[y] = lanes(values[eacIndex(v, 0, y)], values[eacIndex(v, 1, y)],
+                              values[eacIndex(v, 2, y)], values[eacIndex(v, 3, y)]);
+        }
+        block += 8;
+        a = 0;
+    }
+    const Row* mergeAlphas = mode == kETCAlpha8Bit ? alphas : nullptr;
+
+    uint64_t v = load64BigEndian(block);
+    uint32_t indices = uint32_t(v);
+    int flip = int(v >> 32) & 1;
+    int diff = int(v >> 33) & 1;
+    bool opaque = mode != kETCAlpha1Bit || diff != 0;
+    // Punchthrough blocks that are not opaque have a transparent third color.
+    auto color = [&](int idx, int r, int g, int b) {
+        return !opaque && idx == 2 ? rgba(0, 0, 0, 0) : rgba(clampByte(r), clampByte(g), clampByte(b), a);
+    };
+
+    int c[4][3];
+    int etcMode = 0;
+    for (int i = 0; i < 3; i++) {
+        if (mode != kETCAlpha1Bit && diff == 0) {
+            int c0 = int(v >> (60 - i * 8)) & 15;
+            int c1 = int(v >> (56 - i * 8)) & 15;
+            c[0][i] = (c0 << 4) | c0;
+            c[1][i] = (c1 << 4) | c1;
+        } else {
+            int c0 = int(v >> (59 - i * 8)) & 31;
+            int c1 = c0 + kETCDeltas[(v >> (56 - i * 8)) & 7];
+            if (c1 < 0 || c1 > 31) {
+                etcMode = i + 1;
+                break;
+            }
+            c[0][i] = (c0 << 3) | (c0 >> 2);
+            c[1][i] = (c1 << 3) | (c1 >> 2);
+        }
+    }
+
+    switch (etcMode) {
+        case 0: {  // Individual and differential modes (ETC1).
+            uint32_t sub[2][4];
+            for (int s = 0; s < 2; s++) {
+                const int* modifiers = kETCModifiers[opaque][(v >> (37 - s * 3)) & 7];
+                for (int idx = 0; idx < 4; idx++) {
+                    int m = modifiers[idx];
+                    sub[s][idx] = color(idx, c[s][R] + m, c[s][G] + m, c[s][B] + m);
+                }
+            }
+            if (flip == 0) {
+                // The sub-blocks are the left and right halves.
+                Row palette[4];
+                for (int idx = 0; idx < 4; idx++) {
+                    palette[idx] = lanes(sub[0][idx], sub[0][idx], sub[1][idx], sub[1][idx]);
+                }
+                const Row* const rows[4] = {palette, palette, palette, palette};
+                select(indices, kETCLayout, rows, mergeAlphas, dst, stride);
+            } else {
+                // The sub-blocks are the top and bottom halves.
+                Row top[4], bottom[4];
+                for (int idx = 0; idx < 4; idx++) {
+                    top[idx] = broadcast(sub[0][idx]);
+                    bottom[idx] = broadcast(sub[1][idx]);
+                }
+                const Row* const rows[4] = {top, top, bottom, bottom};
+                select(indices, kETCLayout, rows, mergeAlphas, dst, stride);
+            }
+            break;
+        }
+        case 1: {  // T mode.
+            c[0][R] = expand4to8(((v >> 57) & 12) | ((v >> 56) & 3));
+            c[0][G] = expand4to8(v >> 52);
+            c[0][B] = expand4to8(v >> 48);
+            c[2][R] = expand4to8(v >> 44);
+            c[2][G] = expand4to8(v >> 40);
+            c[2][B] = expand4to8(v >> 36);
+            int d = kETCDistances[((v >> 33) & 6) | ((v >> 32) & 1)];
+            uint32_t colors[4] = {
+                color(0, c[0][R], c[0][G], c[0][B]),
+                color(1, c[2][R] + d, c[2][G] + d, c[2][B] + d),
+                color(2, c[2][R], c[2][G], c[2][B]),
+                color(3, c[2][R] - d, c[2][G] - d, c[2][B] - d),
+            };
+            select(indices, kETCLayout, colors, mergeAlphas, dst, stride);
+            break;
+        }
+        case 2: {  // H mode.
+            c[0][R] = expand4to8(v >> 59);
+            c[0][G] = expand4to8(((v >> 55) & 14) | ((v >> 52) & 1));
+            c[0][B] = expand4to8(((v >> 48) & 8) | ((v >> 47) & 7));
+            c[2][R] = expand4to8(v >> 43);
+            c[2][G] = expand4to8(v >> 39);
+            c[2][B] = expand4to8(v >> 35);
+            int idx = int(((v >> 32) & 4) | ((v >> 31) & 2));
+            if ((c[0][R] << 16) + (c[0][G] << 8) + c[0][B] >= (c[2][R] << 16) + (c[2][G] << 8) + c[2][B]) {
+                idx++;
+            }
+            int d = kETCDistances[idx];
+            uint32_t colors[4] = {
+                color(0, c[0][R] + d, c[0][G] + d, c[0][B] + d),
+                color(1, c[0][R] - d, c[0][G] - d, c[0][B] - d),
+                color(2, c[2][R] + d, c[2][G] + d, c[2][B] + d),
+                color(3, c[2][R] - d, c[2][G] - d, c[2][B] - d),
+            };
+            select(indices, kETCLayout, colors, mergeAlphas, dst, stride);
+            break;
+        }
+        case 3: {  // Planar mode, which is always opaque.
+            int co[3], ch[3], cv[3];  // The colors at the origin, horizontal and vertical.
+            co[R] = expand6to8(v >> 57);
+            co[G] = expand7to8(((v >> 50) & 64) | ((v >> 49) & 63));
+            co[B] = expand6to8(((v >> 43) & 32) | ((v >> 40) & 24) | ((v >> 39) & 7));
+            ch[R] = expand6to8(((v >> 33) & 62) | ((v >> 32) & 1));
+            ch[G] = expand7to8(v >> 25);
+            ch[B] = expand6to8(v >> 19);
+            cv[R] = expand6to8(v >> 13);
+            cv[G] = expand7to8(v >> 6);
+            cv[B] = expand6to8(v);
+            for (int y = 0; y < 4; y++) {
+                uint32_t texels[4];
+                for (int x = 0; x < 4; x++) {
+                    int t[3];
+                    for (int i = 0; i < 3; i++) {
+                        t[i] = (x * (ch[i] - co[i]) + y * (cv[i] - co[i]) + 4 * co[i] + 2) >> 2;
+                    }
+                    texels[x] = rgba(clampByte(t[R]), clampByte(t[G]), clampByte(t[B]), a);
+                }
+                Row row = load(texels);
+                store(dst + y * stride, mergeAlphas != nullptr ? merge(row, alphas[y]) : row);
+            }
+            break;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Decoder
+////////////////////////////////////////////////////////////////////////////////
+
+// DecodeBlock decodes the 4x4 texels of a block to the rows of dst, which are
+// stride bytes apart.
+typedef void (*DecodeBlock)(const uint8_t* block, uint8_t* dst, size_t stride);
+
+struct Format {
+    uint32_t block_size;
+    uint32_t texel_size;
+    DecodeBlock decode;
+};
+
+Format getFormat(block_format format) {
+    switch (format) {
+        case BLOCK_DXT1_RGB: return {8, 4, decodeDXT1RGB};
+        case BLOCK_DXT1_RGBA: return {8, 4, decodeDXT1RGBA};
+        case BLOCK_RGTC1_R_U8: return {8, 4, decodeRGTC<false, false>};
+        case BLOCK_RGTC1_R_S8: return {8, 4, decodeRGTC<true, false>};
+        case BLOCK_ETC2_RGB8: return {8, 4, decodeETC2<kETCAlphaNone>};
+        case BLOCK_ETC2_RGB8_A1: return {8, 4, decodeETC2<kETCAlpha1Bit>};
+        case BLOCK_DXT3_RGBA: return {16, 4, decodeDXT3};
+        case BLOCK_DXT5_RGBA: return {16, 4, decodeDXT5};
+        case BLOCK_RGTC2_RG_U8: return {16, 4, decodeRGTC<false, true>};
+        case BLOCK_RGTC2_RG_S8: return {16, 4, decodeRGTC<true, true>};
+        case BLOCK_ETC2_RGBA8: return {16, 4, decodeETC2<kETCAlpha8Bit>};
+        case BLOCK_EAC_R11_U: return {8, 2, decodeEACR<false>};
+        case BLOCK_EAC_R11_S: return {8, 2, decodeEACR<true>};
+        case BLOCK_EAC_RG11_U: return {16, 4, decodeEACRG<false>};
+        case BLOCK_EAC_RG11_S: return {16, 4, decodeEACRG<true>};
+    }
+    return {0, 0, nullptr};
+}
+
+// Decoder decodes the blocks of an image into texels.
+class Decoder {
+public:
+    Decoder(const uint8_t* in, uint8_t* out, uint32_t width, uint32_t height, const Format& format)
+        : in(in), out(out), width(width), height(height), format(format),
+          blocks_x((width + 3) / 4), stride(size_t(width) * format.texel_size) {}
+
+    // rows decodes the block rows [first, last).
+    void rows(uint32_t first, uint32_t last) const {
+        uint8_t tile[16 * kMaxTexelSize];
+        const size_t tile_stride = 4 * format.texel_size;
+        for (uint32_t by = first; by < last; by++) {
+            const uint8_t* block = in + size_t(by) * blocks_x * format.block_size;
+            for (uint32_t bx = 0; bx < blocks_x; bx++, block += format.block_size) {
+                uint32_t x = bx * 4;
+                uint32_t y = by * 4;
+                if (x + 4 <= width && y + 4 <= height) {
+                    format.decode(block, out + y * stride + x * format.texel_size, stride);
+                    continue;
+                }
+                // Blocks on the right and bottom edges are clipped.
+                format.decode(block, tile, tile_stride);
+                uint32_t w = std::min(4u, width - x);
+                uint32_t h = std::min(4u, height - y);
+                for (uint32_t dy = 0; dy < h; dy++) {
+                    memcpy(out + (y + dy) * stride + x * format.texel_size,
+                           tile + dy * tile_stride, w * format.texel_size);
+                }
+            }
+        }
+    }
+
+private:
+    const uint8_t* in;
+    uint8_t* out;
+    const uint32_t width;
+    const uint32_t height;
+    const Format format;
+    const uint32_t blocks_x;
+    const size_t stride;
+};
+
+}  // anonymous namespace
+
+extern "C" void decompress_blocks(
+        uint8_t* in,
+        uint8_t* out,
+        uint32_t width,
+        uint32_t height,
+        block_format format) {
+
+    uint32_t blocks_x = (width + 3) / 4;
+    uint32_t blocks_y = (height + 3) / 4;
+    Format f = getFormat(format);
+    if (blocks_x == 0 || blocks_y == 0 || f.decode == nullptr) {
+        return;
+    }
+
+    Decoder decoder(in, out, width, height, f);
+    uint32_t threads = std::min(std::max(std::thread::hardware_concurrency(), 1u), blocks_y);
+    threads = std::min(threads, std::max(blocks_x * blocks_y / kMinBlocksPerThread, 1u));
+
+    // Each thread decodes a band of block rows, the calling thread the first.
+    std::vector<std::thread> workers;
+    for (uint32_t i = 1; i < threads; i++) {
+        workers.emplace_back([&decoder, i, threads, blocks_y] {
+            decoder.rows(blocks_y * i / threads, blocks_y * (i + 1) / threads);
+        });
+    }
+    decoder.rows(0, blocks_y / threads);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
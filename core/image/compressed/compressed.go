@@ -0,0 +1,92 @@
+// Copyright (C) 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Package compressed implements native decompression of the S3TC, RGTC, ETC2
+// and EAC block compressed formats.
+//
+// Importing compressed replaces the converters of the image package for these
+// formats with ones that decode the same texels in native code, on several
+// threads.
+//
+// compressed is in a separate package from image as it contains cgo code that
+// can slow builds.
+package compressed
+
+// #include "compressed.h"
+import "C"
+
+import (
+	"fmt"
+	"unsafe"
+
+	"github.com/google/gapid/core/image"
+)
+
+// converter decodes the src format to the dst format.
+type converter struct {
+	src, dst *image.Format
+	format   C.block_format
+	// The converter of the image package that was replaced.
+	fallback image.Converter
+}
+
+var converters = []*converter{
+	{src: image.S3_DXT1_RGB, dst: image.RGBA_U8_NORM, format: C.BLOCK_DXT1_RGB},
+	{src: image.S3_DXT1_RGBA, dst: image.RGBA_U8_NORM, format: C.BLOCK_DXT1_RGBA},
+	{src: image.S3_DXT3_RGBA, dst: image.RGBA_U8_NORM, format: C.BLOCK_DXT3_RGBA},
+	{src: image.S3_DXT5_RGBA, dst: image.RGBA_U8_NORM, format: C.BLOCK_DXT5_RGBA},
+	{src: image.RGTC1_BC4_R_U8_NORM, dst: image.RGBA_U8_NORM, format: C.BLOCK_RGTC1_R_U8},
+	{src: image.RGTC1_BC4_R_S8_NORM, dst: image.RGBA_U8_NORM, format: C.BLOCK_RGTC1_R_S8},
+	{src: image.RGTC2_BC5_RG_U8_NORM, dst: image.RGBA_U8_NORM, format: C.BLOCK_RGTC2_RG_U8},
+	{src: image.RGTC2_BC5_RG_S8_NORM, dst: image.RGBA_U8_NORM, format: C.BLOCK_RGTC2_RG_S8},
+	{src: image.ETC2_RGB_U8_NORM, dst: image.RGBA_U8_NORM, format: C.BLOCK_ETC2_RGB8},
+	{src: image.ETC2_RGBA_U8_NORM, dst: image.RGBA_U8_NORM, format: C.BLOCK_ETC2_RGBA8},
+	{src: image.ETC2_RGBA_U8U8U8U1_NORM, dst: image.RGBA_U8_NORM, format: C.BLOCK_ETC2_RGB8_A1},
+	{src: image.ETC2_SRGB_U8_NORM, dst: image.SRGBA_U8_NORM, format: C.BLOCK_ETC2_RGB8},
+	{src: image.ETC2_SRGBA_U8_NORM, dst: image.SRGBA_U8_NORM, format: C.BLOCK_ETC2_RGBA8},
+	{src: image.ETC2_SRGBA_U8U8U8U1_NORM, dst: image.SRGBA_U8_NORM, format: C.BLOCK_ETC2_RGB8_A1},
+	{src: image.ETC2_R_U11_NORM, dst: image.R_U16_NORM, format: C.BLOCK_EAC_R11_U},
+	{src: image.ETC2_RG_U11_NORM, dst: image.RG_U16_NORM, format: C.BLOCK_EAC_RG11_U},
+	{src: image.ETC2_R_S11_NORM, dst: image.R_S16_NORM, format: C.BLOCK_EAC_R11_S},
+	{src: image.ETC2_RG_S11_NORM, dst: image.RG_S16_NORM, format: C.BLOCK_EAC_RG11_S},
+}
+
+func init() {
+	for _, c := range converters {
+		c := c
+		c.fallback = image.ReplaceConverter(c.src, c.dst, c.decompress)
+	}
+}
+
+// decompress decodes the d slices of w x h texels in src. It returns an error
+// if src holds fewer blocks than the slices need, as the native code does not
+// check.
+func (c *converter) decompress(src []byte, w, h, d int) ([]byte, error) {
+	srcSliceSize, dstSliceSize := c.src.Size(w, h, 1), c.dst.Size(w, h, 1)
+	if expected := srcSliceSize * d; len(src) < expected {
+		return nil, fmt.Errorf("Image data size (0x%x) is less than expected (0x%x) for dimensions %dx%dx%d",
+			len(src), expected, w, h, d)
+	}
+	dst := make([]byte, dstSliceSize*d)
+	if len(dst) == 0 {
+		return dst, nil
+	}
+	for z := 0; z < d; z++ {
+		dst, src := dst[z*dstSliceSize:], src[z*srcSliceSize:]
+		in := (*C.uint8_t)(unsafe.Pointer(&src[0]))
+		out := (*C.uint8_t)(unsafe.Pointer(&dst[0]))
+		C.decompress_blocks(in, out, (C.uint32_t)(w), (C.uint32_t)(h), c.format)
+	}
+	return dst, nil
+}
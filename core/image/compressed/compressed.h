@@ -0,0 +1,52 @@
+// Copyright (C) 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// block_format is a 4x4 block compressed format decoded by decompress_blocks.
+typedef enum {
+  // 8 byte blocks decoded to RGBA8 texels.
+  BLOCK_DXT1_RGB,
+  BLOCK_DXT1_RGBA,
+  BLOCK_RGTC1_R_U8,
+  BLOCK_RGTC1_R_S8,
+  BLOCK_ETC2_RGB8,
+  BLOCK_ETC2_RGB8_A1,
+  // 16 byte blocks decoded to RGBA8 texels.
+  BLOCK_DXT3_RGBA,
+  BLOCK_DXT5_RGBA,
+  BLOCK_RGTC2_RG_U8,
+  BLOCK_RGTC2_RG_S8,
+  BLOCK_ETC2_RGBA8,
+  // 8 byte blocks decoded to 16 bit R texels.
+  BLOCK_EAC_R11_U,
+  BLOCK_EAC_R11_S,
+  // 16 byte blocks decoded to 16 bit RG texels.
+  BLOCK_EAC_RG11_U,
+  BLOCK_EAC_RG11_S,
+} block_format;
+
+// decompress_blocks decodes the width x height texels of the blocks of format
+// in to out. The texels are decoded exactly as the Go decoders of the image
+// package do. Large images are decoded by several threads.
+void decompress_blocks(uint8_t* in, uint8_t* out, uint32_t width,
+                       uint32_t height, block_format format);
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
@@ -0,0 +1,152 @@
+// Copyright (C) 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package compressed
+
+import (
+	"bytes"
+	"encoding/binary"
+	"fmt"
+	"io/ioutil"
+	"math/rand"
+	"os"
+	"path/filepath"
+	"testing"
+
+	"github.com/google/gapid/core/image"
+)
+
+// loadTestData returns the blocks and the size of the image of format f in
+// the test data of the image package, or nil if there is none.
+func loadTestData(t *testing.T, f *image.Format) (data []byte, w, h int) {
+	base := filepath.Join("..", "test_data", f.Name)
+	if data, err := ioutil.ReadFile(base + ".bin"); err == nil {
+		// The size of the raw blocks is the size of the reference PNG.
+		pngData, err := ioutil.ReadFile(base + ".png")
+		if err != nil {
+			t.Fatalf("Failed to read '%s.png': %v", base, err)
+		}
+		png, err := image.PNGFrom(pngData)
+		if err != nil {
+			t.Fatalf("Failed to read PNG '%s.png': %v", base, err)
+		}
+		return data, int(png.Width), int(png.Height)
+	}
+
+	ktx, err := ioutil.ReadFile(base + ".ktx")
+	if os.IsNotExist(err) {
+		return nil, 0, 0
+	} else if err != nil {
+		t.Fatalf("Failed to read '%s.ktx': %v", base, err)
+	}
+	// See: https://www.khronos.org/opengles/sdk/tools/KTX/file_format_spec/
+	le := binary.LittleEndian
+	w, h = int(le.Uint32(ktx[36:])), int(le.Uint32(ktx[40:]))
+	offset := 64 + int(le.Uint32(ktx[60:]))
+	size := int(le.Uint32(ktx[offset:]))
+	return ktx[offset+4 : offset+4+size], w, h
+}
+
+func TestDecompressTestData(t *testing.T) {
+	for _, c := range converters {
+		data, w, h := loadTestData(t, c.src)
+		if data == nil {
+			continue
+		}
+		expected, err := c.fallback(data, w, h, 1)
+		if err != nil {
+			t.Errorf("%v: %v", c.src.Name, err)
+			continue
+		}
+		got, err := c.decompress(data, w, h, 1)
+		if err != nil {
+			t.Errorf("%v: %v", c.src.Name, err)
+		} else if !bytes.Equal(got, expected) {
+			t.Errorf("%v: decompress does not match the image package", c.src.Name)
+		}
+	}
+}
+
+func TestDecompressMatchesImage(t *testing.T) {
+	r := rand.New(rand.NewSource(1))
+	for _, c := range converters {
+		for _, size := range []struct{ w, h, d int }{
+			{1, 1, 1}, {4, 4, 1}, {13, 7, 1}, {64, 64, 2}, {333, 129, 1}, {1024, 512, 1},
+		} {
+			src := make([]byte, c.src.Size(size.w, size.h, size.d))
+			r.Read(src)
+			expected, err := c.fallback(src, size.w, size.h, size.d)
+			if err != nil {
+				t.Errorf("%v: %v", c.src.Name, err)
+				continue
+			}
+			got, err := c.decompress(src, size.w, size.h, size.d)
+			if err != nil {
+				t.Errorf("%v %dx%dx%d: %v", c.src.Name, size.w, size.h, size.d, err)
+			} else if !bytes.Equal(got, expected) {
+				t.Errorf("%v %dx%dx%d: decompress does not match the image package",
+					c.src.Name, size.w, size.h, size.d)
+			}
+		}
+	}
+}
+
+func TestConvertUsesDecompress(t *testing.T) {
+	src := make([]byte, image.S3_DXT1_RGB.Size(4, 4, 1))
+	rand.New(rand.NewSource(1)).Read(src)
+	got, err := image.Convert(src, 4, 4, 1, image.S3_DXT1_RGB, image.RGBA_U8_NORM)
+	if err != nil {
+		t.Fatalf("Convert returned error: %v", err)
+	}
+	if expected, _ := converters[0].decompress(src, 4, 4, 1); !bytes.Equal(got, expected) {
+		t.Errorf("Convert does not match decompress")
+	}
+}
+
+func TestDecompressShortData(t *testing.T) {
+	for _, c := range converters {
+		for _, size := range []struct{ w, h, d int }{{4, 4, 1}, {64, 64, 2}} {
+			src := make([]byte, c.src.Size(size.w, size.h, size.d)-1)
+			if _, err := c.decompress(src, size.w, size.h, size.d); err == nil {
+				t.Errorf("%v %dx%dx%d: decompress of %d bytes did not fail",
+					c.src.Name, size.w, size.h, size.d, len(src))
+			}
+		}
+		if _, err := c.decompress(nil, 1, 1, 1); err == nil {
+			t.Errorf("%v: decompress of no data did not fail", c.src.Name)
+		}
+	}
+}
+
+func BenchmarkDecompress(b *testing.B) {
+	const w, h = 2048, 2048
+	r := rand.New(rand.NewSource(1))
+	for _, c := range converters {
+		src := make([]byte, c.src.Size(w, h, 1))
+		r.Read(src)
+		for _, native := range []bool{false, true} {
+			c, name := c, fmt.Sprintf("%v/native=%v", c.src.Name, native)
+			b.Run(name, func(b *testing.B) {
+				b.SetBytes(int64(c.dst.Size(w, h, 1)))
+				for i := 0; i < b.N; i++ {
+					if native {
+						c.decompress(src, w, h, 1)
+					} else {
+						c.fallback(src, w, h, 1)
+					}
+				}
+			})
+		}
+	}
+}
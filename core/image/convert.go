@@ -42,6 +42,20 @@ func RegisterConverter(src, dst *Format, c Converter) {
 	registeredConverters[key] = c
 }
 
+// ReplaceConverter registers the Converter for converting from src to dst
+// formats in place of the one already registered, and returns the replaced
+// Converter. If no converter exists for converting from src to dst, then this
+// function panics.
+func ReplaceConverter(src, dst *Format, c Converter) Converter {
+	key := srcDstFmt{src.Key(), dst.Key()}
+	old, found := registeredConverters[key]
+	if !found {
+		panic(fmt.Errorf("No converter from %s to %s registered", src, dst))
+	}
+	registeredConverters[key] = c
+	return old
+}
+
 func registered(src, dst *Format) bool {
 	key := srcDstFmt{src.Key(), dst.Key()}
 	_, found := registeredConverters[key]
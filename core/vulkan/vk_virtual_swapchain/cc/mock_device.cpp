@@ -0,0 +1,355 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mock_device.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace swapchain {
+namespace test {
+namespace {
+
+MockDevice *device_ = nullptr;
+
+template <typename T>
+uint64_t ID(T handle) {
+  return (uint64_t)handle;
+}
+
+template <typename T>
+T Handle(uint64_t id) {
+  return (T)id;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL AllocateMemory(VkDevice,
+                                              const VkMemoryAllocateInfo *info,
+                                              const VkAllocationCallbacks *,
+                                              VkDeviceMemory *memory) {
+  std::lock_guard<std::mutex> lock(device_->mutex);
+  uint64_t id = device_->NewHandle();
+  device_->memory[id].resize(info->allocationSize);
+  *memory = Handle<VkDeviceMemory>(id);
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL FreeMemory(VkDevice, VkDeviceMemory memory,
+                                      const VkAllocationCallbacks *) {
+  std::lock_guard<std::mutex> lock(device_->mutex);
+  device_->memory.erase(ID(memory));
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL MapMemory(VkDevice, VkDeviceMemory memory,
+                                         VkDeviceSize offset, VkDeviceSize,
+                                         VkMemoryMapFlags, void **data) {
+  std::this_thread::sleep_for(device_->map_latency);
+  std::lock_guard<std::mutex> lock(device_->mutex);
+  device_->maps++;
+  *data = device_->memory[ID(memory)].data() + offset;
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL UnmapMemory(VkDevice, VkDeviceMemory) {}
+
+VKAPI_ATTR VkResult VKAPI_CALL
+InvalidateMappedMemoryRanges(VkDevice, uint32_t, const VkMappedMemoryRange *) {
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateFence(VkDevice, const VkFenceCreateInfo *,
+                                           const VkAllocationCallbacks *,
+                                           VkFence *fence) {
+  std::lock_guard<std::mutex> lock(device_->mutex);
+  uint64_t id = device_->NewHandle();
+  device_->fences[id];
+  *fence = Handle<VkFence>(id);
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyFence(VkDevice, VkFence fence,
+                                        const VkAllocationCallbacks *) {
+  std::lock_guard<std::mutex> lock(device_->mutex);
+  device_->fences.erase(ID(fence));
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL GetFenceStatus(VkDevice, VkFence fence) {
+  std::lock_guard<std::mutex> lock(device_->mutex);
+  return device_->Signaled(ID(fence)) ? VK_SUCCESS : VK_NOT_READY;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL ResetFences(VkDevice, uint32_t count,
+                                           const VkFence *fences) {
+  std::lock_guard<std::mutex> lock(device_->mutex);
+  for (uint32_t i = 0; i < count; ++i) {
+    device_->fences[ID(fences[i])].submitted = false;
+  }
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL WaitForFences(VkDevice, uint32_t count,
+                                             const VkFence *fences,
+                                             VkBool32 wait_all,
+                                             uint64_t timeout) {
+  std::unique_lock<std::mutex> lock(device_->mutex);
+  auto deadline = timeout >= uint64_t(INT64_MAX)
+                      ? clock::time_point::max()
+                      : clock::now() + std::chrono::nanoseconds(timeout);
+  while (true) {
+    // The time the wait is satisfied at, for the copies submitted so far.
+    clock::time_point done =
+        wait_all ? clock::time_point::min() : clock::time_point::max();
+    for (uint32_t i = 0; i < count; ++i) {
+      const MockDevice::Fence &f = device_->fences[ID(fences[i])];
+      clock::time_point at = f.submitted ? f.signal_at : clock::time_point::max();
+      done = wait_all ? std::max(done, at) : std::min(done, at);
+    }
+    if (clock::now() >= done) {
+      return VK_SUCCESS;
+    }
+    if (clock::now() >= deadline) {
+      return VK_TIMEOUT;
+    }
+    device_->submitted.wait_until(lock, std::min(done, deadline));
+  }
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateImage(VkDevice, const VkImageCreateInfo *,
+                                           const VkAllocationCallbacks *,
+                                           VkImage *image) {
+  std::lock_guard<std::mutex> lock(device_->mutex);
+  *image = Handle<VkImage>(device_->NewHandle());
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyImage(VkDevice, VkImage,
+                                        const VkAllocationCallbacks *) {}
+
+VKAPI_ATTR void VKAPI_CALL GetMemoryRequirements(VkDevice, uint64_t,
+                                                 VkMemoryRequirements *reqs) {
+  reqs->size = 64 * 64 * 4;
+  reqs->alignment = 128;
+  reqs->memoryTypeBits = 1;
+}
+
+VKAPI_ATTR void VKAPI_CALL GetImageMemoryRequirements(
+    VkDevice device, VkImage image, VkMemoryRequirements *reqs) {
+  GetMemoryRequirements(device, ID(image), reqs);
+}
+
+VKAPI_ATTR void VKAPI_CALL GetBufferMemoryRequirements(
+    VkDevice device, VkBuffer buffer, VkMemoryRequirements *reqs) {
+  GetMemoryRequirements(device, ID(buffer), reqs);
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL BindImageMemory(VkDevice, VkImage,
+                                               VkDeviceMemory, VkDeviceSize) {
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateBuffer(VkDevice,
+                                            const VkBufferCreateInfo *,
+                                            const VkAllocationCallbacks *,
+                                            VkBuffer *buffer) {
+  std::lock_guard<std::mutex> lock(device_->mutex);
+  *buffer = Handle<VkBuffer>(device_->NewHandle());
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyBuffer(VkDevice, VkBuffer,
+                                         const VkAllocationCallbacks *) {}
+
+VKAPI_ATTR VkResult VKAPI_CALL BindBufferMemory(VkDevice, VkBuffer buffer,
+                                                VkDeviceMemory memory,
+                                                VkDeviceSize) {
+  std::lock_guard<std::mutex> lock(device_->mutex);
+  device_->buffer_memory[ID(buffer)] = ID(memory);
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL CreateCommandPool(
+    VkDevice, const VkCommandPoolCreateInfo *, const VkAllocationCallbacks *,
+    VkCommandPool *pool) {
+  std::lock_guard<std::mutex> lock(device_->mutex);
+  *pool = Handle<VkCommandPool>(device_->NewHandle());
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL DestroyCommandPool(VkDevice, VkCommandPool,
+                                              const VkAllocationCallbacks *) {}
+
+VKAPI_ATTR VkResult VKAPI_CALL
+AllocateCommandBuffers(VkDevice, const VkCommandBufferAllocateInfo *info,
+                       VkCommandBuffer *command_buffers) {
+  std::lock_guard<std::mutex> lock(device_->mutex);
+  for (uint32_t i = 0; i < info->commandBufferCount; ++i) {
+    // Command buffers are dispatchable, so they must point to a dispatch
+    // table pointer that the layer can overwrite.
+    void **dispatch = new void *(nullptr);
+    device_->dispatchable.push_back(dispatch);
+    command_buffers[i] = reinterpret_cast<VkCommandBuffer>(dispatch);
+  }
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL
+BeginCommandBuffer(VkCommandBuffer, const VkCommandBufferBeginInfo *) {
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL EndCommandBuffer(VkCommandBuffer) {
+  return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL CmdCopyImageToBuffer(VkCommandBuffer command_buffer,
+                                                VkImage, VkImageLayout,
+                                                VkBuffer buffer, uint32_t,
+                                                const VkBufferImageCopy *) {
+  std::lock_guard<std::mutex> lock(device_->mutex);
+  device_->copy_destination[command_buffer] = ID(buffer);
+}
+
+VKAPI_ATTR void VKAPI_CALL CmdPipelineBarrier(
+    VkCommandBuffer, VkPipelineStageFlags, VkPipelineStageFlags,
+    VkDependencyFlags, uint32_t, const VkMemoryBarrier *, uint32_t,
+    const VkBufferMemoryBarrier *, uint32_t, const VkImageMemoryBarrier *) {}
+
+void Callback(void *user_data, uint8_t *data, size_t length) {
+  MockPresenter::Frames *frames =
+      static_cast<MockPresenter::Frames *>(user_data);
+  uint32_t frame;
+  memcpy(&frame, data, sizeof(frame));
+  std::this_thread::sleep_for(frames->work);
+  std::lock_guard<std::mutex> lock(frames->mutex);
+  frames->frames.push_back(frame);
+  frames->length = length;
+}
+
+}  // namespace
+
+MockPresenter::MockPresenter() {
+  device_ = &mock;
+  dispatch_ = nullptr;
+  device_handle_ = reinterpret_cast<VkDevice>(&dispatch_);
+
+  memset(&functions_, 0, sizeof(functions_));
+  functions_.vkAllocateMemory = AllocateMemory;
+  functions_.vkFreeMemory = FreeMemory;
+  functions_.vkMapMemory = MapMemory;
+  functions_.vkUnmapMemory = UnmapMemory;
+  functions_.vkInvalidateMappedMemoryRanges = InvalidateMappedMemoryRanges;
+  functions_.vkCreateFence = CreateFence;
+  functions_.vkGetFenceStatus = GetFenceStatus;
+  functions_.vkWaitForFences = WaitForFences;
+  functions_.vkDestroyFence = DestroyFence;
+  functions_.vkResetFences = ResetFences;
+  functions_.vkCreateImage = CreateImage;
+  functions_.vkGetImageMemoryRequirements = GetImageMemoryRequirements;
+  functions_.vkBindImageMemory = BindImageMemory;
+  functions_.vkDestroyImage = DestroyImage;
+  functions_.vkCreateBuffer = CreateBuffer;
+  functions_.vkGetBufferMemoryRequirements = GetBufferMemoryRequirements;
+  functions_.vkBindBufferMemory = BindBufferMemory;
+  functions_.vkDestroyBuffer = DestroyBuffer;
+  functions_.vkCreateCommandPool = CreateCommandPool;
+  functions_.vkDestroyCommandPool = DestroyCommandPool;
+  functions_.vkAllocateCommandBuffers = AllocateCommandBuffers;
+  functions_.vkBeginCommandBuffer = BeginCommandBuffer;
+  functions_.vkEndCommandBuffer = EndCommandBuffer;
+  functions_.vkCmdCopyImageToBuffer = CmdCopyImageToBuffer;
+  functions_.vkCmdPipelineBarrier = CmdPipelineBarrier;
+
+  memset(&properties_, 0, sizeof(properties_));
+  memset(&memory_properties_, 0, sizeof(memory_properties_));
+  memory_properties_.memoryTypeCount = 1;
+  memory_properties_.memoryTypes[0].propertyFlags =
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+
+  memset(&create_info, 0, sizeof(create_info));
+  create_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+  create_info.minImageCount = 3;
+  create_info.imageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+  create_info.imageExtent = {kWidth, kHeight};
+  create_info.imageArrayLayers = 1;
+}
+
+MockPresenter::~MockPresenter() {
+  for (void **dispatch : mock.dispatchable) {
+    delete dispatch;
+  }
+  device_ = nullptr;
+}
+
+VirtualSwapchain *MockPresenter::Create() {
+  return new VirtualSwapchain(device_handle_, 0, &properties_,
+                              &memory_properties_, &functions_, &create_info,
+                              nullptr);
+}
+
+bool MockPresenter::Present(VirtualSwapchain *swapchain, uint32_t i,
+                            uint32_t frame) {
+  bool reused;
+  {
+    std::lock_guard<std::mutex> lock(mock.mutex);
+    VkCommandBuffer command_buffer = swapchain->GetCommandBuffer(i);
+    uint64_t buffer = mock.copy_destination[command_buffer];
+    std::vector<uint8_t> &memory = mock.memory[mock.buffer_memory[buffer]];
+    memcpy(memory.data(), &frame, sizeof(frame));
+
+    MockDevice::Fence &fence = mock.fences[ID(swapchain->GetFence(i))];
+    reused = fence.submitted;
+    mock.last_signal =
+        std::max(mock.last_signal, clock::now() + mock.copy_latency);
+    fence.submitted = true;
+    fence.signal_at = mock.last_signal;
+  }
+  mock.submitted.notify_all();
+  swapchain->NotifySubmitted(i);
+  return !reused;
+}
+
+void MockPresenter::Run(uint32_t count, std::chrono::microseconds render,
+                        std::chrono::microseconds copy,
+                        std::chrono::microseconds callback, Frames *frames) {
+  mock.copy_latency = copy;
+  frames->work = callback;
+
+  VirtualSwapchain *swapchain = Create();
+  swapchain->SetCallback(Callback, frames);
+  swapchain->GetImages(create_info.minImageCount, false);
+
+  auto start = clock::now();
+  for (uint32_t frame = 0; frame < count; ++frame) {
+    uint32_t i;
+    if (!swapchain->GetImage(UINT64_MAX, &i)) {
+      frames->missing_images++;
+      continue;
+    }
+    std::this_thread::sleep_for(render);
+    if (!Present(swapchain, i, frame)) {
+      frames->reused_images++;
+    }
+  }
+  // Destroy waits for all of the presented frames to be handed to the
+  // callback.
+  swapchain->Destroy(nullptr);
+  std::chrono::duration<double> elapsed = clock::now() - start;
+  delete swapchain;
+  frames->fps = count / elapsed.count();
+}
+
+}  // namespace test
+}  // namespace swapchain
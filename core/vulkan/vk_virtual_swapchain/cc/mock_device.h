@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VK_VIRTUAL_SWAPCHAIN_MOCK_DEVICE_H_
+#define VK_VIRTUAL_SWAPCHAIN_MOCK_DEVICE_H_
+
+#include "virtual_swapchain.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace swapchain {
+namespace test {
+
+typedef std::chrono::steady_clock clock;
+
+// MockDevice is a fake VkDevice that completes the copy of each submitted
+// image a fixed latency after its submission. Copies complete in submission
+// order, as they would on a single queue. Mapping memory takes map_latency,
+// as drivers have to set up the mapping of the pages.
+struct MockDevice {
+  std::mutex mutex;
+  std::condition_variable submitted;
+  uint64_t next_handle = 1;
+  std::chrono::microseconds copy_latency{0};
+  std::chrono::microseconds map_latency{0};
+  clock::time_point last_signal;
+
+  struct Fence {
+    bool submitted = false;
+    clock::time_point signal_at;
+  };
+  std::map<uint64_t, Fence> fences;
+  std::map<uint64_t, std::vector<uint8_t>> memory;
+  std::map<uint64_t, uint64_t> buffer_memory;  // buffer -> memory
+  std::map<VkCommandBuffer, uint64_t> copy_destination;  // -> buffer
+  std::vector<void **> dispatchable;
+  size_t maps = 0;
+
+  // Returns the handle for the next created object.
+  uint64_t NewHandle() { return next_handle++; }
+
+  bool Signaled(uint64_t fence) {
+    const Fence &f = fences[fence];
+    return f.submitted && clock::now() >= f.signal_at;
+  }
+};
+
+// MockPresenter creates VirtualSwapchains on a MockDevice, and presents
+// frames to them as the layer's vkQueuePresentKHR does. Only one MockPresenter
+// may exist at a time.
+class MockPresenter {
+ public:
+  static const uint32_t kWidth = 64;
+  static const uint32_t kHeight = 64;
+
+  // The frames seen by the callback, and the errors seen while presenting.
+  struct Frames {
+    std::mutex mutex;
+    std::vector<uint32_t> frames;
+    std::chrono::microseconds work{0};
+    size_t length = 0;
+    // The number of GetImage calls that failed.
+    uint32_t missing_images = 0;
+    // The number of images presented while their previous copy was pending.
+    uint32_t reused_images = 0;
+    // The frames per second from the first GetImage call to the callback
+    // seeing the last frame.
+    double fps = 0;
+  };
+
+  MockPresenter();
+  ~MockPresenter();
+
+  VirtualSwapchain *Create();
+
+  // Does what vkQueuePresentKHR does with image i of swapchain: submits the
+  // copy of the image, which writes frame into the first bytes of the copy.
+  // Returns false if the previous copy of the image was still pending.
+  bool Present(VirtualSwapchain *swapchain, uint32_t i, uint32_t frame);
+
+  // Presents count frames with the given rendering, copy and callback times
+  // to a new swapchain, and stores what the callback saw in frames.
+  void Run(uint32_t count, std::chrono::microseconds render,
+           std::chrono::microseconds copy, std::chrono::microseconds callback,
+           Frames *frames);
+
+  MockDevice mock;
+  VkSwapchainCreateInfoKHR create_info;
+
+ private:
+  void *dispatch_;
+  VkDevice device_handle_;
+  DeviceData functions_;
+  VkPhysicalDeviceProperties properties_;
+  VkPhysicalDeviceMemoryProperties memory_properties_;
+};
+
+}  // namespace test
+}  // namespace swapchain
+
+#endif  // VK_VIRTUAL_SWAPCHAIN_MOCK_DEVICE_H_
@@ -23,6 +23,8 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace {
 
@@ -41,6 +43,18 @@ int32_t FindMemoryType(
 }
 
 void null_callback(void *, uint8_t *, size_t) {}
+
+// The member function that a thread of a VirtualSwapchain runs.
+struct ThreadStart {
+  swapchain::VirtualSwapchain *swapchain;
+  void (swapchain::VirtualSwapchain::*func)();
+};
+
+void run_thread(void *data) {
+  ThreadStart *start = static_cast<ThreadStart *>(data);
+  (start->swapchain->*start->func)();
+  delete start;
+}
 }  // namespace
 
 namespace swapchain {
@@ -62,6 +76,7 @@ VirtualSwapchain::VirtualSwapchain(
       image_data_(num_images_),
       device_(device),
       should_close_(false),
+      copies_done_(false),
       callback_(null_callback),
       queue_(queue),
       functions_(functions),
@@ -173,6 +188,12 @@ VirtualSwapchain::VirtualSwapchain(
                                      &image_data.buffer_memory_);
         functions_->vkBindBufferMemory(device_, image_data.buffer_,
                                        image_data.buffer_memory_, 0);
+        // Keep the buffer mapped, so that reading a frame back does not
+        // have to map and unmap it.
+        void *mapped_value;
+        functions_->vkMapMemory(device_, image_data.buffer_memory_, 0,
+                                VK_WHOLE_SIZE, 0, &mapped_value);
+        image_data.buffer_data_ = static_cast<uint8_t *>(mapped_value);
       }
     }
 
@@ -252,34 +273,55 @@ VirtualSwapchain::VirtualSwapchain(
     free_images_.push_back(i);
   }
 
+  copy_thread_ = StartThread(&VirtualSwapchain::CopyThreadFunc);
+  callback_thread_ = StartThread(&VirtualSwapchain::CallbackThreadFunc);
+}
+
+VirtualSwapchain::thread VirtualSwapchain::StartThread(
+    void (VirtualSwapchain::*func)()) {
+  ThreadStart *start = new ThreadStart{this, func};
+  thread t;
 #ifdef _WIN32
-  thread_ = CreateThread(NULL, 0,
-                         [](void *data) -> DWORD {
-                           ((VirtualSwapchain *)data)->CopyThreadFunc();
-                           return 0;
-                         },
-                         this, 0, nullptr);
+  t = CreateThread(NULL, 0,
+                   [](void *data) -> DWORD {
+                     run_thread(data);
+                     return 0;
+                   },
+                   start, 0, nullptr);
 #else
-  pthread_create(&thread_, nullptr,
+  pthread_create(&t, nullptr,
                  +[](void *data) -> void * {
-                   ((VirtualSwapchain *)data)->CopyThreadFunc();
+                   run_thread(data);
                    return nullptr;
                  },
-                 this);
+                 start);
 #endif
+  return t;
 }
 
-void VirtualSwapchain::Destroy(const VkAllocationCallbacks *pAllocator) {
-  should_close_.store(true);
+void VirtualSwapchain::JoinThread(thread t) {
 #ifdef _WIN32
-  WaitForSingleObject(thread_, INFINITE);
-  CloseHandle(thread_);
+  WaitForSingleObject(t, INFINITE);
+  CloseHandle(t);
 #else
-  pthread_join(thread_, nullptr);
+  pthread_join(t, nullptr);
 #endif
+}
+
+void VirtualSwapchain::Destroy(const VkAllocationCallbacks *pAllocator) {
+  {
+    std::lock_guard<threading::mutex> lock(pending_images_lock_);
+    should_close_ = true;
+  }
+  pending_images_condition_.notify_one();
+  // The copy thread finishes the pending copies, and the callback thread
+  // passes them to the callback, before they terminate.
+  JoinThread(copy_thread_);
+  JoinThread(callback_thread_);
 
   for (size_t i = 0; i < num_images_; ++i) {
     functions_->vkFreeMemory(device_, image_data_[i].image_memory_, pAllocator);
+    functions_->vkUnmapMemory(device_, image_data_[i].buffer_memory_);
     functions_->vkDestroyImage(device_, image_data_[i].image_, pAllocator);
     functions_->vkFreeMemory(device_, image_data_[i].buffer_memory_,
                              pAllocator);
@@ -295,53 +337,106 @@ void VirtualSwapchain::Destroy(const VkAllocationCallbacks *pAllocator) {
 }
 
 void VirtualSwapchain::CopyThreadFunc() {
+  // The images whose copies have been submitted, in submission order. The
+  // flag tells if the copy has completed.
+  std::deque<std::pair<uint32_t, bool>> in_flight;
+  std::vector<VkFence> fences;
   while (true) {
-    uint32_t pending_image = 0;
-    // We have to wait until there is a pending image.
     {
-      // Wait 10ms for our next image.
       std::unique_lock<threading::mutex> pl(pending_images_lock_);
-      while (pending_images_.empty()) {
-        if (threading::cv_status::timeout ==
-            pending_images_condition_.wait_for(
-                pl, std::chrono::milliseconds(
-                        pending_image_timeout_in_milliseconds_))) {
-          if (should_close_.load()) {
-            // One last check to see if there are any more pending images.
-            // If not we can return.
-            if (!pending_images_.empty()) break;
-            return;
-          }
+      // With no copies in flight, sleep until an image is submitted.
+      while (in_flight.empty() && pending_images_.empty() && !should_close_) {
+        pending_images_condition_.wait(pl);
+      }
+      for (uint32_t pending_image : pending_images_) {
+        in_flight.push_back(std::make_pair(pending_image, false));
+      }
+      pending_images_.clear();
+      if (in_flight.empty()) {
+        // should_close_ is set and every copy has been handed off.
+        break;
+      }
+    }
+
+    // Wait for any of the copies that have not completed yet.
+    fences.clear();
+    for (const auto &image : in_flight) {
+      if (!image.second) {
+        fences.push_back(image_data_[image.first].fence_);
+      }
+    }
+    if (!fences.empty()) {
+      VkResult ret = functions_->vkWaitForFences(
+          device_, static_cast<uint32_t>(fences.size()), fences.data(), false,
+          pending_image_timeout_in_milliseconds_ * 1000000ull);
+      if (ret == VK_TIMEOUT) {
+        continue;
+      }
+      // Errors such as a lost device count as completed copies, rather
+      // than leaving the images in flight forever.
+      for (auto &image : in_flight) {
+        if (!image.second) {
+          image.second = functions_->vkGetFenceStatus(
+                             device_, image_data_[image.first].fence_) !=
+                         VK_NOT_READY;
         }
       }
-      pending_image = pending_images_.front();
-      pending_images_.pop_front();
     }
 
-    VkResult ret = functions_->vkWaitForFences(
-        device_, 1, &image_data_[pending_image].fence_, false, UINT64_MAX);
-    (void)ret;  // TODO: Check this?
-    functions_->vkResetFences(device_, 1, &image_data_[pending_image].fence_);
-
-    void *mapped_value;
-    functions_->vkMapMemory(device_, image_data_[pending_image].buffer_memory_,
-                            0, VK_WHOLE_SIZE, 0, &mapped_value);
-    VkMappedMemoryRange range{
-        VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,      // sType
-        nullptr,                                    // pNext
-        image_data_[pending_image].buffer_memory_,  // memory
-        0,                                          // offset
-        VK_WHOLE_SIZE,                              // size
-    };
-    functions_->vkInvalidateMappedMemoryRanges(device_, 1, &range);
+    // Hand the completed copies to the callback thread in submission order,
+    // so that the callback sees the frames in the order they were presented.
+    bool copied = false;
+    while (!in_flight.empty() && in_flight.front().second) {
+      uint32_t image = in_flight.front().first;
+      in_flight.pop_front();
+      functions_->vkResetFences(device_, 1, &image_data_[image].fence_);
+      VkMappedMemoryRange range{
+          VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,  // sType
+          nullptr,                                // pNext
+          image_data_[image].buffer_memory_,      // memory
+          0,                                      // offset
+          VK_WHOLE_SIZE,                          // size
+      };
+      functions_->vkInvalidateMappedMemoryRanges(device_, 1, &range);
+      {
+        std::lock_guard<threading::mutex> cl(copied_images_lock_);
+        copied_images_.push_back(image);
+      }
+      copied = true;
+    }
+    if (copied) {
+      copied_images_condition_.notify_one();
+    }
+  }
+
+  {
+    std::lock_guard<threading::mutex> cl(copied_images_lock_);
+    copies_done_ = true;
+  }
+  copied_images_condition_.notify_one();
+}
+
+void VirtualSwapchain::CallbackThreadFunc() {
+  while (true) {
+    uint32_t copied_image = 0;
+    {
+      std::unique_lock<threading::mutex> cl(copied_images_lock_);
+      while (copied_images_.empty() && !copies_done_) {
+        copied_images_condition_.wait(cl);
+      }
+      if (copied_images_.empty()) {
+        return;
+      }
+      copied_image = copied_images_.front();
+      copied_images_.pop_front();
+    }
 
     uint32_t length = ImageByteSize();
-    { callback_(callback_user_data_, (uint8_t *)mapped_value, length); }
-    functions_->vkUnmapMemory(device_,
-                              image_data_[pending_image].buffer_memory_);
+    callback_(callback_user_data_, image_data_[copied_image].buffer_data_,
+              length);
     {
       std::unique_lock<threading::mutex> l(free_images_lock_);
-      free_images_.push_back(pending_image);
+      free_images_.push_back(copied_image);
     }
     free_images_condition_.notify_all();
   }
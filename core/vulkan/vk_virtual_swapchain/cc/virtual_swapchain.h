@@ -18,7 +18,6 @@
 #define VK_VIRTUAL_SWAPCHAIN_VIRTUAL_SWAPCHAIN_H_
 
 #include <vulkan/vulkan.h>
-#include <atomic>
 #include <deque>
 #include <functional>
 #include <memory>
@@ -33,11 +32,12 @@ namespace swapchain {
 class VirtualSwapchain {
  public:
   // pending_image_timeout_in_milliseconds_ can be configured based on your
-  // application. By default it is 10ms. This tells the secondary thread
-  // how long it should wait if no image has been submitted to see if
-  // it should shut down. Increasing this number will mean that the
-  // secondary thread will wake up less frequently un-necessarily, at the
-  // expense of a longer stall on shutdown.
+  // application. By default it is 10ms. This tells the copy thread how long
+  // it should wait for the copies in flight before it adds the images
+  // submitted in the meantime to the copies it waits for. Increasing this
+  // number will mean that the copy thread will wake up less frequently
+  // un-necessarily, at the expense of noticing new copies later when the
+  // copies in flight take long.
   VirtualSwapchain(VkDevice device, uint32_t queue,
                    const VkPhysicalDeviceProperties *pProperties,
                    const VkPhysicalDeviceMemoryProperties *memory_properties,
@@ -129,10 +129,14 @@ class VirtualSwapchain {
 
  private:
   const VkSwapchainCreateInfoKHR swapchain_info_;
-  // This is the entry-point to our secondary thread.
-  // It is responsible for keeping track of copies, and calling the
-  // callback when a copy has completed.
+  // This is the entry-point to our copy thread.
+  // It is responsible for keeping track of copies, and handing images
+  // to the callback thread as their copies complete.
   void CopyThreadFunc();
+  // This is the entry-point to our callback thread.
+  // It is responsible for calling the callback for the images whose copies
+  // have completed, and freeing the images afterwards.
+  void CallbackThreadFunc();
   // Returns the size of the image in bytes.
   uint32_t ImageByteSize() const;
   // All of the data associated with a single swapchain VkImage.
@@ -142,6 +146,8 @@ class VirtualSwapchain {
 
     VkBuffer buffer_;  // The buffer to copy the image contents into.
     VkDeviceMemory buffer_memory_;  // The memory for the buffer.
+    uint8_t *buffer_data_;  // The buffer memory, mapped for the lifetime of
+                            // the swapchain.
 
     VkFence fence_;  // The fence to signal when the copy is complete.
     VkCommandBuffer
@@ -161,26 +167,41 @@ class VirtualSwapchain {
                         // have been submitted but not processed yet.
   std::deque<uint32_t> free_images_;  // Indices into image_data_ for all images
                                       // that are not currently in use.
+  std::deque<uint32_t>
+      copied_images_;  // Indices into image_data_ for all images whose
+                       // copies have completed, but which have not been
+                       // passed to the callback yet.
   VkDevice device_;  // The device that this swapchain belongs to.
   VkCommandPool
       command_pool_;  // The command_pool that we are allocating buffers from.
 
-  // If should_close_ == true then the next time we wake up we should
-  // terminate our thread.
-  std::atomic<bool> should_close_;
+  // If should_close_ == true then the copy thread should terminate once
+  // all of the pending images have been copied.
+  bool should_close_;
+  // If copies_done_ == true then the callback thread should terminate once
+  // all of the copied images have been passed to the callback.
+  bool copies_done_;
 
 // Some versions of the STL do not handle std::thread correctly,
 // use pthread/win thread instead.
 #ifdef _WIN32
-  HANDLE thread_;
+  typedef HANDLE thread;
 #else
-  pthread_t thread_;
+  typedef pthread_t thread;
 #endif
+  // Starts a thread that calls (this->*func)().
+  thread StartThread(void (VirtualSwapchain::*func)());
+  // Waits for the thread t to terminate.
+  static void JoinThread(thread t);
+
+  thread copy_thread_;
+  thread callback_thread_;
 
   // Leave the mutexes above their associated condition_variables.
   // On windows if you delete the mutex first, bad things happen somtimes.
   threading::mutex
-      pending_images_lock_;  // The lock for modifying our pending images list.
+      pending_images_lock_;  // The lock for modifying our pending images list
+                             // and should_close_.
 
   threading::condition_variable
       pending_images_condition_;  // Condition variable
@@ -188,6 +209,13 @@ class VirtualSwapchain {
                                   // pending_images_ to
                                   // contain an image.
 
+  threading::mutex copied_images_lock_;  // The lock for modifying our copied
+                                         // images list and copies_done_.
+
+  threading::condition_variable
+      copied_images_condition_;  // Condition variable to wait for
+                                 // copied_images_ to contain an image.
+
   threading::mutex
       free_images_lock_;  // The lock for modifying our free images list.
 
@@ -203,8 +231,8 @@ class VirtualSwapchain {
   const DeviceData *functions_;  // All of the resolved function pointers that
                                  // we need to call.
 
-  // This is how many milliseconds we should wait for an image before waking up
-  // and seeing if we should shut down.
+  // This is how many milliseconds we should wait for the copies in flight
+  // before waking up and seeing if more images have been submitted.
   const uint32_t pending_image_timeout_in_milliseconds_;
   // A flag to indicate whether GetImage() always waits for the acquired image
   // specified with the value pointed by the index pointer.  When set to true,
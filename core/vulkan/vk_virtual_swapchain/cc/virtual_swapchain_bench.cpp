@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// virtual-swapchain-bench reports the frames per second sustained by a
+// VirtualSwapchain on a mock device whose copies are slower than rendering.
+
+#include "mock_device.h"
+
+#include <stdio.h>
+
+#include <chrono>
+
+using swapchain::test::MockPresenter;
+
+namespace {
+
+const uint32_t kFrames = 120;
+
+}  // anonymous namespace
+
+int main(int argc, char **argv) {
+  // Render a frame in 1ms, copy it in 8ms, map memory in 1ms and handle the
+  // frame in the callback in 4ms.
+  MockPresenter presenter;
+  presenter.mock.map_latency = std::chrono::microseconds(1000);
+  MockPresenter::Frames frames;
+  presenter.Run(kFrames, std::chrono::microseconds(1000),
+                std::chrono::microseconds(8000),
+                std::chrono::microseconds(4000), &frames);
+  printf("Sustained frames per second: %.1f\n", frames.fps);
+  return 0;
+}
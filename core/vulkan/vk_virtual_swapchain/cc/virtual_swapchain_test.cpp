@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mock_device.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+namespace swapchain {
+namespace test {
+namespace {
+
+class VirtualSwapchainTest : public ::testing::Test {
+ protected:
+  // Presents count frames with the given rendering, copy and callback times,
+  // and checks that the callback saw all of them in order.
+  void Run(uint32_t count, std::chrono::microseconds render,
+           std::chrono::microseconds copy,
+           std::chrono::microseconds callback) {
+    MockPresenter::Frames frames;
+    presenter_.Run(count, render, copy, callback, &frames);
+
+    EXPECT_EQ(0, frames.missing_images);
+    EXPECT_EQ(0, frames.reused_images) << "Images reused too soon";
+    EXPECT_EQ(MockPresenter::kWidth * MockPresenter::kHeight * 4,
+              frames.length);
+    EXPECT_EQ(count, frames.frames.size());
+    for (uint32_t frame = 0; frame < frames.frames.size(); ++frame) {
+      EXPECT_EQ(frame, frames.frames[frame]);
+    }
+  }
+
+  MockPresenter presenter_;
+};
+
+TEST_F(VirtualSwapchainTest, DeliversFramesInOrder) {
+  Run(50, std::chrono::microseconds(0), std::chrono::microseconds(500),
+      std::chrono::microseconds(0));
+}
+
+TEST_F(VirtualSwapchainTest, MapsBuffersOnce) {
+  Run(20, std::chrono::microseconds(0), std::chrono::microseconds(100),
+      std::chrono::microseconds(0));
+  EXPECT_EQ(presenter_.create_info.minImageCount, presenter_.mock.maps);
+}
+
+TEST_F(VirtualSwapchainTest, DestroyWithoutFrames) {
+  VirtualSwapchain *swapchain = presenter_.Create();
+  swapchain->Destroy(nullptr);
+  delete swapchain;
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace swapchain
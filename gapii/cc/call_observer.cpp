@@ -19,6 +19,7 @@
 
 #include "core/cc/thread.h"
 #include "core/cc/timer.h"
+#include "core/cc/trace.h"
 
 #include "gapis/api/gfxtrace.pb.h"
 #include "gapis/memory/memory_pb/memory.pb.h"
@@ -42,16 +43,18 @@ const size_t MEMORY_MERGE_THRESHOLD = 256;
 namespace gapii {
 // Creates a CallObserver with a given spy and applies the memory space for
 // observation data from the spy instance.
-CallObserver::CallObserver(SpyBase* spy, CallObserver* parent, uint8_t api)
+CallObserver::CallObserver(SpyBase* spy, CallObserver* parent, uint8_t api,
+                           const char* cmd_name)
     : mSpy(spy),
       mParent(parent),
       mSeenReferences{{nullptr, 0}},
-      mCurrentCommandName(nullptr),
+      mCurrentCommandName(cmd_name),
       mObserveApplicationPool(spy->shouldObserveApplicationPool()),
       mError(0 /*GL_NO_ERROR*/),
       mApi(api),
       mShouldTrace(false),
-      mCurrentThread(core::Thread::current().id()) {
+      mCurrentThread(core::Thread::current().id()),
+      mTraceScope(cmd_name) {
   // context_t initialization.
   this->context_t::id = 0;
   this->context_t::next_pool_id = &spy->next_pool_id();
@@ -95,6 +98,7 @@ void CallObserver::observePending() {
   if (!mShouldTrace) {
     return;
   }
+  GAPID_TRACE_NAME("CallObserver::observePending");
   for (auto p : mPendingObservations) {
     uint8_t* data = reinterpret_cast<uint8_t*>(p.start());
     uint64_t size = p.end() - p.start();
@@ -155,6 +159,9 @@ gapil::String CallObserver::string(const char* str) {
   for (uint64_t i = 0;; i++) {
     if (str[i] == 0) {
       read(str, i + 1);
+      if (auto strings = mSpy->strings()) {
+        return strings->intern(str, i);
+      }
       return gapil::String(mSpy->arena(), str, str + i);
     }
   }
@@ -162,6 +169,9 @@ gapil::String CallObserver::string(const char* str) {
 
 gapil::String CallObserver::string(const gapil::Slice<char>& slice) {
   read(slice);
+  if (auto strings = mSpy->strings()) {
+    return strings->intern(slice.begin(), slice.end());
+  }
   return gapil::String(mSpy->arena(), slice.begin(), slice.end());
 }
 
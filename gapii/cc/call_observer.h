@@ -25,6 +25,7 @@
 #include "gapil/runtime/cc/string.h"
 
 #include "core/cc/interval_list.h"
+#include "core/cc/tracer.h"
 #include "core/cc/vector.h"
 #include "core/memory/arena/cc/arena.h"
 
@@ -49,7 +50,11 @@ class CallObserver : public context_t {
 
   typedef std::function<void(slice_t*)> OnSliceEncodedCallback;
 
-  CallObserver(SpyBase* spy_p, CallObserver* parent, uint8_t api);
+  // cmd_name is the name of the command being observed, as for
+  // setCurrentCommandName. The lifetime of the observer is recorded as a
+  // trace event of that name while core::Tracer is enabled.
+  CallObserver(SpyBase* spy_p, CallObserver* parent, uint8_t api,
+               const char* cmd_name);
 
   ~CallObserver();
 
@@ -228,6 +233,9 @@ class CallObserver : public context_t {
 
   // Callback invoked whenever slice_encoded() is called.
   OnSliceEncodedCallback mOnSliceEncoded;
+
+  // Records the call in the trace while the observer exists.
+  core::Tracer::Scope mTraceScope;
 };
 
 template <typename T>
@@ -17,15 +17,29 @@
 #include "chunk_writer.h"
 
 #include "core/cc/stream_writer.h"
+#include "core/cc/trace.h"
 
 #include <google/protobuf/io/coded_stream.h>
 
+#include <string>
+#include <vector>
+
 using ::google::protobuf::io::CodedOutputStream;
 
 namespace {
 
 constexpr size_t kBufferSize = 32 * 1024;
 
+// Chunks of at least this many bytes are written out from the strings they
+// are written in, rather than copied into a buffer first.
+constexpr size_t kGatherSize = 4 * 1024;
+
+// The most strings written out with a single writev.
+constexpr size_t kMaxStrings = 64;
+
+// The most emptied strings kept around for buffering small chunks into.
+constexpr size_t kMaxSpares = 4;
+
 class ChunkWriterImpl : public gapii::ChunkWriter {
  public:
   ChunkWriterImpl(const std::shared_ptr<core::StreamWriter>& writer,
@@ -37,7 +51,21 @@ class ChunkWriterImpl : public gapii::ChunkWriter {
   virtual void flush() override;
 
  private:
-  std::string mBuffer;
+  // The strings to write out, in order. Large chunks are swapped in, and
+  // small chunks are appended to the last string while mAppending is true.
+  std::vector<std::string> mStrings;
+
+  // True if small chunks can be appended to the last of mStrings.
+  bool mAppending;
+
+  // The total size of mStrings.
+  size_t mSize;
+
+  // Emptied strings, kept for their capacity.
+  std::vector<std::string> mSpares;
+
+  // Scratch space for the buffers passed to writev.
+  std::vector<core::StreamWriter::Buffer> mBuffers;
 
   std::shared_ptr<core::StreamWriter> mWriter;
 
@@ -48,19 +76,39 @@ class ChunkWriterImpl : public gapii::ChunkWriter {
 
 ChunkWriterImpl::ChunkWriterImpl(
     const std::shared_ptr<core::StreamWriter>& writer, bool no_buffer)
-    : mWriter(writer), mStreamGood(true), mNoBuffer(no_buffer) {}
+    : mAppending(false),
+      mSize(0),
+      mWriter(writer),
+      mStreamGood(true),
+      mNoBuffer(no_buffer) {}
 
 ChunkWriterImpl::~ChunkWriterImpl() {
-  if (mBuffer.size() && mStreamGood) {
+  if (mSize && mStreamGood) {
     flush();
   }
 }
 
 bool ChunkWriterImpl::write(std::string& s) {
   if (mStreamGood) {
-    mBuffer.append(s);
+    mSize += s.size();
+    if (s.size() >= kGatherSize) {
+      // Take the string rather than copying it. This leaves s empty.
+      mStrings.emplace_back();
+      mStrings.back().swap(s);
+      mAppending = false;
+    } else {
+      if (!mAppending) {
+        mStrings.emplace_back();
+        if (!mSpares.empty()) {
+          mStrings.back().swap(mSpares.back());
+          mSpares.pop_back();
+        }
+        mAppending = true;
+      }
+      mStrings.back().append(s);
+    }
 
-    if (mNoBuffer || (mBuffer.size() >= kBufferSize)) {
+    if (mNoBuffer || mSize >= kBufferSize || mStrings.size() >= kMaxStrings) {
       flush();
     }
   }
@@ -69,9 +117,23 @@ bool ChunkWriterImpl::write(std::string& s) {
 }
 
 void ChunkWriterImpl::flush() {
-  size_t bufferSize = mBuffer.size();
-  mStreamGood = mWriter->write(mBuffer.data(), mBuffer.size()) == bufferSize;
-  mBuffer.clear();
+  GAPID_TRACE_NAME("ChunkWriter::flush");
+  GAPID_TRACE_INT("ChunkWriter::flush bytes", mSize);
+  mBuffers.clear();
+  for (const std::string& str : mStrings) {
+    mBuffers.push_back(core::StreamWriter::Buffer{str.data(), str.size()});
+  }
+  mStreamGood = mWriter->writev(mBuffers.data(), mBuffers.size()) == mSize;
+  for (std::string& str : mStrings) {
+    if (mSpares.size() < kMaxSpares && str.capacity() <= 2 * kBufferSize) {
+      str.clear();
+      mSpares.emplace_back();
+      mSpares.back().swap(str);
+    }
+  }
+  mStrings.clear();
+  mAppending = false;
+  mSize = 0;
 }
 
 }  // anonymous namespace
@@ -50,6 +50,11 @@ class ConnectionHeader {
   static const uint32_t FLAG_HIDE_UNKNOWN_EXTENSIONS = 0x00000040;
   // Requests timestamps to be stored in the capture
   static const uint32_t FLAG_STORE_TIMESTAMPS = 0x00000080;
+  // Shares the data of the strings observed with the same contents
+  static const uint32_t FLAG_INTERN_STRINGS = 0x00000100;
+  // Offers to stream the capture through shared memory, see
+  // ConnectionStream::startSharedMemory
+  static const uint32_t FLAG_SHARED_MEMORY = 0x00000200;
 
   // read reads the ConnectionHeader from the provided stream, returning true
   // on success or false on error.
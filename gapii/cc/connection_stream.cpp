@@ -17,8 +17,26 @@
 #include "connection_stream.h"
 
 #include "core/cc/log.h"
+#include "core/cc/shared_memory_connection.h"
 #include "core/cc/socket_connection.h"
 
+#include <algorithm>
+
+namespace {
+
+// The most buffers passed to a single Connection::sendv.
+const size_t kMaxBuffers = 64;
+
+// The size of the shared memory ring that carries the capture. Rings that
+// are larger than the cache are slower, see socket-bench.
+const size_t kSharedMemorySize = 256 << 10;
+
+// Reads stay on the connection, so the ring of the other direction is kept
+// to a page.
+const size_t kSharedMemoryRecvSize = 4 << 10;
+
+}  // anonymous namespace
+
 namespace gapii {
 
 std::shared_ptr<ConnectionStream> ConnectionStream::listenSocket(
@@ -39,14 +57,60 @@ std::shared_ptr<ConnectionStream> ConnectionStream::listenPipe(
 ConnectionStream::ConnectionStream(std::unique_ptr<core::Connection> connection)
     : mConnection(std::move(connection)) {}
 
+bool ConnectionStream::startSharedMemory() {
+  auto shm = core::SharedMemoryConnection::create(kSharedMemorySize,
+                                                  kSharedMemoryRecvSize);
+  if (!mConnection->sendString(shm ? shm->path() : "") || !shm) {
+    return false;
+  }
+  uint32_t accepted = 0;
+  if (mConnection->recv(&accepted, sizeof(accepted)) != sizeof(accepted) ||
+      accepted != 1) {
+    GAPID_WARNING("Shared memory declined, writing to the connection");
+    return false;
+  }
+  mSharedMemory = std::move(shm);
+  return true;
+}
+
 uint64_t ConnectionStream::read(void* data, uint64_t max_size) {
   return mConnection->recv(data, max_size);
 }
 
 uint64_t ConnectionStream::write(const void* data, uint64_t size) {
+  if (mSharedMemory) {
+    return mSharedMemory->send(data, size);
+  }
   return mConnection->send(data, size);
 }
 
-void ConnectionStream::close() { mConnection->close(); }
+uint64_t ConnectionStream::writev(const Buffer* buffers, size_t count) {
+  core::Connection* connection =
+      mSharedMemory ? mSharedMemory.get() : mConnection.get();
+  core::Connection::ConstBuffer converted[kMaxBuffers];
+  uint64_t total = 0;
+  for (size_t start = 0; start < count; start += kMaxBuffers) {
+    const size_t n = std::min(count - start, kMaxBuffers);
+    size_t size = 0;
+    for (size_t i = 0; i < n; i++) {
+      converted[i].data = buffers[start + i].data;
+      converted[i].size = static_cast<size_t>(buffers[start + i].size);
+      size += converted[i].size;
+    }
+    const size_t sent = connection->sendv(converted, n);
+    total += sent;
+    if (sent != size) {
+      break;
+    }
+  }
+  return total;
+}
+
+void ConnectionStream::close() {
+  if (mSharedMemory) {
+    mSharedMemory->close();
+  }
+  mConnection->close();
+}
 
 }  // namespace gapii
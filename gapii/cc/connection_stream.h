@@ -25,6 +25,7 @@
 namespace core {
 
 class Connection;
+class SharedMemoryConnection;
 
 }  // namespace core
 
@@ -51,14 +52,26 @@ class ConnectionStream : public core::StreamWriter, public core::StreamReader {
 
   // core::StreamWriter compliance
   virtual uint64_t write(const void* data, uint64_t size) override;
+  virtual uint64_t writev(const Buffer* buffers, size_t count) override;
 
   // Closes the connection stream
   virtual void close();
 
+  // startSharedMemory offers to send the rest of the written data through
+  // shared memory instead of the connection, which only works if the other
+  // end is on the same machine. It sends the path of the shared memory as a
+  // null-terminated string, or an empty string if it could not be created.
+  // The other end then replies with a uint32 that is 1 if it opened the
+  // shared memory, or 0 if the writes should stay on the connection. Reads
+  // always come from the connection. Returns true if the shared memory is
+  // used.
+  bool startSharedMemory();
+
  private:
   ConnectionStream(std::unique_ptr<core::Connection>);
 
   std::unique_ptr<core::Connection> mConnection;
+  std::unique_ptr<core::SharedMemoryConnection> mSharedMemory;
 };
 
 }  // namespace gapii
@@ -154,6 +154,11 @@ Spy::Spy()
 
   GAPID_INFO("Connection header read");
 
+  if ((header.mFlags & ConnectionHeader::FLAG_SHARED_MEMORY) != 0 &&
+      mConnection->startSharedMemory()) {
+    GAPID_INFO("Writing the capture to shared memory");
+  }
+
   mObserveFrameFrequency = header.mObserveFrameFrequency;
   mObserveDrawFrequency = header.mObserveDrawFrequency;
   mDisablePrecompiledShaders =
@@ -164,6 +169,8 @@ Spy::Spy()
       (header.mFlags & ConnectionHeader::FLAG_HIDE_UNKNOWN_EXTENSIONS) != 0;
   set_record_timestamps(
       0 != (header.mFlags & ConnectionHeader::FLAG_STORE_TIMESTAMPS));
+  set_intern_strings(
+      0 != (header.mFlags & ConnectionHeader::FLAG_INTERN_STRINGS));
 
   // This will be over-written if we also set the header flags
   mSuspendCaptureFrames = header.mStartFrame;
@@ -231,9 +238,8 @@ Spy::Spy()
 void Spy::resolveImports() { GlesSpy::mImports.resolve(); }
 
 CallObserver* Spy::enter(const char* name, uint32_t api) {
-  auto ctx = new CallObserver(this, gContext, api);
+  auto ctx = new CallObserver(this, gContext, api, name);
   lock(ctx);
-  ctx->setCurrentCommandName(name);
   gContext = ctx;
   return ctx;
 }
@@ -16,6 +16,7 @@
 
 #include "spy_base.h"
 
+#include "core/cc/hasher.h"
 #include "core/cc/log.h"
 #include "core/cc/timer.h"
 
@@ -62,7 +63,7 @@ void SpyBase::abort() {
 
 int64_t SpyBase::sendResource(uint8_t api, const void* data, size_t size) {
   GAPID_ASSERT(should_trace(api));
-  auto hash = core::Id::Hash(data, size);
+  auto hash = core::Hasher::Hash(data, size);
 
   // Fast-path if resource with the same hash was already send.
   {
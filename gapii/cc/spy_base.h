@@ -36,6 +36,7 @@
 #include "core/memory_tracker/cc/memory_tracker.h"
 
 #include "gapil/runtime/cc/slice.h"
+#include "gapil/runtime/cc/string.h"
 
 #include <stdint.h>
 
@@ -76,6 +77,10 @@ class SpyBase {
   // returns the spy's memory arena.
   inline core::Arena* arena() { return &mArena; }
 
+  // returns the table interning the strings observed by the spy, or nullptr
+  // if observed strings are not interned.
+  inline gapil::StringTable* strings() { return mStrings.get(); }
+
   // returns a handle to the identifier of the next pool to be allocated.
   inline uint32_t& next_pool_id() { return mNextPoolId; }
 
@@ -112,6 +117,10 @@ class SpyBase {
   void set_record_timestamps(bool record) { mRecordTimestamps = record; }
   bool should_record_timestamps() const { return mRecordTimestamps; }
 
+  void set_intern_strings(bool intern) {
+    mStrings.reset(intern ? new gapil::StringTable(&mArena) : nullptr);
+  }
+
  protected:
   // lock begins the interception of a single command. It must be called
   // before invoking any command on the spy. Blocks if any other thread
@@ -198,6 +207,9 @@ class SpyBase {
   // Memory arena.
   core::Arena mArena;
 
+  // Intern table of the observed strings, allocated from mArena.
+  std::unique_ptr<gapil::StringTable> mStrings;
+
   // The identifier of the next pool to be allocated.
   uint32_t mNextPoolId;
 
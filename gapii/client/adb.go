@@ -54,6 +54,10 @@ type Process struct {
 
 	// The connection
 	conn net.Conn
+
+	// The shared memory that the capture is read from, if GAPII accepted
+	// the SharedMemory flag.
+	shm *sharedMemory
 }
 
 // Start launches an activity on an android device with the GAPII interceptor
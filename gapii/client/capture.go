@@ -21,6 +21,7 @@ import (
 	"io"
 	"math"
 	"net"
+	"strings"
 	"sync/atomic"
 	"time"
 
@@ -54,6 +55,12 @@ const (
 	HideUnknownExtensions Flags = 0x00000040
 	// StoreTimestamps requests that the capture contain timestamps
 	StoreTimestamps Flags = 0x00000080
+	// InternStrings shares the memory of the observed strings with the same
+	// contents
+	InternStrings Flags = 0x00000100
+	// SharedMemory offers to read the capture from shared memory instead of
+	// the socket, which only works when GAPII runs on the same Linux machine.
+	SharedMemory Flags = 0x00000200
 
 	// GlesAPI is hard-coded bit mask for GLES API, it needs to be kept in sync
 	// with the api_index in the gles.api file.
@@ -139,11 +146,53 @@ func (p *Process) connect(ctx context.Context, gvrHandle uint64, interceptorPath
 			conn.Close()
 			return true, log.Err(ctx, err, "Failed to send header")
 		}
+		if (p.Options.Flags & SharedMemory) != 0 {
+			if err := p.acceptSharedMemory(ctx, r, conn); err != nil {
+				conn.Close()
+				return true, log.Err(ctx, err, "Failed to set up shared memory")
+			}
+		}
 		p.conn = conn
 		return true, nil
 	})
 }
 
+// acceptSharedMemory reads the path of the shared memory that GAPII sends
+// after the header when the SharedMemory flag is set, and replies with
+// whether the capture will be read from it. GAPII sends an empty path if it
+// could not create the shared memory.
+func (p *Process) acceptSharedMemory(ctx context.Context, r *bufio.Reader, conn net.Conn) error {
+	conn.SetReadDeadline(time.Now().Add(time.Second * 3))
+	path, err := r.ReadString(0)
+	if err != nil {
+		return err
+	}
+	path = strings.TrimSuffix(path, "\x00")
+	if path == "" {
+		log.I(ctx, "GAPII did not create shared memory, reading the capture from the socket")
+		return nil
+	}
+	shm, err := openSharedMemory(path)
+	accepted := uint32(1)
+	if err != nil {
+		log.W(ctx, "Failed to open shared memory, reading the capture from the socket: %v", err)
+		accepted = 0
+	}
+	w := endian.Writer(conn, device.LittleEndian)
+	w.Uint32(accepted)
+	if err := w.Error(); err != nil {
+		if shm != nil {
+			shm.close()
+		}
+		return err
+	}
+	if shm != nil {
+		log.I(ctx, "Reading the capture from shared memory")
+		p.shm = shm
+	}
+	return nil
+}
+
 // Capture opens up the specified port and then waits for a capture to be
 // delivered using the specified capture options o.
 // It copies the capture into the supplied writer.
@@ -178,6 +227,9 @@ func (p *Process) Capture(ctx context.Context, start task.Signal, stop task.Sign
 
 	conn := p.conn
 	defer conn.Close()
+	if p.shm != nil {
+		defer p.shm.close()
+	}
 
 	var count siSize
 	started := false
@@ -194,8 +246,15 @@ func (p *Process) Capture(ctx context.Context, start task.Signal, stop task.Sign
 			}
 		}
 		now := time.Now()
-		conn.SetReadDeadline(now.Add(time.Millisecond * 500)) // Allow for stop event and UI refreshes.
-		n, err := io.CopyN(w, conn, 1024*64)
+		var n int64
+		var err error
+		if p.shm != nil {
+			// Messages to GAPII still go through the socket.
+			n, err = p.shm.copyTo(w, 1024*64, time.Millisecond*500)
+		} else {
+			conn.SetReadDeadline(now.Add(time.Millisecond * 500)) // Allow for stop event and UI refreshes.
+			n, err = io.CopyN(w, conn, 1024*64)
+		}
 		count += siSize(n)
 		atomic.StoreInt64(written, int64(count))
 		switch {
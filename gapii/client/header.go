@@ -44,6 +44,12 @@ const version = 1
 // All fields are encoded little-endian with no compression, regardless of
 // architecture. All changes must be kept in sync with:
 //   platform/tools/gpu/gapii/cc/connection_header.h
+//
+// If the SharedMemory flag is set, GAPII replies to the header with the
+// null-terminated path of the shared memory that it will write the capture
+// to, or an empty string if it could not create it. For a path, it then
+// waits for a uint32 that is 1 if the shared memory was opened, or 0 if the
+// capture should be written to the socket.
 
 func sendHeader(out io.Writer, options Options, gvrHandle uint64, libInterceptorPath string) error {
 	const maxPath = 512
@@ -0,0 +1,243 @@
+// Copyright (C) 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// +build linux
+
+package client
+
+import (
+	"bytes"
+	"encoding/binary"
+	"fmt"
+	"io"
+	"io/ioutil"
+	"os"
+	"sync/atomic"
+	"syscall"
+	"time"
+	"unsafe"
+)
+
+// The layout of the shared memory, which must be kept in sync with:
+//   core/cc/shared_memory_connection.cpp
+//
+// The memory starts with a page holding the header and the control blocks of
+// the two rings. Ring 0 carries the capture written by GAPII, and ring 1 the
+// data sent back to it, which is unused.
+const (
+	shmMagic       = 0x6d687367 // 'g', 's', 'h', 'm'
+	shmVersion     = 1
+	shmControlSize = 4096
+
+	// Offsets of the header fields.
+	shmMagicOffset       = 0
+	shmVersionOffset     = 4
+	shmPidsOffset        = 8
+	shmRingSizesOffset   = 16
+	shmRingOffsetsOffset = 32
+
+	// Offsets of the ring control blocks.
+	shmCaptureRing = 256
+	shmReplyRing   = 512
+
+	// Offsets of the fields in a ring control block.
+	shmHead            = 0
+	shmTail            = 64
+	shmDataSeq         = 128
+	shmConsumerWaiting = 132
+	shmClosed          = 136
+	shmSpaceSeq        = 192
+	shmProducerWaiting = 196
+)
+
+const (
+	futexWait = 0
+	futexWake = 1
+)
+
+// shmWaitTimeout is the longest time spent blocked before checking that GAPII
+// is still running.
+const shmWaitTimeout = 100 * time.Millisecond
+
+// sharedMemory is the reading end of the ring that GAPII writes the capture
+// to when the SharedMemory flag is set.
+type sharedMemory struct {
+	data   []byte
+	ring   []byte
+	pid    int
+	exited bool
+}
+
+// openSharedMemory maps the shared memory file at path, which was created by
+// GAPII.
+func openSharedMemory(path string) (*sharedMemory, error) {
+	f, err := os.OpenFile(path, os.O_RDWR, 0)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+	info, err := f.Stat()
+	if err != nil {
+		return nil, err
+	}
+	size := info.Size()
+	if size < shmControlSize || size > int64(^uint(0)>>1) {
+		return nil, fmt.Errorf("Shared memory %v has an invalid size: %v", path, size)
+	}
+	data, err := syscall.Mmap(int(f.Fd()), 0, int(size), syscall.PROT_READ|syscall.PROT_WRITE, syscall.MAP_SHARED)
+	if err != nil {
+		return nil, err
+	}
+	s := &sharedMemory{data: data}
+	ringSize := binary.LittleEndian.Uint64(data[shmRingSizesOffset:])
+	ringOffset := binary.LittleEndian.Uint64(data[shmRingOffsetsOffset:])
+	switch {
+	case atomic.LoadUint32(s.word32(shmMagicOffset)) != shmMagic,
+		binary.LittleEndian.Uint32(data[shmVersionOffset:]) != shmVersion,
+		ringSize == 0 || ringSize&(ringSize-1) != 0,
+		ringOffset < shmControlSize || ringOffset > uint64(size),
+		ringSize > uint64(size)-ringOffset:
+		syscall.Munmap(data)
+		return nil, fmt.Errorf("Shared memory %v is not a GAPII connection", path)
+	}
+	s.ring = data[ringOffset : ringOffset+ringSize]
+	s.pid = int(atomic.LoadUint32(s.word32(shmPidsOffset)))
+	// Let GAPII know which process to check on while it waits for space.
+	atomic.StoreUint32(s.word32(shmPidsOffset+4), uint32(os.Getpid()))
+	return s, nil
+}
+
+func (s *sharedMemory) word32(offset int) *uint32 {
+	return (*uint32)(unsafe.Pointer(&s.data[offset]))
+}
+
+func (s *sharedMemory) word64(offset int) *uint64 {
+	return (*uint64)(unsafe.Pointer(&s.data[offset]))
+}
+
+// copyTo writes up to max bytes of the capture to w, straight out of the
+// ring. It waits up to timeout for the first byte to arrive, and returns a
+// timeout error if none does. It returns io.EOF once GAPII has closed the
+// ring, or exited, and all of the capture has been read.
+func (s *sharedMemory) copyTo(w io.Writer, max int64, timeout time.Duration) (int64, error) {
+	head := s.word64(shmCaptureRing + shmHead)
+	tail := s.word64(shmCaptureRing + shmTail)
+	dataSeq := s.word32(shmCaptureRing + shmDataSeq)
+	waiting := s.word32(shmCaptureRing + shmConsumerWaiting)
+	mask := uint64(len(s.ring) - 1)
+	deadline := time.Now().Add(timeout)
+	written := int64(0)
+	for written < max {
+		t := atomic.LoadUint64(tail)
+		h := atomic.LoadUint64(head)
+		if h != t {
+			offset := t & mask
+			n := h - t
+			if n > uint64(len(s.ring))-offset {
+				n = uint64(len(s.ring)) - offset
+			}
+			if n > uint64(max-written) {
+				n = uint64(max - written)
+			}
+			c, err := w.Write(s.ring[offset : offset+n])
+			written += int64(c)
+			atomic.StoreUint64(tail, t+uint64(c))
+			s.wake(shmCaptureRing+shmSpaceSeq, shmCaptureRing+shmProducerWaiting)
+			if err != nil {
+				return written, err
+			}
+			continue
+		}
+		if written > 0 {
+			return written, nil
+		}
+		if s.closed() {
+			if atomic.LoadUint64(head) == t {
+				return 0, io.EOF
+			}
+			continue
+		}
+		remaining := time.Until(deadline)
+		if remaining <= 0 {
+			return 0, shmTimeout{}
+		}
+		if remaining > shmWaitTimeout {
+			remaining = shmWaitTimeout
+		}
+		seq := atomic.LoadUint32(dataSeq)
+		atomic.StoreUint32(waiting, 1)
+		if atomic.LoadUint64(head) == t && !s.closed() {
+			ts := syscall.NsecToTimespec(int64(remaining))
+			_, _, errno := syscall.Syscall6(syscall.SYS_FUTEX, uintptr(unsafe.Pointer(dataSeq)),
+				futexWait, uintptr(seq), uintptr(unsafe.Pointer(&ts)), 0, 0)
+			if errno == syscall.ETIMEDOUT && processExited(s.pid) {
+				s.exited = true
+			}
+		}
+		atomic.StoreUint32(waiting, 0)
+	}
+	return written, nil
+}
+
+// processExited returns true if the process with the given id has exited.
+// A process that has exited stays a zombie until its parent waits for it, so
+// this checks the state of the process rather than whether it exists.
+func processExited(pid int) bool {
+	stat, err := ioutil.ReadFile(fmt.Sprintf("/proc/%d/stat", pid))
+	if err != nil {
+		return os.IsNotExist(err)
+	}
+	// The state follows the command name, which is in parentheses.
+	i := bytes.LastIndexByte(stat, ')')
+	return i >= 0 && i+2 < len(stat) && stat[i+2] == 'Z'
+}
+
+// closed returns true if GAPII has closed the connection or exited.
+func (s *sharedMemory) closed() bool {
+	return s.exited || atomic.LoadUint32(s.word32(shmCaptureRing+shmClosed)) != 0
+}
+
+// wake wakes up the waiters on the futex at seq if the waiting flag at
+// waiting is set.
+func (s *sharedMemory) wake(seq, waiting int) {
+	if atomic.LoadUint32(s.word32(waiting)) != 0 {
+		atomic.AddUint32(s.word32(seq), 1)
+		syscall.Syscall6(syscall.SYS_FUTEX, uintptr(unsafe.Pointer(s.word32(seq))),
+			futexWake, uintptr(^uint32(0)>>1), 0, 0, 0)
+	}
+}
+
+// close marks both rings as closed, wakes up GAPII if it is waiting on
+// either, and unmaps the shared memory.
+func (s *sharedMemory) close() {
+	for _, ring := range []int{shmCaptureRing, shmReplyRing} {
+		atomic.StoreUint32(s.word32(ring+shmClosed), 1)
+		atomic.AddUint32(s.word32(ring+shmDataSeq), 1)
+		atomic.AddUint32(s.word32(ring+shmSpaceSeq), 1)
+		for _, seq := range []int{shmDataSeq, shmSpaceSeq} {
+			syscall.Syscall6(syscall.SYS_FUTEX, uintptr(unsafe.Pointer(s.word32(ring+seq))),
+				futexWake, uintptr(^uint32(0)>>1), 0, 0, 0)
+		}
+	}
+	syscall.Munmap(s.data)
+	s.data, s.ring = nil, nil
+}
+
+// shmTimeout is returned by copyTo when no data arrives in time. It is a
+// net.Error, so that it is handled like a socket read timeout.
+type shmTimeout struct{}
+
+func (shmTimeout) Error() string   { return "Timed out reading the capture from shared memory" }
+func (shmTimeout) Timeout() bool   { return true }
+func (shmTimeout) Temporary() bool { return true }
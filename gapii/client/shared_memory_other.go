@@ -0,0 +1,37 @@
+// Copyright (C) 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// +build !linux
+
+package client
+
+import (
+	"fmt"
+	"io"
+	"time"
+)
+
+// sharedMemory is the reading end of the ring that GAPII writes the capture
+// to, which is only supported on Linux.
+type sharedMemory struct{}
+
+func openSharedMemory(path string) (*sharedMemory, error) {
+	return nil, fmt.Errorf("Shared memory is not supported on this platform")
+}
+
+func (s *sharedMemory) copyTo(w io.Writer, max int64, timeout time.Duration) (int64, error) {
+	return 0, io.EOF
+}
+
+func (s *sharedMemory) close() {}
@@ -41,6 +41,7 @@ const (
 	mapGrowMultiplier = (uint64)(C.GAPIL_MAP_GROW_MULTIPLIER)
 	minMapSize        = (uint64)(C.GAPIL_MIN_MAP_SIZE)
 	mapMaxCapacity    = (float32)(C.GAPIL_MAP_MAX_CAPACITY)
+	mapMaxTombstones  = (uint64)(C.GAPIL_MAP_MAX_TOMBSTONES)
 )
 
 func init() {
@@ -58,7 +58,9 @@ type mapImpl struct {
 
 // Removal is as simple as
 // 1) Find element
-// 2) set used == previously_full
+// 2) If the next element is empty, set used == empty, along with all the
+//    previously_full elements directly before it. No lookup probes past them.
+// 3) Otherwise set used == previously_full
 
 // Once the map hits > 80% capacity, we should rehash the map larger.
 //  Otherwise collisions will turn this into a linear search.
@@ -69,8 +71,10 @@ type mapImpl struct {
 //   3) find first bucket >= h, where used != full (mod capacity)
 //   4) Insert there, mark used = full
 
-// TODO: Investigate rehashing once #full + #previously_full > 80%
-//     If we end up with lots of insertions/deletions, this will prevent linear search
+// If the search for the key probed through more than GAPIL_MAP_MAX_TOMBSTONES
+// previously_full elements, the insertion rehashes the map at the same
+// capacity to drop them, so that lots of insertions/deletions don't turn
+// lookups into a linear search.
 
 func (c *C) defineMapTypes() {
 	// impls is a map of type mangled name to the public MapInfo structure.
@@ -171,6 +175,18 @@ func (c *C) hash64Bit(s *S, value *codegen.Value) *codegen.Value {
 	return v
 }
 
+// mixInteger returns integer keys that fit in 32 bits as they are, so that
+// dense keys fill consecutive buckets, and mixes the bits of larger keys so
+// that keys sharing their low bits, such as aligned handles, do not pile up in
+// the same buckets.
+// This must match mix_integer() in gapil/runtime/cc/hash.h.
+func (c *C) mixInteger(s *S, value *codegen.Value) *codegen.Value {
+	v := s.MulS(value, uint64(0x9e3779b97f4a7c15)).SetName("_mix1")
+	v = s.Xor(v, s.ShiftRight(v, s.Scalar(uint64(32)))).SetName("_mix2")
+	small := s.LessOrEqualTo(value, s.Scalar(uint64(0xffffffff)))
+	return s.Select(small, value, v).SetName("_mix3")
+}
+
 func (c *C) hashVariableValue(s *S, pointer *codegen.Value, numBytes *codegen.Value) *codegen.Value {
 	u64Type := c.T.Target(semantic.Uint64Type)
 	numBytes = numBytes.Load().Cast(u64Type)
@@ -214,7 +230,7 @@ func (c *C) hashValue(s *S, t semantic.Type, value *codegen.Value) *codegen.Valu
 			semantic.Uint32Type,
 			semantic.Int64Type,
 			semantic.Uint64Type:
-			return value.Cast(u64Type)
+			return c.mixInteger(s, value.Cast(u64Type))
 		case semantic.Float32Type:
 			return c.hash64Bit(s, value.Bitcast(u32Type).Cast(u64Type))
 		case semantic.Float64Type:
@@ -226,7 +242,7 @@ func (c *C) hashValue(s *S, t semantic.Type, value *codegen.Value) *codegen.Valu
 			return nil
 		}
 	case *semantic.Enum:
-		return value.Cast(u64Type)
+		return c.mixInteger(s, value.Cast(u64Type))
 	case *semantic.Pointer:
 		return s.ShiftRight(value.Cast(u64Type), s.Scalar(uint64(2)))
 	case *semantic.StaticArray:
@@ -305,6 +321,7 @@ func (c *C) buildMap(keyTy, valTy semantic.Type, mi *MapInfo) {
 		elements := elementsPtr.Load()
 
 		h := c.hashValue(s, keyTy, k)
+		tombstones := s.LocalInit("tombstones", s.Scalar(uint64(0)))
 		// Search for existing
 		s.ForN(capacity, func(s *S, it *codegen.Value) *codegen.Value {
 			check := s.And(s.Add(h, it), s.Sub(capacity, s.Scalar(uint64(1))))
@@ -315,6 +332,9 @@ func (c *C) buildMap(keyTy, valTy semantic.Type, mi *MapInfo) {
 					s.Return(elements.Index(check, "v"))
 				})
 			})
+			s.If(c.equal(s, valid, s.Scalar(mapElementUsed)), func(s *S) {
+				tombstones.Store(s.AddS(tombstones.Load(), uint64(1)))
+			})
 
 			return s.Not(c.equal(s, valid, s.Scalar(mapElementEmpty)))
 		})
@@ -325,6 +345,15 @@ func (c *C) buildMap(keyTy, valTy semantic.Type, mi *MapInfo) {
 				used := s.Div(count.Cast(f32Type), capacity.Cast(f32Type))
 				resize.Store(s.GreaterThan(used, s.Scalar(float32(mapMaxCapacity))))
 			})
+			// Removals have left too many tombstones in the way of lookups.
+			// Rehash at the same capacity to get rid of them. The smallest
+			// buffer is never rehashed, as in rehash() in map.inc.
+			clean := s.LocalInit("clean", s.Scalar(false))
+			s.If(s.Not(resize.Load()), func(s *S) {
+				s.If(s.GreaterThan(tombstones.Load(), s.Scalar(uint64(mapMaxTombstones))), func(s *S) {
+					clean.Store(s.NotEqual(capacity, s.Scalar(uint64(minMapSize))))
+				})
+			})
 
 			getStorageBucket := func(h, table, tablesize *codegen.Value) *codegen.Value {
 				newBucket := s.Local("newBucket", u64Type)
@@ -338,6 +367,33 @@ func (c *C) buildMap(keyTy, valTy semantic.Type, mi *MapInfo) {
 				return newBucket.Load()
 			}
 
+			// rehash moves all the elements to a new elements buffer of
+			// newCapacity, dropping the tombstones of removed elements.
+			rehash := func(s *S, newCapacity *codegen.Value) {
+				capacityPtr.Store(newCapacity)
+				newElements := c.Alloc(s, newCapacity, elTy)
+				s.ForN(newCapacity, func(s *S, it *codegen.Value) *codegen.Value {
+					newElements.Index(it, "used").Store(s.Scalar(mapElementEmpty))
+					return nil
+				})
+
+				s.ForN(capacity, func(s *S, it *codegen.Value) *codegen.Value {
+					valid := elements.Index(it, "used").Load()
+					s.If(c.equal(s, valid, s.Scalar(mapElementFull)), func(s *S) {
+						k := elements.Index(it, "k").Load()
+						v := elements.Index(it, "v").Load()
+						h := c.hashValue(s, keyTy, k)
+						bucket := getStorageBucket(h, newElements, newCapacity)
+						newElements.Index(bucket, "k").Store(k)
+						newElements.Index(bucket, "v").Store(v)
+						newElements.Index(bucket, "used").Store(s.Scalar(mapElementFull))
+					})
+					return nil
+				})
+				c.Free(s, elements)
+				elementsPtr.Store(newElements)
+			}
+
 			s.If(resize.Load(), func(s *S) {
 				// Grow
 				s.IfElse(elements.IsNull(), func(s *S) {
@@ -350,31 +406,12 @@ func (c *C) buildMap(keyTy, valTy semantic.Type, mi *MapInfo) {
 						return nil
 					})
 				}, /* else */ func(s *S) {
-					newCapacity := s.MulS(capacity, uint64(mapGrowMultiplier))
-					capacityPtr.Store(newCapacity)
-					newElements := c.Alloc(s, newCapacity, elTy)
-					s.ForN(newCapacity, func(s *S, it *codegen.Value) *codegen.Value {
-						newElements.Index(it, "used").Store(s.Scalar(mapElementEmpty))
-						return nil
-					})
-
-					s.ForN(capacity, func(s *S, it *codegen.Value) *codegen.Value {
-						valid := elements.Index(it, "used").Load()
-						s.If(c.equal(s, valid, s.Scalar(mapElementFull)), func(s *S) {
-							k := elements.Index(it, "k").Load()
-							v := elements.Index(it, "v").Load()
-							h := c.hashValue(s, keyTy, k)
-							bucket := getStorageBucket(h, newElements, newCapacity)
-							newElements.Index(bucket, "k").Store(k)
-							newElements.Index(bucket, "v").Store(v)
-							newElements.Index(bucket, "used").Store(s.Scalar(mapElementFull))
-						})
-						return nil
-					})
-					c.Free(s, elements)
-					elementsPtr.Store(newElements)
+					rehash(s, s.MulS(capacity, uint64(mapGrowMultiplier)))
 				})
 			})
+			s.If(clean.Load(), func(s *S) {
+				rehash(s, capacity)
+			})
 
 			count := countPtr.Load()
 			capacity := capacityPtr.Load()
@@ -421,8 +458,26 @@ func (c *C) buildMap(keyTy, valTy semantic.Type, mi *MapInfo) {
 					if c.isRefCounted(valTy) {
 						c.release(s, elPtr.Index(0, "v").Load(), valTy)
 					}
-					// Replace element with last
-					elPtr.Index(0, "used").Store(s.Scalar(mapElementUsed))
+					// Only leave a tombstone if lookups may probe past the
+					// element. This must match remove() in map.inc.
+					mask := s.Sub(capacity, s.Scalar(uint64(1)))
+					next := s.And(s.AddS(check, uint64(1)), mask)
+					nextUsed := elements.Index(next, "used").Load()
+					s.IfElse(c.equal(s, nextUsed, s.Scalar(mapElementEmpty)), func(s *S) {
+						elPtr.Index(0, "used").Store(s.Scalar(mapElementEmpty))
+						// Clear the tombstones directly before the element.
+						s.ForN(capacity, func(s *S, it *codegen.Value) *codegen.Value {
+							prev := s.And(s.Sub(check, s.AddS(it, uint64(1))), mask)
+							prevUsed := elements.Index(prev, "used")
+							tombstone := c.equal(s, prevUsed.Load(), s.Scalar(mapElementUsed))
+							s.If(tombstone, func(s *S) {
+								prevUsed.Store(s.Scalar(mapElementEmpty))
+							})
+							return tombstone
+						})
+					}, /* else */ func(s *S) {
+						elPtr.Index(0, "used").Store(s.Scalar(mapElementUsed))
+					})
 					count := countPtr.Load()
 					countM1 := s.SubS(count, uint64(1)).SetName("count-1")
 					// Decrement count
@@ -58,6 +58,7 @@ func Build(env *executor.Env) (replaysrv.Payload, error) {
 
 	payload := replaysrv.Payload{
 		Opcodes:   slice.Bytes(unsafe.Pointer(data.stream.data), uint64(data.stream.size)),
+		Constants: slice.Bytes(unsafe.Pointer(data.constants.data), uint64(data.constants.size)),
 		Resources: make([]*replaysrv.ResourceInfo, len(resources)),
 	}
 
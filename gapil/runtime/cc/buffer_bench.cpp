@@ -0,0 +1,61 @@
+// Copyright (C) 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// buffer-bench reports the time taken by gapil_append_buffer and
+// gapil::ChunkedBuffer to append many small records and produce a flat buffer.
+
+#include "buffer.inc"
+
+#include "core/cc/timer.h"
+#include "core/memory/arena/cc/arena.h"
+
+#include <stdio.h>
+
+namespace {
+
+const uint64_t kSize = 256 << 20;
+const uint32_t kRecord = 0x12345678;
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  core::Arena arena;
+  auto a = reinterpret_cast<arena_t*>(&arena);
+
+  auto start = core::GetNanoseconds();
+  {
+    buffer buf;
+    gapil_create_buffer(a, 16, 16, &buf);
+    for (uint64_t i = 0; i < kSize; i += sizeof(kRecord)) {
+      gapil_append_buffer(&buf, &kRecord, sizeof(kRecord));
+    }
+    gapil_destroy_buffer(&buf);
+  }
+  auto appendTime = core::GetNanoseconds() - start;
+
+  start = core::GetNanoseconds();
+  {
+    gapil::ChunkedBuffer buf(a);
+    for (uint64_t i = 0; i < kSize; i += sizeof(kRecord)) {
+      buf.append(kRecord);
+    }
+    auto flat = buf.flatten();
+    gapil_destroy_buffer(&flat);
+  }
+  auto chunkedTime = core::GetNanoseconds() - start;
+
+  printf("%d MB: gapil_append_buffer %.1f ms, ChunkedBuffer %.1f ms\n",
+         static_cast<int>(kSize >> 20), appendTime / 1e6, chunkedTime / 1e6);
+  return 0;
+}
@@ -0,0 +1,153 @@
+// Copyright (C) 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "buffer.inc"
+
+#include "core/memory/arena/cc/arena.h"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <vector>
+
+namespace {
+
+class BufferTest : public ::testing::Test {
+  void TearDown() {
+    EXPECT_EQ(0, arena.num_allocations());  // nothing leaked
+  }
+
+ public:
+  arena_t* a() { return reinterpret_cast<arena_t*>(&arena); }
+
+  core::Arena arena;
+};
+
+}  // anonymous namespace
+
+TEST_F(BufferTest, reserve) {
+  gapil::Buffer buf(a(), 4);
+  buf.append<uint32_t>(0x12345678);
+  buf.reserve(1024);
+  buf.set_size(1024);
+  EXPECT_TRUE(buf.write<uint32_t>(1020, 0xabcdef01));
+  EXPECT_FALSE(buf.write<uint32_t>(1021, 0));
+
+  auto reader = buf.reader();
+  uint32_t first = 0;
+  EXPECT_TRUE(reader.read(&first));
+  EXPECT_EQ(0x12345678, first);
+}
+
+TEST_F(BufferTest, chunked_append) {
+  gapil::ChunkedBuffer buf(a(), 16);
+  std::vector<uint8_t> expected;
+  for (uint32_t i = 0; i < 1000; i++) {
+    buf.append(i);
+    for (int b = 0; b < 4; b++) {
+      expected.push_back(static_cast<uint8_t>(i >> (b * 8)));
+    }
+    if (i % 100 == 0) {
+      buf.append_zeros(i % 7);
+      expected.insert(expected.end(), i % 7, 0);
+    }
+  }
+  uint8_t large[100];
+  for (int i = 0; i < 100; i++) {
+    large[i] = static_cast<uint8_t>(i);
+  }
+  buf.append(large, sizeof(large));
+  expected.insert(expected.end(), large, large + sizeof(large));
+  EXPECT_EQ(expected.size(), buf.size());
+
+  std::vector<uint8_t> visited;
+  int chunks = 0;
+  buf.for_each_chunk([&](const uint8_t* data, uint64_t size) {
+    visited.insert(visited.end(), data, data + size);
+    chunks++;
+  });
+  EXPECT_EQ(expected, visited);
+  EXPECT_LT(chunks, 12);  // chunks grow geometrically
+
+  auto flat = buf.flatten();
+  EXPECT_EQ(0, buf.size());
+  ASSERT_EQ(expected.size(), flat.size);
+  EXPECT_EQ(0, memcmp(expected.data(), flat.data, flat.size));
+  gapil_destroy_buffer(&flat);
+}
+
+TEST_F(BufferTest, chunked_equal_write) {
+  gapil::ChunkedBuffer buf(a(), 16);
+  std::vector<uint8_t> expected;
+  for (uint32_t i = 0; i < 100; i++) {
+    buf.append(i);
+    for (int b = 0; b < 4; b++) {
+      expected.push_back(static_cast<uint8_t>(i >> (b * 8)));
+    }
+  }
+  // Ranges crossing the chunk boundaries.
+  for (uint64_t offset = 0; offset < expected.size(); offset += 7) {
+    auto size = std::min<uint64_t>(37, expected.size() - offset);
+    EXPECT_TRUE(buf.equal(offset, &expected[offset], size));
+  }
+  EXPECT_TRUE(buf.equal(expected.size(), nullptr, 0));
+
+  uint8_t patch[40];
+  memset(patch, 0xaa, sizeof(patch));
+  buf.write(10, patch, sizeof(patch));
+  EXPECT_FALSE(buf.equal(0, expected.data(), expected.size()));
+  memcpy(&expected[10], patch, sizeof(patch));
+  EXPECT_TRUE(buf.equal(0, expected.data(), expected.size()));
+
+  auto flat = buf.flatten();
+  ASSERT_EQ(expected.size(), flat.size);
+  EXPECT_EQ(0, memcmp(expected.data(), flat.data, flat.size));
+  gapil_destroy_buffer(&flat);
+}
+
+TEST_F(BufferTest, chunked_reserve) {
+  gapil::ChunkedBuffer buf(a(), 16);
+  buf.append<uint64_t>(1);
+  buf.reserve(4096);
+  for (uint64_t i = 0; i < 512; i++) {
+    buf.append(i);
+  }
+  int chunks = 0;
+  buf.for_each_chunk([&](const uint8_t*, uint64_t) { chunks++; });
+  EXPECT_EQ(2, chunks);
+
+  gapil::ChunkedBuffer empty(a());
+  auto flat = empty.flatten();
+  EXPECT_EQ(0, flat.size);
+  gapil_destroy_buffer(&flat);
+}
+
+TEST_F(BufferTest, chunked_matches_append_buffer) {
+  buffer expected;
+  gapil_create_buffer(a(), 16, 16, &expected);
+  gapil::ChunkedBuffer buf(a(), 16);
+  for (uint32_t i = 0; i < 1000; i++) {
+    uint32_t record = i * 0x01010101;
+    gapil_append_buffer(&expected, &record, sizeof(record));
+    buf.append(record);
+  }
+  EXPECT_EQ(expected.size, buf.size());
+
+  auto flat = buf.flatten();
+  ASSERT_EQ(expected.size, flat.size);
+  EXPECT_EQ(0, memcmp(expected.data, flat.data, flat.size));
+  gapil_destroy_buffer(&flat);
+  gapil_destroy_buffer(&expected);
+}
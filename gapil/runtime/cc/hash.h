@@ -76,9 +76,23 @@ struct hash<double, void> {
   }
 };
 
+// Integers that fit in 32 bits, such as identifiers handed out in sequence,
+// are hashed as themselves so that dense keys fill consecutive buckets. Larger
+// integers, such as handles that look like aligned pointers, are mixed so that
+// keys sharing their low bits do not pile up in the same buckets.
+inline uint64_t mix_integer(uint64_t v) {
+  if (v <= 0xffffffffULL) {
+    return v;
+  }
+  v *= 0x9e3779b97f4a7c15ULL;
+  return v ^ (v >> 32);
+}
+
 template <typename T>
 struct hash<T, typename std::enable_if<std::is_integral<T>::value>::type> {
-  uint64_t operator()(const T& v) { return static_cast<uint64_t>(v); }
+  uint64_t operator()(const T& v) {
+    return mix_integer(static_cast<uint64_t>(v));
+  }
 };
 
 template <typename T>
@@ -178,6 +178,12 @@ class Map {
     void reference();
     void release();
 
+    // Moves all the elements to a new elements buffer of the given capacity,
+    // dropping the tombstones of removed elements.
+    void rehash(uint64_t capacity);
+    // Returns the first slot from hash that does not hold an element.
+    uint64_t storage_bucket(uint64_t hash);
+
     inline const element* els() const;
     inline element* els();
   };
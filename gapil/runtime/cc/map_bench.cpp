@@ -0,0 +1,122 @@
+// Copyright (C) 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// map-bench reports the time taken by gapil::Map and std::unordered_map to
+// insert, find, replace and iterate over sequential keys and over keys that
+// look like aligned pointers.
+
+#include "map.inc"
+
+#include "core/cc/timer.h"
+#include "core/memory/arena/cc/arena.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+const uint64_t kBenchmarkKeys = 1 << 17;
+
+// Key patterns of the benchmark: sequential identifiers and handles that
+// look like 64-byte aligned pointers.
+uint64_t sequentialKey(uint64_t i) { return i; }
+uint64_t pointerKey(uint64_t i) { return 0x7f0000000000 + (i << 6); }
+
+double nsPerOp(uint64_t start, uint64_t ops) {
+  return static_cast<double>(core::GetNanoseconds() - start) / ops;
+}
+
+template <typename M>
+void benchmarkMap(const char* name, M* map, uint64_t (*key)(uint64_t)) {
+  uint64_t start = core::GetNanoseconds();
+  for (uint64_t i = 0; i < kBenchmarkKeys; i++) {
+    (*map)[key(i)] = i;
+  }
+  double insert = nsPerOp(start, kBenchmarkKeys);
+
+  uint64_t sum = 0;
+  start = core::GetNanoseconds();
+  for (uint64_t i = 0; i < kBenchmarkKeys; i++) {
+    sum += map->find(key((i * 7919) % kBenchmarkKeys))->second;
+  }
+  double hit = nsPerOp(start, kBenchmarkKeys);
+
+  start = core::GetNanoseconds();
+  for (uint64_t i = 0; i < kBenchmarkKeys; i++) {
+    sum += map->find(key(kBenchmarkKeys + i)) == map->end() ? 1 : 0;
+  }
+  double miss = nsPerOp(start, kBenchmarkKeys);
+
+  // Replace every key once, as objects are destroyed and created.
+  start = core::GetNanoseconds();
+  for (uint64_t i = 0; i < kBenchmarkKeys; i++) {
+    map->erase(key(i));
+    (*map)[key(kBenchmarkKeys + i)] = i;
+  }
+  double churn = nsPerOp(start, kBenchmarkKeys);
+
+  start = core::GetNanoseconds();
+  for (const auto& it : *map) {
+    sum += it.second;
+  }
+  double iterate = nsPerOp(start, kBenchmarkKeys);
+
+  if (map->size() != kBenchmarkKeys || sum == 0) {
+    fprintf(stderr, "%s: unexpected contents\n", name);
+    exit(EXIT_FAILURE);
+  }
+  printf("%-28s insert %6.1f  hit %6.1f  miss %6.1f  churn %7.1f  "
+         "iterate %5.1f ns/op\n",
+         name, insert, hit, miss, churn, iterate);
+}
+
+// Adapts gapil::Map to the parts of the std::unordered_map interface used by
+// benchmarkMap.
+struct GapilMap : public gapil::Map<uint64_t, uint64_t, false> {
+  GapilMap(core::Arena* arena) : gapil::Map<uint64_t, uint64_t, false>(arena) {}
+  uint64_t size() const { return count(); }
+};
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  core::Arena arena;
+  for (auto key : {&sequentialKey, &pointerKey}) {
+    const char* pattern = key == &sequentialKey ? "sequential" : "pointer";
+    {
+      std::unordered_map<uint64_t, uint64_t> map;
+      std::string name = std::string("std::unordered_map ") + pattern;
+      benchmarkMap(name.c_str(), &map, key);
+    }
+    {
+      GapilMap map(&arena);
+      std::string name = std::string("gapil::Map ") + pattern;
+      benchmarkMap(name.c_str(), &map, key);
+
+      uint64_t start = core::GetNanoseconds();
+      auto clone = map.clone();
+      double cloneTime = nsPerOp(start, kBenchmarkKeys);
+
+      start = core::GetNanoseconds();
+      clone.clear();
+      double clearTime = nsPerOp(start, kBenchmarkKeys);
+      printf("%-28s clone %6.1f  clear %6.1f ns/element\n", name.c_str(),
+             cloneTime, clearTime);
+    }
+  }
+  return 0;
+}
@@ -20,6 +20,8 @@
 
 #include <gtest/gtest.h>
 
+#include <string>
+
 template <typename T>
 class MapTest : public ::testing::Test {
   void TearDown() {
@@ -275,3 +277,76 @@ TEST_F(CppMapTest, movable_object) {
   EXPECT_EQ(resize_threshold + 2, map.count());
   EXPECT_EQ(GAPIL_MIN_MAP_SIZE * GAPIL_MAP_GROW_MULTIPLIER, map.capacity());
 }
+
+TYPED_TEST(MapTest, churn) {
+  using key_type = typename TypeParam::key_type;
+  using value_type = typename TypeParam::value_type;
+  auto map = TypeParam(&this->TestFixture::arena);
+
+  // Keep 100 elements in the map while replacing them many times over.
+  for (uint64_t i = 0; i < 100; ++i) {
+    map[key_type(i)] = value_type(i);
+  }
+  uint64_t capacity = map.capacity();
+  for (uint64_t i = 100; i < 10000; ++i) {
+    map.erase(key_type(i - 100));
+    map[key_type(i)] = value_type(i);
+  }
+  EXPECT_EQ(100, map.count());
+  EXPECT_EQ(capacity, map.capacity());
+  for (uint64_t i = 0; i < 10000; ++i) {
+    EXPECT_EQ(i >= 9900, map.contains(key_type(i)));
+  }
+  EXPECT_EQ(value_type(9950), map.findOrZero(key_type(9950)));
+}
+
+TYPED_TEST(MapTest, erase_while_iterating) {
+  using key_type = typename TypeParam::key_type;
+  using value_type = typename TypeParam::value_type;
+  auto map = TypeParam(&this->TestFixture::arena);
+
+  for (uint64_t i = 0; i < 1000; ++i) {
+    map[key_type(i * 64)] = value_type(i);
+  }
+  std::vector<int> seen(1000);
+  for (auto it = map.begin(); it != map.end(); ++it) {
+    seen[it->second]++;
+    map.erase(it->first);
+  }
+  EXPECT_EQ(0, map.count());
+  for (uint64_t i = 0; i < 1000; ++i) {
+    EXPECT_EQ(1, seen[i]);
+  }
+}
+
+TYPED_TEST(MapTest, clone) {
+  using key_type = typename TypeParam::key_type;
+  using value_type = typename TypeParam::value_type;
+  auto map = TypeParam(&this->TestFixture::arena);
+
+  for (uint64_t i = 0; i < 1000; ++i) {
+    map[key_type(i)] = value_type(i + 1);
+  }
+  auto clone = map.clone();
+  EXPECT_NE(map.instance_ptr(), clone.instance_ptr());
+  EXPECT_EQ(1000, clone.count());
+  for (uint64_t i = 0; i < 1000; ++i) {
+    EXPECT_EQ(value_type(i + 1), clone.findOrZero(key_type(i)));
+  }
+  clone[key_type(2000)] = value_type(1);
+  clone.erase(key_type(0));
+  EXPECT_EQ(1000, map.count());
+  EXPECT_TRUE(map.contains(key_type(0)));
+  EXPECT_FALSE(map.contains(key_type(2000)));
+}
+
+TEST_F(CppMapTest, clone_shares_values) {
+  auto map = gapil::Map<uint32_t, gapil::String, false>(&arena);
+  map[1] = gapil::String(&arena, "one");
+  map[2] = gapil::String(&arena, "two");
+
+  auto clone = map.clone();
+  EXPECT_EQ(2, clone.count());
+  EXPECT_STREQ(clone[1].c_str(), "one");
+  EXPECT_STREQ(clone[2].c_str(), "two");
+}
@@ -24,6 +24,11 @@
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
 
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+
 #define ENABLE_DEBUG 0
 #define ENABLE_DEBUG_INST 0
 
@@ -59,6 +64,10 @@ namespace {
 // Must match value used in cc/gapir/memory_manager.h
 const uint64_t unobservedPointer = 0xBADF00D;
 
+// The minimum size in bytes of the instruction stream segments generated in
+// parallel by gapil_replay_build.
+const uint64_t MIN_SEGMENT_SIZE = 1 << 20;
+
 // These functions are only used in debug
 #if ENABLE_DEBUG_INST
 const char* bool_str(bool b) { return b ? "true" : "false"; }
@@ -122,8 +131,34 @@ class Builder {
   Builder(::arena* a, gapil_replay_data* d);
 
   void layout_volatile_memory();
-  void generate_opcodes();
+  void generate_opcodes(uint32_t segments);
   void build_resources();
+  void build_constants();
+
+  // remap returns v with observed pointers remapped to the volatile memory
+  // laid out by layout_volatile_memory(). remap may be called by multiple
+  // threads at once.
+  gapil_replay_asm_value remap(gapil_replay_asm_value v) const;
+
+ private:
+  arena* arena_;
+  gapil_replay_data* data_;
+  std::unordered_map<DataEx::Namespace, std::vector<DataEx::VolatileAddr>>
+      reserved_base_offsets_;
+};
+
+// Generator generates the opcodes of a segment of the instruction stream.
+// Instructions are independent of each other, so the segments of a stream can
+// be generated in parallel, by one Generator each, and their opcodes
+// concatenated in order.
+class Generator {
+ public:
+  Generator(const Builder* builder, ::arena* a, uint64_t size_hint);
+
+  // generate appends the opcodes of the instructions to the opcodes buffer.
+  void generate(const buffer* instructions);
+
+  inline gapil::ChunkedBuffer& opcodes() { return opcodes_; }
 
  private:
   // Various bit-masks used by this class.
@@ -136,8 +171,6 @@ class Builder {
   static const uint64_t mask46 = 0x3fffffffffff;
   static const uint64_t mask52 = 0xfffffffffffff;
 
-  gapil_replay_asm_value remap(gapil_replay_asm_value v);
-
   void push(gapil_replay_asm_value val);
   void load(gapil_replay_asm_value val, gapil_replay_asm_type ty);
   void store(gapil_replay_asm_value dst);
@@ -214,20 +247,23 @@ class Builder {
     return packC(c) | (y << 20) | z;
   }
 
-  arena* arena_;
-  gapil_replay_data* data_;
-  gapil::Buffer opcodes_;
-  std::unordered_map<DataEx::Namespace, std::vector<DataEx::VolatileAddr>>
-      reserved_base_offsets_;
+  const Builder* builder_;
+  gapil::ChunkedBuffer opcodes_;
 };
 
 Builder::Builder(arena* arena, gapil_replay_data* data)
-    : arena_(arena), data_(data), opcodes_(arena) {}
+    : arena_(arena), data_(data) {}
+
+Generator::Generator(const Builder* builder, arena* arena, uint64_t size_hint)
+    : builder_(builder), opcodes_(arena) {
+  opcodes_.reserve(size_hint);
+}
 
 void Builder::layout_volatile_memory() {
   DEBUG_PRINT("Builder::layout_volatile_memory()");
 
   auto ex = reinterpret_cast<DataEx*>(data_->data_ex);
+  ex->merge_reserved();
 
   StackAllocator<uint64_t> volatile_mem;
 
@@ -262,10 +298,118 @@ void Builder::layout_volatile_memory() {
   }
 }
 
-void Builder::generate_opcodes() {
-  DEBUG_PRINT("Builder::generate_opcodes()");
+// inst_size returns the size of the instruction of type ty following its type
+// byte, or 0 if ty is not an instruction type.
+uint64_t inst_size(uint8_t ty) {
+  switch (gapil_replay_asm_inst(ty)) {
+    case GAPIL_REPLAY_ASM_INST_CALL:
+      return sizeof(gapil_replay_asm_call);
+    case GAPIL_REPLAY_ASM_INST_PUSH:
+      return sizeof(gapil_replay_asm_push);
+    case GAPIL_REPLAY_ASM_INST_POP:
+      return sizeof(gapil_replay_asm_pop);
+    case GAPIL_REPLAY_ASM_INST_COPY:
+      return sizeof(gapil_replay_asm_copy);
+    case GAPIL_REPLAY_ASM_INST_CLONE:
+      return sizeof(gapil_replay_asm_clone);
+    case GAPIL_REPLAY_ASM_INST_LOAD:
+      return sizeof(gapil_replay_asm_load);
+    case GAPIL_REPLAY_ASM_INST_STORE:
+      return sizeof(gapil_replay_asm_store);
+    case GAPIL_REPLAY_ASM_INST_STRCPY:
+      return sizeof(gapil_replay_asm_strcpy);
+    case GAPIL_REPLAY_ASM_INST_RESOURCE:
+      return sizeof(gapil_replay_asm_resource);
+    case GAPIL_REPLAY_ASM_INST_POST:
+      return sizeof(gapil_replay_asm_post);
+    case GAPIL_REPLAY_ASM_INST_ADD:
+      return sizeof(gapil_replay_asm_add);
+    case GAPIL_REPLAY_ASM_INST_LABEL:
+      return sizeof(gapil_replay_asm_label);
+    case GAPIL_REPLAY_ASM_INST_SWITCHTHREAD:
+      return sizeof(gapil_replay_asm_switchthread);
+  }
+  return 0;
+}
 
-  gapil::Buffer::Reader reader(&data_->stream);
+// split_instructions returns the offsets of the boundaries of up to count
+// segments of roughly equal size of the instruction stream, starting with 0
+// and ending with the size of the stream. Boundaries are placed between
+// instructions, at the offsets a serial decode of the stream would reach.
+std::vector<uint64_t> split_instructions(const buffer& stream,
+                                         uint32_t count) {
+  std::vector<uint64_t> bounds{0};
+  uint64_t target = stream.size / count;
+  uint64_t offset = 0;
+  while (offset < stream.size) {
+    if (offset >= target * bounds.size() && bounds.size() < count) {
+      bounds.push_back(offset);
+    }
+    auto size = inst_size(stream.data[offset]);
+    if (size > 0 && offset + 1 + size <= stream.size) {
+      offset += 1 + size;
+    } else {
+      offset++;  // Matches Buffer::Reader, which skips the byte.
+    }
+  }
+  bounds.push_back(stream.size);
+  return bounds;
+}
+
+void Builder::generate_opcodes(uint32_t segments) {
+  DEBUG_PRINT("Builder::generate_opcodes(segments: %" PRIu32 ")", segments);
+
+  auto bounds = split_instructions(data_->stream, std::max(segments, 1u));
+  auto count = bounds.size() - 1;
+
+  // Most instructions are encoded as a similar number of opcode bytes.
+  std::vector<std::unique_ptr<Generator>> generators;
+  std::vector<buffer> instructions;
+  for (size_t i = 0; i < count; i++) {
+    auto size = bounds[i + 1] - bounds[i];
+    generators.emplace_back(new Generator(this, arena_, size));
+    instructions.push_back(buffer{data_->stream.arena,
+                                  data_->stream.data + bounds[i],
+                                  static_cast<uint32_t>(size),
+                                  static_cast<uint32_t>(size),
+                                  data_->stream.alignment});
+  }
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < count; i++) {
+    threads.emplace_back([&generators, &instructions, i] {
+      generators[i]->generate(&instructions[i]);
+    });
+  }
+  if (count > 0) {
+    generators[0]->generate(&instructions[0]);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // Free the instructions as they are now no longer needed.
+  gapil_free(arena_, data_->stream.data);
+
+  // The stream is now a stream of opcodes, concatenated in segment order.
+  uint64_t size = 0;
+  for (auto& generator : generators) {
+    size += generator->opcodes().size();
+  }
+  buffer opcodes;
+  gapil_create_buffer(arena_, std::max<uint64_t>(size, 1), 16, &opcodes);
+  for (auto& generator : generators) {
+    generator->opcodes().for_each_chunk(
+        [&opcodes](const uint8_t* data, uint64_t size) {
+          memcpy(opcodes.data + opcodes.size, data, size);
+          opcodes.size += size;
+        });
+  }
+  data_->stream = opcodes;
+}
+
+void Generator::generate(const buffer* instructions) {
+  gapil::Buffer::Reader reader(const_cast<buffer*>(instructions));
 
   while (true) {
     uint8_t ty;
@@ -293,7 +437,7 @@ void Builder::generate_opcodes() {
         if (reader.read(&inst)) {
           DEBUG_PRINT_INST("GAPIL_REPLAY_ASM_INST_PUSH(value: " ASM_VAL_FMT ")",
                            ASM_VAL_ARGS(inst.value));
-          push(remap(inst.value));
+          push(builder_->remap(inst.value));
         }
         break;
       }
@@ -330,7 +474,7 @@ void Builder::generate_opcodes() {
           DEBUG_PRINT_INST(
               "GAPIL_REPLAY_ASM_INST_LOAD(type: %s, src: " ASM_VAL_FMT ")",
               asm_type_str(inst.data_type), ASM_VAL_ARGS(inst.source));
-          load(remap(inst.source), inst.data_type);
+          load(builder_->remap(inst.source), inst.data_type);
         }
         break;
       }
@@ -339,7 +483,7 @@ void Builder::generate_opcodes() {
         if (reader.read(&inst)) {
           DEBUG_PRINT_INST("GAPIL_REPLAY_ASM_INST_STORE(dst: " ASM_VAL_FMT ")",
                            ASM_VAL_ARGS(inst.dst));
-          store(remap(inst.dst));
+          store(builder_->remap(inst.dst));
         }
         break;
       }
@@ -359,7 +503,7 @@ void Builder::generate_opcodes() {
           DEBUG_PRINT_INST("GAPIL_REPLAY_ASM_INST_RESOURCE(index: %" PRIu32
                            ", dst: " ASM_VAL_FMT ")",
                            inst.index, ASM_VAL_ARGS(inst.dest));
-          push(remap(inst.dest));
+          push(builder_->remap(inst.dest));
           CX(Opcode::RESOURCE, inst.index);
         }
         break;
@@ -370,7 +514,7 @@ void Builder::generate_opcodes() {
           DEBUG_PRINT_INST("GAPIL_REPLAY_ASM_INST_POST(src: " ASM_VAL_FMT
                            ", size: 0x%" PRIx64 ")",
                            ASM_VAL_ARGS(inst.source), inst.size);
-          push(remap(inst.source));
+          push(builder_->remap(inst.source));
           C(Opcode::POST);
         }
         break;
@@ -405,12 +549,6 @@ void Builder::generate_opcodes() {
       }
     }
   }
-
-  // Free the instructions as they are now no longer needed.
-  gapil_free(arena_, data_->stream.data);
-
-  // The stream is now a stream of opcodes.
-  data_->stream = opcodes_.release_ownership();
 }
 
 void Builder::build_resources() {
@@ -428,21 +566,29 @@ void Builder::build_resources() {
   data_->resources = resources.release_ownership();
 }
 
-gapil_replay_asm_value Builder::remap(gapil_replay_asm_value v) {
+void Builder::build_constants() {
   auto ex = reinterpret_cast<DataEx*>(data_->data_ex);
+  gapil_destroy_buffer(&data_->constants);
+  data_->constants = ex->constants.flatten();
+}
+
+gapil_replay_asm_value Builder::remap(gapil_replay_asm_value v) const {
+  auto ex = reinterpret_cast<const DataEx*>(data_->data_ex);
 
   if (v.data_type >= GAPIL_REPLAY_ASM_TYPE_OBSERVED_POINTER_NAMESPACE_0) {
     auto ns = DataEx::Namespace(
         v.data_type - GAPIL_REPLAY_ASM_TYPE_OBSERVED_POINTER_NAMESPACE_0);
-    const auto& reserved = ex->reserved[ns];
-    auto idx = reserved.index_of(v.data);
+    // Lookups must not modify the maps, as remap is called concurrently.
+    auto it = ex->reserved.find(ns);
+    auto idx = it != ex->reserved.end() ? it->second.index_of(v.data) : -1;
 
     if (idx < 0) {
       GAPID_WARNING("Pointer 0x%" PRIx64 "@%d not reserved", v.data, ns);
       return gapil_replay_asm_value{unobservedPointer,
                                     GAPIL_REPLAY_ASM_TYPE_ABSOLUTE_POINTER};
     } else {
-      const auto& offsets = reserved_base_offsets_[ns];
+      const auto& reserved = it->second;
+      const auto& offsets = reserved_base_offsets_.at(ns);
       auto remapped = offsets[idx] + v.data - reserved[idx].mStart;
       return gapil_replay_asm_value{remapped,
                                     GAPIL_REPLAY_ASM_TYPE_VOLATILE_POINTER};
@@ -451,7 +597,7 @@ gapil_replay_asm_value Builder::remap(gapil_replay_asm_value v) {
   return v;
 }
 
-void Builder::push(gapil_replay_asm_value val) {
+void Generator::push(gapil_replay_asm_value val) {
   auto v = val.data;
   auto t = val.data_type;
   switch (t) {
@@ -534,7 +680,7 @@ void Builder::push(gapil_replay_asm_value val) {
   }
 }
 
-void Builder::load(gapil_replay_asm_value val, gapil_replay_asm_type ty) {
+void Generator::load(gapil_replay_asm_value val, gapil_replay_asm_type ty) {
   if ((val.data & ~mask20) == 0) {
     switch (val.data_type) {
       case GAPIL_REPLAY_ASM_TYPE_CONSTANT_POINTER:
@@ -551,7 +697,7 @@ void Builder::load(gapil_replay_asm_value val, gapil_replay_asm_type ty) {
   CX(Opcode::LOAD, ty);
 }
 
-void Builder::store(gapil_replay_asm_value dst) {
+void Generator::store(gapil_replay_asm_value dst) {
   if ((dst.data & ~mask20) == 0 &&
       dst.data_type == GAPIL_REPLAY_ASM_TYPE_VOLATILE_POINTER) {
     CX(Opcode::STORE_V, dst.data);
@@ -564,8 +710,16 @@ void Builder::store(gapil_replay_asm_value dst) {
 }  // anonymous namespace
 
 void gapil_replay_build(context* ctx, gapil_replay_data* data) {
+  auto segments = std::min<uint64_t>(std::thread::hardware_concurrency(),
+                                     data->stream.size / MIN_SEGMENT_SIZE);
+  gapil_replay_build_segments(ctx, data, static_cast<uint32_t>(segments));
+}
+
+void gapil_replay_build_segments(context* ctx, gapil_replay_data* data,
+                                 uint32_t segments) {
   Builder builder(ctx->arena, data);
   builder.layout_volatile_memory();
-  builder.generate_opcodes();
+  builder.generate_opcodes(segments);
   builder.build_resources();
+  builder.build_constants();
 }
\ No newline at end of file
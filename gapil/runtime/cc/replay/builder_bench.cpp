@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// builder-bench reports the time taken to build a large random recording of
+// replay instructions, with the streams built serially and in parallel.
+
+#include "recording.h"
+
+#include "core/cc/timer.h"
+
+#include <stdio.h>
+
+using gapil::runtime::replay::test::Recording;
+
+namespace {
+
+const size_t kInstructions = 2000000;
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  for (uint32_t segments : {1, 8}) {
+    Recording recording(1, kInstructions);
+    auto start = core::GetNanoseconds();
+    recording.build(segments);
+    auto time = core::GetNanoseconds() - start;
+    printf("%d instructions, %d segments: %.1f ms\n",
+           static_cast<int>(kInstructions), static_cast<int>(segments),
+           time / 1e6);
+  }
+  return 0;
+}
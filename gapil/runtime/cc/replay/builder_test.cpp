@@ -0,0 +1,76 @@
+// Copyright (C) 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "recording.h"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <vector>
+
+using gapil::runtime::replay::test::Recording;
+using gapil::runtime::replay::test::kNamespaces;
+
+namespace {
+
+void expectEqual(const buffer& a, const buffer& b) {
+  ASSERT_EQ(a.size, b.size);
+  EXPECT_EQ(0, memcmp(a.data, b.data, a.size));
+}
+
+std::vector<uint8_t> bytes(const buffer& buf) {
+  return std::vector<uint8_t>(buf.data, buf.data + buf.size);
+}
+
+}  // anonymous namespace
+
+TEST(ReplayBuilderTest, parallel_matches_serial) {
+  const size_t kInstructions = 20000;
+  Recording serial(1234, kInstructions);
+  serial.build(1);
+  EXPECT_LT(0, serial.opcodes().size);
+  for (uint32_t segments : {2, 3, 8, 64}) {
+    Recording parallel(1234, kInstructions);
+    parallel.build(segments);
+    expectEqual(serial.opcodes(), parallel.opcodes());
+    expectEqual(serial.constants(), parallel.constants());
+  }
+}
+
+TEST(ReplayBuilderTest, small_streams) {
+  for (size_t instructions : {0, 1, 2, 5}) {
+    Recording serial(42, instructions);
+    serial.build(1);
+    Recording parallel(42, instructions);
+    parallel.build(8);
+    expectEqual(serial.opcodes(), parallel.opcodes());
+  }
+}
+
+TEST(ReplayBuilderTest, repeated_reservations) {
+  Recording once(9, 1000);
+  once.build(1);
+
+  // Memory reserved again and again is merged into the same blocks.
+  Recording repeated(9, 1000);
+  for (uint64_t i = 0; i < 10000; i++) {
+    uint64_t base = 0x10000 * (i % 64 + 1);
+    repeated.reserve(base + i % 0x10, 0x80, i % kNamespaces);
+  }
+  repeated.build(1);
+
+  EXPECT_EQ(bytes(once.opcodes()), bytes(repeated.opcodes()));
+  EXPECT_EQ(bytes(once.constants()), bytes(repeated.constants()));
+}
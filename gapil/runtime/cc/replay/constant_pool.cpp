@@ -0,0 +1,202 @@
+// Copyright (C) 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "constant_pool.h"
+#include "dataex.h"
+
+#include "core/cc/hasher.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace gapil {
+namespace runtime {
+namespace replay {
+
+// The size of the first chunk of the pool.
+static const uint64_t kFirstChunkSize = 64 << 10;
+
+ConstantPool::ConstantPool(arena* a) : data_(a, kFirstChunkSize), stats_{} {}
+
+uint64_t ConstantPool::window(const uint8_t* data, bool* anchor) {
+  uint64_t v;
+  memcpy(&v, data, sizeof(v));
+  *anchor = (((v * 0x9e3779b97f4a7c15ULL) >> 32) & ANCHOR_MASK) == 0;
+  return v;
+}
+
+uint32_t ConstantPool::add(const void* ptr, uint32_t size,
+                           uint32_t alignment) {
+  auto data = reinterpret_cast<const uint8_t*>(ptr);
+  alignment = std::max(alignment, 1u);
+  stats_.count++;
+  stats_.bytes += size;
+  if (size == 0) {
+    // An empty constant holds no bytes, so any aligned offset will do.
+    return 0;
+  }
+
+  auto id = core::Hasher::Hash(data, size);
+  uint64_t offset = 0;
+  if (find_exact(id, data, size, alignment, &offset)) {
+    stats_.exact++;
+    return offset;
+  }
+  if (find_range(data, size, alignment, &offset)) {
+    stats_.ranges++;
+  } else if (pack(data, size, alignment, &offset)) {
+    stats_.packed++;
+  } else if (find_overlap(data, size, alignment, &offset)) {
+    stats_.overlap++;
+    auto overlap = data_.size() - offset;
+    data_.append(data + overlap, size - overlap);
+    index(offset, data, size);
+  } else {
+    offset = align<uint64_t>(data_.size(), alignment);
+    if (offset > data_.size()) {
+      holes_[data_.size()] = offset - data_.size();
+      data_.append_zeros(offset - data_.size());
+    }
+    data_.append(data, size);
+    index(offset, data, size);
+  }
+  exact_.emplace(id, offset);
+  return offset;
+}
+
+bool ConstantPool::find_exact(const core::Id& id, const uint8_t* data,
+                              uint32_t size, uint32_t alignment,
+                              uint64_t* offset) {
+  auto it = exact_.find(id);
+  if (it == exact_.end() || it->second % alignment != 0) {
+    return false;
+  }
+  *offset = it->second;
+  return true;
+}
+
+bool ConstantPool::find_range(const uint8_t* data, uint32_t size,
+                              uint32_t alignment, uint64_t* offset) {
+  int lookups = 0;
+  for (uint32_t i = 0; i + WINDOW_SIZE <= size; i++) {
+    bool anchor = false;
+    auto w = window(data + i, &anchor);
+    if (!anchor) {
+      continue;
+    }
+    auto it = anchors_.find(w);
+    if (it != anchors_.end()) {
+      for (auto candidate : it->second) {
+        if (candidate < i) {
+          continue;
+        }
+        auto start = candidate - i;
+        if (start % alignment == 0 && start + size <= data_.size() &&
+            data_.equal(start, data, size)) {
+          use(start, start + size);
+          *offset = start;
+          return true;
+        }
+      }
+      if (++lookups == MAX_ANCHOR_LOOKUPS) {
+        break;
+      }
+    }
+  }
+  return false;
+}
+
+bool ConstantPool::find_overlap(const uint8_t* data, uint32_t size,
+                                uint32_t alignment, uint64_t* offset) {
+  auto end = data_.size();
+  auto max = std::min<uint64_t>({size - 1, end, MAX_OVERLAP});
+  for (uint64_t overlap = max; overlap > 0; overlap--) {
+    auto start = end - overlap;
+    if (start % alignment == 0 && data_.equal(start, data, overlap)) {
+      use(start, end);
+      *offset = start;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ConstantPool::pack(const uint8_t* data, uint32_t size, uint32_t alignment,
+                        uint64_t* offset) {
+  if (size == 0 || size > MAX_PACKED_SIZE) {
+    return false;
+  }
+  int lookups = 0;
+  for (auto it = holes_.rbegin();
+       it != holes_.rend() && lookups < MAX_HOLE_LOOKUPS; ++it, ++lookups) {
+    auto hole_start = it->first;
+    auto hole_end = it->first + it->second;
+    auto start = align<uint64_t>(hole_start, alignment);
+    if (start + size <= hole_end) {
+      data_.write(start, data, size);
+      use(start, start + size);
+      // The remains of the hole are kept for other constants.
+      if (start > hole_start) {
+        holes_[hole_start] = start - hole_start;
+      }
+      if (start + size < hole_end) {
+        holes_[start + size] = hole_end - (start + size);
+      }
+      *offset = start;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ConstantPool::index(uint64_t offset, const uint8_t* data, uint32_t size) {
+  for (uint32_t i = 0; i + WINDOW_SIZE <= size; i++) {
+    bool anchor = false;
+    auto w = window(data + i, &anchor);
+    if (anchor) {
+      auto& offsets = anchors_[w];
+      if (offsets.size() < MAX_ANCHOR_OFFSETS) {
+        offsets.push_back(offset + i);
+      }
+    }
+  }
+}
+
+void ConstantPool::use(uint64_t start, uint64_t end) {
+  // Padding bytes that are part of a constant must keep their zero value.
+  auto it = holes_.upper_bound(start);
+  if (it != holes_.begin()) {
+    --it;
+  }
+  while (it != holes_.end() && it->first < end) {
+    auto hole_start = it->first;
+    auto hole_end = it->first + it->second;
+    if (hole_end <= start) {
+      ++it;
+      continue;
+    }
+    it = holes_.erase(it);
+    if (hole_start < start) {
+      holes_[hole_start] = start - hole_start;
+    }
+    if (hole_end > end) {
+      holes_[end] = hole_end - end;
+    }
+  }
+}
+
+}  // namespace replay
+}  // namespace runtime
+}  // namespace gapil
@@ -0,0 +1,122 @@
+// Copyright (C) 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __GAPIL_RUNTIME_REPLAY_CONSTANT_POOL_H__
+#define __GAPIL_RUNTIME_REPLAY_CONSTANT_POOL_H__
+
+#include "core/cc/id.h"
+#include "gapil/runtime/cc/buffer.inc"
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace gapil {
+namespace runtime {
+namespace replay {
+
+// ConstantPool holds the constant data of a replay. Constants are shared
+// wherever their bytes are already in the pool:
+//  * A constant equal to a previously added constant is shared.
+//  * A constant found within the pool, such as the sub-array of a larger
+//    array, is shared. Constants are found from content-defined anchors: the
+//    8-byte windows of the pool whose hash has its low bits clear.
+//  * A constant starting with the bytes that end the pool overlaps them.
+// Small constants are packed into the alignment padding left before larger
+// constants.
+class ConstantPool {
+ public:
+  struct Stats {
+    uint64_t count;    // number of constants added.
+    uint64_t bytes;    // number of bytes of the constants added.
+    uint64_t exact;    // constants equal to a previous constant.
+    uint64_t ranges;   // constants found within the pool.
+    uint64_t overlap;  // constants overlapping the end of the pool.
+    uint64_t packed;   // constants packed into alignment padding.
+  };
+
+  ConstantPool(arena* a);
+
+  // add returns the offset of a constant in the pool holding the size bytes
+  // of data, at the given alignment.
+  uint32_t add(const void* data, uint32_t size, uint32_t alignment);
+
+  // size returns the size of the pool in bytes.
+  inline uint64_t size() const;
+
+  // stats returns the statistics of the constants added to the pool.
+  inline const Stats& stats() const;
+
+  // flatten returns the pool's data, and empties the pool.
+  inline buffer flatten();
+
+ private:
+  // The number of bytes of the windows used as anchors.
+  static const uint32_t WINDOW_SIZE = 8;
+  // The mask of the hash bits that must be clear for a window to be an
+  // anchor. One window in 16 is an anchor.
+  static const uint64_t ANCHOR_MASK = 15;
+  // The maximum number of pool offsets kept per anchor.
+  static const size_t MAX_ANCHOR_OFFSETS = 4;
+  // The maximum number of anchors of a constant found in the pool's index
+  // that are tried.
+  static const int MAX_ANCHOR_LOOKUPS = 4;
+  // The size of the largest constant packed into alignment padding.
+  static const uint32_t MAX_PACKED_SIZE = 8;
+  // The number of most recent alignment padding holes searched.
+  static const int MAX_HOLE_LOOKUPS = 64;
+  // The maximum number of bytes a constant overlaps the end of the pool.
+  static const uint32_t MAX_OVERLAP = 64;
+
+  // Returns the window at data, and whether the window is an anchor.
+  static inline uint64_t window(const uint8_t* data, bool* anchor);
+
+  bool find_exact(const core::Id& id, const uint8_t* data, uint32_t size,
+                  uint32_t alignment, uint64_t* offset);
+  bool find_range(const uint8_t* data, uint32_t size, uint32_t alignment,
+                  uint64_t* offset);
+  bool find_overlap(const uint8_t* data, uint32_t size, uint32_t alignment,
+                    uint64_t* offset);
+  bool pack(const uint8_t* data, uint32_t size, uint32_t alignment,
+            uint64_t* offset);
+
+  // Records the anchors of the size bytes at offset.
+  void index(uint64_t offset, const uint8_t* data, uint32_t size);
+
+  // Removes the holes intersecting [start, end), which are now in use.
+  void use(uint64_t start, uint64_t end);
+
+  gapil::ChunkedBuffer data_;
+  std::unordered_map<core::Id, uint64_t> exact_;
+  std::unordered_map<uint64_t, std::vector<uint64_t>> anchors_;
+  std::map<uint64_t, uint64_t> holes_;  // offset -> size of zero padding.
+  Stats stats_;
+};
+
+uint64_t ConstantPool::size() const { return data_.size(); }
+
+const ConstantPool::Stats& ConstantPool::stats() const { return stats_; }
+
+buffer ConstantPool::flatten() {
+  exact_.clear();
+  anchors_.clear();
+  holes_.clear();
+  return data_.flatten();
+}
+
+}  // namespace replay
+}  // namespace runtime
+}  // namespace gapil
+
+#endif  // __GAPIL_RUNTIME_REPLAY_CONSTANT_POOL_H__
@@ -0,0 +1,83 @@
+// Copyright (C) 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// constant-pool-bench reports how the constants of a large random replay are
+// shared by the ConstantPool, and the size of the pool compared to the
+// constants laid out without it.
+
+#include "constant_pool.h"
+#include "constants.h"
+
+#include "core/memory/arena/cc/arena.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <string>
+#include <unordered_set>
+
+using gapil::runtime::replay::ConstantPool;
+using gapil::runtime::replay::test::Constant;
+using gapil::runtime::replay::test::workload;
+
+namespace {
+
+const size_t kConstants = 100000;
+const uint32_t kPointerAlignment = 8;
+
+// Returns the size of the constants laid out as before the pool: constants
+// equal to a previous constant are shared, and all the constants are aligned
+// to at least the pointer alignment.
+uint64_t unpooled_size(const std::vector<Constant>& constants,
+                       uint32_t pointer_alignment) {
+  std::unordered_set<std::string> seen;
+  uint64_t size = 0;
+  for (const auto& c : constants) {
+    std::string key(c.data.begin(), c.data.end());
+    if (seen.insert(key).second) {
+      auto alignment = std::max(c.alignment, pointer_alignment);
+      size = ((size + alignment - 1) / alignment) * alignment;
+      size += c.data.size();
+    }
+  }
+  return size;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  core::Arena arena;
+  auto constants = workload(42, kConstants);
+
+  ConstantPool pool(reinterpret_cast<arena_t*>(&arena));
+  for (const auto& c : constants) {
+    pool.add(c.data.data(), c.data.size(), c.alignment);
+  }
+  auto before = unpooled_size(constants, kPointerAlignment);
+  auto after = pool.size();
+  const auto& stats = pool.stats();
+
+  printf("Constants: %" PRIu64 " (%" PRIu64 " bytes)\n", stats.count,
+         stats.bytes);
+  printf("  shared: %" PRIu64 " exact, %" PRIu64 " ranges, %" PRIu64
+         " overlapping, %" PRIu64 " packed\n",
+         stats.exact, stats.ranges, stats.overlap, stats.packed);
+  printf("  pool size: %" PRIu64 " bytes before, %" PRIu64
+         " bytes after (%.1f%%)\n",
+         before, after, 100.0 * after / before);
+
+  auto flat = pool.flatten();
+  gapil_destroy_buffer(&flat);
+  return 0;
+}
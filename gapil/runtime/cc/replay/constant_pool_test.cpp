@@ -0,0 +1,181 @@
+// Copyright (C) 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "constant_pool.h"
+#include "constants.h"
+
+#include "core/memory/arena/cc/arena.h"
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+
+#include <random>
+#include <vector>
+
+using gapil::runtime::replay::ConstantPool;
+using gapil::runtime::replay::test::Constant;
+using gapil::runtime::replay::test::bytes;
+using gapil::runtime::replay::test::random;
+using gapil::runtime::replay::test::range;
+using gapil::runtime::replay::test::value;
+using gapil::runtime::replay::test::workload;
+
+namespace {
+
+class ConstantPoolTest : public ::testing::Test {
+  void TearDown() {
+    EXPECT_EQ(0, arena.num_allocations());  // nothing leaked
+  }
+
+ public:
+  arena_t* a() { return reinterpret_cast<arena_t*>(&arena); }
+
+  uint32_t add(ConstantPool& pool, const Constant& c) {
+    return pool.add(c.data.data(), c.data.size(), c.alignment);
+  }
+
+  // Adds the constants to the pool, then checks that each of the returned
+  // offsets is aligned and holds the constant's data.
+  void check(ConstantPool& pool, const std::vector<Constant>& constants) {
+    std::vector<uint32_t> offsets;
+    for (const auto& c : constants) {
+      offsets.push_back(add(pool, c));
+    }
+    auto flat = pool.flatten();
+    for (size_t i = 0; i < constants.size(); i++) {
+      const auto& c = constants[i];
+      EXPECT_EQ(0, offsets[i] % c.alignment) << "constant " << i;
+      ASSERT_LE(offsets[i] + c.data.size(), flat.size) << "constant " << i;
+      EXPECT_EQ(0, memcmp(flat.data + offsets[i], c.data.data(), c.data.size()))
+          << "constant " << i;
+    }
+    gapil_destroy_buffer(&flat);
+  }
+
+  core::Arena arena;
+};
+
+}  // anonymous namespace
+
+TEST_F(ConstantPoolTest, exact) {
+  ConstantPool pool(a());
+  auto x = value<uint32_t>(42);
+  auto off = add(pool, x);
+  EXPECT_EQ(off, add(pool, x));
+  // Sharing honours the alignment of the constant.
+  auto y = bytes("hi", 1);
+  EXPECT_EQ(4, add(pool, y));
+  auto z = bytes("hi", 8);
+  EXPECT_EQ(0, add(pool, z) % 8);
+  EXPECT_EQ(1, pool.stats().exact);
+  check(pool, {x, y, z});
+}
+
+TEST_F(ConstantPoolTest, ranges) {
+  ConstantPool pool(a());
+  std::mt19937 rng(1);
+  auto big = random(rng, 4096, 16);
+  auto base = add(pool, big);
+  auto size = pool.size();
+  for (size_t start = 0; start < 4000; start += 160) {
+    auto sub = range(big, start, 96);
+    EXPECT_EQ(base + start, add(pool, sub));
+  }
+  EXPECT_EQ(size, pool.size());
+  EXPECT_EQ(25, pool.stats().ranges);
+  check(pool, {big, range(big, 64, 200), range(big, 8, 100)});
+}
+
+TEST_F(ConstantPoolTest, overlap) {
+  ConstantPool pool(a());
+  auto x = bytes("abcdef", 1);
+  auto y = bytes("defghi", 1);
+  EXPECT_EQ(0, add(pool, x));
+  EXPECT_EQ(3, add(pool, y));
+  EXPECT_EQ(9, pool.size());
+  EXPECT_EQ(1, pool.stats().overlap);
+  check(pool, {x, y});
+}
+
+TEST_F(ConstantPoolTest, empty) {
+  ConstantPool pool(a());
+  EXPECT_EQ(0, add(pool, Constant{{}, 8}));
+  auto x = bytes("abc", 1);
+  EXPECT_EQ(0, add(pool, x));
+  EXPECT_EQ(0, add(pool, Constant{{}, 1}));
+  EXPECT_EQ(3, pool.size());
+  check(pool, {x, Constant{{}, 16}});
+}
+
+TEST_F(ConstantPoolTest, pack) {
+  ConstantPool pool(a());
+  std::mt19937 rng(2);
+  auto byte = value<uint8_t>(7);
+  auto big = random(rng, 32, 16);
+  auto word = value<uint32_t>(0x12345678);
+  auto half = value<uint16_t>(0x9abc);
+  EXPECT_EQ(0, add(pool, byte));
+  EXPECT_EQ(16, add(pool, big));
+  // The padding between byte and big holds the small constants.
+  EXPECT_EQ(4, add(pool, word));
+  EXPECT_EQ(8, add(pool, half));
+  EXPECT_EQ(48, pool.size());
+  EXPECT_EQ(2, pool.stats().packed);
+  check(pool, {byte, big, word, half});
+}
+
+TEST_F(ConstantPoolTest, padding_kept_in_ranges) {
+  ConstantPool pool(a());
+  std::mt19937 rng(3);
+  auto byte = value<uint8_t>(1);
+  auto big = random(rng, 64, 16);
+  add(pool, byte);
+  add(pool, big);
+  // A range starting in the padding before big uses the padding's zeros,
+  // which must not be replaced by packed constants.
+  Constant padded{std::vector<uint8_t>(8, 0), 8};
+  padded.data.insert(padded.data.end(), big.data.begin(), big.data.end());
+  check(pool, {padded, value<uint32_t>(0xffffffff), value<uint8_t>(0xff)});
+  EXPECT_EQ(1, pool.stats().ranges);
+}
+
+TEST_F(ConstantPoolTest, random) {
+  for (uint32_t seed = 0; seed < 20; seed++) {
+    ConstantPool pool(a());
+    check(pool, workload(seed, 2000));
+  }
+}
+
+TEST_F(ConstantPoolTest, stats) {
+  ConstantPool pool(a());
+  std::mt19937 rng(4);
+  auto byte = value<uint8_t>(1);
+  auto big = random(rng, 256, 16);
+  auto word = value<uint32_t>(0x12345678);
+  auto x = bytes("abcdefghij", 1);
+  auto y = bytes("ghijklmnop", 1);
+  for (const auto& c : {byte, big, word, word, range(big, 64, 96), x, y}) {
+    add(pool, c);
+  }
+  const auto& stats = pool.stats();
+  EXPECT_EQ(7, stats.count);
+  EXPECT_EQ(1 + 256 + 4 + 4 + 96 + 10 + 10, stats.bytes);
+  EXPECT_EQ(1, stats.exact);
+  EXPECT_EQ(1, stats.ranges);
+  EXPECT_EQ(1, stats.overlap);
+  EXPECT_EQ(1, stats.packed);
+  EXPECT_EQ(16 + 256 + 16, pool.size());
+  check(pool, {});
+}
@@ -0,0 +1,108 @@
+// Copyright (C) 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __GAPIL_RUNTIME_REPLAY_CONSTANTS_H__
+#define __GAPIL_RUNTIME_REPLAY_CONSTANTS_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#include <random>
+#include <vector>
+
+namespace gapil {
+namespace runtime {
+namespace replay {
+namespace test {
+
+// Constant is the data and alignment of a constant added to a ConstantPool.
+struct Constant {
+  std::vector<uint8_t> data;
+  uint32_t alignment;
+};
+
+inline Constant bytes(const char* str, uint32_t alignment) {
+  return Constant{std::vector<uint8_t>(str, str + strlen(str)), alignment};
+}
+
+template <typename T>
+inline Constant value(T v) {
+  Constant c{std::vector<uint8_t>(sizeof(T)), alignof(T)};
+  memcpy(c.data.data(), &v, sizeof(T));
+  return c;
+}
+
+inline Constant random(std::mt19937& rng, size_t size, uint32_t alignment) {
+  Constant c{std::vector<uint8_t>(size), alignment};
+  for (auto& b : c.data) {
+    b = static_cast<uint8_t>(rng());
+  }
+  return c;
+}
+
+inline Constant range(const Constant& c, size_t start, size_t size) {
+  return Constant{std::vector<uint8_t>(c.data.begin() + start,
+                                       c.data.begin() + start + size),
+                  c.alignment};
+}
+
+// Returns the constants of a replay: small scalars and handles, strings,
+// structures, and arrays of which some sub-ranges are used again.
+inline std::vector<Constant> workload(uint32_t seed, size_t count) {
+  std::mt19937 rng(seed);
+  std::vector<Constant> arrays;
+  std::vector<Constant> out;
+  const char* names[] = {"main", "position", "color", "texcoord", "u_mvp"};
+  for (size_t i = 0; i < count; i++) {
+    switch (rng() % 8) {
+      case 0:
+        out.push_back(value<uint8_t>(rng() % 4));
+        break;
+      case 1:
+        out.push_back(value<uint32_t>(rng() % 64));
+        break;
+      case 2:
+        out.push_back(value<uint64_t>(0x1000 + (rng() % 256) * 0x10));
+        break;
+      case 3:
+        out.push_back(bytes(names[rng() % 5], 1));
+        break;
+      case 4:
+        out.push_back(random(rng, 16 + (rng() % 8) * 8, 8));
+        break;
+      case 5:
+      case 6: {
+        arrays.push_back(random(rng, 256 + (rng() % 16) * 64, 16));
+        out.push_back(arrays.back());
+        break;
+      }
+      case 7:
+        if (!arrays.empty()) {
+          const auto& a = arrays[rng() % arrays.size()];
+          size_t start = (rng() % (a.data.size() / 64)) * 16;
+          size_t size = 64 + (rng() % 8) * 16;
+          out.push_back(range(a, start, size));
+        }
+        break;
+    }
+  }
+  return out;
+}
+
+}  // namespace test
+}  // namespace replay
+}  // namespace runtime
+}  // namespace gapil
+
+#endif  // __GAPIL_RUNTIME_REPLAY_CONSTANTS_H__
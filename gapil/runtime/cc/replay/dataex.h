@@ -15,10 +15,14 @@
 #ifndef __GAPIL_RUNTIME_REPLAY_DATAEX_H__
 #define __GAPIL_RUNTIME_REPLAY_DATAEX_H__
 
+#include "constant_pool.h"
+
 #include "core/cc/id.h"
 #include "core/cc/interval_list.h"
 
+#include <algorithm>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace gapil {
@@ -73,11 +77,39 @@ struct DataEx {
     uint32_t size;
   };
 
+  inline DataEx(arena* a) : constants(a) {}
+
+  // merge_reserved merges the ranges recorded in pending into reserved, in a
+  // single sort and sweep per namespace. The merged ranges take the largest
+  // alignment of the ranges they merge.
+  inline void merge_reserved() {
+    for (auto& it : pending) {
+      if (it.second.empty()) {
+        continue;
+      }
+      reserved[it.first].mergeAll(
+          std::move(it.second), [](MemoryRange& merged,
+                                   const MemoryRange& other) {
+            merged.mAlignment = std::max(merged.mAlignment, other.mAlignment);
+          });
+    }
+    pending.clear();
+  }
+
   StackAllocator<VolatileAddr> allocated;
   std::unordered_map<Namespace, MemoryRanges> reserved;
+
+  // The ranges recorded by gapil_replay_reserve_memory, not yet merged into
+  // reserved by merge_reserved(). Merging each range as it is recorded moves
+  // all the ranges that follow it.
+  std::unordered_map<Namespace, std::vector<MemoryRange>> pending;
+
   std::unordered_map<core::Id, ResourceInfo> resources;
   std::unordered_map<RemapKey, VolatileAddr> remappings;
-  std::unordered_map<core::Id, uint32_t> constant_offsets;
+
+  // The constant data, moved to gapil_replay_data::constants by
+  // gapil_replay_build.
+  ConstantPool constants;
 };
 
 }  // namespace replay
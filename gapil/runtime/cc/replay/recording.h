@@ -0,0 +1,171 @@
+// Copyright (C) 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __GAPIL_RUNTIME_REPLAY_RECORDING_H__
+#define __GAPIL_RUNTIME_REPLAY_RECORDING_H__
+
+#include "asm.h"
+#include "replay.h"
+
+#include "core/memory/arena/cc/arena.h"
+
+#include <random>
+
+namespace gapil {
+namespace runtime {
+namespace replay {
+namespace test {
+
+const uint32_t kNamespaces = 2;
+
+// Records a random replay: reserved memory ranges and an instruction stream
+// using them. Recording with the same seed gives the same replay.
+class Recording {
+ public:
+  Recording(uint32_t seed, size_t instructions) : rng_(seed) {
+    ctx_ = context{};
+    ctx_.arena = reinterpret_cast<arena_t*>(&arena_);
+    ctx_.next_pool_id = &next_pool_id_;
+    data_ = gapil_replay_data{};
+    data_.pointer_alignment = 8;
+    gapil_replay_init_data(&ctx_, &data_);
+    gapil_create_buffer(ctx_.arena, 64, 16, &data_.stream);
+
+    for (uint32_t ns = 0; ns < kNamespaces; ns++) {
+      for (uint64_t i = 0; i < 64; i++) {
+        uint64_t base = 0x10000 * (i + 1) + ns;
+        slice sli = {nullptr, base, base, 0x100 + i, 0x100 + i};
+        gapil_replay_reserve_memory(&ctx_, &data_, &sli, ns, 4);
+      }
+    }
+    gapil_replay_allocate_memory(&ctx_, &data_, 0x1000, 16);
+
+    for (size_t i = 0; i < instructions; i++) {
+      record();
+    }
+  }
+
+  ~Recording() {
+    gapil_destroy_buffer(&data_.stream);
+    gapil_replay_term_data(&ctx_, &data_);
+  }
+
+  void reserve(uint64_t base, uint64_t size, uint32_t ns) {
+    slice sli = {nullptr, base, base, size, size};
+    gapil_replay_reserve_memory(&ctx_, &data_, &sli, ns, 4);
+  }
+
+  void build(uint32_t segments) {
+    gapil_replay_build_segments(&ctx_, &data_, segments);
+  }
+
+  const buffer& opcodes() const { return data_.stream; }
+  const buffer& constants() const { return data_.constants; }
+
+ private:
+  gapil_replay_asm_value value() {
+    auto ty = rng_() % (GAPIL_REPLAY_ASM_TYPE_OBSERVED_POINTER_NAMESPACE_0 +
+                        kNamespaces);
+    uint64_t v = 0;
+    switch (rng_() % 4) {
+      case 0:
+        v = rng_() % 0x100;
+        break;
+      case 1:
+        v = static_cast<uint64_t>(-static_cast<int64_t>(rng_() % 0x100));
+        break;
+      case 2:
+        v = (uint64_t(rng_()) << 32) | rng_();
+        break;
+      default:
+        v = uint64_t(rng_()) << 8;
+        break;
+    }
+    if (ty == GAPIL_REPLAY_ASM_TYPE_FLOAT) {
+      v &= 0xffffffff;
+    } else if (ty >= GAPIL_REPLAY_ASM_TYPE_OBSERVED_POINTER_NAMESPACE_0) {
+      // A pointer into one of the reserved ranges.
+      v = 0x10000 * (rng_() % 64 + 1) + rng_() % 0x100 +
+          (ty - GAPIL_REPLAY_ASM_TYPE_OBSERVED_POINTER_NAMESPACE_0);
+    }
+    return gapil_replay_asm_value{v, gapil_replay_asm_type(ty)};
+  }
+
+  template <typename T>
+  void write(gapil_replay_asm_inst ty, const T& inst) {
+    uint8_t b = ty;
+    gapil_append_buffer(&data_.stream, &b, 1);
+    gapil_append_buffer(&data_.stream, &inst, sizeof(inst));
+  }
+
+  void record() {
+    switch (rng_() % 9) {
+      case 0:
+        write(GAPIL_REPLAY_ASM_INST_CALL,
+              gapil_replay_asm_call{GAPIL_BOOL(rng_() % 2),
+                                    uint8_t(rng_() % 4),
+                                    uint16_t(rng_() % 1000)});
+        break;
+      case 1:
+        write(GAPIL_REPLAY_ASM_INST_PUSH, gapil_replay_asm_push{value()});
+        break;
+      case 2:
+        write(GAPIL_REPLAY_ASM_INST_POP,
+              gapil_replay_asm_pop{uint32_t(rng_() % 8)});
+        break;
+      case 3: {
+        uint32_t v = rng_() % 0x100;
+        auto addr =
+            gapil_replay_add_constant(&ctx_, &data_, &v, sizeof(v), 4);
+        write(GAPIL_REPLAY_ASM_INST_LOAD,
+              gapil_replay_asm_load{
+                  GAPIL_REPLAY_ASM_TYPE_UINT32,
+                  {addr, GAPIL_REPLAY_ASM_TYPE_CONSTANT_POINTER}});
+        break;
+      }
+      case 4:
+        write(GAPIL_REPLAY_ASM_INST_LOAD,
+              gapil_replay_asm_load{GAPIL_REPLAY_ASM_TYPE_UINT64, value()});
+        break;
+      case 5:
+        write(GAPIL_REPLAY_ASM_INST_STORE, gapil_replay_asm_store{value()});
+        break;
+      case 6:
+        write(GAPIL_REPLAY_ASM_INST_POST,
+              gapil_replay_asm_post{value(), rng_() % 0x100});
+        break;
+      case 7:
+        write(GAPIL_REPLAY_ASM_INST_LABEL,
+              gapil_replay_asm_label{uint32_t(rng_() % 0x1000)});
+        break;
+      default:
+        write(GAPIL_REPLAY_ASM_INST_SWITCHTHREAD,
+              gapil_replay_asm_switchthread{uint32_t(rng_() % 4)});
+        break;
+    }
+  }
+
+  std::mt19937 rng_;
+  core::Arena arena_;
+  uint32_t next_pool_id_ = 1;
+  context ctx_;
+  gapil_replay_data data_;
+};
+
+}  // namespace test
+}  // namespace replay
+}  // namespace runtime
+}  // namespace gapil
+
+#endif  // __GAPIL_RUNTIME_REPLAY_RECORDING_H__
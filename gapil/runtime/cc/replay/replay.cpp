@@ -46,6 +46,10 @@ int GAPIL_REPLAY_FORCE_LINK = 0;
 
 namespace {
 
+// The number of ranges recorded by gapil_replay_reserve_memory below which they
+// are not merged before a build.
+const size_t kMinPendingReserved = 4096;
+
 std::unordered_map<std::string, gapil_replay_remap_func*> remap_funcs;
 
 }  // anonymous namespace
@@ -54,7 +58,7 @@ extern "C" {
 
 void gapil_replay_init_data(context* ctx, gapil_replay_data* data) {
   auto arena = reinterpret_cast<core::Arena*>(ctx->arena);
-  data->data_ex = arena->create<DataEx>();
+  data->data_ex = arena->create<DataEx>(ctx->arena);
   data->resources = buffer{.arena = ctx->arena};
   data->constants = buffer{.arena = ctx->arena};
 }
@@ -84,11 +88,14 @@ void gapil_replay_reserve_memory(context* ctx, gapil_replay_data* data,
   auto ex = reinterpret_cast<DataEx*>(data->data_ex);
   auto start = sli->root;
   auto end = sli->base + sli->size;
-  auto& reserved = ex->reserved[ns];
-  for (auto block : reserved.intersect(start, end)) {
-    alignment = std::max(alignment, block.mAlignment);
+  auto& pending = ex->pending[ns];
+  pending.push_back(MemoryRange(start, end, alignment));
+  // Ranges reserved again and again are merged once there are as many of them
+  // as reserved ranges, so that merging stays O(log n) per range.
+  if (pending.size() >= std::max<size_t>(kMinPendingReserved,
+                                         ex->reserved[ns].count())) {
+    ex->merge_reserved();
   }
-  reserved.merge(MemoryRange(start, end, alignment));
 }
 
 uint32_t gapil_replay_add_resource(context* ctx, gapil_replay_data* data,
@@ -119,38 +126,7 @@ uint32_t gapil_replay_add_constant(context* ctx, gapil_replay_data* data,
               size);
   auto ex = reinterpret_cast<DataEx*>(data->data_ex);
 
-  // TODO: Remove. This is only here to match old implementation.
-  alignment = std::max(alignment, data->pointer_alignment);
-
-  // try to find an existing constant in the constants buffer.
-  auto id = core::Id::Hash(buf, size);
-  auto it = ex->constant_offsets.find(id);
-  if (it != ex->constant_offsets.end()) {
-    return it->second;
-  }
-
-  auto& consts = data->constants;
-
-  // grow the constants buffer to fit the data with the specified alignment.
-  auto offset = align<size_t>(consts.size, alignment);
-  auto new_size = offset + size;
-  if (new_size > consts.capacity) {
-    auto arena = reinterpret_cast<core::Arena*>(consts.arena);
-    consts.capacity = std::max<uint32_t>(new_size, consts.capacity * 2);
-    consts.data = (uint8_t*)arena->reallocate(consts.data, consts.capacity,
-                                              consts.alignment);
-  }
-  // clear the alignment padding to 0
-  memset(consts.data + consts.size, 0, offset - consts.size);
-  consts.size = new_size;
-
-  // append the data.
-  memcpy(consts.data + offset, buf, size);
-
-  // add the id to the constants_offsets map so that this data can be shared.
-  ex->constant_offsets[id] = offset;
-
-  return offset;
+  return ex->constants.add(buf, size, alignment);
 }
 
 gapil_replay_remap_func* gapil_replay_get_remap_func(char* api, char* type) {
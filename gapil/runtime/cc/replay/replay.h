@@ -34,7 +34,7 @@ typedef struct gapil_replay_data_t {
   // the replay.
   buffer resources;
 
-  // buffer of constant data used by the replay.
+  // buffer of constant data used by the replay, filled by gapil_replay_build.
   buffer constants;
 
   // function used to emit the call of the current command
@@ -52,9 +52,17 @@ typedef struct gapil_replay_data_t {
 // Runtime API implemented in replay.cpp                                      //
 ////////////////////////////////////////////////////////////////////////////////
 
-// TODO
+// gapil_replay_build builds the replay opcodes, resources and constants from
+// the recorded instruction stream. The opcodes of large streams are generated
+// in parallel.
 void gapil_replay_build(context* ctx, gapil_replay_data* data);
 
+// gapil_replay_build_segments is gapil_replay_build, generating the opcodes of
+// up to segments segments of the instruction stream in parallel. The result
+// does not depend on the number of segments.
+void gapil_replay_build_segments(context* ctx, gapil_replay_data* data,
+                                 uint32_t segments);
+
 // gapil_replay_remap_func is a function that can be used to return a remapping
 // key for the given remapped value at ptr.
 typedef uint64_t gapil_replay_remap_func(context* ctx, void* ptr);
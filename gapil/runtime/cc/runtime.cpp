@@ -31,6 +31,7 @@
 #include <inttypes.h>
 
 #include <cstring>
+#include <vector>
 
 #if 0
 #define DEBUG_PRINT(...) GAPID_DEBUG(__VA_ARGS__)
@@ -234,17 +235,44 @@ void gapil_copy_slice(context* ctx, slice* dst, slice* src) {
 
   uint64_t size = std::min(dst->size, src->size);
 
-  uint64_t dstBufLen = 0;
-  auto dstPtr = gapil_resolve_pool_data(ctx, dst->pool, dst->base, GAPIL_WRITE,
-                                        &dstBufLen);
-  GAPID_ASSERT_MSG(size <= dstBufLen, "gapil_copy_slice overflows dst buffer");
-
-  uint64_t srcBufLen = 0;
-  auto srcPtr = gapil_resolve_pool_data(ctx, src->pool, src->base, GAPIL_READ,
-                                        &srcBufLen);
-  GAPID_ASSERT_MSG(size <= srcBufLen, "gapil_copy_slice overflows src buffer");
-
-  memcpy(dstPtr, srcPtr, size);
+  // When dst starts inside src, copying the ranges front to back would read
+  // bytes already overwritten by the previous ranges. The ranges are then
+  // resolved first and copied back to front.
+  bool backwards = dst->pool == src->pool && dst->base > src->base &&
+                   dst->base < src->base + size;
+  struct Range {
+    void* dst;
+    void* src;
+    uint64_t len;
+  };
+  std::vector<Range> ranges;
+
+  // Resolve and copy the largest ranges the pools can provide at once. Pools
+  // that are not contiguous, such as paged application memory, are copied
+  // range by range.
+  uint64_t offset = 0;
+  while (offset < size) {
+    uint64_t dstBufLen = 0;
+    auto dstPtr = gapil_resolve_pool_data(ctx, dst->pool, dst->base + offset,
+                                          GAPIL_WRITE, &dstBufLen);
+    GAPID_ASSERT_MSG(dstBufLen > 0, "gapil_copy_slice overflows dst buffer");
+
+    uint64_t srcBufLen = 0;
+    auto srcPtr = gapil_resolve_pool_data(ctx, src->pool, src->base + offset,
+                                          GAPIL_READ, &srcBufLen);
+    GAPID_ASSERT_MSG(srcBufLen > 0, "gapil_copy_slice overflows src buffer");
+
+    uint64_t len = std::min(size - offset, std::min(dstBufLen, srcBufLen));
+    if (backwards) {
+      ranges.push_back(Range{dstPtr, srcPtr, len});
+    } else {
+      memmove(dstPtr, srcPtr, len);
+    }
+    offset += len;
+  }
+  for (auto it = ranges.rbegin(); it != ranges.rend(); ++it) {
+    memmove(it->dst, it->src, it->len);
+  }
 }
 
 void gapil_cstring_to_slice(context* ctx, uintptr_t ptr, slice* out) {
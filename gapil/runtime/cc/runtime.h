@@ -39,6 +39,9 @@ typedef uint8_t gapil_char;
 #define GAPIL_MAP_GROW_MULTIPLIER 4
 #define GAPIL_MIN_MAP_SIZE 32
 #define GAPIL_MAP_MAX_CAPACITY 0.8f
+// Number of tombstones an insertion may probe through before the map is
+// rehashed in place.
+#define GAPIL_MAP_MAX_TOMBSTONES 32
 
 // context contains information about the environment in which a function is
 // executing.
@@ -248,6 +251,8 @@ typedef struct gapil_runtime_callbacks_t {
   void (*apply_writes)(context*);
 
   // Returns a pointer to the pool's data starting at pointer for size bytes.
+  // size may be less than the remaining bytes of the pool if the pool's data
+  // is not contiguous.
   void* (*resolve_pool_data)(context*, pool*, uint64_t ptr, gapil_data_access,
                              uint64_t* size);
 
@@ -308,6 +313,7 @@ DECL_GAPIL_CB(void, gapil_free_pool, pool*);
 DECL_GAPIL_CB(void*, gapil_slice_data, context*, slice*, gapil_data_access);
 
 // copies N bytes of data from src to dst, where N is min(dst.size, src.size).
+// The pool data is resolved in as few ranges as resolve_pool_data provides.
 DECL_GAPIL_CB(void, gapil_copy_slice, context*, slice* dst, slice* src);
 
 // allocates a new slice and underlying pool filled with the data of string.
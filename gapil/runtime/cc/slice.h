@@ -78,6 +78,8 @@ class Slice {
   inline const pool_t* pool() const;
 
   // Returns true if the slice contains the specified value.
+  // Slices of integers, enums and pointers are scanned with SIMD instructions
+  // where available.
   inline bool contains(const T& value) const;
 
   // Returns a new subset slice from this slice.
@@ -88,7 +90,8 @@ class Slice {
   inline T& operator[](uint64_t index) const;
 
   // Copies count elements starting at start into the dst Slice starting at
-  // dstStart.
+  // dstStart. Trivially copyable elements are copied with a single memmove.
+  // The source and destination ranges may overlap.
   inline void copy(const Slice<T>& dst, uint64_t start, uint64_t count,
                    uint64_t dstStart) const;
 
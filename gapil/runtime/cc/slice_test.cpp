@@ -13,11 +13,45 @@
 // limitations under the License.
 
 #include "slice.inc"
+#include "string.h"
 
 #include "core/memory/arena/cc/arena.h"
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+enum class Kind : uint16_t { A = 1, B = 0x100, C = 0x101 };
+
+template <typename T>
+void expectContainsEveryPosition() {
+  // Covers the vectorized body and the scalar tail of each length.
+  for (size_t count = 0; count < 40; count++) {
+    std::vector<T> data(count);
+    for (size_t i = 0; i < count; i++) {
+      data[i] = static_cast<T>(i + 1);
+    }
+    gapil::Slice<T> sli(data.data(), count);
+    EXPECT_FALSE(sli.contains(static_cast<T>(0)));
+    EXPECT_FALSE(sli.contains(static_cast<T>(count + 1)));
+    for (size_t i = 0; i < count; i++) {
+      EXPECT_TRUE(sli.contains(static_cast<T>(i + 1)));
+    }
+  }
+}
+
+// Resolves pool data at most 7 bytes at a time.
+void* resolve_chunked(context_t*, pool_t* pool, uint64_t ptr,
+                      gapil_data_access, uint64_t* size) {
+  *size = std::min<uint64_t>(7, pool->size - ptr);
+  return reinterpret_cast<uint8_t*>(pool->buffer) + ptr;
+}
+
+}  // anonymous namespace
+
 TEST(SliceTest, empty) {
   gapil::Slice<uint8_t> sli;
 
@@ -65,3 +99,115 @@ TEST(SliceTest, new_pool) {
 
   EXPECT_EQ(arena.num_allocations(), initial_allocs);  // nothing leaked
 }
+
+TEST(SliceTest, contains) {
+  expectContainsEveryPosition<uint8_t>();
+  expectContainsEveryPosition<int16_t>();
+  expectContainsEveryPosition<uint32_t>();
+  expectContainsEveryPosition<int64_t>();
+  expectContainsEveryPosition<float>();
+
+  // 64-bit values whose halves appear in other elements.
+  uint64_t wide[] = {0x100000002, 0x300000001, 0x200000003};
+  gapil::Slice<uint64_t> wideSli(wide, 3);
+  EXPECT_FALSE(wideSli.contains(0x100000001));
+  EXPECT_FALSE(wideSli.contains(0x200000002));
+  EXPECT_TRUE(wideSli.contains(0x300000001));
+
+  Kind kinds[] = {Kind::A, Kind::B, Kind::A, Kind::B, Kind::A,
+                  Kind::B, Kind::A, Kind::B, Kind::A};
+  gapil::Slice<Kind> kindSli(kinds, 9);
+  EXPECT_TRUE(kindSli.contains(Kind::B));
+  EXPECT_FALSE(kindSli.contains(Kind::C));
+
+  int a = 0, b = 0, c = 0;
+  int* ptrs[] = {&a, &b, &a, &b};
+  gapil::Slice<int*> ptrSli(ptrs, 4);
+  EXPECT_TRUE(ptrSli.contains(&b));
+  EXPECT_FALSE(ptrSli.contains(&c));
+}
+
+TEST(SliceTest, copy) {
+  core::Arena arena;
+  context_t ctx;
+  ctx.arena = reinterpret_cast<arena_t*>(&arena);
+  ctx.next_pool_id = arena.create<uint32_t>(1);
+  auto initial_allocs = arena.num_allocations();
+
+  {
+    uint32_t data[] = {1, 2, 3, 4, 5, 6, 7, 8};
+    gapil::Slice<uint32_t> src(data, 8);
+    auto dst = gapil::Slice<uint32_t>::create(&ctx, 8);
+    src.copy(dst, 2, 4, 1);
+    uint32_t expected[] = {0, 3, 4, 5, 6, 0, 0, 0};
+    EXPECT_TRUE(std::equal(dst.begin(), dst.end(), expected));
+
+    // Overlapping ranges, in both directions.
+    src.copy(src, 0, 6, 2);
+    uint32_t shiftedUp[] = {1, 2, 1, 2, 3, 4, 5, 6};
+    EXPECT_TRUE(std::equal(src.begin(), src.end(), shiftedUp));
+    src.copy(src, 2, 6, 0);
+    uint32_t shiftedDown[] = {1, 2, 3, 4, 5, 6, 5, 6};
+    EXPECT_TRUE(std::equal(src.begin(), src.end(), shiftedDown));
+  }
+  {
+    // Elements that are not trivially copyable keep their references.
+    gapil::String data[4];
+    data[0] = gapil::String(&arena, "a");
+    data[1] = gapil::String(&arena, "b");
+    gapil::Slice<gapil::String> strings(data, 4);
+    strings.copy(strings, 0, 2, 1);
+    EXPECT_STREQ("a", data[0].c_str());
+    EXPECT_STREQ("a", data[1].c_str());
+    EXPECT_STREQ("b", data[2].c_str());
+    EXPECT_STREQ("", data[3].c_str());
+  }
+
+  EXPECT_EQ(arena.num_allocations(), initial_allocs);  // nothing leaked
+}
+
+TEST(SliceTest, copy_slice_ranges) {
+  core::Arena arena;
+  context_t ctx;
+  ctx.arena = reinterpret_cast<arena_t*>(&arena);
+  ctx.next_pool_id = arena.create<uint32_t>(1);
+
+  gapil_runtime_callbacks callbacks = {};
+  callbacks.resolve_pool_data = resolve_chunked;
+  gapil_set_runtime_callbacks(&callbacks);
+
+  {
+    auto src = gapil::Slice<uint8_t>::create(&ctx, 50);
+    auto dst = gapil::Slice<uint8_t>::create(&ctx, 40);
+    for (uint64_t i = 0; i < src.count(); i++) {
+      src[i] = static_cast<uint8_t>(i * 3);
+    }
+    slice_t srcSub = {const_cast<pool_t*>(src.pool()), 0, 5, 45, 45};
+    slice_t dstSub = {const_cast<pool_t*>(dst.pool()), 0, 3, 37, 37};
+    gapil_copy_slice(&ctx, &dstSub, &srcSub);
+    for (uint64_t i = 0; i < dst.count(); i++) {
+      EXPECT_EQ(i < 3 ? 0 : static_cast<uint8_t>((i + 2) * 3), dst[i]);
+    }
+  }
+  // Overlapping copies within a pool, longer than the resolved ranges, in
+  // both directions.
+  for (uint64_t shift : {1, 10}) {
+    auto sli = gapil::Slice<uint8_t>::create(&ctx, 50);
+    for (uint64_t i = 0; i < sli.count(); i++) {
+      sli[i] = static_cast<uint8_t>(i);
+    }
+    slice_t low = {const_cast<pool_t*>(sli.pool()), 0, 2, 30, 30};
+    slice_t high = {const_cast<pool_t*>(sli.pool()), 0, 2 + shift, 30, 30};
+    gapil_copy_slice(&ctx, &high, &low);
+    for (uint64_t i = 0; i < 30; i++) {
+      EXPECT_EQ(2 + i, sli[2 + shift + i]);
+    }
+    gapil_copy_slice(&ctx, &low, &high);
+    for (uint64_t i = 0; i < 30; i++) {
+      EXPECT_EQ(2 + i, sli[2 + i]);
+    }
+  }
+
+  gapil_runtime_callbacks none = {};
+  gapil_set_runtime_callbacks(&none);
+}
@@ -17,6 +17,7 @@
 #include "core/cc/assert.h"
 #include "core/memory/arena/cc/arena.h"
 
+#include <algorithm>
 #include <cstring>
 
 namespace gapil {
@@ -86,11 +87,17 @@ String& String::operator+=(const String& other) {
 }
 
 bool String::operator==(const String& other) const {
-  return gapil_string_compare(ptr, other.ptr) == 0;
+  if (ptr == other.ptr) {
+    return true;
+  }
+  if (ptr->length != other.ptr->length) {
+    return false;
+  }
+  return memcmp(ptr->data, other.ptr->data, ptr->length) == 0;
 }
 
 bool String::operator!=(const String& other) const {
-  return gapil_string_compare(ptr, other.ptr) != 0;
+  return !(*this == other);
 }
 
 bool String::operator<(const String& other) const {
@@ -135,4 +142,75 @@ void String::reference() {
   ptr->ref_count++;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// StringTable                                                                //
+////////////////////////////////////////////////////////////////////////////////
+
+size_t StringTable::KeyHash::operator()(const Key& key) const {
+  // FNV-1a.
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (uint64_t i = 0; i < key.length; i++) {
+    hash = (hash ^ key.data[i]) * 0x100000001b3ULL;
+  }
+  return static_cast<size_t>(hash);
+}
+
+bool StringTable::KeyEqual::operator()(const Key& a, const Key& b) const {
+  return a.length == b.length && memcmp(a.data, b.data, a.length) == 0;
+}
+
+const size_t StringTable::MIN_PURGE_COUNT;
+
+StringTable::StringTable(core::Arena* arena)
+    : mArena(arena), mPurgeCount(MIN_PURGE_COUNT) {}
+
+StringTable::~StringTable() {
+  for (auto it : mStrings) {
+    auto ptr = it.second;
+    ptr->ref_count--;
+    if (ptr->ref_count == 0) {
+      gapil_free_string(ptr);
+    }
+  }
+}
+
+String StringTable::intern(const char* start, const char* end) {
+  return intern(start, end - start);
+}
+
+String StringTable::intern(const char* start, size_t len) {
+  if (len == 0) {
+    return String();
+  }
+  auto it = mStrings.find(Key{reinterpret_cast<const uint8_t*>(start), len});
+  if (it != mStrings.end()) {
+    String str(it->second);
+    str.reference();
+    return str;
+  }
+  if (mStrings.size() >= mPurgeCount) {
+    purge();
+    mPurgeCount = std::max(MIN_PURGE_COUNT, mStrings.size() * 2);
+  }
+  // The table holds the reference made by gapil_make_string.
+  auto ptr = gapil_make_string(reinterpret_cast<arena_t*>(mArena), len,
+                               const_cast<char*>(start));
+  mStrings.emplace(Key{ptr->data, ptr->length}, ptr);
+  String str(ptr);
+  str.reference();
+  return str;
+}
+
+void StringTable::purge() {
+  for (auto it = mStrings.begin(); it != mStrings.end();) {
+    auto ptr = it->second;
+    if (ptr->ref_count == 1) {
+      it = mStrings.erase(it);
+      gapil_free_string(ptr);
+    } else {
+      ++it;
+    }
+  }
+}
+
 }  // namespace gapil
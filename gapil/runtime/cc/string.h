@@ -18,6 +18,7 @@
 #include "runtime.h"
 
 #include <functional>
+#include <unordered_map>
 
 namespace core {
 class Arena;
@@ -52,6 +53,8 @@ class String {
   String& operator+=(const String&);
 
   // Comparison operators. Strings are compared using their underlying data.
+  // Strings sharing the same data, such as the strings of a StringTable,
+  // compare equal without reading it.
   bool operator==(const String& other) const;
   bool operator!=(const String& other) const;
   bool operator<(const String& other) const;
@@ -72,6 +75,8 @@ class String {
   inline core::Arena* arena() const;
 
  private:
+  friend class StringTable;
+
   static string_t EMPTY;
 
   String(string_t*);
@@ -86,6 +91,63 @@ inline core::Arena* String::arena() const {
   return reinterpret_cast<core::Arena*>(ptr->arena);
 }
 
+// StringTable is an intern table of Strings allocated from an arena.
+// Strings made by a StringTable share a single underlying string for each
+// distinct content, so repeatedly observing the same bytes, such as entry
+// point or extension names, allocates them once, and equal interned strings
+// compare by pointer. Strings made by the table are regular Strings, and
+// remain valid after the table is destroyed.
+// The table holds a reference to each of its strings. Strings only referenced
+// by the table are periodically dropped as the table grows.
+// Unlike the arena, a StringTable is not synchronized and must not be used by
+// multiple threads at once.
+class StringTable {
+ public:
+  StringTable(core::Arena* arena);
+  ~StringTable();
+
+  // Returns a string with the given data, sharing the underlying data of a
+  // previously interned string with the same content.
+  String intern(const char* start, size_t len);
+  String intern(const char* start, const char* end);
+
+  // Releases the strings only referenced by the table.
+  void purge();
+
+  // Returns the number of distinct strings held by the table.
+  inline size_t count() const;
+
+  // Returns the arena the strings are allocated from.
+  inline core::Arena* arena() const;
+
+ private:
+  // The minimum number of strings held before the table is purged.
+  static const size_t MIN_PURGE_COUNT = 1024;
+
+  // Key refers to the data of an interned string.
+  struct Key {
+    const uint8_t* data;
+    uint64_t length;
+  };
+  struct KeyHash {
+    size_t operator()(const Key& key) const;
+  };
+  struct KeyEqual {
+    bool operator()(const Key& a, const Key& b) const;
+  };
+
+  StringTable(const StringTable&) = delete;
+  StringTable& operator=(const StringTable&) = delete;
+
+  core::Arena* mArena;
+  std::unordered_map<Key, string_t*, KeyHash, KeyEqual> mStrings;
+  size_t mPurgeCount;
+};
+
+inline size_t StringTable::count() const { return mStrings.size(); }
+
+inline core::Arena* StringTable::arena() const { return mArena; }
+
 }  // namespace gapil
 
 namespace std {
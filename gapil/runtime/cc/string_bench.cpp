@@ -0,0 +1,57 @@
+// Copyright (C) 2017 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// string-bench reports the memory allocated for the strings observed by a
+// GLES capture, with and without interning them in a StringTable. The model
+// is a small vocabulary of shader variable and extension names, observed many
+// times and held by the state.
+
+#include "string.h"
+
+#include "core/memory/arena/cc/arena.h"
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+const int kObservations = 100000;
+const int kNames = 300;
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  std::vector<std::string> names;
+  for (int i = 0; i < kNames; i++) {
+    names.push_back("u_material.layer[" + std::to_string(i % 8) + "].uniform" +
+                    std::to_string(i));
+  }
+
+  core::Arena plainArena;
+  core::Arena internArena;
+  gapil::StringTable table(&internArena);
+  std::vector<gapil::String> plain;
+  std::vector<gapil::String> interned;
+  for (int i = 0; i < kObservations; i++) {
+    const auto& name = names[(i * 7919) % kNames];
+    plain.emplace_back(&plainArena, name.data(), name.size());
+    interned.push_back(table.intern(name.data(), name.size()));
+  }
+  printf("%d strings: %zu bytes allocated, %zu bytes interned\n",
+         kObservations, plainArena.num_bytes_allocated(),
+         internArena.num_bytes_allocated());
+  return 0;
+}
@@ -18,6 +18,11 @@
 
 #include <gtest/gtest.h>
 
+#include <string.h>
+
+#include <string>
+#include <vector>
+
 TEST(StringTest, empty) {
   gapil::String str;
 
@@ -187,3 +192,72 @@ TEST(StringTest, clear) {
   EXPECT_EQ(arena.num_allocations(), 0);
   EXPECT_STREQ(str.c_str(), "");
 }
+
+TEST(StringTest, intern) {
+  core::Arena arena;
+  {
+    gapil::StringTable table(&arena);
+    const char data[] = "glDrawArrays glDrawArrays";
+    auto strA = table.intern(&data[0], 12);
+    auto strB = table.intern(&data[13], &data[25]);
+    auto strC = table.intern("glDrawElements", 14);
+    EXPECT_EQ(arena.num_allocations(), 2);
+    EXPECT_STREQ(strA.c_str(), "glDrawArrays");
+    EXPECT_EQ(strA.c_str(), strB.c_str());  // shared data
+    EXPECT_TRUE(strA == strB);
+    EXPECT_FALSE(strA == strC);
+    EXPECT_TRUE(strA < strC);
+    EXPECT_EQ(strA, gapil::String(&arena, "glDrawArrays"));
+    EXPECT_EQ(table.count(), 2);
+
+    auto empty = table.intern("", size_t(0));
+    EXPECT_EQ(empty, gapil::String());
+    EXPECT_EQ(table.count(), 2);
+  }
+  EXPECT_EQ(arena.num_allocations(), 0);  // nothing leaked
+}
+
+TEST(StringTest, intern_purge) {
+  core::Arena arena;
+  gapil::String kept;
+  {
+    gapil::StringTable table(&arena);
+    kept = table.intern("uniform", 7);
+    table.intern("attribute", 9);
+    EXPECT_EQ(arena.num_allocations(), 2);
+    table.purge();
+    EXPECT_EQ(table.count(), 1);
+    EXPECT_EQ(arena.num_allocations(), 1);
+    EXPECT_EQ(kept.c_str(), table.intern("uniform", 7).c_str());
+  }
+  // Interned strings outlive their table.
+  EXPECT_STREQ(kept.c_str(), "uniform");
+  EXPECT_EQ(arena.num_allocations(), 1);
+  kept.clear();
+  EXPECT_EQ(arena.num_allocations(), 0);
+}
+
+TEST(StringTest, intern_shares_duplicates) {
+  const int kObservations = 30;
+  const char* names[] = {"u_color", "u_texture", "GL_OES_depth24"};
+  const int kNames = sizeof(names) / sizeof(names[0]);
+
+  core::Arena arena;
+  {
+    gapil::StringTable table(&arena);
+    std::vector<gapil::String> first;
+    for (int i = 0; i < kNames; i++) {
+      first.push_back(table.intern(names[i], strlen(names[i])));
+    }
+    std::vector<gapil::String> interned;
+    for (int i = 0; i < kObservations; i++) {
+      // Copy the name so that only equal contents are shared.
+      std::string name = names[i % kNames];
+      interned.push_back(table.intern(name.data(), name.size()));
+      EXPECT_EQ(first[i % kNames].c_str(), interned.back().c_str());
+    }
+    EXPECT_EQ(table.count(), kNames);
+    EXPECT_EQ(arena.num_allocations(), kNames);
+  }
+  EXPECT_EQ(arena.num_allocations(), 0);
+}
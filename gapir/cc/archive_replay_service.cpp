@@ -15,8 +15,12 @@
  */
 
 #include "archive_replay_service.h"
+#include "mapped_payload.h"
+
 #include "core/cc/log.h"
 
+#include <stdio.h>
+
 #include <fstream>
 #include <memory>
 
@@ -24,7 +28,12 @@ namespace gapir {
 
 std::unique_ptr<ReplayService::Payload> ArchiveReplayService::getPayload(
     const std::string&) {
-  std::fstream input(mFilePrefix, std::ios::in | std::ios::binary);
+  auto mapped = MappedPayload::open(mArchiveDir + "/payload.map");
+  if (mapped != nullptr) {
+    return std::move(mapped);
+  }
+  std::fstream input(mArchiveDir + "/payload.bin",
+                     std::ios::in | std::ios::binary);
   std::unique_ptr<replay_service::Payload> payload(new replay_service::Payload);
   payload->ParseFromIstream(&input);
   return std::unique_ptr<Payload>(new Payload(std::move(payload)));
@@ -35,15 +44,20 @@ bool ArchiveReplayService::sendPosts(
   if (mPostbackDir.empty()) {
     return true;
   }
-  std::unique_ptr<replay_service::PostData> postdata(posts->release_to_proto());
-  int nMessages = postdata->post_data_pieces_size();
-  for (int i = 0; i < nMessages; ++i) {
-    uint64_t id = postdata->post_data_pieces(i).id();
-    std::string data = postdata->post_data_pieces(i).data();
-    std::string path = mPostbackDir + "/" + std::to_string(id) + ".bin";
-    std::fstream output(path, std::ios::out | std::ios::binary);
-    output.write(data.data(), data.size());
+  if (mPostbacks == nullptr) {
+    // Archive::write keeps the existing record of an id, so the postbacks of
+    // a previous run are removed rather than appended to.
+    auto archive = mPostbackDir + "/postbacks";
+    remove((archive + ".index").c_str());
+    remove((archive + ".data").c_str());
+    mPostbacks.reset(new core::Archive(archive));
+  }
+  bool ok = true;
+  for (size_t i = 0; i < posts->piece_count(); ++i) {
+    ok = mPostbacks->write(std::to_string(posts->piece_id(i)),
+                           posts->piece_data(i), posts->piece_size(i)) &&
+         ok;
   }
-  return true;
+  return ok;
 }
 }  // namespace gapir
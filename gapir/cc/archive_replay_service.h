@@ -31,14 +31,20 @@ namespace gapir {
 // It represents an local on-disk source of replay payload data.
 class ArchiveReplayService : public ReplayService {
  public:
-  ArchiveReplayService(const std::string& fileprefix,
+  // Creates a replay service reading the payload from the archive directory
+  // archiveDir. Post data is written to an archive in postbackDir, or dropped
+  // if postbackDir is empty.
+  ArchiveReplayService(const std::string& archiveDir,
                        const std::string& postbackDir)
-      : mFilePrefix(fileprefix), mPostbackDir(postbackDir) {}
+      : mArchiveDir(archiveDir), mPostbackDir(postbackDir) {}
 
-  // Read payload from disk.
+  // Read payload from disk. The memory-mapped payload.map is used if present,
+  // otherwise payload.bin is parsed.
   std::unique_ptr<Payload> getPayload(const std::string& _payload) override;
 
-  // Send post data to local on disk file.
+  // Writes post data to the postbacks.{index,data} archive in the postback
+  // directory, keyed by post ID. The archive left by a previous run is
+  // replaced on the first post.
   bool sendPosts(std::unique_ptr<Posts> posts) override;
 
   // We are reading from disk, so the following methods are not implemented.
@@ -67,8 +73,11 @@ class ArchiveReplayService : public ReplayService {
   }
 
  private:
-  std::string mFilePrefix;
+  std::string mArchiveDir;
   std::string mPostbackDir;
+
+  // The archive post data is written to. Recreated on the first post.
+  std::unique_ptr<core::Archive> mPostbacks;
 };
 
 }  // namespace gapir
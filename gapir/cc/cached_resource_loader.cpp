@@ -17,6 +17,8 @@
 #include "cached_resource_loader.h"
 #include "resource.h"
 
+#include "core/cc/trace.h"
+
 #include <utility>
 #include <vector>
 
@@ -26,6 +28,7 @@ bool CachedResourceLoader::loadBatch(const ResourceLoadingBatch& bat) {
   if (bat.size() == 0) {
     return true;
   }
+  GAPID_TRACE_NAME("CachedResourceLoader::loadBatch");
   auto res = fetch(bat.resources().data(), bat.resources().size());
   if (res == nullptr) {
     return false;
@@ -49,6 +52,7 @@ bool CachedResourceLoader::loadBatch(const ResourceLoadingBatch& bat) {
 
 bool CachedResourceLoader::load(const Resource* resources, size_t count,
                                 void* target, size_t targetSize) {
+  GAPID_TRACE_NAME("CachedResourceLoader::load");
   size_t totalSize = 0;
   for (size_t i = 0; i < count; i++) {
     totalSize += resources[i].size;
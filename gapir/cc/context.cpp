@@ -143,7 +143,8 @@ bool Context::interpret(bool cleanup) {
   }
   mInterpreter->setApiRequestCallback(std::move(callback));
   auto instAndCount = mReplayRequest->getInstructionList();
-  auto res = mInterpreter->run(instAndCount.first, instAndCount.second) &&
+  auto res = mInterpreter->run(instAndCount.first, instAndCount.second,
+                               &mReplayRequest->getVerifiedBlocks()) &&
              mPostBuffer->flush();
   if (cleanup) {
     mInterpreter.reset(nullptr);
@@ -21,51 +21,115 @@
 
 #include <stdint.h>
 #include <functional>
-#include <unordered_map>
+#include <memory>
+#include <vector>
 
 namespace gapir {
 
 class Stack;
 
 // FunctionTable provides a mapping of function id to a VM function.
+//
+// The function ids of an API are dense, so the table is a flat array indexed
+// by the id, split into pages that are only allocated when a function is
+// inserted into them. A lookup is two array reads and a call is a plain
+// indirect call, with no hashing or type-erasure on the way.
 class FunctionTable {
  public:
   // General signature for functions callable by the interpreter with a function
-  // call instruction. The first argument is a pointer to the stack of the
-  // Virtual Machine and the second argument is true if the caller expect the
-  // return value of the function to be pushed to the stack. The function should
-  // return true if the function call was successful, false otherwise.
-  typedef std::function<bool(uint32_t, Stack*, bool)> Function;
+  // call instruction. The first argument is the context pointer given to
+  // insert(), the second one is the current label, the third one is a pointer
+  // to the stack of the Virtual Machine and the last argument is true if the
+  // caller expect the return value of the function to be pushed to the stack.
+  // The function should return true if the function call was successful, false
+  // otherwise.
+  typedef bool (*Function)(void* context, uint32_t label, Stack* stack,
+                           bool pushReturn);
+
+  // Signature for functions that carry their own state. These are stored in
+  // the table and called through a trampoline, so they cost one extra
+  // indirection compared to a Function.
+  typedef std::function<bool(uint32_t, Stack*, bool)> Closure;
 
   // The function identifier. These are part of the protocol between the server
   // and the replay system, and so must remain consistent.
   typedef uint16_t Id;
 
-  // Inserts a function into the table.
-  inline void insert(Id id, Function func);
+  // A function of the table bound to its context.
+  struct Entry {
+    Function function;
+    void* context;
+
+    inline bool operator()(uint32_t label, Stack* stack,
+                           bool pushReturn) const {
+      return function(context, label, stack, pushReturn);
+    }
+  };
+
+  // Function trampoline calling the member function F of the object passed as
+  // context.
+  template <typename T, bool (T::*F)(uint32_t, Stack*, bool)>
+  static bool method(void* context, uint32_t label, Stack* stack,
+                     bool pushReturn) {
+    return (static_cast<T*>(context)->*F)(label, stack, pushReturn);
+  }
+
+  // Inserts a function into the table. context is passed back to the function
+  // on every call.
+  inline void insert(Id id, Function func, void* context = nullptr);
+
+  // Inserts a closure into the table. The table keeps the closure alive.
+  inline void insert(Id id, Closure func);
 
   // Returns a function from the table, or nullptr if there is no function with
   // the specified identifier.
-  inline Function* lookup(Id id);
+  inline const Entry* lookup(Id id) const;
 
  private:
-  // Map of the supported function ids to the actual function implementations
-  std::unordered_map<Id, Function> mFunctions;
+  enum : uint32_t {
+    PAGE_BITS = 8,
+    PAGE_SIZE = 1U << PAGE_BITS,
+    PAGE_MASK = PAGE_SIZE - 1,
+    PAGE_COUNT = 0x10000U >> PAGE_BITS,
+  };
+
+  static bool callClosure(void* context, uint32_t label, Stack* stack,
+                          bool pushReturn) {
+    return (*static_cast<Closure*>(context))(label, stack, pushReturn);
+  }
+
+  // The pages of the table, indexed by the high bits of the function id.
+  // Unused slots have a null function.
+  std::unique_ptr<Entry[]> mPages[PAGE_COUNT];
+
+  // The closures inserted into the table, referenced by the entry contexts.
+  std::vector<std::unique_ptr<Closure>> mClosures;
 };
 
-inline FunctionTable::Function* FunctionTable::lookup(Id id) {
-  auto func = mFunctions.find(id);
-  if (func == mFunctions.end()) {
+inline const FunctionTable::Entry* FunctionTable::lookup(Id id) const {
+  const Entry* page = mPages[id >> PAGE_BITS].get();
+  if (page == nullptr || page[id & PAGE_MASK].function == nullptr) {
     return nullptr;
   }
-  return &func->second;
+  return &page[id & PAGE_MASK];
 }
 
-inline void FunctionTable::insert(Id id, Function func) {
-  if (mFunctions.count(id) != 0) {
+inline void FunctionTable::insert(Id id, Function func, void* context) {
+  std::unique_ptr<Entry[]>& page = mPages[id >> PAGE_BITS];
+  if (!page) {
+    page.reset(new Entry[PAGE_SIZE]());
+  }
+  Entry& entry = page[id & PAGE_MASK];
+  if (entry.function != nullptr) {
     GAPID_FATAL("Duplicate functions inserted into table");
   }
-  mFunctions[id] = func;
+  entry.function = func;
+  entry.context = context;
+}
+
+inline void FunctionTable::insert(Id id, Closure func) {
+  mClosures.emplace_back(new Closure(std::move(func)));
+  insert(id, &callClosure, mClosures.back().get());
 }
 
 }  // namespace gapir
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// function-table-bench compares the cost of dispatching a call through the
+// FunctionTable with the std::unordered_map of std::function it replaced.
+
+#include "function_table.h"
+
+#include "core/cc/timer.h"
+
+#include <stdio.h>
+
+#include <unordered_map>
+
+using gapir::FunctionTable;
+using gapir::Stack;
+
+namespace {
+
+const uint32_t kFunctions = 512;
+const uint32_t kCalls = 1 << 22;
+
+// Counts the calls made to it through the function table context.
+bool countCall(void* context, uint32_t, Stack*, bool) {
+  ++*static_cast<uint32_t*>(context);
+  return true;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char** argv) {
+  uint32_t mapCalls = 0;
+  std::unordered_map<FunctionTable::Id, FunctionTable::Closure> map;
+  for (uint32_t i = 0; i < kFunctions; i++) {
+    map[i] = [&mapCalls](uint32_t, Stack*, bool) {
+      ++mapCalls;
+      return true;
+    };
+  }
+
+  uint32_t tableCalls = 0;
+  FunctionTable table;
+  for (uint32_t i = 0; i < kFunctions; i++) {
+    table.insert(i, &countCall, &tableCalls);
+  }
+
+  uint64_t start = core::GetNanoseconds();
+  for (uint32_t i = 0; i < kCalls; i++) {
+    auto func = map.find((i * 7) % kFunctions);
+    func->second(i, nullptr, false);
+  }
+  uint64_t mapTime = core::GetNanoseconds() - start;
+
+  start = core::GetNanoseconds();
+  for (uint32_t i = 0; i < kCalls; i++) {
+    auto func = table.lookup((i * 7) % kFunctions);
+    (*func)(i, nullptr, false);
+  }
+  uint64_t tableTime = core::GetNanoseconds() - start;
+
+  if (mapCalls != kCalls || tableCalls != kCalls) {
+    fprintf(stderr, "Expected %u calls, got %u and %u\n", kCalls, mapCalls,
+            tableCalls);
+    return 1;
+  }
+  printf("unordered_map<std::function>: %.2f ns/call\n",
+         static_cast<double>(mapTime) / kCalls);
+  printf("FunctionTable:                %.2f ns/call\n",
+         static_cast<double>(tableTime) / kCalls);
+  return 0;
+}
@@ -19,6 +19,7 @@
 
 #include "core/cc/crash_handler.h"
 #include "core/cc/log.h"
+#include "core/cc/trace.h"
 
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
@@ -56,6 +57,57 @@ inline bool sum(Stack& stack, uint32_t count) {
   return stack.isValid();
 }
 
+// Returns the value pushed by a PUSH_I instruction of the given type and data.
+Stack::BaseValue pushIValue(BaseType type, Stack::BaseValue data) {
+  switch (type) {
+    // Sign extension for signed types
+    case BaseType::Int32:
+    case BaseType::Int64:
+      if (data & 0x80000) {
+        data |= 0xfffffffffff00000ULL;
+      }
+      break;
+    // Shifting the value into the exponent for floating point types
+    case BaseType::Float:
+      data <<= 23;
+      break;
+    case BaseType::Double:
+      data <<= 52;
+      break;
+    default:
+      break;
+  }
+  return data;
+}
+
+// Returns value of the given type extended with the data of an EXTEND
+// instruction.
+Stack::BaseValue extendValue(BaseType type, Stack::BaseValue value,
+                             uint32_t data) {
+  switch (type) {
+    // Masking out the mantissa end extending it with the new bits for floating
+    // point types
+    case BaseType::Float: {
+      value |= (data & 0x007fffffULL);
+      break;
+    }
+    case BaseType::Double: {
+      uint64_t exponent = value & 0xfff0000000000000ULL;
+      value <<= 26;
+      value |= data;
+      value &= 0x000fffffffffffffULL;
+      value |= exponent;
+      break;
+    }
+    // Extending the value with 26 new LSB
+    default: {
+      value = (value << 26) | data;
+      break;
+    }
+  }
+  return value;
+}
+
 }  // anonymous namespace
 
 Interpreter::Interpreter(core::CrashHandler& crash_handler,
@@ -69,8 +121,15 @@ Interpreter::Interpreter(core::CrashHandler& crash_handler,
       mInstructions(nullptr),
       mInstructionCount(0),
       mCurrentInstruction(0),
+      mNextBlock(nullptr),
+      mBlocksEnd(nullptr),
       mNextThread(0),
       mLabel(0) {
+  static_assert(API_COUNT == (API_INDEX_MASK >> API_BIT_SHIFT) + 1,
+                "API_COUNT must cover every encodable api index");
+  for (auto& functions : mRendererFunctions) {
+    functions = nullptr;
+  }
   registerBuiltin(GLOBAL_INDEX, PRINT_STACK_FUNCTION_ID,
                   [](uint32_t, Stack* stack, bool) {
                     stack->printStack();
@@ -83,31 +142,43 @@ void Interpreter::setApiRequestCallback(ApiRequestCallback callback) {
 }
 
 void Interpreter::registerBuiltin(uint8_t api, FunctionTable::Id id,
-                                  FunctionTable::Function func) {
-  mBuiltins[api].insert(id, func);
+                                  FunctionTable::Closure func) {
+  GAPID_ASSERT(api < API_COUNT);
+  mBuiltins[api].insert(id, std::move(func));
+}
+
+void Interpreter::registerBuiltin(uint8_t api, FunctionTable::Id id,
+                                  FunctionTable::Function func,
+                                  void* context) {
+  GAPID_ASSERT(api < API_COUNT);
+  mBuiltins[api].insert(id, func, context);
 }
 
 void Interpreter::setRendererFunctions(uint8_t api,
                                        FunctionTable* functionTable) {
-  if (functionTable != nullptr) {
-    mRendererFunctions[api] = functionTable;
-  } else {
-    mRendererFunctions.erase(api);
-  }
+  GAPID_ASSERT(api < API_COUNT);
+  mRendererFunctions[api] = functionTable;
 }
 
 void Interpreter::resetInstructions() {
   mInstructions = nullptr;
   mInstructionCount = 0;
   mCurrentInstruction = 0;
+  mNextBlock = nullptr;
+  mBlocksEnd = nullptr;
 }
 
-bool Interpreter::run(const uint32_t* instructions, uint32_t count) {
+bool Interpreter::run(const uint32_t* instructions, uint32_t count,
+                      const std::vector<StackVerifier::Block>* verifiedBlocks) {
   GAPID_ASSERT(mInstructions == nullptr);
   GAPID_ASSERT(mInstructionCount == 0);
   GAPID_ASSERT(mCurrentInstruction == 0);
   mInstructions = instructions;
   mInstructionCount = count;
+  if (verifiedBlocks != nullptr && !verifiedBlocks->empty()) {
+    mNextBlock = verifiedBlocks->data();
+    mBlocksEnd = mNextBlock + verifiedBlocks->size();
+  }
   // Reset the promise here, otherwise this may throw.
   mExecResult = std::promise<Result>();
   auto unregisterHandler = mCrashHandler.registerHandler(
@@ -122,8 +193,22 @@ bool Interpreter::run(const uint32_t* instructions, uint32_t count) {
 }
 
 void Interpreter::exec() {
+  GAPID_TRACE_NAME("Interpreter::exec");
   for (; mCurrentInstruction < mInstructionCount; mCurrentInstruction++) {
-    switch (interpret(mInstructions[mCurrentInstruction])) {
+    Result result;
+    if (mNextBlock != mBlocksEnd &&
+        mNextBlock->begin == mCurrentInstruction) {
+      const StackVerifier::Block& block = *mNextBlock++;
+      // The block is only proven for a valid stack with room for its growth.
+      if (mStack.isValid() && mStack.available() >= block.growth) {
+        result = interpretBlock(block);
+      } else {
+        result = interpret(mInstructions[mCurrentInstruction]);
+      }
+    } else {
+      result = interpret(mInstructions[mCurrentInstruction]);
+    }
+    switch (result) {
       case SUCCESS:
         break;
       case ERROR:
@@ -162,15 +247,17 @@ bool Interpreter::registerApi(uint8_t api) {
 }
 
 Interpreter::Result Interpreter::call(uint32_t opcode) {
+  GAPID_TRACE_NAME("Interpreter::call");
   auto id = opcode & FUNCTION_ID_MASK;
   auto api = (opcode & API_INDEX_MASK) >> API_BIT_SHIFT;
   auto func = mBuiltins[api].lookup(id);
   auto label = getLabel();
   if (func == nullptr) {
-    if (mRendererFunctions.count(api) > 0) {
+    if (mRendererFunctions[api] != nullptr) {
       func = mRendererFunctions[api]->lookup(id);
     } else {
-      if (apiRequestCallback && apiRequestCallback(this, api)) {
+      if (apiRequestCallback && apiRequestCallback(this, api) &&
+          mRendererFunctions[api] != nullptr) {
         func = mRendererFunctions[api]->lookup(id);
       } else {
         GAPID_WARNING("[%u]Error setting up renderer functions for api: %u",
@@ -196,26 +283,7 @@ Interpreter::Result Interpreter::pushI(uint32_t opcode) {
     GAPID_WARNING("Error: pushI basic type invalid %d", (int)type);
     return ERROR;
   }
-  Stack::BaseValue data = extract20bitData(opcode);
-  switch (type) {
-    // Sign extension for signed types
-    case BaseType::Int32:
-    case BaseType::Int64:
-      if (data & 0x80000) {
-        data |= 0xfffffffffff00000ULL;
-      }
-      break;
-    // Shifting the value into the exponent for floating point types
-    case BaseType::Float:
-      data <<= 23;
-      break;
-    case BaseType::Double:
-      data <<= 52;
-      break;
-    default:
-      break;
-  }
-  mStack.pushValue(type, data);
+  mStack.pushValue(type, pushIValue(type, extract20bitData(opcode)));
   return mStack.isValid() ? SUCCESS : ERROR;
 }
 
@@ -305,6 +373,14 @@ Interpreter::Result Interpreter::copy(uint32_t opcode) {
   uint32_t count = extract26bitData(opcode);
   void* target = mStack.pop<void*>();
   const void* source = mStack.pop<const void*>();
+  if (!mStack.isValid()) {
+    return ERROR;
+  }
+  return copyMemory(target, source, count);
+}
+
+Interpreter::Result Interpreter::copyMemory(void* target, const void* source,
+                                            uint32_t count) {
   if (!isWriteAddress(target)) {
     GAPID_WARNING("Error: copy target is invalid %p %" PRIu32, target, count);
     return ERROR;
@@ -322,7 +398,7 @@ Interpreter::Result Interpreter::copy(uint32_t opcode) {
     return ERROR;
   }
   memcpy(target, source, count);
-  return mStack.isValid() ? SUCCESS : ERROR;
+  return SUCCESS;
 }
 
 Interpreter::Result Interpreter::clone(uint32_t opcode) {
@@ -334,6 +410,14 @@ Interpreter::Result Interpreter::strcpy(uint32_t opcode) {
   uint32_t count = extract26bitData(opcode);
   char* target = mStack.pop<char*>();
   const char* source = mStack.pop<const char*>();
+  if (!mStack.isValid()) {
+    return ERROR;
+  }
+  return copyString(target, source, count);
+}
+
+Interpreter::Result Interpreter::copyString(char* target, const char* source,
+                                            uint32_t count) {
   // Requires that the whole count is available, even if source is shorter.
   if (!isWriteAddress(target)) {
     GAPID_WARNING("Error: copy target is invalid %p %d", target, count);
@@ -362,35 +446,14 @@ Interpreter::Result Interpreter::strcpy(uint32_t opcode) {
   for (; i < count; i++) {
     target[i] = 0;
   }
-  return mStack.isValid() ? SUCCESS : ERROR;
+  return SUCCESS;
 }
 
 Interpreter::Result Interpreter::extend(uint32_t opcode) {
   uint32_t data = extract26bitData(opcode);
   auto type = mStack.getTopType();
   auto value = mStack.popBaseValue();
-  switch (type) {
-    // Masking out the mantissa end extending it with the new bits for floating
-    // point types
-    case BaseType::Float: {
-      value |= (data & 0x007fffffULL);
-      break;
-    }
-    case BaseType::Double: {
-      uint64_t exponent = value & 0xfff0000000000000ULL;
-      value <<= 26;
-      value |= data;
-      value &= 0x000fffffffffffffULL;
-      value |= exponent;
-      break;
-    }
-    // Extending the value with 26 new LSB
-    default: {
-      value = (value << 26) | data;
-      break;
-    }
-  }
-  mStack.pushValue(type, value);
+  mStack.pushValue(type, extendValue(type, value, data));
   return mStack.isValid() ? SUCCESS : ERROR;
 }
 
@@ -537,6 +600,127 @@ Interpreter::Result Interpreter::interpret(uint32_t opcode) {
   }
 }
 
+Interpreter::Result Interpreter::interpretBlock(
+    const StackVerifier::Block& block) {
+  for (mCurrentInstruction = block.begin; mCurrentInstruction < block.end;
+       mCurrentInstruction++) {
+    Result result = interpretVerified(mInstructions[mCurrentInstruction]);
+    if (result != SUCCESS) {
+      return result;
+    }
+  }
+  mCurrentInstruction = block.end - 1;
+  return SUCCESS;
+}
+
+Interpreter::Result Interpreter::interpretVerified(uint32_t opcode) {
+  InstructionCode code =
+      static_cast<InstructionCode>(opcode >> OPCODE_BIT_SHIFT);
+  switch (code) {
+    case InstructionCode::PUSH_I: {
+      DEBUG_OPCODE_TY_20("PUSH_I", opcode);
+      BaseType type = extractType(opcode);
+      mStack.pushValueUnchecked(type,
+                                pushIValue(type, extract20bitData(opcode)));
+      return SUCCESS;
+    }
+    case InstructionCode::LOAD_C: {
+      DEBUG_OPCODE_TY_20("LOAD_C", opcode);
+      BaseType type = extractType(opcode);
+      const void* address =
+          mMemoryManager->constantToAbsolute(extract20bitData(opcode));
+      if (!isConstantAddressForType(address, type)) {
+        GAPID_WARNING("Error: loadC not constant address %p", address);
+        return ERROR;
+      }
+      mStack.pushFromUnchecked(type, address);
+      return SUCCESS;
+    }
+    case InstructionCode::LOAD_V: {
+      DEBUG_OPCODE_TY_20("LOAD_V", opcode);
+      BaseType type = extractType(opcode);
+      const void* address =
+          mMemoryManager->volatileToAbsolute(extract20bitData(opcode));
+      if (!isVolatileAddressForType(address, type)) {
+        GAPID_WARNING("Error: loadV not volatile address %p", address);
+        return ERROR;
+      }
+      mStack.pushFromUnchecked(type, address);
+      return SUCCESS;
+    }
+    case InstructionCode::LOAD: {
+      DEBUG_OPCODE_TY_20("LOAD", opcode);
+      const void* address = mStack.popPointerUnchecked();
+      if (!isReadAddress(address)) {
+        GAPID_WARNING("Error: load not readable address %p", address);
+        return ERROR;
+      }
+      mStack.pushFromUnchecked(extractType(opcode), address);
+      return SUCCESS;
+    }
+    case InstructionCode::POP:
+      DEBUG_OPCODE_26("POP", opcode);
+      mStack.discardUnchecked(extract26bitData(opcode));
+      return SUCCESS;
+    case InstructionCode::STORE_V: {
+      DEBUG_OPCODE_26("STORE_V", opcode);
+      void* address =
+          mMemoryManager->volatileToAbsolute(extract26bitData(opcode));
+      if (!isVolatileAddressForType(address, mStack.getTopTypeUnchecked())) {
+        GAPID_WARNING("Error: storeV not volatile address %p", address);
+        return ERROR;
+      }
+      mStack.popToUnchecked(address);
+      return mStack.isValid() ? SUCCESS : ERROR;
+    }
+    case InstructionCode::STORE: {
+      DEBUG_OPCODE("STORE", opcode);
+      void* address = const_cast<void*>(mStack.popPointerUnchecked());
+      if (!isWriteAddress(address)) {
+        GAPID_WARNING("Error: store not write address %p", address);
+        return ERROR;
+      }
+      mStack.popToUnchecked(address);
+      return mStack.isValid() ? SUCCESS : ERROR;
+    }
+    case InstructionCode::COPY: {
+      DEBUG_OPCODE_26("COPY", opcode);
+      void* target = const_cast<void*>(mStack.popPointerUnchecked());
+      const void* source = mStack.popPointerUnchecked();
+      if (!mStack.isValid()) {
+        return ERROR;
+      }
+      return copyMemory(target, source, extract26bitData(opcode));
+    }
+    case InstructionCode::CLONE:
+      DEBUG_OPCODE_26("CLONE", opcode);
+      mStack.cloneUnchecked(extract26bitData(opcode));
+      return SUCCESS;
+    case InstructionCode::STRCPY: {
+      DEBUG_OPCODE_26("STRCPY", opcode);
+      char* target =
+          static_cast<char*>(const_cast<void*>(mStack.popPointerUnchecked()));
+      const char* source =
+          static_cast<const char*>(mStack.popPointerUnchecked());
+      if (!mStack.isValid()) {
+        return ERROR;
+      }
+      return copyString(target, source, extract26bitData(opcode));
+    }
+    case InstructionCode::EXTEND: {
+      DEBUG_OPCODE_26("EXTEND", opcode);
+      BaseType type = mStack.getTopTypeUnchecked();
+      Stack::BaseValue value = mStack.popBaseValueUnchecked();
+      mStack.pushValueUnchecked(
+          type, extendValue(type, value, extract26bitData(opcode)));
+      return SUCCESS;
+    }
+    default:
+      // ADD and LABEL are cheap enough to share the checked implementation.
+      return interpret(opcode);
+  }
+}
+
 #undef DEBUG_OPCODE
 
 }  // namespace gapir
@@ -19,6 +19,7 @@
 
 #include "function_table.h"
 #include "stack.h"
+#include "stack_verifier.h"
 #include "thread_pool.h"
 
 #include "gapir/replay_service/vm.h"
@@ -29,8 +30,8 @@
 
 #include <functional>
 #include <future>
-#include <unordered_map>
 #include <utility>
+#include <vector>
 
 namespace gapir {
 
@@ -52,6 +53,8 @@ class Interpreter {
   enum : uint32_t {
     // The API index to use for global builtin functions.
     GLOBAL_INDEX = 0,
+    // The number of API indices that can be encoded in a call instruction.
+    API_COUNT = 16,
   };
 
   // Function ids for implementation specific functions and special debugging
@@ -65,6 +68,19 @@ class Interpreter {
     // 0xff81..0xffff reserved for synthetic functions
   };
 
+  // The bit layout of an instruction.
+  enum : uint32_t {
+    TYPE_MASK = 0x03f00000U,
+    FUNCTION_ID_MASK = 0x0000ffffU,
+    API_INDEX_MASK = 0x000f0000U,
+    PUSH_RETURN_MASK = 0x01000000U,
+    DATA_MASK20 = 0x000fffffU,
+    DATA_MASK26 = 0x03ffffffU,
+    API_BIT_SHIFT = 16,
+    TYPE_BIT_SHIFT = 20,
+    OPCODE_BIT_SHIFT = 26,
+  };
+
   // Creates a new interpreter with the specified memory manager (for resolving
   // memory addresses) and with the specified maximum stack size
   Interpreter(core::CrashHandler& crash_handler,
@@ -73,15 +89,20 @@ class Interpreter {
   void setApiRequestCallback(ApiRequestCallback callback);
 
   // Registers a builtin function to the builtin function table.
-  void registerBuiltin(uint8_t api, FunctionTable::Id, FunctionTable::Function);
+  void registerBuiltin(uint8_t api, FunctionTable::Id, FunctionTable::Closure);
+  void registerBuiltin(uint8_t api, FunctionTable::Id, FunctionTable::Function,
+                       void* context);
 
   // Assigns the function table as the renderer functions to use for the given
   // api.
   void setRendererFunctions(uint8_t api, FunctionTable* functionTable);
 
   // Runs the interpreter on the instruction list specified by the pointer and
-  // by its size.
-  bool run(const uint32_t* instructions, uint32_t count);
+  // by its size. If verifiedBlocks is not null, it must be the result of
+  // StackVerifier::verify() for the instruction list, and the verified blocks
+  // are executed without the stack checks.
+  bool run(const uint32_t* instructions, uint32_t count,
+           const std::vector<StackVerifier::Block>* verifiedBlocks = nullptr);
 
   // Resets the interpreter to be able to continue running instructions
   // from this point.
@@ -96,18 +117,6 @@ class Interpreter {
  private:
   void exec();
 
-  enum : uint32_t {
-    TYPE_MASK = 0x03f00000U,
-    FUNCTION_ID_MASK = 0x0000ffffU,
-    API_INDEX_MASK = 0x000f0000U,
-    PUSH_RETURN_MASK = 0x01000000U,
-    DATA_MASK20 = 0x000fffffU,
-    DATA_MASK26 = 0x03ffffffU,
-    API_BIT_SHIFT = 16,
-    TYPE_BIT_SHIFT = 20,
-    OPCODE_BIT_SHIFT = 26,
-  };
-
   enum Result {
     SUCCESS,
     ERROR,
@@ -158,17 +167,32 @@ class Interpreter {
   // Interpret one specific opcode.
   Result interpret(uint32_t opcode);
 
+  // Interpret one opcode of a verified block, skipping the stack checks.
+  Result interpretVerified(uint32_t opcode);
+
+  // Interprets the verified block starting at the current instruction. On
+  // return the current instruction is the last one interpreted.
+  Result interpretBlock(const StackVerifier::Block& block);
+
+  // Copies count bytes from source to target after checking both addresses.
+  Result copyMemory(void* target, const void* source, uint32_t count);
+
+  // Copies the string from source to target after checking both addresses.
+  // Exactly count bytes are written to target.
+  Result copyString(char* target, const char* source, uint32_t count);
+
   // The crash handler used for catching and reporting crashes.
   core::CrashHandler& mCrashHandler;
 
   // Memory manager which managing the memory used during the interpretation
   const MemoryManager* mMemoryManager;
 
-  // The builtin functions.
-  std::unordered_map<uint8_t, FunctionTable> mBuiltins;
+  // The builtin functions, indexed by api.
+  FunctionTable mBuiltins[API_COUNT];
 
-  // The current renderer functions.
-  std::unordered_map<uint8_t, FunctionTable*> mRendererFunctions;
+  // The current renderer functions, indexed by api. nullptr if the api has
+  // not been registered.
+  FunctionTable* mRendererFunctions[API_COUNT];
 
   // Callback function for requesting renderer functions for an unknown api.
   ApiRequestCallback apiRequestCallback;
@@ -185,6 +209,11 @@ class Interpreter {
   // The index of the current instruction.
   uint32_t mCurrentInstruction;
 
+  // The next verified block to be reached, and the end of the verified blocks
+  // of the instruction list. Both nullptr if the list was not verified.
+  const StackVerifier::Block* mNextBlock;
+  const StackVerifier::Block* mBlocksEnd;
+
   // The next thread execution should continue on.
   uint32_t mNextThread;
 
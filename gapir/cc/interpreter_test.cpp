@@ -19,6 +19,8 @@
 
 #include <gtest/gtest.h>
 
+#include <string.h>
+
 #include <memory>
 #include <vector>
 
@@ -38,6 +40,12 @@ struct CheckTopOfStack {
   }
 };
 
+// Counts the calls made to it through the function table context.
+bool countCall(void* context, uint32_t, Stack*, bool) {
+  ++*static_cast<uint32_t*>(context);
+  return true;
+}
+
 class InterpreterTest : public ::testing::Test {
  protected:
   virtual void SetUp() {
@@ -407,5 +415,132 @@ TEST_F(InterpreterTest, UnknownApi) {
   EXPECT_FALSE(res);
 }
 
+TEST_F(InterpreterTest, RendererFunctionContext) {
+  uint32_t callCount = 0;
+  FunctionTable functions;
+  functions.insert(0x123, &countCall, &callCount);
+  mInterpreter->setRendererFunctions(1, &functions);
+
+  std::vector<uint32_t> instructions{
+      instruction(Interpreter::InstructionCode::CALL, (1 << 16) | 0x123),
+      instruction(Interpreter::InstructionCode::CALL, (1 << 16) | 0x123)};
+  bool res = mInterpreter->run(instructions.data(), instructions.size());
+  EXPECT_TRUE(res);
+  EXPECT_EQ(2, callCount);
+}
+
+TEST_F(InterpreterTest, ApiRequestWithoutFunctions) {
+  mInterpreter->setApiRequestCallback(
+      [](Interpreter*, uint8_t) { return true; });
+  std::vector<uint32_t> instructions{
+      instruction(Interpreter::InstructionCode::CALL, 1 << 16)};
+  bool res = mInterpreter->run(instructions.data(), instructions.size());
+  EXPECT_FALSE(res);
+}
+
+// Runs instructions once on the checked path and once with the verified
+// blocks, in fresh interpreters sharing the memory, and expects the same
+// result and volatile memory from both runs.
+class VerifiedInterpreterTest : public InterpreterTest {
+ protected:
+  void expectSameResult(const std::vector<uint32_t>& instructions,
+                        bool expected) {
+    auto blocks =
+        StackVerifier::verify(instructions.data(), instructions.size());
+    EXPECT_FALSE(blocks.empty());
+    uint8_t* volatileMemory =
+        static_cast<uint8_t*>(mMemoryManager->volatileToAbsolute(0));
+
+    memset(volatileMemory, 0, MEMORY_SIZE / 2);
+    Interpreter checked(crash_handler, mMemoryManager.get(), STACK_SIZE);
+    EXPECT_EQ(expected, checked.run(instructions.data(), instructions.size()));
+    std::vector<uint8_t> checkedMemory(volatileMemory,
+                                       volatileMemory + MEMORY_SIZE / 2);
+
+    memset(volatileMemory, 0, MEMORY_SIZE / 2);
+    Interpreter verified(crash_handler, mMemoryManager.get(), STACK_SIZE);
+    EXPECT_EQ(expected, verified.run(instructions.data(), instructions.size(),
+                                     &blocks));
+    std::vector<uint8_t> verifiedMemory(volatileMemory,
+                                        volatileMemory + MEMORY_SIZE / 2);
+    EXPECT_EQ(checkedMemory, verifiedMemory);
+  }
+};
+
+TEST_F(VerifiedInterpreterTest, Values) {
+  mMemoryManager->setVolatileMemory(MEMORY_SIZE / 2);
+  std::vector<uint32_t> instructions{
+      instruction(Interpreter::InstructionCode::PUSH_I, BaseType::Int32,
+                  0xfffff),
+      instruction(Interpreter::InstructionCode::STORE_V, 0),
+      instruction(Interpreter::InstructionCode::PUSH_I, BaseType::Double,
+                  0x3ff),
+      instruction(Interpreter::InstructionCode::EXTEND, 0x1234567),
+      instruction(Interpreter::InstructionCode::STORE_V, 8),
+      instruction(Interpreter::InstructionCode::PUSH_I, BaseType::Uint16, 7),
+      instruction(Interpreter::InstructionCode::PUSH_I, BaseType::Uint16, 9),
+      instruction(Interpreter::InstructionCode::CLONE, 1),
+      instruction(Interpreter::InstructionCode::ADD, 3),
+      instruction(Interpreter::InstructionCode::STORE_V, 16),
+      instruction(Interpreter::InstructionCode::PUSH_I, BaseType::Uint8, 1),
+      instruction(Interpreter::InstructionCode::PUSH_I, BaseType::Uint8, 2),
+      instruction(Interpreter::InstructionCode::POP, 1),
+      instruction(Interpreter::InstructionCode::STORE_V, 20)};
+  expectSameResult(instructions, true);
+}
+
+TEST_F(VerifiedInterpreterTest, Memory) {
+  uint8_t constantMemory[16] = {'a', 'b', 'c', 0, 1, 2, 3, 4, 5, 6, 7, 8};
+  mMemoryManager->setReplayData(constantMemory, 16, nullptr, 0);
+  mMemoryManager->setVolatileMemory(MEMORY_SIZE / 2);
+  std::vector<uint32_t> instructions{
+      instruction(Interpreter::InstructionCode::LOAD_C, BaseType::Uint32, 4),
+      instruction(Interpreter::InstructionCode::STORE_V, 0),
+      instruction(Interpreter::InstructionCode::PUSH_I,
+                  BaseType::ConstantPointer, 8),
+      instruction(Interpreter::InstructionCode::PUSH_I,
+                  BaseType::VolatilePointer, 8),
+      instruction(Interpreter::InstructionCode::COPY, 4),
+      instruction(Interpreter::InstructionCode::PUSH_I,
+                  BaseType::ConstantPointer, 0),
+      instruction(Interpreter::InstructionCode::PUSH_I,
+                  BaseType::VolatilePointer, 16),
+      instruction(Interpreter::InstructionCode::STRCPY, 8),
+      instruction(Interpreter::InstructionCode::LOAD_V, BaseType::Uint16, 16),
+      instruction(Interpreter::InstructionCode::PUSH_I,
+                  BaseType::VolatilePointer, 32),
+      instruction(Interpreter::InstructionCode::STORE),
+      instruction(Interpreter::InstructionCode::PUSH_I,
+                  BaseType::VolatilePointer, 8),
+      instruction(Interpreter::InstructionCode::LOAD, BaseType::Uint8, 0),
+      instruction(Interpreter::InstructionCode::STORE_V, 40)};
+  expectSameResult(instructions, true);
+}
+
+TEST_F(VerifiedInterpreterTest, InvalidAddress) {
+  mMemoryManager->setVolatileMemory(MEMORY_SIZE / 2);
+  std::vector<uint32_t> instructions{
+      instruction(Interpreter::InstructionCode::PUSH_I, BaseType::Uint32, 1),
+      instruction(Interpreter::InstructionCode::STORE_V, MEMORY_SIZE)};
+  expectSameResult(instructions, false);
+}
+
+TEST_F(VerifiedInterpreterTest, FullStackFallsBack) {
+  mMemoryManager->setVolatileMemory(MEMORY_SIZE / 2);
+  std::vector<uint32_t> instructions{
+      instruction(Interpreter::InstructionCode::PUSH_I, BaseType::Uint32, 1),
+      instruction(Interpreter::InstructionCode::PUSH_I, BaseType::Uint32, 2),
+      instruction(Interpreter::InstructionCode::ADD, 2),
+      instruction(Interpreter::InstructionCode::STORE_V, 0)};
+  auto blocks = StackVerifier::verify(instructions.data(), instructions.size());
+  ASSERT_EQ(1, blocks.size());
+
+  // A stack of one entry has no room for the growth of the block, so it runs
+  // on the checked path and fails there.
+  Interpreter interpreter(crash_handler, mMemoryManager.get(), 1);
+  EXPECT_FALSE(
+      interpreter.run(instructions.data(), instructions.size(), &blocks));
+}
+
 }  // namespace test
 }  // namespace gapir
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mapped_payload.h"
+
+#include "core/cc/log.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if GAPIR_MAPPED_PAYLOAD_USE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif  // GAPIR_MAPPED_PAYLOAD_USE_MMAP
+
+namespace gapir {
+
+std::unique_ptr<MappedPayload> MappedPayload::open(const std::string& path) {
+#if GAPIR_MAPPED_PAYLOAD_USE_MMAP
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return nullptr;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 ||
+      static_cast<uint64_t>(st.st_size) < sizeof(MappedPayloadHeader)) {
+    ::close(fd);
+    return nullptr;
+  }
+  void* base = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping stays valid after the descriptor is closed.
+  ::close(fd);
+  if (base == MAP_FAILED) {
+    GAPID_WARNING("Unable to map payload file %s", path.c_str());
+    return nullptr;
+  }
+  std::unique_ptr<MappedPayload> payload(
+      new MappedPayload(static_cast<const uint8_t*>(base), st.st_size));
+#else   // GAPIR_MAPPED_PAYLOAD_USE_MMAP
+  FILE* file = fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    return nullptr;
+  }
+  fseek(file, 0, SEEK_END);
+  uint64_t size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  if (size < sizeof(MappedPayloadHeader)) {
+    fclose(file);
+    return nullptr;
+  }
+  uint8_t* base = new uint8_t[size];
+  bool ok = fread(base, size, 1, file) == 1;
+  fclose(file);
+  std::unique_ptr<MappedPayload> payload(new MappedPayload(base, size));
+  if (!ok) {
+    return nullptr;
+  }
+#endif  // GAPIR_MAPPED_PAYLOAD_USE_MMAP
+
+  if (!payload->load()) {
+    GAPID_WARNING("Malformed mapped payload file %s", path.c_str());
+    return nullptr;
+  }
+  return payload;
+}
+
+MappedPayload::MappedPayload(const uint8_t* base, uint64_t size)
+    : mBase(base),
+      mSize(size),
+      mHeader(reinterpret_cast<const MappedPayloadHeader*>(base)) {}
+
+MappedPayload::~MappedPayload() {
+#if GAPIR_MAPPED_PAYLOAD_USE_MMAP
+  ::munmap(const_cast<uint8_t*>(mBase), mSize);
+#else
+  delete[] mBase;
+#endif
+}
+
+bool MappedPayload::load() {
+  if (memcmp(mHeader->magic, kMappedPayloadMagic, sizeof(mHeader->magic)) !=
+          0 ||
+      mHeader->version != kMappedPayloadVersion) {
+    return false;
+  }
+  auto inFile = [this](uint64_t offset, uint64_t size) {
+    return offset <= mSize && size <= mSize - offset;
+  };
+  if (!inFile(mHeader->resources_offset, mHeader->resources_size) ||
+      !inFile(mHeader->constants_offset, mHeader->constants_size) ||
+      !inFile(mHeader->opcodes_offset, mHeader->opcodes_size) ||
+      mHeader->opcodes_offset % sizeof(uint32_t) != 0) {
+    return false;
+  }
+
+  const uint8_t* at = mBase + mHeader->resources_offset;
+  const uint8_t* end = at + mHeader->resources_size;
+  mResources.reserve(mHeader->resource_count);
+  for (uint32_t i = 0; i < mHeader->resource_count; i++) {
+    uint32_t size;
+    uint32_t idSize;
+    if (static_cast<size_t>(end - at) < sizeof(size) + sizeof(idSize)) {
+      return false;
+    }
+    memcpy(&size, at, sizeof(size));
+    memcpy(&idSize, at + sizeof(size), sizeof(idSize));
+    at += sizeof(size) + sizeof(idSize);
+    if (static_cast<size_t>(end - at) < idSize) {
+      return false;
+    }
+    mResources.emplace_back(
+        ResourceId(reinterpret_cast<const char*>(at), idSize), size);
+    at += idSize;
+  }
+  return true;
+}
+
+}  // namespace gapir
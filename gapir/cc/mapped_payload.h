@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GAPIR_MAPPED_PAYLOAD_H
+#define GAPIR_MAPPED_PAYLOAD_H
+
+#include "replay_service.h"
+#include "resource.h"
+
+#include "core/cc/target.h"
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#if TARGET_OS == GAPID_OS_LINUX || TARGET_OS == GAPID_OS_OSX
+#define GAPIR_MAPPED_PAYLOAD_USE_MMAP 1
+#else
+#define GAPIR_MAPPED_PAYLOAD_USE_MMAP 0
+#endif
+
+namespace gapir {
+
+// Layout of a mapped payload file. All the integers are little-endian and
+// every section starts at a kMappedPayloadAlignment boundary:
+//
+//   header:    MappedPayloadHeader
+//   resources: resource_count x {uint32 size, uint32 id_size, char id[]}
+//   constants: constants_size bytes
+//   opcodes:   opcodes_size bytes
+//
+// Must match the writer in gapir/client/mapped_payload.go.
+static const char kMappedPayloadMagic[8] = {'G', 'A', 'P', 'I',
+                                            'R', 'P', 'L', 'D'};
+static const uint32_t kMappedPayloadVersion = 1;
+static const uint64_t kMappedPayloadAlignment = 4096;
+
+struct MappedPayloadHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t stack_size;
+  uint32_t volatile_memory_size;
+  uint32_t resource_count;
+  uint64_t resources_offset;
+  uint64_t resources_size;
+  uint64_t constants_offset;
+  uint64_t constants_size;
+  uint64_t opcodes_offset;
+  uint64_t opcodes_size;
+};
+
+// MappedPayload is a payload backed by a mapped payload file. The opcodes and
+// constants are used directly from the mapping, so the MemoryManager points
+// into the file and no parsing or copying takes place before the replay.
+class MappedPayload : public ReplayService::Payload {
+ public:
+  // Opens and maps the payload file at path. Returns nullptr if the file does
+  // not exist or is not a valid mapped payload.
+  static std::unique_ptr<MappedPayload> open(const std::string& path);
+
+  ~MappedPayload() override;
+
+  // ReplayService::Payload overrides
+  uint32_t stack_size() const override { return mHeader->stack_size; }
+  uint32_t volatile_memory_size() const override {
+    return mHeader->volatile_memory_size;
+  }
+  size_t constants_size() const override { return mHeader->constants_size; }
+  const void* constants_data() const override {
+    return mBase + mHeader->constants_offset;
+  }
+  size_t resource_info_count() const override { return mResources.size(); }
+  const std::string resource_id(int index) const override {
+    return mResources[index].id;
+  }
+  uint32_t resource_size(int index) const override {
+    return mResources[index].size;
+  }
+  size_t opcodes_size() const override { return mHeader->opcodes_size; }
+  const void* opcodes_data() const override {
+    return mBase + mHeader->opcodes_offset;
+  }
+
+ private:
+  MappedPayload(const uint8_t* base, uint64_t size);
+
+  // Validates the header and decodes the resource index. Returns false if the
+  // mapped file is malformed.
+  bool load();
+
+  // The start and the size of the mapped file.
+  const uint8_t* mBase;
+  uint64_t mSize;
+
+  // The header at the start of the mapped file.
+  const MappedPayloadHeader* mHeader;
+
+  // The decoded resource index.
+  std::vector<Resource> mResources;
+};
+
+}  // namespace gapir
+
+#endif  // GAPIR_MAPPED_PAYLOAD_H
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mapped_payload.h"
+#include "memory_manager.h"
+#include "mock_replay_service.h"
+#include "replay_request.h"
+#include "test_utilities.h"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace ::testing;
+
+namespace gapir {
+namespace test {
+namespace {
+
+const uint32_t MEMORY_SIZE = 4096;
+
+// The mapped payload that WriteMappedPayload in gapir/client writes for the
+// payload of MappedPayloadTest. TestMappedPayloadLayout in
+// gapir/client/mapped_payload_test.go pins the same bytes.
+std::vector<uint8_t> goWriterOutput() {
+  static const uint8_t kHeader[] = {
+      'G',  'A',  'P',  'I',  'R',  'P',  'L',  'D',   // magic
+      0x01, 0x00, 0x00, 0x00,                          // version
+      0x80, 0x00, 0x00, 0x00,                          // stack size
+      0x00, 0x04, 0x00, 0x00,                          // volatile memory size
+      0x02, 0x00, 0x00, 0x00,                          // resource count
+      0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // resources offset
+      0x17, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // resources size
+      0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // constants offset
+      0x09, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // constants size
+      0x00, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // opcodes offset
+      0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // opcodes size
+  };
+  static const uint8_t kResources[] = {
+      0x10, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 'Z', 'Y', 'X',
+      0x20, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, '1', '2', '3', '4',
+  };
+  static const uint8_t kConstants[] = {'A', 'B', 'C', 'D', 'E',
+                                       'F', 'G', 'H', 'I'};
+  static const uint8_t kOpcodes[] = {0, 0, 0, 0, 1, 0, 0, 0,
+                                     2, 0, 0, 0, 3, 0, 0, 0};
+  std::vector<uint8_t> file(0x4000, 0);
+  memcpy(&file[0x0000], kHeader, sizeof(kHeader));
+  memcpy(&file[0x1000], kResources, sizeof(kResources));
+  memcpy(&file[0x2000], kConstants, sizeof(kConstants));
+  memcpy(&file[0x3000], kOpcodes, sizeof(kOpcodes));
+  return file;
+}
+
+class MappedPayloadTest : public Test {
+ protected:
+  virtual void SetUp() {
+    mPath = TempDir() + "mapped_payload_test.map";
+    mConstants = {'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I'};
+    mResources = {{"ZYX", 16}, {"1234", 32}};
+    mInstructions = {0, 1, 2, 3};
+  }
+
+  virtual void TearDown() { remove(mPath.c_str()); }
+
+  void writeFile(const std::vector<uint8_t>& data) {
+    FILE* file = fopen(mPath.c_str(), "wb");
+    ASSERT_NE(nullptr, file);
+    fwrite(data.data(), data.size(), 1, file);
+    fclose(file);
+  }
+
+  std::string mPath;
+  std::vector<uint8_t> mConstants;
+  std::vector<Resource> mResources;
+  std::vector<uint32_t> mInstructions;
+};
+
+}  // anonymous namespace
+
+TEST_F(MappedPayloadTest, OpenGoWriterOutput) {
+  writeFile(goWriterOutput());
+
+  auto mapped = MappedPayload::open(mPath);
+  ASSERT_NE(nullptr, mapped);
+  EXPECT_EQ(128, mapped->stack_size());
+  EXPECT_EQ(1024, mapped->volatile_memory_size());
+
+  ASSERT_EQ(mConstants.size(), mapped->constants_size());
+  EXPECT_EQ(0, memcmp(mConstants.data(), mapped->constants_data(),
+                      mConstants.size()));
+
+  ASSERT_EQ(mResources.size(), mapped->resource_info_count());
+  for (size_t i = 0; i < mResources.size(); i++) {
+    EXPECT_EQ(mResources[i].id, mapped->resource_id(i));
+    EXPECT_EQ(mResources[i].size, mapped->resource_size(i));
+  }
+
+  ASSERT_EQ(mInstructions.size() * sizeof(uint32_t), mapped->opcodes_size());
+  EXPECT_EQ(0, memcmp(mInstructions.data(), mapped->opcodes_data(),
+                      mapped->opcodes_size()));
+
+  // Sections are aligned in the file, so they are aligned in memory too.
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(mapped->constants_data()) %
+                   kMappedPayloadAlignment);
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(mapped->opcodes_data()) %
+                   kMappedPayloadAlignment);
+}
+
+TEST_F(MappedPayloadTest, OpenMissing) {
+  EXPECT_EQ(nullptr, MappedPayload::open(mPath));
+}
+
+TEST_F(MappedPayloadTest, OpenMalformed) {
+  writeFile(std::vector<uint8_t>(sizeof(MappedPayloadHeader) * 2, 0x42));
+  EXPECT_EQ(nullptr, MappedPayload::open(mPath));
+}
+
+TEST_F(MappedPayloadTest, ReplayRequestUsesMapping) {
+  writeFile(goWriterOutput());
+
+  auto mapped = MappedPayload::open(mPath);
+  ASSERT_NE(nullptr, mapped);
+  const void* constants = mapped->constants_data();
+  const void* opcodes = mapped->opcodes_data();
+
+  auto mock_srv = std::unique_ptr<MockReplayService>(new MockReplayService());
+  EXPECT_CALL(*mock_srv, getPayload("payload"))
+      .WillOnce(Return(ByMove(std::move(mapped))));
+
+  std::vector<uint32_t> memorySizes = {MEMORY_SIZE};
+  MemoryManager memoryManager(memorySizes);
+  auto replayRequest =
+      ReplayRequest::create(mock_srv.get(), "payload", &memoryManager);
+  ASSERT_NE(nullptr, replayRequest);
+
+  // The memory manager points straight into the mapped file.
+  EXPECT_EQ(constants, memoryManager.getConstantAddress());
+  EXPECT_EQ(opcodes, memoryManager.getOpcodeAddress());
+  EXPECT_EQ(mResources, replayRequest->getResources());
+}
+
+}  // namespace test
+}  // namespace gapir
@@ -61,6 +61,9 @@ std::unique_ptr<ReplayRequest> ReplayRequest::create(
   req->mInstructionList = {
       static_cast<const uint32_t*>(payload->opcodes_data()), instCount};
   GAPID_DEBUG("Instruction count: %" PRIu32, instCount);
+  req->mVerifiedBlocks =
+      StackVerifier::verify(req->mInstructionList.first, instCount);
+  GAPID_DEBUG("Verified blocks: %zu", req->mVerifiedBlocks.size());
   memoryManager->setReplayData(
       (const uint8_t*)payload->constants_data(), payload->constants_size(),
       (const uint8_t*)payload->opcodes_data(), payload->opcodes_size());
@@ -88,4 +91,9 @@ const std::pair<const uint32_t*, uint32_t>& ReplayRequest::getInstructionList()
   return mInstructionList;
 }
 
+const std::vector<StackVerifier::Block>& ReplayRequest::getVerifiedBlocks()
+    const {
+  return mVerifiedBlocks;
+}
+
 }  // namespace gapir
@@ -28,6 +28,7 @@
 
 #include "memory_manager.h"
 #include "replay_service.h"
+#include "stack_verifier.h"
 
 namespace gapir {
 
@@ -59,6 +60,9 @@ class ReplayRequest {
   // instruction list
   const std::pair<const uint32_t*, uint32_t>& getInstructionList() const;
 
+  // Get the blocks of the instruction list proven by the StackVerifier
+  const std::vector<StackVerifier::Block>& getVerifiedBlocks() const;
+
  private:
   ReplayRequest() = default;
 
@@ -74,6 +78,9 @@ class ReplayRequest {
   // The base address and the number of the instructions
   std::pair<const uint32_t*, uint32_t> mInstructionList;
 
+  // The verified blocks of the instruction list
+  std::vector<StackVerifier::Block> mVerifiedBlocks;
+
   // The list of resources (resource id, resource size) used by the replay
   std::vector<Resource> mResources;
 
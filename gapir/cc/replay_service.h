@@ -81,38 +81,43 @@ class ReplayService {
   };
 
   // Payload is a wraper class of replay_service::Payload, it hides the
-  // new/delete operations of the proto object from outer code.
+  // new/delete operations of the proto object from outer code. Payloads that
+  // are not backed by a proto object (e.g. memory-mapped archives) override
+  // the accessors.
   class Payload {
    public:
     // Creates a new Payload from a protobuf payload object.
     Payload(std::unique_ptr<replay_service::Payload> protoPayload);
 
-    ~Payload();
+    virtual ~Payload();
     Payload(const Payload&) = delete;
     Payload(Payload&&) = delete;
     Payload& operator=(const Payload&) = delete;
     Payload& operator=(Payload&&) = delete;
 
     // Returns the stack size in bytes specified by this replay payload.
-    uint32_t stack_size() const;
+    virtual uint32_t stack_size() const;
     // Returns the volatile memory size in bytes specified by this replay
     // payload.
-    uint32_t volatile_memory_size() const;
+    virtual uint32_t volatile_memory_size() const;
     // Returns the constant memory size in bytes specified by this replay
     // payload.
-    size_t constants_size() const;
+    virtual size_t constants_size() const;
     // Gets a pointer to the payload constant data.
-    const void* constants_data() const;
+    virtual const void* constants_data() const;
     // Returns the count of resource info.
-    size_t resource_info_count() const;
+    virtual size_t resource_info_count() const;
     // Returns the ID of the 'index'th (starts from 0) resource info.
-    const std::string resource_id(int index) const;
+    virtual const std::string resource_id(int index) const;
     // Returns the expected size of the 'index'th (starts from 0) resource info.
-    uint32_t resource_size(int index) const;
+    virtual uint32_t resource_size(int index) const;
     // Returns the size in bytes of the opcodes in this replay payload.
-    size_t opcodes_size() const;
+    virtual size_t opcodes_size() const;
     // Gets a pointer to the opcodes in this replay payload.
-    const void* opcodes_data() const;
+    virtual const void* opcodes_data() const;
+
+   protected:
+    Payload() = default;
 
    private:
     // The internal proto object.
@@ -20,6 +20,8 @@
 #include "replay_service.h"
 #include "resource.h"
 
+#include "core/cc/trace.h"
+
 #include <stdint.h>
 #include <memory>
 
@@ -64,6 +66,8 @@ class PassThroughResourceLoader : public ResourceLoader {
     if (mSrv == nullptr) {
       return nullptr;
     }
+    GAPID_TRACE_NAME("PassThroughResourceLoader::fetch");
+    GAPID_TRACE_INT("fetched resources", count);
     return mSrv->getResources(resources, count);
   }
 
@@ -192,6 +192,23 @@ void Stack::popTo(void* address) {
   }
 }
 
+void Stack::popToUnchecked(void* address) {
+  switch (getTopTypeUnchecked()) {
+    case BaseType::ConstantPointer:
+    case BaseType::VolatilePointer: {
+      const void* pointer = popPointerUnchecked();
+      // Note we are copying the pointer not what is pointed to.
+      memcpy(address, &pointer, sizeof(pointer));
+      return;
+    }
+    default:
+      mTop--;
+      memcpy(address, mStack[mTop].valuePtr(),
+             baseTypeSize(mStack[mTop].type()));
+      return;
+  }
+}
+
 void Stack::discard(uint32_t count) {
   if (!mValid) {
     GAPID_WARNING("Discard on invalid stack");
@@ -183,6 +183,45 @@ class Stack {
   // call.
   void pushFrom(BaseType type, const void* data);
 
+  // Unchecked operations for instruction blocks proven by the StackVerifier.
+  // They skip the validity, bounds and type checks of the operations above, so
+  // the caller must guarantee that the stack is valid, that there is room for
+  // every push and that every pop finds an entry of the expected type.
+  // Constant and volatile pointers are still checked against the memory
+  // layout when they are converted to absolute pointers.
+
+  // Returns the number of entries that can be pushed before the stack is full.
+  uint32_t available() const { return mStack.size() - mTop; }
+
+  BaseType getTopTypeUnchecked() const { return mStack[mTop - 1].type(); }
+
+  void pushValueUnchecked(BaseType type, BaseValue value) {
+    mStack[mTop++].set(type, &value);
+  }
+
+  void pushFromUnchecked(BaseType type, const void* data) {
+    mStack[mTop++].set(type, data);
+  }
+
+  BaseValue popBaseValueUnchecked() { return mStack[--mTop].getBaseValue(); }
+
+  // Pops an entry of any of the pointer types as an absolute pointer. Puts the
+  // stack into an invalid state if the pointer is outside of its memory.
+  const void* popPointerUnchecked() {
+    mTop--;
+    return checkAndGetTopPointer("popPointerUnchecked");
+  }
+
+  // Like popTo(), without the checks.
+  void popToUnchecked(void* address);
+
+  void discardUnchecked(uint32_t count) { mTop -= count; }
+
+  void cloneUnchecked(uint32_t n) {
+    mStack[mTop] = mStack[mTop - n - 1];
+    mTop++;
+  }
+
  private:
   // Check that the stack is valid and a pop is allowed (non-empty).
   bool popCheck(const char* what);
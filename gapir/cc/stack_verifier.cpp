@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stack_verifier.h"
+#include "base_type.h"
+#include "interpreter.h"
+
+#include <algorithm>
+
+namespace gapir {
+namespace {
+
+// The types of the entries pushed within the current block, bottom first.
+typedef std::vector<BaseType> Types;
+
+// Pops an entry that the checked Stack accepts as a pointer.
+bool popPointer(Types* types) {
+  if (types->empty() || !isPointerType(types->back())) {
+    return false;
+  }
+  types->pop_back();
+  return true;
+}
+
+// Pops an entry of any type.
+bool popAny(Types* types) {
+  if (types->empty()) {
+    return false;
+  }
+  types->pop_back();
+  return true;
+}
+
+// Applies the stack effect of an ADD of count values. Mirrors the type rules
+// of Interpreter::add().
+bool add(uint32_t count, Types* types) {
+  if (count < 2) {
+    return true;
+  }
+  if (count > types->size()) {
+    return false;
+  }
+  BaseType type = types->back();
+  BaseType result = type;
+  auto first = types->end() - count;
+  switch (type) {
+    case BaseType::Bool:
+    case BaseType::VolatilePointer:
+      return false;
+    case BaseType::AbsolutePointer:
+    case BaseType::ConstantPointer:
+      if (!std::all_of(first, types->end(), isPointerType)) {
+        return false;
+      }
+      result = BaseType::AbsolutePointer;
+      break;
+    default:
+      if (std::any_of(first, types->end(),
+                      [type](BaseType t) { return t != type; })) {
+        return false;
+      }
+      break;
+  }
+  types->erase(first, types->end());
+  types->push_back(result);
+  return true;
+}
+
+// Applies the stack effect of opcode to types. Returns false if the effect
+// depends on entries that were not pushed within the current block, on the
+// behaviour of a function outside of the VM, or if the instruction would fail
+// on the checked path.
+bool apply(uint32_t opcode, Types* types) {
+  auto code = static_cast<vm::Opcode>(opcode >> Interpreter::OPCODE_BIT_SHIFT);
+  auto type = static_cast<BaseType>((opcode & Interpreter::TYPE_MASK) >>
+                                    Interpreter::TYPE_BIT_SHIFT);
+  uint32_t data = opcode & Interpreter::DATA_MASK26;
+  switch (code) {
+    case vm::Opcode::PUSH_I:
+    case vm::Opcode::LOAD_C:
+    case vm::Opcode::LOAD_V:
+      if (!isValid(type)) {
+        return false;
+      }
+      types->push_back(type);
+      return true;
+    case vm::Opcode::LOAD:
+      if (!isValid(type) || !popPointer(types)) {
+        return false;
+      }
+      types->push_back(type);
+      return true;
+    case vm::Opcode::POP:
+      if (data > types->size()) {
+        return false;
+      }
+      types->resize(types->size() - data);
+      return true;
+    case vm::Opcode::STORE_V:
+      return popAny(types);
+    case vm::Opcode::STORE:
+      return popPointer(types) && popAny(types);
+    case vm::Opcode::COPY:
+    case vm::Opcode::STRCPY:
+      return popPointer(types) && popPointer(types);
+    case vm::Opcode::CLONE:
+      if (data >= types->size()) {
+        return false;
+      }
+      types->push_back((*types)[types->size() - data - 1]);
+      return true;
+    case vm::Opcode::EXTEND:
+      // Extends the top entry in place, keeping its type.
+      return !types->empty();
+    case vm::Opcode::ADD:
+      return add(data, types);
+    case vm::Opcode::LABEL:
+      return true;
+    default:
+      // CALL, RESOURCE, POST, SWITCH_THREAD and invalid opcodes.
+      return false;
+  }
+}
+
+}  // anonymous namespace
+
+std::vector<StackVerifier::Block> StackVerifier::verify(
+    const uint32_t* instructions, uint32_t count) {
+  std::vector<Block> blocks;
+  Types types;
+  Block block = {0, 0, 0};
+  for (uint32_t i = 0; i < count; i++) {
+    if (apply(instructions[i], &types)) {
+      block.end = i + 1;
+      block.growth = std::max<uint32_t>(block.growth, types.size());
+      continue;
+    }
+    // The instruction runs on the checked path and nothing is known about the
+    // stack after it.
+    if (block.end > block.begin) {
+      blocks.push_back(block);
+    }
+    block = {i + 1, i + 1, 0};
+    types.clear();
+  }
+  if (block.end > block.begin) {
+    blocks.push_back(block);
+  }
+  return blocks;
+}
+
+}  // namespace gapir
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GAPIR_STACK_VERIFIER_H
+#define GAPIR_STACK_VERIFIER_H
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace gapir {
+
+// StackVerifier proves the stack safety of an instruction list ahead of its
+// execution, so that the interpreter can run the proven parts without the
+// per-operation checks of the Stack.
+//
+// The instruction list is split into blocks at every instruction that calls
+// out of the VM (CALL, POST, RESOURCE), switches thread, or touches stack
+// entries that were not pushed within the same block. Within a block every
+// pop is matched by the type of the entry it pops, so a block only needs the
+// stack to be valid and to have room for its growth when it is entered.
+// Instructions outside of the verified blocks run on the checked path.
+class StackVerifier {
+ public:
+  // A verified block of instructions.
+  struct Block {
+    // The index of the first instruction of the block.
+    uint32_t begin;
+    // The index one past the last instruction of the block.
+    uint32_t end;
+    // The maximum number of entries the block pushes on top of the stack it
+    // is entered with.
+    uint32_t growth;
+  };
+
+  // Returns the verified blocks of the instruction list, in increasing
+  // instruction order.
+  static std::vector<Block> verify(const uint32_t* instructions,
+                                   uint32_t count);
+};
+
+}  // namespace gapir
+
+#endif  // GAPIR_STACK_VERIFIER_H
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "stack_verifier.h"
+#include "interpreter.h"
+#include "test_utilities.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace gapir {
+namespace test {
+namespace {
+
+typedef Interpreter::InstructionCode Op;
+
+std::vector<StackVerifier::Block> verify(
+    const std::vector<uint32_t>& instructions) {
+  return StackVerifier::verify(instructions.data(), instructions.size());
+}
+
+void expectBlock(const StackVerifier::Block& block, uint32_t begin,
+                 uint32_t end, uint32_t growth) {
+  EXPECT_EQ(begin, block.begin);
+  EXPECT_EQ(end, block.end);
+  EXPECT_EQ(growth, block.growth);
+}
+
+}  // anonymous namespace
+
+TEST(StackVerifierTest, Empty) { EXPECT_TRUE(verify({}).empty()); }
+
+TEST(StackVerifierTest, CallsSplitBlocks) {
+  auto blocks = verify({
+      instruction(Op::LABEL, 1),
+      instruction(Op::PUSH_I, BaseType::Uint32, 1),
+      instruction(Op::PUSH_I, BaseType::ConstantPointer, 4),
+      instruction(Op::CALL, 0),
+      instruction(Op::PUSH_I, BaseType::Uint32, 2),
+      instruction(Op::POST),
+      instruction(Op::CALL, 0),
+  });
+  ASSERT_EQ(2, blocks.size());
+  expectBlock(blocks[0], 0, 3, 2);
+  expectBlock(blocks[1], 4, 5, 1);
+}
+
+TEST(StackVerifierTest, GrowthIsTheMaximumDepth) {
+  auto blocks = verify({
+      instruction(Op::PUSH_I, BaseType::Uint32, 1),
+      instruction(Op::PUSH_I, BaseType::Uint32, 2),
+      instruction(Op::CLONE, 1),
+      instruction(Op::ADD, 3),
+      instruction(Op::STORE_V, 0),
+      instruction(Op::PUSH_I, BaseType::Uint8, 3),
+  });
+  ASSERT_EQ(1, blocks.size());
+  expectBlock(blocks[0], 0, 6, 3);
+}
+
+TEST(StackVerifierTest, PopOfUnknownEntryIsNotVerified) {
+  // The STORE_V pops the return value of the call.
+  auto blocks = verify({
+      instruction(Op::CALL, 0x01000000),
+      instruction(Op::STORE_V, 0),
+      instruction(Op::PUSH_I, BaseType::Uint32, 1),
+      instruction(Op::POP, 2),
+      instruction(Op::PUSH_I, BaseType::Uint32, 1),
+      instruction(Op::POP, 1),
+  });
+  ASSERT_EQ(2, blocks.size());
+  expectBlock(blocks[0], 2, 3, 1);
+  expectBlock(blocks[1], 4, 6, 1);
+}
+
+TEST(StackVerifierTest, TypeMismatchIsNotVerified) {
+  auto blocks = verify({
+      instruction(Op::PUSH_I, BaseType::Uint32, 1),
+      instruction(Op::LOAD, BaseType::Uint32, 0),
+      instruction(Op::PUSH_I, BaseType::Uint32, 1),
+      instruction(Op::PUSH_I, BaseType::Int32, 1),
+      instruction(Op::ADD, 2),
+      instruction(Op::PUSH_I, BaseType::VolatilePointer, 1),
+      instruction(Op::PUSH_I, BaseType::Uint32, 1),
+      instruction(Op::COPY, 1),
+  });
+  ASSERT_EQ(3, blocks.size());
+  expectBlock(blocks[0], 0, 1, 1);
+  expectBlock(blocks[1], 2, 4, 2);
+  expectBlock(blocks[2], 5, 7, 2);
+}
+
+TEST(StackVerifierTest, PointerRules) {
+  auto blocks = verify({
+      instruction(Op::PUSH_I, BaseType::Uint32, 1),
+      instruction(Op::PUSH_I, BaseType::VolatilePointer, 8),
+      instruction(Op::STORE),
+      instruction(Op::PUSH_I, BaseType::ConstantPointer, 0),
+      instruction(Op::PUSH_I, BaseType::VolatilePointer, 0),
+      instruction(Op::STRCPY, 4),
+      instruction(Op::PUSH_I, BaseType::ConstantPointer, 0),
+      instruction(Op::LOAD, BaseType::Uint16, 0),
+      instruction(Op::EXTEND, 1),
+      instruction(Op::STORE_V, 0),
+  });
+  ASSERT_EQ(1, blocks.size());
+  expectBlock(blocks[0], 0, 10, 2);
+}
+
+TEST(StackVerifierTest, InvalidInstructionsAreNotVerified) {
+  auto blocks = verify({
+      instruction(Op::PUSH_I, BaseType::Uint32, 1),
+      63U << 26,
+      instruction(Op::PUSH_I, static_cast<BaseType>(50), 1),
+      instruction(Op::SWITCH_THREAD, 1),
+      instruction(Op::PUSH_I, BaseType::Uint32, 1),
+  });
+  ASSERT_EQ(2, blocks.size());
+  expectBlock(blocks[0], 0, 1, 1);
+  expectBlock(blocks[1], 4, 5, 1);
+}
+
+}  // namespace test
+}  // namespace gapir
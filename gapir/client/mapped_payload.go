@@ -0,0 +1,91 @@
+// Copyright (C) 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package client
+
+import (
+	"bytes"
+	"encoding/binary"
+	"io"
+)
+
+// The mapped payload format. Must match gapir/cc/mapped_payload.h.
+const (
+	mappedPayloadMagic     = "GAPIRPLD"
+	mappedPayloadVersion   = 1
+	mappedPayloadAlignment = 4096
+)
+
+type mappedPayloadHeader struct {
+	Magic              [8]byte
+	Version            uint32
+	StackSize          uint32
+	VolatileMemorySize uint32
+	ResourceCount      uint32
+	ResourcesOffset    uint64
+	ResourcesSize      uint64
+	ConstantsOffset    uint64
+	ConstantsSize      uint64
+	OpcodesOffset      uint64
+	OpcodesSize        uint64
+}
+
+func alignMappedSection(offset uint64) uint64 {
+	return (offset + mappedPayloadAlignment - 1) &^ (mappedPayloadAlignment - 1)
+}
+
+// WriteMappedPayload writes the payload p to w in the mapped payload format,
+// where the opcodes and constants sit in page aligned sections that GAPIR can
+// memory-map and replay from without parsing or copying them.
+func WriteMappedPayload(w io.Writer, p *Payload) error {
+	index := &bytes.Buffer{}
+	for _, r := range p.Resources {
+		binary.Write(index, binary.LittleEndian, r.Size)
+		binary.Write(index, binary.LittleEndian, uint32(len(r.Id)))
+		index.WriteString(r.Id)
+	}
+
+	header := mappedPayloadHeader{
+		Version:            mappedPayloadVersion,
+		StackSize:          p.StackSize,
+		VolatileMemorySize: p.VolatileMemorySize,
+		ResourceCount:      uint32(len(p.Resources)),
+		ResourcesSize:      uint64(index.Len()),
+		ConstantsSize:      uint64(len(p.Constants)),
+		OpcodesSize:        uint64(len(p.Opcodes)),
+	}
+	copy(header.Magic[:], mappedPayloadMagic)
+	header.ResourcesOffset = alignMappedSection(uint64(binary.Size(header)))
+	header.ConstantsOffset = alignMappedSection(header.ResourcesOffset + header.ResourcesSize)
+	header.OpcodesOffset = alignMappedSection(header.ConstantsOffset + header.ConstantsSize)
+
+	headerBytes := &bytes.Buffer{}
+	if err := binary.Write(headerBytes, binary.LittleEndian, &header); err != nil {
+		return err
+	}
+
+	offset := uint64(0)
+	padding := make([]byte, mappedPayloadAlignment)
+	for _, section := range [][]byte{headerBytes.Bytes(), index.Bytes(), p.Constants, p.Opcodes} {
+		if _, err := w.Write(section); err != nil {
+			return err
+		}
+		end := offset + uint64(len(section))
+		offset = alignMappedSection(end)
+		if _, err := w.Write(padding[:offset-end]); err != nil {
+			return err
+		}
+	}
+	return nil
+}
@@ -0,0 +1,66 @@
+// Copyright (C) 2018 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+package client
+
+import (
+	"bytes"
+	"testing"
+
+	"github.com/google/gapid/core/assert"
+	"github.com/google/gapid/core/log"
+)
+
+// TestMappedPayloadLayout pins the bytes of a small mapped payload. The same
+// bytes are read back by gapir in gapir/cc/mapped_payload_test.cpp, so both
+// must be updated together.
+func TestMappedPayloadLayout(t *testing.T) {
+	ctx := log.Testing(t)
+	p := &Payload{
+		StackSize:          128,
+		VolatileMemorySize: 1024,
+		Constants:          []byte("ABCDEFGHI"),
+		Resources: []*ResourceInfo{
+			{Id: "ZYX", Size: 16},
+			{Id: "1234", Size: 32},
+		},
+		Opcodes: []byte{0, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 3, 0, 0, 0},
+	}
+	buf := &bytes.Buffer{}
+	assert.For(ctx, "err").ThatError(WriteMappedPayload(buf, p)).Succeeded()
+
+	expected := make([]byte, 0x4000)
+	copy(expected[0x0000:], []byte{
+		'G', 'A', 'P', 'I', 'R', 'P', 'L', 'D', // magic
+		0x01, 0x00, 0x00, 0x00, // version
+		0x80, 0x00, 0x00, 0x00, // stack size
+		0x00, 0x04, 0x00, 0x00, // volatile memory size
+		0x02, 0x00, 0x00, 0x00, // resource count
+		0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // resources offset
+		0x17, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // resources size
+		0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // constants offset
+		0x09, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // constants size
+		0x00, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // opcodes offset
+		0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // opcodes size
+	})
+	copy(expected[0x1000:], []byte{
+		0x10, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 'Z', 'Y', 'X',
+		0x20, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, '1', '2', '3', '4',
+	})
+	copy(expected[0x2000:], p.Constants)
+	copy(expected[0x3000:], p.Opcodes)
+
+	assert.For(ctx, "size").That(buf.Len()).Equals(len(expected))
+	assert.For(ctx, "bytes").That(bytes.Equal(buf.Bytes(), expected)).Equals(true)
+}
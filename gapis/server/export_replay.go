@@ -27,6 +27,7 @@ import (
 	"github.com/google/gapid/core/data/id"
 	"github.com/google/gapid/core/log"
 	"github.com/google/gapid/core/os/device/bind"
+	gapir "github.com/google/gapid/gapir/client"
 	"github.com/google/gapid/gapis/capture"
 	"github.com/google/gapid/gapis/database"
 	"github.com/google/gapid/gapis/replay"
@@ -146,11 +147,21 @@ func exportReplay(ctx context.Context, c *path.Capture, d *path.Device, out stri
 		return log.Errf(ctx, err, "Failed to create output directory: %v", out)
 	}
 
-	payloadBytes, err := proto.Marshal(payload)
-	if err != nil {
-		return log.Errf(ctx, err, "Failed to serialize replay payload.")
+	if opts.MappedPayload {
+		err = writeMappedPayload(gopath.Join(out, "payload.map"), payload)
+		if err != nil {
+			return log.Errf(ctx, err, "Failed to write mapped replay payload.")
+		}
+	} else {
+		payloadBytes, err := proto.Marshal(payload)
+		if err != nil {
+			return log.Errf(ctx, err, "Failed to serialize replay payload.")
+		}
+		err = ioutil.WriteFile(gopath.Join(out, "payload.bin"), payloadBytes, 0644)
+		if err != nil {
+			return log.Errf(ctx, err, "Failed to write replay payload.")
+		}
 	}
-	err = ioutil.WriteFile(gopath.Join(out, "payload.bin"), payloadBytes, 0644)
 
 	ar := archive.New(gopath.Join(out, "resources"))
 	defer ar.Dispose()
@@ -170,3 +181,18 @@ func exportReplay(ctx context.Context, c *path.Capture, d *path.Device, out stri
 
 	return nil
 }
+
+// writeMappedPayload writes payload to the file at path in the format that
+// gapir maps into memory.
+func writeMappedPayload(path string, payload *gapir.Payload) (err error) {
+	f, err := os.Create(path)
+	if err != nil {
+		return err
+	}
+	defer func() {
+		if cerr := f.Close(); err == nil {
+			err = cerr
+		}
+	}()
+	return gapir.WriteMappedPayload(f, payload)
+}
@@ -61,6 +61,9 @@ import (
 
 	// Register all the apis
 	_ "github.com/google/gapid/gapis/api/all"
+
+	// Decode compressed textures natively
+	_ "github.com/google/gapid/core/image/compressed"
 )
 
 const (
@@ -16,14 +16,18 @@
 
 #include "third_party/glslang/SPIRV/GlslangToSpv.h"
 #include "third_party/glslang/SPIRV/disassemble.h"
+#include "third_party/glslang/SPIRV/doc.h"
 #include "third_party/glslang/glslang/Public/ShaderLang.h"
 
 #include "libmanager.h"
+#include "shader_cache.h"
 #include "spirv2glsl.h"
 #include "spv_manager.h"
+#include "worker_pool.h"
 
 #include <cstring>
 #include <iostream>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -131,6 +135,19 @@ void set_error_msg(code_with_debug_info_t* x, std::string msg) {
   strcpy(x->message, msg.c_str());
 }
 
+// initializeProcess sets up the process-wide state of glslang, once. The
+// compiler initialization is fairly expensive, so it is kept initialized
+// indefinitely. Everything else used by the conversions lives on the stack
+// of the converting thread.
+void initializeProcess() {
+  static std::once_flag once;
+  std::call_once(once, [] {
+    glslang::InitializeProcess();
+    // The SPIR-V disassembler fills its tables lazily without a lock.
+    spv::Parameterize();
+  });
+}
+
 std::vector<unsigned int> parseGlslang(const char* code, const char* preamble,
                                        std::string* err_msg,
                                        shader_type shader_ty,
@@ -209,7 +226,7 @@ std::vector<unsigned int> parseGlslang(const char* code, const char* preamble,
     }
   }
 
-  glslang::InitializeProcess();
+  initializeProcess();
   glslang::TShader shader(lang);
   shader.setPreamble(preamble);
   shader.setStrings(&code, 1);
@@ -248,9 +265,6 @@ std::vector<unsigned int> parseGlslang(const char* code, const char* preamble,
     glslang::GlslangToSpv(*program.getIntermediate(lang), spirv);
   }
 
-  // The compiler initialization is fairly expensive, so keep it initialized
-  // indefinitely. glslang::FinalizeProcess();
-
   // Hack the SPIR-V to add a version to the header
   if (spirv.size() >= 2) {
     spirv[1] = glslang::EShTargetSpv_1_0;
@@ -266,8 +280,8 @@ std::vector<unsigned int> parseGlslang(const char* code, const char* preamble,
  * 3. Decompiles changed spirv to source code using spirv-cross,
  * 4. Check, if changed source code correctly compiles.
  **/
-code_with_debug_info_t* convertGlsl(const char* input, size_t length,
-                                    const convert_options_t* options) {
+code_with_debug_info_t* convertGlslUncached(const char* input, size_t length,
+                                            const convert_options_t* options) {
   code_with_debug_info_t* result = new code_with_debug_info_t{};
   std::string err_msg;
 
@@ -282,26 +296,7 @@ code_with_debug_info_t* convertGlsl(const char* input, size_t length,
 
   // makes changes
   spvmanager::SpvManager my_manager(spirv);
-  if (options->prefix_names) {
-    if (options->names_prefix) {
-      my_manager.mapDeclarationNames(options->names_prefix);
-    } else {
-      my_manager.mapDeclarationNames();
-    }
-  }
-  if (options->add_outputs_for_inputs) {
-    if (options->output_prefix) {
-      my_manager.addOutputForInputs(options->output_prefix);
-    } else {
-      my_manager.addOutputForInputs();
-    }
-  }
-  if (options->make_debuggable) {
-    my_manager.makeSpvDebuggable();
-  }
-  my_manager.renameViewIndex();
-  my_manager.removeLayoutLocations();
-  my_manager.initLocals();
+  my_manager.runPasses(my_manager.passes(options));
 
   std::vector<unsigned int> spirv_new = my_manager.getSpvBinary();
 
@@ -354,12 +349,42 @@ code_with_debug_info_t* convertGlsl(const char* input, size_t length,
   return result;
 }
 
+/**
+ * Returns the result of convertGlslUncached, from the shader cache if it
+ * holds it.
+ **/
+code_with_debug_info_t* convertGlsl(const char* input, size_t length,
+                                    const convert_options_t* options) {
+  using shadercache::ShaderCache;
+  auto& cache = ShaderCache::get();
+  auto key = ShaderCache::convertKey(input, length, options);
+  std::string cached;
+  if (cache.lookup(key, &cached)) {
+    code_with_debug_info_t* result = new code_with_debug_info_t{};
+    if (ShaderCache::decode(cached, result)) {
+      return result;
+    }
+    deleteGlslCodeWithDebug(result);
+  }
+  code_with_debug_info_t* result = convertGlslUncached(input, length, options);
+  cache.store(key, ShaderCache::encode(result));
+  return result;
+}
+
+void convertGlslBatch(const char* const* inputs, const size_t* lengths,
+                      const convert_options_t* options, size_t count,
+                      code_with_debug_info_t** results) {
+  workerpool::WorkerPool::get().run(count, [&](size_t i) {
+    results[i] = convertGlsl(inputs[i], lengths[i], &options[i]);
+  });
+}
+
 /**
  * Releses memory allocated by SpvManager.
  * May needs update after changes.
  **/
 void deleteGlslCodeWithDebug(code_with_debug_info_t* debug) {
-  delete debug->message;
+  delete[] debug->message;
   delete[] debug->source_code;
   delete[] debug->disassembly_string;
 
@@ -435,8 +460,8 @@ const char* opcodeToString(uint32_t opcode) {
   return spvOpcodeString(static_cast<SpvOp>(opcode));
 }
 
-glsl_compile_result_t* compileGlsl(const char* code,
-                                   const compile_options_t* options) {
+glsl_compile_result_t* compileGlslUncached(const char* code,
+                                           const compile_options_t* options) {
   glsl_compile_result_t* result =
       new glsl_compile_result_t{true, nullptr, spirv_binary_t{nullptr, 0}};
 
@@ -459,6 +484,25 @@ glsl_compile_result_t* compileGlsl(const char* code,
   return result;
 }
 
+glsl_compile_result_t* compileGlsl(const char* code,
+                                   const compile_options_t* options) {
+  using shadercache::ShaderCache;
+  auto& cache = ShaderCache::get();
+  auto key = ShaderCache::compileKey(code, options);
+  std::string cached;
+  if (cache.lookup(key, &cached)) {
+    glsl_compile_result_t* result =
+        new glsl_compile_result_t{true, nullptr, spirv_binary_t{nullptr, 0}};
+    if (ShaderCache::decode(cached, result)) {
+      return result;
+    }
+    deleteCompileResult(result);
+  }
+  glsl_compile_result_t* result = compileGlslUncached(code, options);
+  cache.store(key, ShaderCache::encode(result));
+  return result;
+}
+
 void deleteCompileResult(glsl_compile_result_t* result) {
   if (result) {
     delete[] result->message;
@@ -466,3 +510,15 @@ void deleteCompileResult(glsl_compile_result_t* result) {
   }
   delete result;
 }
+
+void setShaderCacheDir(const char* dir) {
+  shadercache::ShaderCache::get().setDirectory(dir);
+}
+
+void getShaderCacheStats(shader_cache_stats_t* stats) {
+  shadercache::ShaderCache::get().stats(stats);
+}
+
+void clearShaderCacheMemory() {
+  shadercache::ShaderCache::get().clearMemory();
+}
@@ -96,9 +96,26 @@ typedef struct glsl_compile_result_t {
   spirv_binary_t binary;
 } glsl_compile_result_t;
 
+typedef struct shader_cache_stats_t {
+  uint64_t hits;    /* lookups found in memory */
+  uint64_t loads;   /* lookups found on disk */
+  uint64_t misses;  /* lookups not found */
+  uint64_t entries; /* results held in memory */
+} shader_cache_stats_t;
+
 code_with_debug_info_t* convertGlsl(const char*, size_t,
                                     const convert_options_t*);
 
+/**
+ * Converts the count shaders inputs[i] of lengths[i] bytes with options[i]
+ * in parallel, and assigns the result of each to results[i]. The results are
+ * the ones convertGlsl would return. convertGlsl and compileGlsl may also be
+ * called from several threads at once.
+ **/
+void convertGlslBatch(const char* const* inputs, const size_t* lengths,
+                      const convert_options_t* options, size_t count,
+                      code_with_debug_info_t** results);
+
 void deleteGlslCodeWithDebug(code_with_debug_info_t*);
 
 const char* getDisassembleText(uint32_t*, size_t);
@@ -115,6 +132,20 @@ glsl_compile_result_t* compileGlsl(const char* code, const compile_options_t*);
 
 void deleteCompileResult(glsl_compile_result_t*);
 
+/**
+ * The results of convertGlsl and compileGlsl are cached in memory. Once
+ * setShaderCacheDir is called with an existing directory, they are also
+ * stored in that directory, and the results stored there are reused.
+ **/
+void setShaderCacheDir(const char* dir);
+
+void getShaderCacheStats(shader_cache_stats_t*);
+
+/**
+ * Drops the results cached in memory, keeping the ones on disk.
+ **/
+void clearShaderCacheMemory();
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,299 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "shader_cache.h"
+
+#include <cstring>
+
+#ifndef GAPID_VERSION_AND_BUILD
+// The version is part of every key: without it, results of different
+// versions of the shader libraries would be mixed up on disk.
+#error GAPID_VERSION_AND_BUILD must be defined (see cc_copts())
+#endif
+
+namespace shadercache {
+namespace {
+
+// The version of the keys and of the encoding of the results. Increment it
+// when either changes.
+const uint32_t kCacheVersion = 1;
+
+// The maximum number of bytes of results held in memory. Results dropped from
+// memory are still found in the archive on disk.
+const size_t kMaxMemoryBytes = 64 << 20;
+
+// Writer appends values to a string of bytes.
+class Writer {
+ public:
+  void u8(uint8_t v) { data.push_back(static_cast<char>(v)); }
+  void u32(uint32_t v) { bytes(&v, sizeof(v)); }
+  void bytes(const void* p, size_t size) {
+    data.append(static_cast<const char*>(p), size);
+  }
+  // str writes the optional string s, distinguishing nullptr from "".
+  void str(const char* s) {
+    u8(s != nullptr);
+    if (s != nullptr) {
+      str(s, strlen(s));
+    }
+  }
+  void str(const char* s, size_t length) {
+    u32(length);
+    bytes(s, length);
+  }
+
+  std::string data;
+};
+
+// Reader reads the values written by a Writer. Reading past the end of the
+// data clears ok.
+class Reader {
+ public:
+  Reader(const std::string& data) : data(data), offset(0), ok(true) {}
+
+  uint8_t u8() {
+    uint8_t v = 0;
+    bytes(&v, sizeof(v));
+    return v;
+  }
+  uint32_t u32() {
+    uint32_t v = 0;
+    bytes(&v, sizeof(v));
+    return v;
+  }
+  void bytes(void* p, size_t size) {
+    if (!ok || size > data.size() - offset) {
+      ok = false;
+      return;
+    }
+    memcpy(p, data.data() + offset, size);
+    offset += size;
+  }
+  // str returns a new[] allocated copy of the string written by
+  // Writer::str(const char*).
+  char* str() {
+    if (!u8()) {
+      return nullptr;
+    }
+    auto length = u32();
+    if (!ok || length > data.size() - offset) {
+      ok = false;
+      return nullptr;
+    }
+    auto out = new char[length + 1];
+    bytes(out, length);
+    out[length] = '\0';
+    return out;
+  }
+
+  const std::string& data;
+  size_t offset;
+  bool ok;
+};
+
+Writer keyWriter(const char* kind) {
+  Writer w;
+  w.str(kind);
+  w.u32(kCacheVersion);
+  w.str(GAPID_VERSION_AND_BUILD);
+  return w;
+}
+
+}  // anonymous namespace
+
+ShaderCache& ShaderCache::get() {
+  static ShaderCache cache;
+  return cache;
+}
+
+core::Id ShaderCache::convertKey(const char* input, size_t length,
+                                 const convert_options_t* options) {
+  auto w = keyWriter("convertGlsl");
+  w.u32(options->shader_type);
+  w.str(options->preamble);
+  w.u8(options->prefix_names);
+  w.str(options->names_prefix);
+  w.u8(options->add_outputs_for_inputs);
+  w.str(options->output_prefix);
+  w.u8(options->make_debuggable);
+  w.u8(options->check_after_changes);
+  w.u8(options->disassemble);
+  w.u8(options->relaxed);
+  w.u8(options->strip_optimizations);
+  w.u32(options->target_glsl_version);
+  w.str(input, length);
+  return core::Id::Hash(w.data.data(), w.data.size());
+}
+
+core::Id ShaderCache::compileKey(const char* code,
+                                 const compile_options_t* options) {
+  auto w = keyWriter("compileGlsl");
+  w.u32(options->shader_type);
+  w.u32(options->client_type);
+  w.str(options->preamble);
+  w.str(code);
+  return core::Id::Hash(w.data.data(), w.data.size());
+}
+
+std::string ShaderCache::encode(const code_with_debug_info_t* result) {
+  Writer w;
+  w.u8(result->ok);
+  w.str(result->message);
+  w.str(result->source_code);
+  w.str(result->disassembly_string);
+  w.u8(result->info != nullptr);
+  if (result->info != nullptr) {
+    w.u32(result->info->insts_num);
+    for (uint32_t i = 0; i < result->info->insts_num; i++) {
+      const auto& inst = result->info->insts[i];
+      w.u32(inst.id);
+      w.u32(inst.opcode);
+      w.u32(inst.words_num);
+      w.bytes(inst.words, inst.words_num * sizeof(uint32_t));
+      w.str(inst.name);
+    }
+  }
+  return std::move(w.data);
+}
+
+std::string ShaderCache::encode(const glsl_compile_result_t* result) {
+  Writer w;
+  w.u8(result->ok);
+  w.str(result->message);
+  w.u32(result->binary.words_num);
+  w.bytes(result->binary.words, result->binary.words_num * sizeof(uint32_t));
+  return std::move(w.data);
+}
+
+bool ShaderCache::decode(const std::string& data,
+                         code_with_debug_info_t* result) {
+  Reader r(data);
+  result->ok = r.u8();
+  result->message = r.str();
+  result->source_code = r.str();
+  result->disassembly_string = r.str();
+  if (r.u8()) {
+    auto count = r.u32();
+    // Each instruction takes at least 13 bytes.
+    if (!r.ok || count > data.size() / 13) {
+      return false;
+    }
+    result->info = new debug_instructions_t{new instruction_t[count](), count};
+    for (uint32_t i = 0; i < count && r.ok; i++) {
+      auto& inst = result->info->insts[i];
+      inst.id = r.u32();
+      inst.opcode = r.u32();
+      auto words = r.u32();
+      if (!r.ok || words > (data.size() - r.offset) / sizeof(uint32_t)) {
+        return false;
+      }
+      inst.words = new uint32_t[words];
+      inst.words_num = words;
+      r.bytes(inst.words, words * sizeof(uint32_t));
+      inst.name = r.str();
+    }
+  }
+  return r.ok && r.offset == data.size();
+}
+
+bool ShaderCache::decode(const std::string& data,
+                         glsl_compile_result_t* result) {
+  Reader r(data);
+  result->ok = r.u8();
+  result->message = r.str();
+  auto words = r.u32();
+  if (!r.ok || words > (data.size() - r.offset) / sizeof(uint32_t)) {
+    return false;
+  }
+  if (words > 0) {
+    result->binary.words = new uint32_t[words];
+    result->binary.words_num = words;
+    r.bytes(result->binary.words, words * sizeof(uint32_t));
+  }
+  return r.ok && r.offset == data.size();
+}
+
+void ShaderCache::setDirectory(const std::string& dir) {
+  std::string path = dir;
+  if (!path.empty() && path.back() != '/' && path.back() != '\\') {
+    path.push_back('/');
+  }
+  std::lock_guard<std::mutex> lock(mMutex);
+  mArchive.reset(new core::Archive(path + "shaders"));
+}
+
+bool ShaderCache::lookup(const core::Id& key, std::string* data) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto it = mIndex.find(key);
+  if (it != mIndex.end()) {
+    mStats.hits++;
+    mEntries.splice(mEntries.begin(), mEntries, it->second);
+    *data = it->second->second;
+    return true;
+  }
+  if (mArchive) {
+    auto name = key.string();
+    auto size = mArchive->size(name);
+    if (size > 0) {
+      data->resize(size);
+      if (mArchive->read(name, &data->front(), size)) {
+        mStats.loads++;
+        insert(key, *data);
+        return true;
+      }
+    }
+  }
+  mStats.misses++;
+  return false;
+}
+
+void ShaderCache::store(const core::Id& key, const std::string& data) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  insert(key, data);
+  if (mArchive) {
+    mArchive->write(key.string(), data.data(), data.size());
+  }
+}
+
+void ShaderCache::clearMemory() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  mEntries.clear();
+  mIndex.clear();
+  mBytes = 0;
+}
+
+void ShaderCache::insert(const core::Id& key, const std::string& data) {
+  if (mIndex.count(key) > 0 || data.size() > kMaxMemoryBytes) {
+    return;
+  }
+  while (mBytes + data.size() > kMaxMemoryBytes) {
+    auto& last = mEntries.back();
+    mBytes -= last.second.size();
+    mIndex.erase(last.first);
+    mEntries.pop_back();
+  }
+  mEntries.emplace_front(key, data);
+  mIndex.emplace(key, mEntries.begin());
+  mBytes += data.size();
+}
+
+void ShaderCache::stats(shader_cache_stats_t* out) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  *out = mStats;
+  out->entries = mEntries.size();
+}
+
+}  // namespace shadercache
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SHADER_CACHE_H_
+#define SHADER_CACHE_H_
+
+#include "libmanager.h"
+
+#include "core/cc/archive.h"
+#include "core/cc/id.h"
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace shadercache {
+
+// ShaderCache holds the results of convertGlsl() and compileGlsl(), keyed by
+// the hash of their source, options and the library version. The most
+// recently used results are held in memory, up to a byte budget, and, once
+// setDirectory() is called, all the results are stored in an archive on disk
+// so that they outlive the process.
+class ShaderCache {
+ public:
+  // get returns the process-wide cache.
+  static ShaderCache& get();
+
+  // convertKey returns the key of the convertGlsl() result for the given
+  // arguments.
+  static core::Id convertKey(const char* input, size_t length,
+                             const convert_options_t* options);
+
+  // compileKey returns the key of the compileGlsl() result for the given
+  // arguments.
+  static core::Id compileKey(const char* code,
+                             const compile_options_t* options);
+
+  // The results are encoded as strings of bytes.
+  static std::string encode(const code_with_debug_info_t* result);
+  static std::string encode(const glsl_compile_result_t* result);
+  static bool decode(const std::string& data, code_with_debug_info_t* result);
+  static bool decode(const std::string& data, glsl_compile_result_t* result);
+
+  // setDirectory stores the cache in the existing directory dir, and loads the
+  // results stored there.
+  void setDirectory(const std::string& dir);
+
+  // lookup returns true and assigns the result keyed by key to data if the
+  // cache holds it.
+  bool lookup(const core::Id& key, std::string* data);
+
+  // store adds the result data keyed by key to the cache.
+  void store(const core::Id& key, const std::string& data);
+
+  // clearMemory drops the results held in memory. The results on disk are
+  // kept.
+  void clearMemory();
+
+  void stats(shader_cache_stats_t* out);
+
+ private:
+  // The results held in memory, most recently used first.
+  typedef std::list<std::pair<core::Id, std::string>> Entries;
+
+  ShaderCache() = default;
+
+  // insert adds the result data keyed by key to the results held in memory,
+  // dropping the least recently used results over the byte budget. mMutex
+  // must be held.
+  void insert(const core::Id& key, const std::string& data);
+
+  std::mutex mMutex;
+  Entries mEntries;
+  std::unordered_map<core::Id, Entries::iterator> mIndex;
+  size_t mBytes = 0;  // size of the data of mEntries.
+  std::unique_ptr<core::Archive> mArchive;
+  shader_cache_stats_t mStats = {};
+};
+
+}  // namespace shadercache
+
+#endif  // SHADER_CACHE_H_
@@ -16,6 +16,9 @@
 
 #include "spv_manager.h"
 #include <assert.h>
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
 
 namespace spvmanager {
 
@@ -38,9 +41,10 @@ namespace spvmanager {
  *print after each 'store' inst.
  **/
 void SpvManager::makeSpvDebuggable() {
-  declareDebugVariables();
-  declarePrints();
-  insertPrintCallsIntoFunctions();
+  declareDebugPrints();
+  for (auto& function : *context->module()) {
+    insertPrintCallsIntoFunction(function);
+  }
 }
 
 /**
@@ -119,52 +123,9 @@ void SpvManager::renameViewIndex() {
 // For example, "v.x = 42.0;" becomes "v = vec4(42.0, v.y, v.z, v.w);"
 void SpvManager::initLocals() {
   for (auto& function : *context->module()) {
-    std::map<Instruction*, std::unique_ptr<Instruction>> replacement;
-    std::unordered_set<Instruction*> seen;
-    function.ForEachInst([this, &seen, &replacement](Instruction* inst) {
-      if (inst->opcode() == SpvOpLoad || inst->opcode() == SpvOpStore) {
-        Instruction* var = def_use_mgr->GetDef(inst->GetSingleWordInOperand(0));
-        if (seen.insert(var).second) {
-          if (inst->opcode() == SpvOpLoad && var->opcode() == SpvOpVariable &&
-              (var->GetSingleWordInOperand(0) == spv::StorageClassFunction ||
-               var->GetSingleWordInOperand(0) == spv::StorageClassPrivate) &&
-              var->NumInOperands() == 1 /* No initializer */) {
-            // We have found Load before Store to a local variable (function
-            // scope)
-            auto* vecType = getPointeeIfPointer(var->type_id())->AsVector();
-            if (vecType && vecType->element_count() == 4) {
-              // TODO: Handle more then just vec4 types, or fix the issue in
-              // SPIRV-Cross
-              uint32_t elem_type_id = TypeToId(vecType->element_type());
-              uint32_t elem_id = addConstant(elem_type_id, {0});
-              uint32_t init_value_id = getUnique();
-              context->AddGlobalValue(makeInstruction(
-                  SpvOpConstantComposite, TypeToId(vecType), init_value_id,
-                  {{elem_id, elem_id, elem_id, elem_id}}));
-              replacement[var] = makeInstruction(
-                  var->opcode(), var->type_id(), var->result_id(),
-                  {{var->GetSingleWordInOperand(0)}, {init_value_id}});
-            }
-          }
-        }
-      }
-    });
-    for (auto& basic_block : function) {
-      for (auto it = basic_block.begin(); it != basic_block.end(); ++it) {
-        std::unique_ptr<Instruction> newInst(std::move(replacement[&*it]));
-        if (newInst != nullptr) {
-          it = it.Erase().InsertBefore(std::move(newInst));
-        }
-      }
-    }
-    for (auto it = context->types_values_begin();
-         it != context->types_values_end(); ++it) {
-      std::unique_ptr<Instruction> newInst(std::move(replacement[&*it]));
-      if (newInst != nullptr) {
-        it = it.Erase().InsertBefore(std::move(newInst));
-      }
-    }
+    findUninitializedLocals(function);
   }
+  initializeLocals();
 }
 
 // Remove all layout(location = ...) qualifiers.
@@ -181,6 +142,104 @@ void SpvManager::removeLayoutLocations() {
   }
 }
 
+std::vector<Pass> SpvManager::passes(const convert_options_t* options) {
+  std::vector<Pass> out;
+  if (options->prefix_names) {
+    const char* prefix = options->names_prefix;
+    out.push_back({"mapDeclarationNames", [this, prefix] {
+                     if (prefix) {
+                       mapDeclarationNames(prefix);
+                     } else {
+                       mapDeclarationNames();
+                     }
+                   }});
+  }
+  if (options->add_outputs_for_inputs) {
+    const char* prefix = options->output_prefix;
+    out.push_back({"addOutputForInputs", [this, prefix] {
+                     if (prefix) {
+                       addOutputForInputs(prefix);
+                     } else {
+                       addOutputForInputs();
+                     }
+                   }});
+  }
+  if (options->make_debuggable) {
+    out.push_back({"makeSpvDebuggable", [this] { declareDebugPrints(); },
+                   [this](Function& f) { insertPrintCallsIntoFunction(f); }});
+  }
+  out.push_back({"renameViewIndex", nullptr, nullptr,
+                 [this] { renameViewIndex(); }});
+  out.push_back({"removeLayoutLocations", nullptr, nullptr,
+                 [this] { removeLayoutLocations(); }});
+  out.push_back({"initLocals", nullptr,
+                 [this](Function& f) { findUninitializedLocals(f); },
+                 [this] { initializeLocals(); }});
+  return out;
+}
+
+namespace {
+
+template <typename T>
+int64_t countInstructions(T& node) {
+  int64_t count = 0;
+  node.ForEachInst([&count](Instruction*) { count++; });
+  return count;
+}
+
+}  // anonymous namespace
+
+void SpvManager::runPasses(const std::vector<Pass>& passes,
+                           std::vector<PassStats>* stats) {
+  std::vector<PassStats> costs;
+  for (auto& pass : passes) {
+    costs.push_back(PassStats{pass.name, 0, 0});
+  }
+
+  // run calls step of the pass at index i, adding its cost to costs[i].
+  // count returns the number of instructions step may change.
+  auto run = [&](size_t i, const std::function<void()>& step,
+                 const std::function<int64_t()>& count) {
+    if (stats == nullptr) {
+      step();
+      return;
+    }
+    int64_t before = count();
+    auto start = std::chrono::steady_clock::now();
+    step();
+    auto end = std::chrono::steady_clock::now();
+    costs[i].nanoseconds +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+            .count();
+    costs[i].instructions += count() - before;
+  };
+  auto countModule = [this] { return countInstructions(*context->module()); };
+
+  for (size_t i = 0; i < passes.size(); i++) {
+    if (passes[i].prepare) {
+      run(i, passes[i].prepare, countModule);
+    }
+  }
+  for (auto& function : *context->module()) {
+    for (size_t i = 0; i < passes.size(); i++) {
+      if (passes[i].visit) {
+        auto& visit = passes[i].visit;
+        run(i, [&] { visit(function); },
+            [&] { return countInstructions(function); });
+      }
+    }
+  }
+  for (size_t i = 0; i < passes.size(); i++) {
+    if (passes[i].finish) {
+      run(i, passes[i].finish, countModule);
+    }
+  }
+
+  if (stats != nullptr) {
+    stats->insert(stats->end(), costs.begin(), costs.end());
+  }
+}
+
 /**
  * Return binary currently handled by module
  **/
@@ -705,19 +764,25 @@ void SpvManager::setStepVariable() {
 }
 
 /**
- * Traverses function blocks to insert print function calls.
+ * Declares the debug variables and print functions, and collects the
+ *instructions setting 'curr_step'. Those are added to the first block
+ *visited by insertPrintCallsIntoFunction, the one of the main function.
  **/
-void SpvManager::insertPrintCallsIntoFunctions() {
-  // main function is first, add insts to the first block
+void SpvManager::declareDebugPrints() {
+  declareDebugVariables();
+  declarePrints();
   setStepVariable();
+}
 
-  for (Module::iterator it = context->module()->begin();
-       it != context->module()->end(); it++) {
-    if (isDebugFunction(*it)) continue;
+/**
+ * Traverses function blocks to insert print function calls.
+ **/
+void SpvManager::insertPrintCallsIntoFunction(Function& function) {
+  if (isDebugFunction(function)) return;
 
-    for (Function::iterator fun_it = it->begin(); fun_it != it->end(); fun_it++)
-      insertPrintCallsIntoBlock(*fun_it);
-  }
+  for (Function::iterator fun_it = function.begin(); fun_it != function.end();
+       fun_it++)
+    insertPrintCallsIntoBlock(*fun_it);
 }
 
 void SpvManager::moveCollectedBlockInsts(BasicBlock::iterator& it) {
@@ -802,6 +867,79 @@ uint32_t SpvManager::insertPrintDeclaration(uint32_t type_id) {
   return 0;
 }
 
+/**
+ * Records the function and private vec4 variables of the function that are
+ *loaded before being stored to, for initializeLocals to initialize.
+ **/
+void SpvManager::findUninitializedLocals(Function& function) {
+  std::unordered_set<Instruction*> seen;
+  function.ForEachInst([this, &seen](Instruction* inst) {
+    if (inst->opcode() == SpvOpLoad || inst->opcode() == SpvOpStore) {
+      Instruction* var = def_use_mgr->GetDef(inst->GetSingleWordInOperand(0));
+      if (seen.insert(var).second) {
+        if (inst->opcode() == SpvOpLoad && var->opcode() == SpvOpVariable &&
+            (var->GetSingleWordInOperand(0) == spv::StorageClassFunction ||
+             var->GetSingleWordInOperand(0) == spv::StorageClassPrivate) &&
+            var->NumInOperands() == 1 /* No initializer */) {
+          // We have found Load before Store to a local variable (function
+          // scope)
+          auto* vecType = getPointeeIfPointer(var->type_id())->AsVector();
+          // TODO: Handle more then just vec4 types, or fix the issue in
+          // SPIRV-Cross
+          if (vecType && vecType->element_count() == 4 &&
+              std::find(uninitialized_locals.begin(),
+                        uninitialized_locals.end(),
+                        var) == uninitialized_locals.end()) {
+            uninitialized_locals.push_back(var);
+          }
+        }
+      }
+    }
+  });
+}
+
+/**
+ * Replaces the variables found by findUninitializedLocals with variables
+ *initialized to zero.
+ **/
+void SpvManager::initializeLocals() {
+  std::unordered_map<Instruction*, std::unique_ptr<Instruction>> replacement;
+  for (Instruction* var : uninitialized_locals) {
+    auto* vecType = getPointeeIfPointer(var->type_id())->AsVector();
+    uint32_t elem_type_id = TypeToId(vecType->element_type());
+    uint32_t elem_id = addConstant(elem_type_id, {0});
+    uint32_t init_value_id = getUnique();
+    context->AddGlobalValue(makeInstruction(
+        SpvOpConstantComposite, TypeToId(vecType), init_value_id,
+        {{elem_id, elem_id, elem_id, elem_id}}));
+    replacement[var] = makeInstruction(
+        var->opcode(), var->type_id(), var->result_id(),
+        {{var->GetSingleWordInOperand(0)}, {init_value_id}});
+  }
+  uninitialized_locals.clear();
+  if (replacement.empty()) {
+    return;
+  }
+
+  for (auto& function : *context->module()) {
+    for (auto& basic_block : function) {
+      for (auto it = basic_block.begin(); it != basic_block.end(); ++it) {
+        auto found = replacement.find(&*it);
+        if (found != replacement.end()) {
+          it = it.Erase().InsertBefore(std::move(found->second));
+        }
+      }
+    }
+  }
+  for (auto it = context->types_values_begin();
+       it != context->types_values_end(); ++it) {
+    auto found = replacement.find(&*it);
+    if (found != replacement.end()) {
+      it = it.Erase().InsertBefore(std::move(found->second));
+    }
+  }
+}
+
 uint32_t SpvManager::getVariableTypeId(uint32_t var_id) {
   Instruction* var_inst = def_use_mgr->GetDef(var_id);
   uint32_t type_id = var_inst->type_id();
@@ -38,6 +38,7 @@
 
 #include <stdint.h>
 #include <cstring>
+#include <functional>
 #include <iostream>
 #include <map>
 #include <set>
@@ -61,6 +62,23 @@ using spvtools::opt::analysis::TypeManager;
 typedef std::map<uint32_t, uint32_t> map_uint;
 typedef std::pair<uint32_t, uint32_t> name_type;
 
+// Pass is a transform of the module run by SpvManager::runPasses, in up to
+// three steps: prepare changes the module, visit changes a function of the
+// module, and finish changes the module once every function was visited.
+struct Pass {
+  std::string name;
+  std::function<void()> prepare;
+  std::function<void(Function&)> visit;
+  std::function<void()> finish;
+};
+
+// PassStats is the cost of a pass run by SpvManager::runPasses.
+struct PassStats {
+  std::string name;
+  uint64_t nanoseconds;  // Wall time spent in the pass.
+  int64_t instructions;  // Instructions added to the module by the pass.
+};
+
 class SpvManager {
  public:
   SpvManager(const std::vector<uint32_t>& spv_binary) {
@@ -95,6 +113,21 @@ class SpvManager {
   void removeLayoutLocations();
   void initLocals();
   void makeSpvDebuggable();
+
+  // passes returns the passes convertGlsl applies for options, in the order
+  // of the calls above they stand for. The passes refer to the strings of
+  // options.
+  std::vector<Pass> passes(const convert_options_t* options);
+
+  // runPasses runs the prepare step of each pass, then visits each function
+  // once with every pass, then runs the finish step of each pass, each in
+  // the order of passes. This is equivalent to running the passes one after
+  // the other as long as no pass prepares changes that depend on the visits
+  // or the finish of the passes before it. If stats is not null, the cost of
+  // each pass is appended to it.
+  void runPasses(const std::vector<Pass>& passes,
+                 std::vector<PassStats>* stats = nullptr);
+
   std::vector<unsigned int> getSpvBinary();
   debug_instructions_t* getDebugInstructions();
 
@@ -128,6 +161,8 @@ class SpvManager {
   std::vector<std::unique_ptr<Instruction>> curr_block_insts;
   map_uint typeid_to_printid;
   map_uint consts;
+  // local variables read before being written, in order of discovery
+  std::vector<Instruction*> uninitialized_locals;
 
   std::vector<spvtools::ir::Operand> makeOperands(
       spv_opcode_desc&, std::initializer_list<std::initializer_list<uint32_t>>&,
@@ -164,11 +199,15 @@ class SpvManager {
   void declareDebugVariables();
   void declarePrints();
   void setStepVariable();
-  void insertPrintCallsIntoFunctions();
+  void declareDebugPrints();
+  void insertPrintCallsIntoFunction(Function&);
   void moveCollectedBlockInsts(BasicBlock::iterator&);
   void insertPrintCallsIntoBlock(BasicBlock&);
   uint32_t insertPrintDeclaration(uint32_t);
 
+  void findUninitializedLocals(Function&);
+  void initializeLocals();
+
   uint32_t getVariableTypeId(uint32_t);
   uint32_t getTypeToConvert(const Type*);
   uint32_t getArrayLength(const Type*);
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "spv_manager.h"
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+#include <vector>
+
+namespace spvmanager {
+namespace test {
+
+const char* kExample = "gapis/shadertools/cc/spirv_example.spv";
+
+std::vector<uint32_t> readSpirv(const char* filename) {
+  std::vector<uint32_t> words;
+  if (FILE* fp = fopen(filename, "rb")) {
+    uint32_t buf[1024];
+    while (size_t len = fread(buf, sizeof(uint32_t), 1024, fp)) {
+      words.insert(words.end(), buf, buf + len);
+    }
+    fclose(fp);
+  }
+  return words;
+}
+
+// runInOrder applies the transforms of options the way convertGlsl did before
+// the passes, one after the other.
+std::vector<uint32_t> runInOrder(const std::vector<uint32_t>& spirv,
+                                 const convert_options_t& options) {
+  SpvManager manager(spirv);
+  if (options.prefix_names) {
+    manager.mapDeclarationNames(options.names_prefix);
+  }
+  if (options.add_outputs_for_inputs) {
+    manager.addOutputForInputs(options.output_prefix);
+  }
+  if (options.make_debuggable) {
+    manager.makeSpvDebuggable();
+  }
+  manager.renameViewIndex();
+  manager.removeLayoutLocations();
+  manager.initLocals();
+  return manager.getSpvBinary();
+}
+
+std::vector<uint32_t> runPasses(const std::vector<uint32_t>& spirv,
+                                const convert_options_t& options,
+                                std::vector<PassStats>* stats) {
+  SpvManager manager(spirv);
+  manager.runPasses(manager.passes(&options), stats);
+  return manager.getSpvBinary();
+}
+
+convert_options_t options(bool names, bool outputs, bool debuggable) {
+  convert_options_t o{};
+  o.shader_type = FRAGMENT;
+  o.prefix_names = names;
+  o.names_prefix = "x";
+  o.add_outputs_for_inputs = outputs;
+  o.output_prefix = "_out";
+  o.make_debuggable = debuggable;
+  return o;
+}
+
+TEST(SpvManagerTest, PassesMatchCallsInOrder) {
+  auto spirv = readSpirv(kExample);
+  ASSERT_FALSE(spirv.empty());
+
+  for (int i = 0; i < 8; i++) {
+    auto o = options(i & 1, i & 2, i & 4);
+    auto expected = runInOrder(spirv, o);
+    EXPECT_EQ(expected, runPasses(spirv, o, nullptr)) << "options " << i;
+    // Recording the stats does not change the result.
+    std::vector<PassStats> stats;
+    EXPECT_EQ(expected, runPasses(spirv, o, &stats)) << "options " << i;
+  }
+}
+
+TEST(SpvManagerTest, PassStats) {
+  auto spirv = readSpirv(kExample);
+  ASSERT_FALSE(spirv.empty());
+
+  std::vector<PassStats> stats;
+  runPasses(spirv, options(true, true, true), &stats);
+
+  std::vector<std::string> names;
+  for (auto& s : stats) {
+    names.push_back(s.name);
+  }
+  EXPECT_EQ(std::vector<std::string>({"mapDeclarationNames",
+                                      "addOutputForInputs", "makeSpvDebuggable",
+                                      "renameViewIndex", "removeLayoutLocations",
+                                      "initLocals"}),
+            names);
+
+  // Renaming and removing decorations add no instructions, the others do.
+  EXPECT_EQ(0, stats[0].instructions);
+  EXPECT_LT(0, stats[1].instructions);
+  EXPECT_LT(0, stats[2].instructions);
+  EXPECT_EQ(0, stats[3].instructions);
+  EXPECT_EQ(0, stats[4].instructions);
+  EXPECT_LT(0, stats[5].instructions);
+  EXPECT_LT(0u, stats[2].nanoseconds);
+}
+
+}  // namespace test
+}  // namespace spvmanager
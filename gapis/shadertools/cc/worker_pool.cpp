@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "worker_pool.h"
+
+#include <algorithm>
+
+namespace workerpool {
+
+WorkerPool& WorkerPool::get() {
+  // The calling thread of a batch works too.
+  static WorkerPool pool(
+      std::max<size_t>(std::thread::hardware_concurrency(), 1) - 1);
+  return pool;
+}
+
+WorkerPool::WorkerPool(size_t workers)
+    : mJob(nullptr), mCount(0), mBatch(0), mActive(0), mStop(false), mNext(0) {
+  for (size_t i = 0; i < workers; i++) {
+    mWorkers.emplace_back([this] { work(); });
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStop = true;
+  }
+  mWake.notify_all();
+  for (auto& worker : mWorkers) {
+    worker.join();
+  }
+}
+
+void WorkerPool::run(size_t count, const Job& job) {
+  std::lock_guard<std::mutex> batch(mBatchMutex);
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mJob = &job;
+    mCount = count;
+    mNext = 0;
+    mBatch++;
+    mActive++;
+  }
+  mWake.notify_all();
+
+  drain(job, count);
+
+  std::unique_lock<std::mutex> lock(mMutex);
+  mActive--;
+  mDone.wait(lock, [this] { return mActive == 0; });
+  // Workers woken after this point find no batch to drain.
+  mJob = nullptr;
+}
+
+void WorkerPool::work() {
+  uint64_t seen = 0;
+  std::unique_lock<std::mutex> lock(mMutex);
+  for (;;) {
+    mWake.wait(lock, [&] { return mStop || mBatch != seen; });
+    if (mStop) {
+      return;
+    }
+    seen = mBatch;
+    if (mJob == nullptr) {
+      continue;
+    }
+    auto job = mJob;
+    auto count = mCount;
+    mActive++;
+    lock.unlock();
+
+    drain(*job, count);
+
+    lock.lock();
+    if (--mActive == 0) {
+      mDone.notify_all();
+    }
+  }
+}
+
+void WorkerPool::drain(const Job& job, size_t count) {
+  for (size_t i = mNext++; i < count; i = mNext++) {
+    job(i);
+  }
+}
+
+}  // namespace workerpool
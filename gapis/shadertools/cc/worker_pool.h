@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2018 Google Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WORKER_POOL_H_
+#define WORKER_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace workerpool {
+
+// WorkerPool runs batches of jobs on a set of threads that live as long as
+// the process, so that the per-thread state of glslang is set up once per
+// thread rather than once per batch.
+class WorkerPool {
+ public:
+  typedef std::function<void(size_t)> Job;
+
+  // get returns the process-wide pool, with a worker per hardware thread.
+  static WorkerPool& get();
+
+  ~WorkerPool();
+
+  // run calls job(i) for each i in [0, count), on the workers and on the
+  // calling thread, and returns once all the calls have returned. Batches
+  // from different threads run one after the other.
+  void run(size_t count, const Job& job);
+
+ private:
+  WorkerPool(size_t workers);
+
+  // work is the loop of a worker thread.
+  void work();
+
+  // drain calls job for the indices of the current batch until there are
+  // none left.
+  void drain(const Job& job, size_t count);
+
+  std::mutex mBatchMutex;  // Held for the duration of a batch.
+  std::mutex mMutex;       // Guards the fields below.
+  std::condition_variable mWake;
+  std::condition_variable mDone;
+  const Job* mJob;
+  size_t mCount;
+  uint64_t mBatch;  // The number of batches started.
+  uint32_t mActive;  // The number of threads draining the batch.
+  bool mStop;
+  std::atomic<size_t> mNext;
+  std::vector<std::thread> mWorkers;
+};
+
+}  // namespace workerpool
+
+#endif  // WORKER_POOL_H_
@@ -23,17 +23,15 @@ import "C"
 import (
 	"bytes"
 	"fmt"
+	"os"
 	"sort"
 	"strings"
-	"sync"
 	"unsafe"
 
 	"github.com/google/gapid/core/fault"
 	"github.com/google/gapid/core/text"
 )
 
-var mutex sync.Mutex
-
 // Instruction represents a SPIR-V instruction.
 type Instruction struct {
 	ID     uint32   // Result identifer.
@@ -147,6 +145,7 @@ type ConvertOptions struct {
 // o and returns the modification status and result. Possible modifications
 // includes creating output variables for input variables, prefixing all
 // non-builtin symbols with a given prefix, etc.
+// ConvertGlsl and CompileGlsl may be called from several goroutines at once.
 func ConvertGlsl(source string, o *ConvertOptions) (CodeWithDebugInfo, error) {
 	toFree := []unsafe.Pointer{}
 	defer func() {
@@ -155,8 +154,42 @@ func ConvertGlsl(source string, o *ConvertOptions) (CodeWithDebugInfo, error) {
 		}
 	}()
 
-	mutex.Lock()
-	defer mutex.Unlock()
+	cstr := func(s string) *C.char {
+		out := C.CString(s)
+		toFree = append(toFree, unsafe.Pointer(out))
+		return out
+	}
+
+	opts := o.toC(cstr)
+	result := C.convertGlsl(cstr(source), C.size_t(len(source)), &opts)
+	defer C.deleteGlslCodeWithDebug(result)
+
+	return convertResult(result, source, o)
+}
+
+// ConvertGlslBatch converts each of the sources with the options of the same
+// index, as ConvertGlsl would, on several threads. It returns the result and
+// the error of each source. Every source fails if o does not hold one options
+// per source.
+func ConvertGlslBatch(sources []string, o []*ConvertOptions) ([]CodeWithDebugInfo, []error) {
+	count := len(sources)
+	if len(o) != count {
+		errs := make([]error, count)
+		for i := range errs {
+			errs[i] = fmt.Errorf("ConvertGlslBatch given %d sources but %d options", count, len(o))
+		}
+		return make([]CodeWithDebugInfo, count), errs
+	}
+	if count == 0 {
+		return nil, nil
+	}
+
+	toFree := []unsafe.Pointer{}
+	defer func() {
+		for _, ptr := range toFree {
+			C.free(ptr)
+		}
+	}()
 
 	cstr := func(s string) *C.char {
 		out := C.CString(s)
@@ -164,7 +197,29 @@ func ConvertGlsl(source string, o *ConvertOptions) (CodeWithDebugInfo, error) {
 		return out
 	}
 
-	opts := C.struct_convert_options_t{
+	inputs := make([]*C.char, count)
+	lengths := make([]C.size_t, count)
+	opts := make([]C.struct_convert_options_t, count)
+	results := make([]*C.code_with_debug_info_t, count)
+	for i, source := range sources {
+		inputs[i] = cstr(source)
+		lengths[i] = C.size_t(len(source))
+		opts[i] = o[i].toC(cstr)
+	}
+	C.convertGlslBatch(&inputs[0], &lengths[0], &opts[0], C.size_t(count), &results[0])
+
+	rets := make([]CodeWithDebugInfo, count)
+	errs := make([]error, count)
+	for i, result := range results {
+		rets[i], errs[i] = convertResult(result, sources[i], o[i])
+		C.deleteGlslCodeWithDebug(result)
+	}
+	return rets, errs
+}
+
+// toC returns the C options for o, allocating its strings with cstr.
+func (o *ConvertOptions) toC(cstr func(string) *C.char) C.struct_convert_options_t {
+	return C.struct_convert_options_t{
 		shader_type:            C.shader_type(o.ShaderType),
 		preamble:               cstr(o.Preamble),
 		prefix_names:           C.bool(o.PrefixNames),
@@ -178,9 +233,11 @@ func ConvertGlsl(source string, o *ConvertOptions) (CodeWithDebugInfo, error) {
 		strip_optimizations:    C.bool(o.StripOptimizations),
 		target_glsl_version:    C.int(o.TargetGLSLVersion),
 	}
-	result := C.convertGlsl(cstr(source), C.size_t(len(source)), &opts)
-	defer C.deleteGlslCodeWithDebug(result)
+}
 
+// convertResult returns the CodeWithDebugInfo and the error of the result of
+// converting source with the options o.
+func convertResult(result *C.code_with_debug_info_t, source string, o *ConvertOptions) (CodeWithDebugInfo, error) {
 	ret := CodeWithDebugInfo{
 		SourceCode:        C.GoString(result.source_code),
 		DisassemblyString: C.GoString(result.disassembly_string),
@@ -278,8 +335,6 @@ func CompileGlsl(source string, o CompileOptions) ([]uint32, error) {
 			C.free(ptr)
 		}
 	}()
-	mutex.Lock()
-	defer mutex.Unlock()
 
 	cstr := func(s string) *C.char {
 		out := C.CString(s)
@@ -317,6 +372,47 @@ func CompileGlsl(source string, o CompileOptions) ([]uint32, error) {
 	return words, fault.Const(strings.Join(msg, "\n"))
 }
 
+// CacheStats holds the statistics of the cache of ConvertGlsl and CompileGlsl
+// results.
+type CacheStats struct {
+	Hits    uint64 // Lookups found in memory.
+	Loads   uint64 // Lookups found on disk.
+	Misses  uint64 // Lookups not found, which translated the shader.
+	Entries uint64 // Results held in memory.
+}
+
+// SetCacheDir stores the results of ConvertGlsl and CompileGlsl in the
+// directory dir, creating it if needed. The results stored there by earlier
+// processes are reused.
+func SetCacheDir(dir string) error {
+	if err := os.MkdirAll(dir, 0755); err != nil {
+		return err
+	}
+	cdir := C.CString(dir)
+	defer C.free(unsafe.Pointer(cdir))
+	C.setShaderCacheDir(cdir)
+	return nil
+}
+
+// GetCacheStats returns the statistics of the cache of ConvertGlsl and
+// CompileGlsl results.
+func GetCacheStats() CacheStats {
+	stats := C.shader_cache_stats_t{}
+	C.getShaderCacheStats(&stats)
+	return CacheStats{
+		Hits:    uint64(stats.hits),
+		Loads:   uint64(stats.loads),
+		Misses:  uint64(stats.misses),
+		Entries: uint64(stats.entries),
+	}
+}
+
+// ClearCacheMemory drops the results of ConvertGlsl and CompileGlsl cached in
+// memory. The results stored in the cache directory are kept.
+func ClearCacheMemory() {
+	C.clearShaderCacheMemory()
+}
+
 type DescriptorSets map[uint32]DescriptorSet
 type DescriptorSet []DescriptorBinding
 
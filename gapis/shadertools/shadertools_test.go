@@ -15,6 +15,10 @@
 package shadertools_test
 
 import (
+	"fmt"
+	"io/ioutil"
+	"os"
+	"sync"
 	"testing"
 
 	"github.com/google/gapid/core/assert"
@@ -89,6 +93,119 @@ void main()
 	}
 }
 
+func TestConvertGlslCache(t *testing.T) {
+	ctx := log.Testing(t)
+	dir, err := ioutil.TempDir("", "shadertools")
+	if !assert.For(ctx, "err").ThatError(err).Succeeded() {
+		return
+	}
+	defer os.RemoveAll(dir)
+	assert.For(ctx, "err").ThatError(shadertools.SetCacheDir(dir)).Succeeded()
+
+	opts := shadertools.ConvertOptions{
+		ShaderType:        shadertools.TypeFragment,
+		MakeDebuggable:    true,
+		CheckAfterChanges: true,
+	}
+	src := `#version 310 es
+precision highp float;
+out vec4 color;
+void main() { color = vec4(0.25, 0.5, 0.75, 1.); }`
+
+	start := shadertools.GetCacheStats()
+	cold, err := shadertools.ConvertGlsl(src, &opts)
+	if !assert.For(ctx, "err").ThatError(err).Succeeded() {
+		return
+	}
+	for i := 0; i < 10; i++ {
+		warm, err := shadertools.ConvertGlsl(src, &opts)
+		assert.For(ctx, "err").ThatError(err).Succeeded()
+		assert.For(ctx, "warm").That(warm).DeepEquals(cold)
+	}
+	warm := shadertools.GetCacheStats()
+	assert.For(ctx, "misses").That(warm.Misses - start.Misses).Equals(uint64(1))
+	assert.For(ctx, "hits").That(warm.Hits - start.Hits).Equals(uint64(10))
+
+	// Other options are another conversion.
+	opts.MakeDebuggable = false
+	_, err = shadertools.ConvertGlsl(src, &opts)
+	assert.For(ctx, "err").ThatError(err).Succeeded()
+	assert.For(ctx, "misses").That(shadertools.GetCacheStats().Misses - start.Misses).Equals(uint64(2))
+	opts.MakeDebuggable = true
+
+	// The results stored in the cache directory are loaded once dropped from
+	// memory.
+	shadertools.ClearCacheMemory()
+	loaded, err := shadertools.ConvertGlsl(src, &opts)
+	assert.For(ctx, "err").ThatError(err).Succeeded()
+	assert.For(ctx, "loaded").That(loaded).DeepEquals(cold)
+	assert.For(ctx, "loads").That(shadertools.GetCacheStats().Loads - start.Loads).Equals(uint64(1))
+}
+
+func TestConvertGlslConcurrent(t *testing.T) {
+	ctx := log.Testing(t)
+	opts := shadertools.ConvertOptions{
+		ShaderType:        shadertools.TypeFragment,
+		MakeDebuggable:    true,
+		CheckAfterChanges: true,
+		Disassemble:       true,
+	}
+	const count = 64
+	// Each pass appends its own comment so that it misses the results cached
+	// by the others, while translating to the same code.
+	source := func(i int, pass string) string {
+		return fmt.Sprintf(`#version 310 es
+precision highp float;
+uniform vec4 u%d;
+out vec4 color;
+void main() { color = u%d * vec4(%d.0); }
+// %s`, i, i, i, pass)
+	}
+
+	serial := make([]shadertools.CodeWithDebugInfo, count)
+	for i := range serial {
+		res, err := shadertools.ConvertGlsl(source(i, "serial"), &opts)
+		if !assert.For(ctx, "err").ThatError(err).Succeeded() {
+			return
+		}
+		serial[i] = res
+	}
+
+	concurrent := make([]shadertools.CodeWithDebugInfo, count)
+	errs := make([]error, count)
+	wg := sync.WaitGroup{}
+	for i := range concurrent {
+		wg.Add(1)
+		go func(i int) {
+			defer wg.Done()
+			concurrent[i], errs[i] = shadertools.ConvertGlsl(source(i, "goroutine"), &opts)
+		}(i)
+	}
+	wg.Wait()
+	for i := range concurrent {
+		assert.For(ctx, "err").ThatError(errs[i]).Succeeded()
+		assert.For(ctx, "concurrent").That(concurrent[i]).DeepEquals(serial[i])
+	}
+
+	sources := make([]string, count)
+	batchOpts := make([]*shadertools.ConvertOptions, count)
+	for i := range sources {
+		sources[i], batchOpts[i] = source(i, "batch"), &opts
+	}
+	batch, errs := shadertools.ConvertGlslBatch(sources, batchOpts)
+	for i := range batch {
+		assert.For(ctx, "err").ThatError(errs[i]).Succeeded()
+		assert.For(ctx, "batch").That(batch[i]).DeepEquals(serial[i])
+	}
+
+	// Each source needs its options.
+	batch, errs = shadertools.ConvertGlslBatch(sources, batchOpts[1:])
+	assert.For(ctx, "batch").That(len(batch)).Equals(count)
+	for i := range errs {
+		assert.For(ctx, "err").ThatError(errs[i]).Failed()
+	}
+}
+
 func TestCompileGlsl(t *testing.T) {
 	for _, test := range []struct {
 		desc     string
@@ -230,6 +230,12 @@ func (t *DesktopTracer) SetupTrace(ctx context.Context, o *service.TraceOptions)
 		panic(err)
 		return nil, nil, err
 	}
-	process := &gapii.Process{Port: boundPort, Device: t.b, Options: tracer.GapiiOptions(o)}
+	options := tracer.GapiiOptions(o)
+	if isLocal, err := t.b.IsLocal(ctx); err == nil && isLocal && runtime.GOOS == "linux" {
+		// The application runs on this machine, so the capture can be read
+		// from shared memory rather than the socket.
+		options.Flags |= gapii.SharedMemory
+	}
+	process := &gapii.Process{Port: boundPort, Device: t.b, Options: options}
 	return process, cleanup, nil
 }
@@ -103,6 +103,9 @@ func GapiiOptions(o *service.TraceOptions) gapii.Options {
 	if o.RecordTraceTimes {
 		flags |= gapii.StoreTimestamps
 	}
+	if o.InternStrings {
+		flags |= gapii.InternStrings
+	}
 
 	return gapii.Options{
 		o.ObserveFrameFrequency,